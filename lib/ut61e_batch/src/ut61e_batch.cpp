@@ -0,0 +1,133 @@
+/*
+ * ut61e_batch.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_batch.h"
+#include "ut61e_protocol.h"
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#define UT61E_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// One vector block's worth of results, before the scalar finish
+struct ut61e_batch_block {
+    int32_t digits[32];
+    uint16_t flags[32];
+    uint8_t valid[32];
+    uint8_t function[32];   // Function code with VAHZ applied
+    uint8_t range[32];
+    uint8_t status[32];
+    uint8_t option4[32];
+};
+
+// ES51922 function table entry for every byte value, null if unknown
+static const ut61e_function_t *const *function_table() {
+    static const ut61e_function_t *table[256];
+    static bool ready = [] {
+        uint8_t count;
+        const ut61e_function_t *functions = ES51922::functions(count);
+        for (uint8_t i = 0; i < count; i++)
+            table[functions[i].code] = &functions[i];
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+static void store_row(const ut61e_batch_columns &out, size_t i, const ut61e_reading_t &r, bool valid) {
+    if (out.digits)
+        out.digits[i] = r.digits;
+    if (out.values)
+        out.values[i] = ut61e_reading_value(r);
+    if (out.exponents)
+        out.exponents[i] = r.exponent;
+    if (out.modes)
+        out.modes[i] = r.mode;
+    if (out.ranges)
+        out.ranges[i] = r.range;
+    if (out.flags)
+        out.flags[i] = r.flags;
+    if (out.valid)
+        out.valid[i] = valid;
+}
+
+// Mode and exponent for a decoded block, then into the columns from base
+static size_t finish_block(const ut61e_batch_block &b, size_t count, size_t base, const ut61e_batch_columns &out) {
+    const ut61e_function_t *const *functions = function_table();
+    size_t good = 0;
+    for (size_t k = 0; k < count; k++) {
+        ut61e_reading_t r;
+        const ut61e_function_t *function = functions[b.function[k]];
+        ES51922::apply_function(function, b.range[k], b.status[k], b.option4[k], r);
+        r.digits = b.digits[k];
+        r.flags = b.flags[k];
+        bool valid = b.valid[k] && function;
+        store_row(out, base + k, r, valid);
+        good += valid;
+    }
+    return good;
+}
+
+#ifdef UT61E_BATCH_X86
+namespace ut61e_batch_sse2 {
+#define UT61E_BATCH_WIDTH 128
+#include "ut61e_batch_kernel.h"
+#undef UT61E_BATCH_WIDTH
+}
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+namespace ut61e_batch_avx2 {
+#define UT61E_BATCH_WIDTH 256
+#include "ut61e_batch_kernel.h"
+#undef UT61E_BATCH_WIDTH
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+ut61e_batch_isa_t ut61e_batch_best_isa() {
+#ifdef UT61E_BATCH_X86
+    static const ut61e_batch_isa_t best = __builtin_cpu_supports("avx2") ? UT61E_BATCH_AVX2 : UT61E_BATCH_SSE2;
+    return best;
+#else
+    return UT61E_BATCH_SCALAR;
+#endif
+}
+
+const char *ut61e_batch_isa_name(ut61e_batch_isa_t isa) {
+    static const char *const names[UT61E_BATCH_ISA_COUNT] = {"scalar", "sse2", "avx2"};
+    return isa < UT61E_BATCH_ISA_COUNT ? names[isa] : "?";
+}
+
+size_t ut61e_decode_batch(const uint8_t *packets, size_t n, const ut61e_batch_columns &out, ut61e_batch_isa_t isa) {
+    if (isa > ut61e_batch_best_isa())
+        isa = ut61e_batch_best_isa();
+    size_t i = 0, good = 0;
+#ifdef UT61E_BATCH_X86
+    if (isa == UT61E_BATCH_AVX2)
+        i = ut61e_batch_avx2::decode(packets, n, out, good);
+    else if (isa == UT61E_BATCH_SSE2)
+        i = ut61e_batch_sse2::decode(packets, n, out, good);
+#endif
+    // The rest (or everything) a packet at a time
+    for (; i < n; i++) {
+        ut61e_reading_t r;
+        bool valid = ES51922::decode(packets + 12 * i, r);
+        store_row(out, i, r, valid);
+        good += valid;
+    }
+    return good;
+}
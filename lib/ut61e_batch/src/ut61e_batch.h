@@ -0,0 +1,51 @@
+/*
+ * ut61e_batch.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Batch decoding of UT61E packets for offline analysis on the host: an
+ * array of 12 byte packets (packet_u_t) in, one column per field out.
+ * On x86 the fixed-bit check, digits and flags are worked out 16 or 32
+ * packets at a time with SSE2 or AVX2; everywhere else, and for the last
+ * few packets, ES51922::decode() does it one at a time. Both give identical
+ * columns.
+ */
+
+#include <cstdint>
+#include <cstddef>
+
+#ifndef UT61E_BATCH_H_
+#define UT61E_BATCH_H_
+
+enum ut61e_batch_isa_t : uint8_t {
+	UT61E_BATCH_SCALAR = 0,
+	UT61E_BATCH_SSE2,
+	UT61E_BATCH_AVX2,
+	UT61E_BATCH_ISA_COUNT
+};
+
+// Output columns, each with room for n entries. Any of them may be null to
+// skip it. Every packet's row is filled in, valid or not, exactly as
+// ES51922::decode() fills a ut61e_reading_t.
+struct ut61e_batch_columns {
+	int32_t *digits;      // Signed display digits, 0 under OL/UL
+	double *values;       // digits * 10^exponent, base units
+	int8_t *exponents;
+	uint8_t *modes;       // ut61e_mode_t
+	uint8_t *ranges;      // Range code 0-7
+	uint16_t *flags;      // UT61E_FLAG_*
+	uint8_t *valid;       // 0 = garbled packet or unknown function code
+};
+
+// Best instruction set this CPU supports
+ut61e_batch_isa_t ut61e_batch_best_isa();
+const char *ut61e_batch_isa_name(ut61e_batch_isa_t isa);
+
+// Decode n packets stored back to back. isa is clamped to what the CPU
+// supports. Returns the number of valid packets.
+size_t ut61e_decode_batch(const uint8_t *packets, size_t n, const ut61e_batch_columns &out,
+                          ut61e_batch_isa_t isa = ut61e_batch_best_isa());
+
+#endif /* UT61E_BATCH_H_ */
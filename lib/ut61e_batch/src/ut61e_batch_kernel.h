@@ -0,0 +1,165 @@
+/*
+ * ut61e_batch_kernel.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * The vector part of ut61e_decode_batch(), written once for both vector
+ * widths. ut61e_batch.cpp includes it twice, inside a namespace each time,
+ * with UT61E_BATCH_WIDTH set to 128 (SSE2) or 256 (AVX2), so no include
+ * guard.
+ *
+ * A block is 16 packets per 128 bit lane. Each packet is loaded as one
+ * 16 byte row and the rows are transposed so that vector c holds byte c of
+ * every packet; after that every test is the same few instructions for the
+ * whole block. AVX2 unpacks work within each lane, so its second lane is
+ * simply another 16 packets (the 16 after the first lane's).
+ */
+
+#if UT61E_BATCH_WIDTH == 256
+typedef __m256i V;
+static const size_t LANES = 2;
+static inline V load_row(const uint8_t *p, size_t i) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(p + 12 * i))),
+                                   _mm_loadu_si128((const __m128i *)(p + 12 * (i + 16))), 1);
+}
+// One 128 bit store per lane, lane_bytes apart
+static inline void store(void *dst, V v, size_t lane_bytes) {
+    _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(v));
+    _mm_storeu_si128((__m128i *)((uint8_t *)dst + lane_bytes), _mm256_extracti128_si256(v, 1));
+}
+static inline V vand(V a, V b) { return _mm256_and_si256(a, b); }
+static inline V vor(V a, V b) { return _mm256_or_si256(a, b); }
+static inline V vandnot(V a, V b) { return _mm256_andnot_si256(a, b); }
+static inline V vxor(V a, V b) { return _mm256_xor_si256(a, b); }
+static inline V zero() { return _mm256_setzero_si256(); }
+#define VOP(op) _mm256_##op
+#else
+typedef __m128i V;
+static const size_t LANES = 1;
+static inline V load_row(const uint8_t *p, size_t i) { return _mm_loadu_si128((const __m128i *)(p + 12 * i)); }
+static inline void store(void *dst, V v, size_t) { _mm_storeu_si128((__m128i *)dst, v); }
+static inline V vand(V a, V b) { return _mm_and_si128(a, b); }
+static inline V vor(V a, V b) { return _mm_or_si128(a, b); }
+static inline V vandnot(V a, V b) { return _mm_andnot_si128(a, b); }
+static inline V vxor(V a, V b) { return _mm_xor_si128(a, b); }
+static inline V zero() { return _mm_setzero_si128(); }
+#define VOP(op) _mm_##op
+#endif
+
+static const size_t BLOCK = 16 * LANES;
+
+static inline V set8(uint8_t x) { return VOP(set1_epi8)((char)x); }
+// 0xff where all the bits of mask are set
+static inline V bits(V c, uint8_t mask) { return VOP(cmpeq_epi8)(vand(c, set8(mask)), set8(mask)); }
+// Byte mask to 16 bit lanes for the first or second 8 packets of each lane
+static inline V widen16(V m, bool high) { return high ? VOP(unpackhi_epi8)(m, m) : VOP(unpacklo_epi8)(m, m); }
+
+// Decode one block at p into b. Reads 4 bytes past the last packet.
+static void decode_block(const uint8_t *p, ut61e_batch_block &b) {
+    V r[16], t[16], u[4][3], v[2][6], c[12];
+    for (size_t i = 0; i < 16; i++)
+        r[i] = load_row(p, i);
+    // 16x16 byte transpose, stopping once byte columns 0-11 are out
+    for (size_t i = 0; i < 16; i += 2) {
+        t[i] = VOP(unpacklo_epi8)(r[i], r[i + 1]);
+        t[i + 1] = VOP(unpackhi_epi8)(r[i], r[i + 1]);
+    }
+    for (size_t g = 0; g < 4; g++) {
+        u[g][0] = VOP(unpacklo_epi16)(t[4 * g], t[4 * g + 2]);
+        u[g][1] = VOP(unpackhi_epi16)(t[4 * g], t[4 * g + 2]);
+        u[g][2] = VOP(unpacklo_epi16)(t[4 * g + 1], t[4 * g + 3]);
+    }
+    for (size_t h = 0; h < 2; h++) {
+        for (size_t k = 0; k < 3; k++) {
+            v[h][2 * k] = VOP(unpacklo_epi32)(u[2 * h][k], u[2 * h + 1][k]);
+            v[h][2 * k + 1] = VOP(unpackhi_epi32)(u[2 * h][k], u[2 * h + 1][k]);
+        }
+    }
+    for (size_t m = 0; m < 6; m++) {
+        c[2 * m] = VOP(unpacklo_epi64)(v[0][m], v[1][m]);
+        c[2 * m + 1] = VOP(unpackhi_epi64)(v[0][m], v[1][m]);
+    }
+    const V &status = c[7], &option1 = c[8], &option2 = c[9], &option3 = c[10], &option4 = c[11];
+
+    // Fixed bits: every byte 0x30 | value
+    V sane = set8(0xff);
+    for (size_t i = 0; i < 12; i++)
+        sane = vand(sane, VOP(cmpeq_epi8)(vand(c[i], set8(0xf0)), set8(0x30)));
+
+    // Flags, low and high byte
+    V underload = bits(option2, 0x08);
+    V overload = vandnot(underload, bits(status, 0x01));
+    V peak_max = bits(option1, 0x08);
+    V current = vand(option3, set8(0x0c));
+    V low = vor(vor(vor(vand(bits(status, 0x04), set8(UT61E_FLAG_NEGATIVE)),
+                        vand(bits(option1, 0x02), set8(UT61E_FLAG_RELATIVE))),
+                    vor(vand(bits(option4, 0x02), set8(UT61E_FLAG_HOLD)),
+                        vand(bits(status, 0x02), set8(UT61E_FLAG_BATTERY_LOW)))),
+                vor(vor(vand(bits(option3, 0x02), set8(UT61E_FLAG_AUTO)),
+                        vand(overload, set8(UT61E_FLAG_OVERLOAD))),
+                    vor(vand(underload, set8(UT61E_FLAG_UNDERLOAD)),
+                        vand(peak_max, set8(UT61E_FLAG_PEAK_MAX)))));
+    V high = vor(vand(vandnot(peak_max, bits(option1, 0x04)), set8(UT61E_FLAG_PEAK_MIN >> 8)),
+                 vor(vand(VOP(cmpeq_epi8)(current, set8(0x04)), set8(UT61E_FLAG_AC >> 8)),
+                     vand(VOP(cmpeq_epi8)(current, set8(0x08)), set8(UT61E_FLAG_DC >> 8))));
+    store(b.flags, VOP(unpacklo_epi8)(low, high), 32);
+    store(b.flags + 8, VOP(unpackhi_epi8)(low, high), 32);
+
+    // Digits: bytes 0x30-0x39, anything else counts as 0 and is only
+    // allowed under OL/UL
+    V out_of_range = vor(underload, bits(status, 0x01));
+    V all_digits = set8(0xff), d[6];
+    for (size_t i = 1; i <= 5; i++) {
+        d[i] = VOP(sub_epi8)(c[i], set8(0x30));
+        V is_digit = VOP(cmpeq_epi8)(VOP(min_epu8)(d[i], set8(9)), d[i]);
+        d[i] = vand(d[i], is_digit);
+        all_digits = vand(all_digits, is_digit);
+    }
+    store(b.valid, vand(vand(sane, vor(all_digits, out_of_range)), set8(1)), 16);
+
+    V blank = vor(underload, overload), negative = bits(status, 0x04);
+    for (int half = 0; half < 2; half++) {
+        V w[6];
+        for (size_t i = 1; i <= 5; i++)
+            w[i] = half ? VOP(unpackhi_epi8)(d[i], zero()) : VOP(unpacklo_epi8)(d[i], zero());
+        // ((d1 * 10 + d2) * 100 + d3 * 10 + d4) fits 16 bits, then * 10 + d5 in 32
+        V x = VOP(add_epi16)(VOP(mullo_epi16)(VOP(add_epi16)(VOP(mullo_epi16)(w[1], VOP(set1_epi16)(10)), w[2]),
+                                              VOP(set1_epi16)(100)),
+                             VOP(add_epi16)(VOP(mullo_epi16)(w[3], VOP(set1_epi16)(10)), w[4]));
+        V blank16 = widen16(blank, half), negative16 = widen16(negative, half);
+        for (int quarter = 0; quarter < 2; quarter++) {
+            V pairs = quarter ? VOP(unpackhi_epi16)(x, w[5]) : VOP(unpacklo_epi16)(x, w[5]);
+            V value = VOP(madd_epi16)(pairs, VOP(set1_epi32)((1 << 16) | 10));
+            V blank32 = quarter ? VOP(unpackhi_epi16)(blank16, blank16) : VOP(unpacklo_epi16)(blank16, blank16);
+            V negative32 = quarter ? VOP(unpackhi_epi16)(negative16, negative16)
+                                   : VOP(unpacklo_epi16)(negative16, negative16);
+            value = vandnot(blank32, value);
+            value = VOP(sub_epi32)(vxor(value, negative32), negative32);
+            store(b.digits + 8 * half + 4 * quarter, value, 64);
+        }
+    }
+
+    // What the scalar finish needs for mode and exponent
+    V vahz = bits(option3, 0x01);
+    store(b.function, vor(vand(vahz, set8(0x32)), vandnot(vahz, c[6])), 16);
+    store(b.range, c[0], 16);
+    store(b.status, status, 16);
+    store(b.option4, option4, 16);
+}
+
+// Whole blocks from packets[0..n), leaving at least one packet after the
+// last block so its over-read stays inside the array. Returns the number
+// of packets done.
+static size_t decode(const uint8_t *packets, size_t n, const ut61e_batch_columns &out, size_t &good) {
+    ut61e_batch_block b;
+    size_t i = 0;
+    for (; i + BLOCK < n; i += BLOCK) {
+        decode_block(packets + 12 * i, b);
+        good += finish_block(b, BLOCK, i, out);
+    }
+    return i;
+}
+
+#undef VOP
@@ -0,0 +1,244 @@
+/*
+ * ut61e_codec.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_codec.h"
+#include <cstring>
+
+// Record kinds, low 2 bits of the control byte
+#define KIND_REPEAT     0
+#define KIND_VALUE      1
+#define KIND_FULL       2
+#define KIND_RUN        3
+#define SMALL_ESCAPE    63
+
+// FULL record field mask
+#define FIELD_EXPONENT  0x01
+#define FIELD_MODE      0x02
+#define FIELD_RANGE     0x04
+#define FIELD_FLAGS     0x08
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+UT61E_ENCODER::UT61E_ENCODER(uint8_t *b, size_t c) {
+    reset(b, c);
+}
+
+void UT61E_ENCODER::reset(uint8_t *b, size_t c) {
+    buffer = b;
+    capacity = c;
+    reset();
+}
+
+void UT61E_ENCODER::reset() {
+    length = 0;
+    count = 0;
+    run = 0;
+    previous_delta = 0;
+    memset(&previous, 0, sizeof(previous));
+}
+
+void UT61E_ENCODER::put_varint(uint64_t v) {
+    while (v >= 0x80) {
+        buffer[length++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    buffer[length++] = (uint8_t)v;
+}
+
+void UT61E_ENCODER::put_control(uint8_t kind, uint64_t small) {
+    if (small < SMALL_ESCAPE) {
+        buffer[length++] = (uint8_t)(kind | small << 2);
+    } else {
+        buffer[length++] = (uint8_t)(kind | SMALL_ESCAPE << 2);
+        put_varint(small - SMALL_ESCAPE);
+    }
+}
+
+void UT61E_ENCODER::flush() {
+    if (!run)
+        return;
+    // A run of one is cheaper as a plain repeat
+    if (run == 1)
+        put_control(KIND_REPEAT, 0);
+    else
+        put_control(KIND_RUN, run);
+    run = 0;
+}
+
+bool UT61E_ENCODER::add(const ut61e_reading_t &r) {
+    // Room for a pending run plus the worst case record
+    if (capacity - length < UT61E_CODEC_MAX_RECORD + 12)
+        return false;
+
+    int64_t delta = (int64_t)r.time_ms - (int64_t)previous.time_ms;
+    int64_t dod = delta - previous_delta;
+    bool same = count && ut61e_same_reading(r, previous);
+
+    if (same && dod == 0) {
+        run++;
+    } else {
+        flush();
+        uint64_t t = zigzag(dod);
+        if (same) {
+            put_control(KIND_REPEAT, t);
+        } else {
+            uint8_t mask = (r.exponent != previous.exponent ? FIELD_EXPONENT : 0)
+                | (r.mode != previous.mode ? FIELD_MODE : 0)
+                | (r.range != previous.range ? FIELD_RANGE : 0)
+                | (r.flags != previous.flags ? FIELD_FLAGS : 0);
+            if (!mask) {
+                put_control(KIND_VALUE, t);
+            } else {
+                put_control(KIND_FULL, t);
+                buffer[length++] = mask;
+                if (mask & FIELD_EXPONENT)
+                    buffer[length++] = (uint8_t)r.exponent;
+                if (mask & FIELD_MODE)
+                    buffer[length++] = r.mode;
+                if (mask & FIELD_RANGE)
+                    buffer[length++] = r.range;
+                if (mask & FIELD_FLAGS)
+                    put_varint(r.flags ^ previous.flags);
+            }
+            put_varint(zigzag((int64_t)r.digits - previous.digits));
+        }
+    }
+    previous = r;
+    previous_delta = delta;
+    count++;
+    return true;
+}
+
+UT61E_DECODER::UT61E_DECODER(const uint8_t *d, size_t l) {
+    reset(d, l);
+}
+
+void UT61E_DECODER::reset(const uint8_t *d, size_t l) {
+    data = d;
+    length = l;
+    position = 0;
+    run = 0;
+    error = false;
+    previous_delta = 0;
+    memset(&previous, 0, sizeof(previous));
+}
+
+bool UT61E_DECODER::get_varint(uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (position >= length)
+            return false;
+        uint8_t b = data[position++];
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool UT61E_DECODER::get_byte(uint8_t &b) {
+    if (position >= length)
+        return false;
+    b = data[position++];
+    return true;
+}
+
+bool UT61E_DECODER::get_small(uint8_t control, uint64_t &v) {
+    v = control >> 2;
+    if (v < SMALL_ESCAPE)
+        return true;
+    uint64_t extra;
+    if (!get_varint(extra))
+        return false;
+    v = SMALL_ESCAPE + extra;
+    return true;
+}
+
+void UT61E_DECODER::advance_time(int64_t dod) {
+    previous_delta += dod;
+    previous.time_ms = (uint32_t)(previous.time_ms + previous_delta);
+}
+
+bool UT61E_DECODER::next(ut61e_reading_t &r) {
+    if (run) {
+        run--;
+        advance_time(0);
+        r = previous;
+        return true;
+    }
+    if (position >= length)
+        return false;
+
+    uint8_t control = data[position++];
+    uint64_t small;
+    if (!get_small(control, small)) {
+        error = true;
+        return false;
+    }
+    uint8_t kind = control & 3;
+    if (kind == KIND_RUN) {
+        if (small == 0) {
+            error = true;
+            return false;
+        }
+        run = (uint32_t)small - 1;
+        advance_time(0);
+        r = previous;
+        return true;
+    }
+
+    advance_time(unzigzag(small));
+    if (kind == KIND_FULL) {
+        uint8_t mask, b;
+        uint64_t flags = 0;
+        if (!get_byte(mask)) {
+            error = true;
+            return false;
+        }
+        if (mask & FIELD_EXPONENT) {
+            if (!get_byte(b)) {
+                error = true;
+                return false;
+            }
+            previous.exponent = (int8_t)b;
+        }
+        if (mask & FIELD_MODE) {
+            if (!get_byte(previous.mode)) {
+                error = true;
+                return false;
+            }
+        }
+        if (mask & FIELD_RANGE) {
+            if (!get_byte(previous.range)) {
+                error = true;
+                return false;
+            }
+        }
+        if ((mask & FIELD_FLAGS) && !get_varint(flags)) {
+            error = true;
+            return false;
+        }
+        previous.flags ^= (uint16_t)flags;
+    }
+    if (kind == KIND_VALUE || kind == KIND_FULL) {
+        uint64_t digits;
+        if (!get_varint(digits)) {
+            error = true;
+            return false;
+        }
+        previous.digits = (int32_t)(previous.digits + unzigzag(digits));
+    }
+    r = previous;
+    return true;
+}
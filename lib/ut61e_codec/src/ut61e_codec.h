@@ -0,0 +1,93 @@
+/*
+ * ut61e_codec.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_reading.h"
+
+#ifndef UT61E_CODEC_H_
+#define UT61E_CODEC_H_
+
+// Streaming compression for sequences of ut61e_reading_t.
+//
+// Every record starts with a control byte: the low 2 bits are the record
+// kind, the upper 6 bits a small zig-zag number (63 = escape, a varint
+// follows). Timestamps are stored as the delta of the delta between
+// readings, so a meter sending at a steady rate costs 0 bits of time.
+//
+//   REPEAT  same reading as before         small = time delta-of-delta
+//   RUN     n repeats, each exactly on     small = n
+//           cadence (delta-of-delta 0)
+//   VALUE   only the digits changed        small = time delta-of-delta,
+//                                          then zig-zag varint digit delta
+//   FULL    mode/range/flags/exponent      small = time delta-of-delta,
+//           changed too                    then a mask of changed fields,
+//                                          the new fields, digit delta
+//
+// Mode, range and flags are only written when they change, so they are
+// effectively run-length encoded between FULL records. A stream starts from
+// an all-zero previous reading; reset() on both sides starts a new one.
+// Plain C++ so it runs the same on the ESP8266 and the host.
+
+#define UT61E_CODEC_MAX_RECORD  32   // Worst case bytes for one add()
+
+class UT61E_ENCODER {
+	public:
+		UT61E_ENCODER(uint8_t *buffer, size_t capacity);
+		~UT61E_ENCODER() { }
+
+		// Append a reading. Returns false, leaving the stream untouched, when
+		// the buffer can't be guaranteed to hold it.
+		bool add(const ut61e_reading_t &r);
+		// Write out any pending RUN. Call before using data()/size().
+		void flush();
+		// Start a new independent stream, optionally in a new buffer
+		void reset();
+		void reset(uint8_t *buffer, size_t capacity);
+
+		const uint8_t *data() const { return buffer; }
+		size_t size() const { return length; }
+		uint32_t count;    // Readings added since reset()
+	private:
+		uint8_t *buffer;
+		size_t capacity;
+		size_t length;
+		ut61e_reading_t previous;
+		int64_t previous_delta;
+		uint32_t run;      // Pending on-cadence repeats not yet written
+
+		void put_control(uint8_t kind, uint64_t small);
+		void put_varint(uint64_t v);
+};
+
+class UT61E_DECODER {
+	public:
+		UT61E_DECODER(const uint8_t *data, size_t length);
+		~UT61E_DECODER() { }
+
+		// Produce the next reading; false at the end of the data or on a
+		// corrupt stream (see error).
+		bool next(ut61e_reading_t &r);
+		void reset(const uint8_t *data, size_t length);
+
+		bool error;
+	private:
+		const uint8_t *data;
+		size_t length;
+		size_t position;
+		ut61e_reading_t previous;
+		int64_t previous_delta;
+		uint32_t run;
+
+		bool get_byte(uint8_t &b);
+		bool get_varint(uint64_t &v);
+		bool get_small(uint8_t control, uint64_t &v);
+		void advance_time(int64_t dod);
+};
+
+#endif /* UT61E_CODEC_H_ */
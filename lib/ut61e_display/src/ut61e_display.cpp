@@ -10,6 +10,7 @@
 #include "ut61e_display.h"
 #include <exception>
 #include <vector>
+#include <cstdio>
 #include <cstring>
 #include <math.h>
 
@@ -17,8 +18,8 @@ using std::unordered_map;
 using std::vector;
 
 // Constructors
-UT61E_DISP::UT61E_DISP() {serial = 0;};
-UT61E_DISP::UT61E_DISP(HardwareSerial &s):serial(&s) {};
+UT61E_DISP::UT61E_DISP() {serial = 0; reading = {};};
+UT61E_DISP::UT61E_DISP(HardwareSerial &s):serial(&s) {reading = {};};
 
 // Private Utility methods
 bit_map_t UT61E_DISP::get_bits(uint8_t b, status_map_t bitmap)
@@ -54,15 +55,59 @@ bit_map_t UT61E_DISP::get_bits(uint8_t b, status_map_t bitmap)
 // Wrapper to take chars as packet
 bool UT61E_DISP::parse(char const c[12], bool e){
     strncpy(packet.char_packet,c,12);
-    return _parse(e);
+    return decode(e);
 };
 
 // Wrapper to take chars as packet
 bool UT61E_DISP::parse(uint8_t const u[12], bool e){
     memcpy(packet.raw_packet,u,12);
-    return _parse(e);
+    return decode(e);
 };
 
+// While a reading is steady the meter repeats the same packet, so check the
+// last one before decoding. Bytes 1-5 are the digits; with everything else
+// unchanged the function, range and flags still hold.
+bool UT61E_DISP::decode(bool e){
+    if (!check()) {
+        check_failures++;
+        if (serial)
+            serial->println("(bad packet)");
+        return false;
+    }
+    if (memoise && memo_valid) {
+        if (memcmp(packet.raw_packet, memo_packet, 12) == 0) {
+            memo_hits++;
+            if (serial)
+                serial->println("(repeat)");
+            return memo_result;
+        }
+        if (packet.pb.d_range == memo_packet[0] && memcmp(packet.raw_packet + 6, memo_packet + 6, 6) == 0) {
+            memo_partial++;
+            decode_digits();
+            memcpy(memo_packet, packet.raw_packet, 12);
+            return memo_result;
+        }
+    }
+    memo_misses++;
+    memo_result = _parse(e);
+    memcpy(memo_packet, packet.raw_packet, 12);
+    memo_valid = true;
+    return memo_result;
+};
+
+bool UT61E_DISP::check() const {
+    for (int i = 0; i < 12; i++)
+        if ((packet.raw_packet[i] & 0xf0) != 0x30)
+            return false;
+    // OL/UL may show anything in the digits
+    if ((packet.pb.d_status & 0x01) || (packet.pb.d_option2 & 0x08))
+        return true;
+    for (int i = 1; i <= 5; i++)
+        if (packet.raw_packet[i] > 0x39)
+            return false;
+    return true;
+}
+
 // All the status and info bits
 // ut61e class to map data packet to display value and flags
 range_dict_map_t UT61E_DISP::RANGE_VOLTAGE = {
@@ -316,22 +361,34 @@ bool UT61E_DISP::_parse(bool extended_format = false){
     }
     options.merge(get_bits(packet.pb.d_option4, OPTION4));
 
-    Function_Dict dial_function = DIAL_FUNCTION[packet.pb.d_function];
-     
+    // Lookups with find(): operator[] would add every unknown code to the
+    // tables. Unknown codes decode as no function / no range, as before.
+    uint8_t function_code = packet.pb.d_function;
     // # When the rotary switch is set to 'voltage' or 'ampere' mode and then you 
     // # press the frequency button, the meter shows 'Hz' (or '%') but the
     // # function byte is still the same as before so we have to correct for that:
     if(options["VAHZ"])
-        dial_function = DIAL_FUNCTION[0b0110010];
+        function_code = 0b0110010;
+    auto function_entry = DIAL_FUNCTION.find(function_code);
+    static const Function_Dict no_function = {"", {}, ""};
+    const Function_Dict &dial_function =
+        function_entry != DIAL_FUNCTION.end() ? function_entry->second : no_function;
+    if (function_entry == DIAL_FUNCTION.end())
+        unknown_function++;
     mode = dial_function.function;
-    Range_Dict m_range = dial_function.subfunction[packet.pb.d_range];
+    auto range_entry = dial_function.subfunction.find(packet.pb.d_range);
+    Range_Dict m_range = {0, 0, ""};
+    if (range_entry != dial_function.subfunction.end())
+        m_range = range_entry->second;
     unit = dial_function.unit;
     if(mode == "frequency" and options["JUDGE"])
     {
         mode = "duty_cycle";
         unit = "%";
         m_range = {1e0, 1, "%"}; // 2200.0°C
-    };
+    }
+    else if (range_entry == dial_function.subfunction.end() && function_entry != DIAL_FUNCTION.end())
+        unknown_range++;
     if(options["AC"] and options["DC"])
         std::exception(); // ValueError
     else if (options["DC"])
@@ -398,47 +455,30 @@ bool UT61E_DISP::_parse(bool extended_format = false){
     else if (mode == "temperature" and not options["VBAR"])
         m_range = {1e0, 2, "deg"}; // 220.00°C and °F
 
-    int d4,d3,d2,d1,d0;
-    d4 = LCD_DIGITS[packet.pb.d_digit4];
-    d3 = LCD_DIGITS[packet.pb.d_digit3];
-    d2 = LCD_DIGITS[packet.pb.d_digit2];
-    d1 = LCD_DIGITS[packet.pb.d_digit1];
-    d0 = LCD_DIGITS[packet.pb.d_digit0];
-
-    vector<int> digit_array = {d0,d1,d2,d3,d4};
-
-    // char display_string[7];
-    // stringstream display_string;
-
-    sprintf(display_string,".%1d%1d%1d%1d%1d",d4,d3,d2,d1,d0);
-    for (size_t i = 0; i < (5 - m_range.dp_digit_position); i++)
-        {
-        display_string[i]=display_string[i+1];
-        display_string[i+1]='.';
-    }
-    
-    if(serial)
-    {
-        serial->printf("{dp_position : %d}",m_range.dp_digit_position);
-        serial->printf("{display_string : %s}",display_string);
-    }
-    display_value = 0;
-    for (int i = 0; i<5;i++)
-        display_value += digit_array[i]*pow(10,i);
-    if(options["SIGN"])
-    {
-        display_value = -display_value;
-        sign = true;
-    } else {
-        sign = false;
-    }
-    display_value = display_value / pow(10,m_range.dp_digit_position);
+    sign = options["SIGN"];
     display_unit = m_range.display_unit;
-    value = float(display_value) * m_range.value_multiplier;
-    
+    memo_dp_position = m_range.dp_digit_position;
+    memo_multiplier = m_range.value_multiplier;
+
+    // Compact form of the reading for storage and batching
+    reading.exponent = (int8_t)(m_range.value_multiplier > 0 ? lround(log10(m_range.value_multiplier)) : 0)
+        - m_range.dp_digit_position;
+    reading.mode = ut61e_mode_code(mode.c_str(), mode.size());
+    reading.range = packet.pb.d_range & 0x07;
+    reading.flags = (sign ? UT61E_FLAG_NEGATIVE : 0)
+        | (relative ? UT61E_FLAG_RELATIVE : 0)
+        | (hold ? UT61E_FLAG_HOLD : 0)
+        | (battery_low ? UT61E_FLAG_BATTERY_LOW : 0)
+        | (mrange == "auto" ? UT61E_FLAG_AUTO : 0)
+        | (operation == "overload" ? UT61E_FLAG_OVERLOAD : 0)
+        | (operation == "underload" ? UT61E_FLAG_UNDERLOAD : 0)
+        | (peak == "max" ? UT61E_FLAG_PEAK_MAX : 0)
+        | (peak == "min" ? UT61E_FLAG_PEAK_MIN : 0)
+        | (currentType == "AC" ? UT61E_FLAG_AC : 0)
+        | (currentType == "DC" ? UT61E_FLAG_DC : 0);
+
+    decode_digits();
     if(operation != "normal"){
-        display_value = 0;
-        value = 0;
     if(serial)
         serial->println(operation.c_str());
 
@@ -475,21 +515,65 @@ bool UT61E_DISP::_parse(bool extended_format = false){
     return true;
 };
 
+// Digit byte to value, 0 for anything that isn't one (the OL display)
+int UT61E_DISP::digit(uint8_t b){
+    auto d = LCD_DIGITS.find(b);
+    return d == LCD_DIGITS.end() ? 0 : d->second;
+}
+
+// The value and display string from the digit bytes, using the range, sign
+// and operation of the last full decode
+void UT61E_DISP::decode_digits(){
+    int d4,d3,d2,d1,d0;
+    d4 = digit(packet.pb.d_digit4);
+    d3 = digit(packet.pb.d_digit3);
+    d2 = digit(packet.pb.d_digit2);
+    d1 = digit(packet.pb.d_digit1);
+    d0 = digit(packet.pb.d_digit0);
+
+    int digit_array[5] = {d0,d1,d2,d3,d4};
+
+    sprintf(display_string,".%1d%1d%1d%1d%1d",d4,d3,d2,d1,d0);
+    for (size_t i = 0; i < (size_t)(5 - memo_dp_position); i++)
+        {
+        display_string[i]=display_string[i+1];
+        display_string[i+1]='.';
+    }
+    
+    if(serial)
+    {
+        serial->printf("{dp_position : %d}",memo_dp_position);
+        serial->printf("{display_string : %s}",display_string);
+    }
+    display_value = 0;
+    for (int i = 0; i<5;i++)
+        display_value += digit_array[i]*pow(10,i);
+    if(sign)
+        display_value = -display_value;
+    display_value = display_value / pow(10,memo_dp_position);
+    value = float(display_value) * memo_multiplier;
+    reading.digits = ((((d4 * 10 + d3) * 10 + d2) * 10 + d1) * 10 + d0) * (sign ? -1 : 1);
+
+    if(operation != "normal"){
+        display_value = 0;
+        value = 0;
+        reading.digits = 0;
+    }
+}
+
 const char *UT61E_DISP::get(){
-    results.clear();
-    results << 
-        "value:" << value <<
-        ",unit:" << unit << 
-        ",display_value:" << display_value <<
-        ",display_unit:" << display_unit <<
-        ",mode:" << mode <<
-        ",currentType:" << currentType <<
-        ",peak:" << peak <<
-        ",relative:" << relative <<
-        ",hold:" << hold <<
-        ",range:" << mrange <<
-        ",operation:" << operation <<
-        ",battery_low:" << battery_low;
- //   results_string = results.str();
-    return results.str().c_str();
-}
\ No newline at end of file
+    snprintf(results, sizeof(results),
+        "value:%g,unit:%s,display_value:%g,display_unit:%s,mode:%s,currentType:%s,peak:%s"
+        ",relative:%i,hold:%i,range:%s,operation:%s,battery_low:%i",
+        value, unit.c_str(), display_value, display_unit.c_str(), mode.c_str(),
+        currentType.c_str(), peak.c_str(), relative, hold, mrange.c_str(),
+        operation.c_str(), battery_low);
+    return results;
+}
+
+void UT61E_DISP::shown(ut61e_shown_t &s) const {
+    s.value = value;
+    s.display_value = display_value;
+    snprintf(s.display_string, sizeof(s.display_string), "%s", display_string);
+    snprintf(s.display_unit, sizeof(s.display_unit), "%s", display_unit.c_str());
+}
@@ -10,13 +10,12 @@
 #include <string>
 #include <unordered_map>
 #include <tuple>
-#include <sstream>
 #include <HardwareSerial.h> 
+#include "ut61e_reading.h"
 
 using std::unordered_map;
 using std::string;
 using std::tuple;
-using std::stringstream;
 
 #ifndef UT61E_DISP_H_
 #define UT61E_DISP_H_
@@ -67,8 +66,17 @@ class UT61E_DISP {
 	private:
 		packet_u_t packet;
 		bool _parse(bool);
+		bool decode(bool);
+		void decode_digits();
+		int digit(uint8_t b);
+		// Memo of the last packet decoded, see parse()
+		uint8_t memo_packet[12];
+		bool memo_valid {false};
+		bool memo_result {false};
+		int memo_dp_position {0};
+		float memo_multiplier {1};
 		bit_map_t get_bits(uint8_t b, status_map_t bitmap);
-		stringstream results;
+		char results[256];
 		void dump_map(bit_map_t m);
 		void print_byte(uint8_t byte);
 		HardwareSerial *serial {0};
@@ -119,14 +127,32 @@ class UT61E_DISP {
 			string operation; //string
 			bool battery_low; //bool
 			bool sign; //Negative sign
+			ut61e_reading_t reading; // Compact copy of the above, time_ms left for the caller
 
 			UT61E_DISP();
 			UT61E_DISP(HardwareSerial &s);
 			~UT61E_DISP() { }
 
+			void set_serial(HardwareSerial *s) { serial = s; } // Decoder dumps go here, 0 for none
+			// The last packet is remembered: an identical packet returns the
+			// cached decode (hit), one where only the digit bytes changed just
+			// recomputes the value and display string (partial), anything else
+			// is decoded in full (miss).
 			bool parse(char const *, bool);
 			bool parse(uint8_t const *, bool);
-			const char *get(); // Format results into a string stream then return its .str
+			void forget() { memo_valid = false; } // Next parse decodes in full
+			bool memoise {true};      // Set false to always decode in full
+			uint32_t memo_hits {0};
+			uint32_t memo_partial {0};
+			uint32_t memo_misses {0};
+			// Packet sanity: every byte 0x30 | value, digits 0-9 unless OL/UL.
+			// parse() rejects packets that fail it without decoding them.
+			bool check() const;
+			uint32_t check_failures {0};    // Packets check() rejected
+			uint32_t unknown_function {0};  // Function codes not in DIAL_FUNCTION
+			uint32_t unknown_range {0};     // Range codes the function doesn't have
+			const char *get(); // Format results into a member buffer and return it (valid until the next call)
+			void shown(ut61e_shown_t &s) const; // The display part of the last reading, for the serializers
 };
 
 #endif /* UT61E_DISP_H_ */
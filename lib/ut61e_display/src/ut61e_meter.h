@@ -0,0 +1,71 @@
+/*
+ * ut61e_meter.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * The meter the firmware reads, as one type per protocol policy
+ * (ut61e_protocol.h): its framer, and a decoder that gives both the reading
+ * and what the display showed. Any policy decodes with
+ * UT61E_PROTOCOL_DECODER; the UT61E (ES51922) keeps UT61E_DISP, whose
+ * strings the published JSON has always carried.
+ */
+
+#include <cstdint>
+#include <HardwareSerial.h>
+#include "ut61e_display.h"
+#include "ut61e_framer.h"
+#include "ut61e_protocol.h"
+
+#ifndef UT61E_METER_H_
+#define UT61E_METER_H_
+
+template <class Protocol>
+class UT61E_METER {
+	public:
+		typedef UT61E_FRAMER_T<Protocol> framer_t;
+		static const uint8_t PACKET_SIZE = Protocol::PACKET_SIZE;
+		static const uint8_t FRAME_SIZE = Protocol::FRAME_SIZE;
+
+		// False if the packet isn't valid, and then r and s mean nothing.
+		// r.time_ms is left as it was.
+		bool decode(const uint8_t *packet, ut61e_reading_t &r, ut61e_shown_t &s) {
+			bool good = decoder.decode(packet, r);
+			decoder.shown(r, s);
+			return good;
+		}
+		void set_serial(HardwareSerial *) { }   // Only UT61E_DISP dumps its decoding
+
+		uint32_t check_failures() const { return decoder.errors; }
+		uint32_t unknown_function() const { return 0; }   // Counted in check_failures
+		uint32_t unknown_range() const { return 0; }
+
+		UT61E_PROTOCOL_DECODER<Protocol> decoder;
+};
+
+template <>
+class UT61E_METER<ES51922> {
+	public:
+		typedef UT61E_FRAMER_T<ES51922> framer_t;
+		static const uint8_t PACKET_SIZE = ES51922::PACKET_SIZE;
+		static const uint8_t FRAME_SIZE = ES51922::FRAME_SIZE;
+
+		bool decode(const uint8_t *packet, ut61e_reading_t &r, ut61e_shown_t &s) {
+			bool good = dmm.parse(packet, false);
+			uint32_t time = r.time_ms;
+			r = dmm.reading;
+			r.time_ms = time;
+			dmm.shown(s);
+			return good;
+		}
+		void set_serial(HardwareSerial *s) { dmm.set_serial(s); }
+
+		uint32_t check_failures() const { return dmm.check_failures; }
+		uint32_t unknown_function() const { return dmm.unknown_function; }
+		uint32_t unknown_range() const { return dmm.unknown_range; }
+
+		UT61E_DISP dmm;
+};
+
+#endif /* UT61E_METER_H_ */
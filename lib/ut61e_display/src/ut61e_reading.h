@@ -0,0 +1,170 @@
+/*
+ * ut61e_reading.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Numeric codes for the reading schema published by the firmware
+ * (value, unit, display_value, mode, flags) and a compact fixed size record
+ * of one decoded reading. Plain C++ with no Arduino dependencies so the host
+ * tools can share it.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifndef UT61E_READING_H_
+#define UT61E_READING_H_
+
+// Function selector modes, as the "mode" field names them
+enum ut61e_mode_t : uint8_t {
+	UT61E_MODE_UNKNOWN = 0,
+	UT61E_MODE_VOLTAGE,
+	UT61E_MODE_CURRENT,
+	UT61E_MODE_RESISTANCE,
+	UT61E_MODE_CONTINUITY,
+	UT61E_MODE_DIODE,
+	UT61E_MODE_FREQUENCY,
+	UT61E_MODE_CAPACITANCE,
+	UT61E_MODE_TEMPERATURE,
+	UT61E_MODE_ADP,
+	UT61E_MODE_DUTY_CYCLE,
+	UT61E_MODE_COUNT
+};
+
+static const char *const UT61E_MODE_NAMES[UT61E_MODE_COUNT] = {
+	"", "voltage", "current", "resistance", "continuity", "diode",
+	"frequency", "capacitance", "temperature", "ADP", "duty_cycle"
+};
+
+// Base units, as the "unit" field names them
+enum ut61e_unit_t : uint8_t {
+	UT61E_UNIT_NONE = 0,
+	UT61E_UNIT_VOLT,
+	UT61E_UNIT_AMP,
+	UT61E_UNIT_OHM,
+	UT61E_UNIT_HERTZ,
+	UT61E_UNIT_FARAD,
+	UT61E_UNIT_DEGREE,
+	UT61E_UNIT_PERCENT,
+	UT61E_UNIT_COUNT
+};
+
+static const char *const UT61E_UNIT_NAMES[UT61E_UNIT_COUNT] = {
+	"", "V", "A", "Ω", "Hz", "F", "deg", "%"
+};
+
+// Everything else in a reading is a yes/no, packed into "flags"
+#define UT61E_FLAG_NEGATIVE     0x0001  // Minus sign on the display
+#define UT61E_FLAG_RELATIVE     0x0002  // REL mode
+#define UT61E_FLAG_HOLD         0x0004  // HOLD mode
+#define UT61E_FLAG_BATTERY_LOW  0x0008
+#define UT61E_FLAG_AUTO         0x0010  // Auto range (else manual)
+#define UT61E_FLAG_OVERLOAD     0x0020  // OL shown, value forced to 0
+#define UT61E_FLAG_UNDERLOAD    0x0040
+#define UT61E_FLAG_PEAK_MAX     0x0080
+#define UT61E_FLAG_PEAK_MIN     0x0100
+#define UT61E_FLAG_AC           0x0200
+#define UT61E_FLAG_DC           0x0400
+
+// One decoded reading in 16 bytes. The value in base units is
+// digits * 10^exponent, e.g. 1.2345 kΩ is {digits 12345, exponent -1}.
+// Overload/underload readings carry digits 0, like the JSON "value".
+struct ut61e_reading_t {
+	uint32_t time_ms;   // Capture time, millis() on the device
+	int32_t digits;     // Display digits as an integer, signed
+	int8_t exponent;    // Power of ten to get base units
+	uint8_t mode;       // ut61e_mode_t
+	uint8_t range;      // Range code from the packet (0-7)
+	uint8_t reserved;
+	uint16_t flags;     // UT61E_FLAG_*
+};
+
+// What the display showed, as UT61E_DISP decoded it. With a
+// ut61e_reading_t this is everything the serializers write, so a reading
+// can be written out again without its packet or a decoder.
+struct ut61e_shown_t {
+	float value;              // Base units, as the "value" field
+	float display_value;
+	char display_string[7];   // Digits and decimal point, no sign
+	char display_unit[5];     // With its prefix, UTF-8: "kΩ", "µF"
+};
+
+// Equal apart from the timestamp
+inline bool ut61e_same_reading(const ut61e_reading_t &a, const ut61e_reading_t &b) {
+	return a.digits == b.digits && a.exponent == b.exponent && a.mode == b.mode
+		&& a.range == b.range && a.flags == b.flags;
+}
+
+inline double ut61e_reading_value(const ut61e_reading_t &r) {
+	static const double powers[] = {1e-12, 1e-11, 1e-10, 1e-9, 1e-8, 1e-7, 1e-6, 1e-5, 1e-4, 1e-3,
+		1e-2, 1e-1, 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+	int e = r.exponent + 12;
+	return e >= 0 && e < (int)(sizeof(powers) / sizeof(powers[0])) ? r.digits * powers[e] : 0;
+}
+
+// Columns of the readings CSV that ut61e-decode and the history export write
+#define UT61E_READING_CSV_HEADER  "time_ms,value,unit,mode,range,flags\n"
+#define UT61E_VALUE_TEXT_MAX      24   // ut61e_format_value() output with its NUL
+
+// Exact decimal text of digits * 10^exponent, e.g. 12345, -4 -> "1.2345",
+// never rounded or in exponent notation. Zeros and decimals stop at 12,
+// past anything a meter shows. Writes a NUL and returns the length.
+inline size_t ut61e_format_value(char *out, int32_t digits, int8_t exponent) {
+	char *p = out;
+	uint32_t magnitude = digits < 0 ? -(uint32_t)digits : digits;
+	if (digits < 0)
+		*p++ = '-';
+	char text[10];   // Backwards
+	int n = 0;
+	do {
+		text[n++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+	int decimals = exponent < 0 ? (-exponent < 12 ? -exponent : 12) : 0;
+	if (n <= decimals) {
+		*p++ = '0';
+		*p++ = '.';
+		for (int i = n; i < decimals; i++)
+			*p++ = '0';
+	}
+	while (n) {
+		if (n == decimals && p[-1] != '.')
+			*p++ = '.';
+		*p++ = text[--n];
+	}
+	if (digits != 0)
+		for (int i = 0; i < exponent && i < 12; i++)
+			*p++ = '0';
+	*p = 0;
+	return p - out;
+}
+
+// Base unit of each mode
+inline ut61e_unit_t ut61e_mode_unit(uint8_t mode) {
+	static const ut61e_unit_t units[UT61E_MODE_COUNT] = {
+		UT61E_UNIT_NONE, UT61E_UNIT_VOLT, UT61E_UNIT_AMP, UT61E_UNIT_OHM, UT61E_UNIT_OHM,
+		UT61E_UNIT_VOLT, UT61E_UNIT_HERTZ, UT61E_UNIT_FARAD, UT61E_UNIT_DEGREE,
+		UT61E_UNIT_NONE, UT61E_UNIT_PERCENT
+	};
+	return mode < UT61E_MODE_COUNT ? units[mode] : UT61E_UNIT_NONE;
+}
+
+// Name lookups, returning the *_UNKNOWN/NONE code for anything unexpected
+inline ut61e_mode_t ut61e_mode_code(const char *name, size_t length) {
+	for (uint8_t i = 1; i < UT61E_MODE_COUNT; i++)
+		if (strlen(UT61E_MODE_NAMES[i]) == length && !memcmp(UT61E_MODE_NAMES[i], name, length))
+			return (ut61e_mode_t)i;
+	return UT61E_MODE_UNKNOWN;
+}
+
+inline ut61e_unit_t ut61e_unit_code(const char *name, size_t length) {
+	for (uint8_t i = 1; i < UT61E_UNIT_COUNT; i++)
+		if (strlen(UT61E_UNIT_NAMES[i]) == length && !memcmp(UT61E_UNIT_NAMES[i], name, length))
+			return (ut61e_unit_t)i;
+	return UT61E_UNIT_NONE;
+}
+
+#endif /* UT61E_READING_H_ */
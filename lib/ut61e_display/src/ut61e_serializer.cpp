@@ -0,0 +1,144 @@
+/*
+ * ut61e_serializer.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_serializer.h"
+#include <cstdarg>
+#include <cstdio>
+#include <math.h>
+
+// snprintf that keeps appending and remembers how much room it would have needed
+class bounded_writer {
+    public:
+        bounded_writer(char *b, size_t s):buffer(b),size(s),used(0) {
+            if (size)
+                buffer[0] = 0;
+        }
+        void add(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+            va_list args;
+            va_start(args, format);
+            size_t room = used < size ? size - used : 0;
+            int n = vsnprintf(room ? buffer + used : nullptr, room, format, args);
+            va_end(args);
+            if (n > 0)
+                used += n;
+        }
+        size_t length() const { return used; }
+    private:
+        char *buffer;
+        size_t size;
+        size_t used;
+};
+
+// The flags as the strings the formats have always used
+struct reading_text {
+    const char *mode;
+    const char *unit;
+    const char *current_type;
+    const char *peak;
+    const char *range;
+    const char *operation;
+    bool relative;
+    bool hold;
+    bool battery_low;
+    bool sign;
+
+    explicit reading_text(const ut61e_reading_t &r) {
+        mode = UT61E_MODE_NAMES[r.mode < UT61E_MODE_COUNT ? r.mode : 0];
+        unit = UT61E_UNIT_NAMES[ut61e_mode_unit(r.mode)];
+        current_type = r.flags & UT61E_FLAG_AC ? "AC" : r.flags & UT61E_FLAG_DC ? "DC" : "";
+        peak = r.flags & UT61E_FLAG_PEAK_MAX ? "max" : r.flags & UT61E_FLAG_PEAK_MIN ? "min" : "";
+        range = r.flags & UT61E_FLAG_AUTO ? "auto" : "manual";
+        operation = r.flags & UT61E_FLAG_UNDERLOAD ? "underload"
+                  : r.flags & UT61E_FLAG_OVERLOAD ? "overload" : "normal";
+        relative = r.flags & UT61E_FLAG_RELATIVE;
+        hold = r.flags & UT61E_FLAG_HOLD;
+        battery_low = r.flags & UT61E_FLAG_BATTERY_LOW;
+        sign = r.flags & UT61E_FLAG_NEGATIVE;
+    }
+};
+
+size_t UT61E_SERIALIZER::write(const UT61E_DISP &dmm, char *buffer, size_t size) const {
+    ut61e_shown_t s;
+    dmm.shown(s);
+    return write(dmm.reading, s, buffer, size);
+}
+
+size_t UT61E_SERIALIZER::write(const UT61E_DISP &dmm, Print &out) const {
+    char buffer[MAX_LENGTH];
+    size_t n = write(dmm, buffer, sizeof(buffer));
+    if (n >= sizeof(buffer))
+        n = sizeof(buffer) - 1;
+    return out.write((const uint8_t *)buffer, n);
+}
+
+// The basic JSON is kept byte for byte as subscribers have always had it:
+// the mode name under "unit", and %f cut to 6 characters (7 with a minus
+// sign), so 22 MΩ still comes out as 220000. The extended JSON has the
+// exact value and the unit. It uses %.6g, which keeps all 5 display
+// digits at any range and stays valid JSON (2.2e+07 for 22 MΩ).
+size_t UT61E_JSON_SERIALIZER::write(const ut61e_reading_t &r, const ut61e_shown_t &s, char *buffer,
+                                    size_t size) const {
+    bounded_writer w(buffer, size);
+    reading_text t(r);
+    if (!extended) {
+        char value[16], abs_value[16];
+        snprintf(value, t.sign ? 8 : 7, "%f", s.value);
+        snprintf(abs_value, 7, "%f", fabs(s.display_value));
+        w.add("{\"currentType\":\"%s\",\"unit\":\"%s\",\"value\":%s,\"absValue\":%s,\"negative\":%s}",
+              t.current_type, t.mode, value, abs_value, t.sign ? "true" : "false");
+        return w.length();
+    }
+    w.add("{\"value\":%.6g,\"unit\":\"%s\",\"display_value\":%.6g,\"display_unit\":\"%s\","
+          "\"display_string\":\"%s\",\"mode\":\"%s\",\"currentType\":\"%s\",\"peak\":\"%s\","
+          "\"relative\":\"%i\",\"hold\":\"%i\",\"range\":\"%s\",\"operation\":\"%s\","
+          "\"battery_low\":\"%i\",\"negative\":%s}",
+          s.value, t.unit, s.display_value, s.display_unit,
+          s.display_string, t.mode, t.current_type, t.peak,
+          t.relative, t.hold, t.range, t.operation,
+          t.battery_low, t.sign ? "true" : "false");
+    return w.length();
+}
+
+const char *UT61E_CSV_SERIALIZER::header() {
+    return "value,unit,display_value,display_unit,display_string,mode,currentType,peak,"
+           "relative,hold,range,operation,battery_low,negative";
+}
+
+// None of the fields can contain a comma or quote, so nothing needs quoting
+size_t UT61E_CSV_SERIALIZER::write(const ut61e_reading_t &r, const ut61e_shown_t &s, char *buffer,
+                                   size_t size) const {
+    bounded_writer w(buffer, size);
+    reading_text t(r);
+    w.add("%.6g,%s,%.6g,%s,%s,%s,%s,%s,%i,%i,%s,%s,%i,%i",
+          s.value, t.unit, s.display_value, s.display_unit,
+          s.display_string, t.mode, t.current_type, t.peak,
+          t.relative, t.hold, t.range, t.operation,
+          t.battery_low, t.sign);
+    return w.length();
+}
+
+// Tag values can't be empty in line protocol, so tags only go in when set.
+// String field values are quoted; none of ours contain quotes or backslashes.
+size_t UT61E_INFLUX_SERIALIZER::write(const ut61e_reading_t &r, const ut61e_shown_t &s, char *buffer,
+                                      size_t size) const {
+    bounded_writer w(buffer, size);
+    reading_text t(r);
+    w.add("%s,device=%s", measurement, device);
+    if (*t.mode)
+        w.add(",mode=%s", t.mode);
+    if (*t.unit)
+        w.add(",unit=%s", t.unit);
+    if (*t.current_type)
+        w.add(",current_type=%s", t.current_type);
+    w.add(" value=%.6g,display_value=%.6g,display_unit=\"%s\",range=\"%s\",operation=\"%s\","
+          "peak=\"%s\",relative=%s,hold=%s,battery_low=%s",
+          s.value, s.display_value, s.display_unit, t.range,
+          t.operation, t.peak, t.relative ? "true" : "false",
+          t.hold ? "true" : "false", t.battery_low ? "true" : "false");
+    return w.length();
+}
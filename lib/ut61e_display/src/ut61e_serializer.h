@@ -0,0 +1,71 @@
+/*
+ * ut61e_serializer.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstddef>
+#include <Print.h>
+#include "ut61e_display.h"
+
+#ifndef UT61E_SERIALIZER_H_
+#define UT61E_SERIALIZER_H_
+
+// Formats a decoded reading into a caller supplied buffer (or straight to a
+// Print) without allocating. write() behaves like snprintf: the output is
+// always NUL terminated and the return value is the length the whole output
+// needed, so a result >= size means it was truncated.
+//
+// A reading is its ut61e_reading_t and what the display showed, so one
+// queued long after its packet was decoded is written the same as straight
+// from the decoder.
+class UT61E_SERIALIZER {
+	public:
+		virtual ~UT61E_SERIALIZER() { }
+		virtual size_t write(const ut61e_reading_t &r, const ut61e_shown_t &s, char *buffer, size_t size) const = 0;
+		// The decoder's last reading
+		size_t write(const UT61E_DISP &dmm, char *buffer, size_t size) const;
+		// Formats on the stack then writes once; returns bytes written
+		size_t write(const UT61E_DISP &dmm, Print &out) const;
+
+		static const size_t MAX_LENGTH = 512;
+};
+
+// The JSON published on the tele/<id>/JSON (basic, @superhousetv spec) and
+// tele/<id>_x/JSON (extended, @cabletie spec) topics
+class UT61E_JSON_SERIALIZER: public UT61E_SERIALIZER {
+	public:
+		explicit UT61E_JSON_SERIALIZER(bool extended = true):extended(extended) { }
+		size_t write(const ut61e_reading_t &r, const ut61e_shown_t &s, char *buffer, size_t size) const override;
+		using UT61E_SERIALIZER::write;
+	private:
+		bool extended;
+};
+
+// One CSV row per reading, columns as header() lists them
+class UT61E_CSV_SERIALIZER: public UT61E_SERIALIZER {
+	public:
+		size_t write(const ut61e_reading_t &r, const ut61e_shown_t &s, char *buffer, size_t size) const override;
+		using UT61E_SERIALIZER::write;
+		static const char *header();
+};
+
+// InfluxDB line protocol, for Telegraf or a TSDB directly:
+//   ut61e,device=ABC123,mode=voltage,unit=V value=1.2345,display_value=1.2345,...
+// The device has no wall clock, so no timestamp is written and the receiver
+// stamps the line on arrival.
+class UT61E_INFLUX_SERIALIZER: public UT61E_SERIALIZER {
+	public:
+		// Both strings must outlive the serializer
+		UT61E_INFLUX_SERIALIZER(const char *measurement, const char *device)
+			:measurement(measurement),device(device) { }
+		size_t write(const ut61e_reading_t &r, const ut61e_shown_t &s, char *buffer, size_t size) const override;
+		using UT61E_SERIALIZER::write;
+	private:
+		const char *measurement;
+		const char *device;
+};
+
+#endif /* UT61E_SERIALIZER_H_ */
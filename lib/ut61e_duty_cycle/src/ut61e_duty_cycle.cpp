@@ -0,0 +1,175 @@
+/*
+ * ut61e_duty_cycle.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_duty_cycle.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#define RTC_MAGIC   0x5544   // "DU"
+
+UT61E_DUTY_CYCLE::UT61E_DUTY_CYCLE(const ut61e_duty_config &c): config(c) {
+    if (config.publish_every < 1)
+        config.publish_every = 1;
+    memset(&state, 0, sizeof(state));
+}
+
+// FNV-1a over everything but the checksum itself
+uint32_t UT61E_DUTY_CYCLE::checksum() const {
+    const uint8_t *p = (const uint8_t *)&state;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(state); i++) {
+        if (i >= offsetof(ut61e_rtc_state, checksum) && i < offsetof(ut61e_rtc_state, wakes))
+            continue;
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+bool UT61E_DUTY_CYCLE::begin() {
+    if (state.magic == RTC_MAGIC && state.count <= UT61E_RTC_READINGS && state.checksum == checksum())
+        return true;
+    memset(&state, 0, sizeof(state));
+    state.magic = RTC_MAGIC;
+    return false;
+}
+
+bool UT61E_DUTY_CYCLE::capturing(uint32_t awake_ms, uint16_t readings) const {
+    return awake_ms < config.capture_ms && readings < config.packets && readings < UT61E_RTC_READINGS;
+}
+
+void UT61E_DUTY_CYCLE::add(const ut61e_reading_t &r, uint32_t awake_ms) {
+    if (state.count == UT61E_RTC_READINGS) {
+        memmove(state.readings, state.readings + 1, (UT61E_RTC_READINGS - 1) * sizeof(ut61e_rtc_reading));
+        state.count--;
+        state.dropped++;
+    }
+    ut61e_rtc_reading &k = state.readings[state.count++];
+    k.time_ms = state.clock_ms + awake_ms;
+    k.digits = r.digits;
+    k.exponent = r.exponent;
+    k.mode = r.mode;
+    k.flags = r.flags;
+}
+
+// Decided at the start of a wake: every Kth wake, or when after this
+// wake's capture the buffer couldn't take the next one's
+bool UT61E_DUTY_CYCLE::publish_due(uint32_t wakes, uint8_t count) const {
+    return (wakes + 1) % config.publish_every == 0 || count + 2 * config.packets > UT61E_RTC_READINGS;
+}
+
+bool UT61E_DUTY_CYCLE::publish_due() const {
+    return publish_due(state.wakes, state.count);
+}
+
+bool UT61E_DUTY_CYCLE::next_publishes() const {
+    return publish_due(state.wakes, state.count);
+}
+
+void UT61E_DUTY_CYCLE::published() {
+    state.count = 0;
+    state.cycle_wakes = 0;
+    state.dropped = 0;
+    state.publish_failures = 0;
+    state.awake_ms = 0;
+    state.radio_ms = 0;
+    state.asleep_ms = 0;
+}
+
+uint32_t UT61E_DUTY_CYCLE::sleep(uint32_t awake_ms, uint32_t radio_ms) {
+    state.wakes++;
+    if (state.cycle_wakes < 255)
+        state.cycle_wakes++;
+    state.awake_ms += awake_ms;
+    state.radio_ms += radio_ms;
+    state.asleep_ms += config.sleep_ms;
+    state.clock_ms += awake_ms + config.sleep_ms;
+    state.magic = RTC_MAGIC;
+    state.checksum = checksum();
+    return config.sleep_ms;
+}
+
+// mA * ms / 3600 = uAh
+double UT61E_DUTY_CYCLE::uah_per_reading(const ut61e_duty_power &power) const {
+    if (!state.count)
+        return 0;
+    uint32_t cpu_ms = state.awake_ms - state.radio_ms + state.cycle_wakes * power.boot_ms;
+    double ma_ms = (double)cpu_ms * power.awake_ma + (double)state.radio_ms * power.radio_ma
+                 + (double)state.asleep_ms * power.sleep_ma;
+    return ma_ms / 3600.0 / state.count;
+}
+
+ut61e_reading_t UT61E_DUTY_CYCLE::reading(const ut61e_rtc_reading &k) {
+    ut61e_reading_t r = {};
+    r.time_ms = k.time_ms;
+    r.digits = k.digits;
+    r.exponent = k.exponent;
+    r.mode = k.mode;
+    r.flags = k.flags;
+    return r;
+}
+
+// {"wakes":..,...,"readings":[[time_ms,value,"unit",flags],...]}. The
+// timings cover the wakes before this one; the publish is still going on.
+size_t UT61E_DUTY_CYCLE::json(char *buffer, size_t size, const ut61e_duty_power &power) const {
+    int n = snprintf(buffer, size,
+        "{\"wakes\":%u,\"clock_ms\":%u,\"dropped\":%u,\"publish_failures\":%u,\"awake_ms\":%u,"
+        "\"radio_ms\":%u,\"asleep_ms\":%u,\"uah_per_reading\":%.2f,\"readings\":[",
+        (unsigned)state.wakes, (unsigned)state.clock_ms, state.dropped, state.publish_failures,
+        (unsigned)state.awake_ms, (unsigned)state.radio_ms, (unsigned)state.asleep_ms, uah_per_reading(power));
+    size_t used = n > 0 ? n : 0;
+    for (uint8_t i = 0; i < state.count && used < size; i++) {
+        ut61e_reading_t r = reading(state.readings[i]);
+        n = snprintf(buffer + used, size - used, "%s[%u,%.6g,\"%s\",%u]", i ? "," : "", (unsigned)r.time_ms,
+                     ut61e_reading_value(r), UT61E_UNIT_NAMES[ut61e_mode_unit(r.mode)], r.flags);
+        used += n > 0 ? n : 0;
+    }
+    if (used < size) {
+        n = snprintf(buffer + used, size - used, "]}");
+        used += n > 0 ? n : 0;
+    }
+    return used;
+}
+
+// Run the schedule from an empty buffer to its first publish
+ut61e_duty_estimate UT61E_DUTY_CYCLE::estimate(const ut61e_duty_config &config, const ut61e_duty_power &power) {
+    UT61E_DUTY_CYCLE duty(config);
+    duty.begin();
+    // The first packet is usually caught partway, so good ones arrive from
+    // two packet intervals in
+    uint32_t readings_per_wake = config.packets;
+    if (power.packet_ms && config.capture_ms / power.packet_ms < readings_per_wake + 1)
+        readings_per_wake = config.capture_ms / power.packet_ms ? config.capture_ms / power.packet_ms - 1 : 0;
+    if (readings_per_wake > UT61E_RTC_READINGS)
+        readings_per_wake = UT61E_RTC_READINGS;
+    uint32_t capture = config.capture_ms;
+    if (readings_per_wake == config.packets || readings_per_wake == UT61E_RTC_READINGS)
+        capture = (readings_per_wake + 1) * power.packet_ms;
+
+    ut61e_duty_estimate e = {};
+    e.capture_ms = power.boot_ms + capture;
+    uint32_t wakes = 0, readings = 0;
+    ut61e_reading_t r = {};
+    for (;;) {
+        bool publish = duty.publish_due();
+        for (uint32_t i = 0; i < readings_per_wake; i++)
+            duty.add(r, 0);
+        readings += readings_per_wake;
+        wakes++;
+        if (publish || wakes > 10000)
+            break;
+        duty.sleep(capture, 0);
+    }
+    double ma_ms = wakes * ((double)e.capture_ms * power.awake_ma + (double)config.sleep_ms * power.sleep_ma)
+                 + (double)power.connect_ms * power.radio_ma;
+    e.cycle_ms = wakes * (e.capture_ms + config.sleep_ms) + power.connect_ms;
+    e.average_ma = ma_ms / e.cycle_ms;
+    e.uah_per_reading = readings ? ma_ms / 3600.0 / readings : 0;
+    e.readings_per_hour = readings * 3600000.0 / e.cycle_ms;
+    return e;
+}
@@ -0,0 +1,120 @@
+/*
+ * ut61e_duty_cycle.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_reading.h"
+
+#ifndef UT61E_DUTY_CYCLE_H_
+#define UT61E_DUTY_CYCLE_H_
+
+// RTC user memory is 512 bytes. The first 128 belong to the boot loader's
+// OTA command, so the state goes after them.
+#define UT61E_RTC_OFFSET_BLOCKS   32     // 4 byte blocks
+#define UT61E_RTC_BYTES           384
+#define UT61E_RTC_READINGS        29
+
+// A reading as kept across deep sleep: the range and reserved byte of
+// ut61e_reading_t left out
+struct ut61e_rtc_reading {
+	uint32_t time_ms;   // Device clock, counting sleep
+	int32_t digits;
+	int8_t exponent;
+	uint8_t mode;
+	uint16_t flags;
+};
+
+// Everything that survives deep sleep. Checked with a checksum, so a power
+// on or a crash starts afresh.
+struct ut61e_rtc_state {
+	uint16_t magic;
+	uint8_t count;         // Readings waiting to be published
+	uint8_t cycle_wakes;   // Wakes since the last publish
+	uint32_t checksum;
+	uint32_t wakes;        // Since power on
+	uint32_t clock_ms;     // Device clock at the start of this wake
+	uint16_t dropped;      // Readings lost to a full buffer
+	uint16_t publish_failures;
+	uint32_t awake_ms;     // Since the last publish: awake, radio on, asleep
+	uint32_t radio_ms;
+	uint32_t asleep_ms;
+	ut61e_rtc_reading readings[UT61E_RTC_READINGS];
+};
+static_assert(sizeof(ut61e_rtc_state) <= UT61E_RTC_BYTES && sizeof(ut61e_rtc_state) % 4 == 0,
+              "RTC state must fit the user memory in whole blocks");
+
+struct ut61e_duty_config {
+	uint16_t packets;          // Capture this many good readings a wake ...
+	uint32_t capture_ms;       // ... or for this long, whichever comes first
+	uint32_t sleep_ms;
+	uint8_t publish_every;     // Connect and publish on every Kth wake
+};
+
+// Current draw of each phase, for the energy model
+struct ut61e_duty_power {
+	float awake_ma = 17;       // CPU running, radio off
+	float radio_ma = 75;       // Connecting and publishing
+	float sleep_ma = 0.15f;    // Deep sleep, D1 mini regulator and USB chip included
+	uint32_t boot_ms = 200;    // Wake to setup()
+	uint32_t connect_ms = 3000;// WiFi, MQTT and the publish
+	uint32_t packet_ms = 500;  // The meter's packet interval
+};
+
+struct ut61e_duty_estimate {
+	uint32_t capture_ms;       // Awake per wake
+	uint32_t cycle_ms;         // K wakes and sleeps
+	double average_ma;
+	double uah_per_reading;
+	double readings_per_hour;
+};
+
+// The schedule for battery operation: wake, capture some readings into RTC
+// memory, and deep sleep again. WiFi only comes on every Kth wake, or
+// earlier if the buffer couldn't take another wake's readings, to publish
+// everything buffered. The decisions are plain functions of the state, so
+// they run on the host as well (see ut61e-bench duty).
+class UT61E_DUTY_CYCLE {
+	public:
+		UT61E_DUTY_CYCLE(const ut61e_duty_config &config);
+		~UT61E_DUTY_CYCLE() { }
+
+		// Call with state read from RTC memory. Returns false and starts
+		// afresh if it isn't valid.
+		bool begin();
+		// Still capturing after awake_ms with this many readings
+		bool capturing(uint32_t awake_ms, uint16_t readings) const;
+		// Buffer a reading taken awake_ms into this wake. When the buffer
+		// is full the oldest reading goes.
+		void add(const ut61e_reading_t &r, uint32_t awake_ms);
+		// This wake connects and publishes
+		bool publish_due() const;
+		// The buffered readings went out: forget them and the timings
+		void published();
+		void publish_failed() { state.publish_failures++; }
+		// End the wake: account the times and seal the state for RTC
+		// memory. Returns how long to sleep.
+		uint32_t sleep(uint32_t awake_ms, uint32_t radio_ms);
+		// The coming wake will publish, so it needs the radio calibrated
+		bool next_publishes() const;
+		// Measured charge per reading since the last publish, from the
+		// timings in the state and the power figures
+		double uah_per_reading(const ut61e_duty_power &power) const;
+		// The buffered readings as JSON for tele/<id>/BATCH
+		size_t json(char *buffer, size_t size, const ut61e_duty_power &power) const;
+
+		static ut61e_reading_t reading(const ut61e_rtc_reading &r);
+		static ut61e_duty_estimate estimate(const ut61e_duty_config &config, const ut61e_duty_power &power);
+
+		ut61e_rtc_state state;
+		ut61e_duty_config config;
+	private:
+		uint32_t checksum() const;
+		bool publish_due(uint32_t wakes, uint8_t count) const;
+};
+
+#endif /* UT61E_DUTY_CYCLE_H_ */
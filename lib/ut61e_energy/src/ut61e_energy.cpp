@@ -0,0 +1,96 @@
+/*
+ * ut61e_energy.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_energy.h"
+#include <cmath>
+#include <cstdio>
+
+// Readings that show something other than the live value
+#define NOT_LIVE    (UT61E_FLAG_RELATIVE | UT61E_FLAG_PEAK_MAX | UT61E_FLAG_PEAK_MIN)
+
+UT61E_ENERGY::UT61E_ENERGY() {
+    supply_volts = 0;
+    measured_volts = 0;
+    max_gap_ms = 2000;
+    reset();
+}
+
+void UT61E_ENERGY::configure(float v, uint32_t gap) {
+    supply_volts = v;
+    max_gap_ms = gap;
+}
+
+void UT61E_ENERGY::reset() {
+    samples = 0;
+    gaps = 0;
+    covered_ms = 0;
+    gap_ms = 0;
+    overload_ms = 0;
+    range_skips = 0;
+    last_amps = 0;
+    peak_amps = 0;
+    coulombs = 0;
+    joules = 0;
+    have_last = false;
+    overloaded = false;
+    last_time_ms = 0;
+}
+
+void UT61E_ENERGY::update(const ut61e_reading_t &r) {
+    bool out_of_range = r.flags & (UT61E_FLAG_OVERLOAD | UT61E_FLAG_UNDERLOAD);
+    if (r.mode == UT61E_MODE_VOLTAGE) {
+        // The supply, measured before switching to current
+        if (!(r.flags & (UT61E_FLAG_AC | NOT_LIVE)) && !out_of_range)
+            measured_volts = fabs(ut61e_reading_value(r));
+        have_last = false;
+        return;
+    }
+    if (r.mode != UT61E_MODE_CURRENT || (r.flags & (UT61E_FLAG_AC | NOT_LIVE))) {
+        have_last = false;
+        return;
+    }
+
+    uint32_t dt = r.time_ms - last_time_ms;
+    if (out_of_range) {
+        if (r.flags & UT61E_FLAG_AUTO)
+            range_skips++;
+        else if (have_last)
+            overloaded = true;
+        return;
+    }
+
+    float amps = ut61e_reading_value(r);
+    if (have_last && overloaded) {
+        overload_ms += dt;
+    } else if (have_last && dt > max_gap_ms) {
+        gaps++;
+        gap_ms += dt;
+    } else if (have_last) {
+        double c = (last_amps + amps) / 2.0 * dt / 1000.0;
+        coulombs += c;
+        joules += c * volts();
+        covered_ms += dt;
+    }
+    samples++;
+    if (fabsf(amps) > peak_amps)
+        peak_amps = fabsf(amps);
+    last_amps = amps;
+    last_time_ms = r.time_ms;
+    have_last = true;
+    overloaded = false;
+}
+
+size_t UT61E_ENERGY::json(char *buffer, size_t size) const {
+    int n = snprintf(buffer, size,
+        "{\"mAh\":%.4f,\"Wh\":%.5f,\"volts\":%.3f,\"supply\":\"%s\",\"seconds\":%.1f,\"samples\":%u,"
+        "\"gaps\":%u,\"gap_s\":%.1f,\"overload_s\":%.1f,\"range_skips\":%u,\"amps\":%.6g,\"peak_amps\":%.6g}",
+        charge_mah(), energy_wh(), volts(), supply_volts > 0 ? "configured" : measured_volts > 0 ? "measured" : "none",
+        covered_ms / 1000.0, samples, gaps, gap_ms / 1000.0, overload_ms / 1000.0, range_skips,
+        last_amps, peak_amps);
+    return n > 0 ? n : 0;
+}
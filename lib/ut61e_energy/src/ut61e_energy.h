@@ -0,0 +1,70 @@
+/*
+ * ut61e_energy.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_reading.h"
+
+#ifndef UT61E_ENERGY_H_
+#define UT61E_ENERGY_H_
+
+// Coulomb counter for DC current readings: charge in mAh and, with a supply
+// voltage, energy in Wh, by the trapezoidal rule on the readings' capture
+// times.
+//
+// Only live DC current readings are integrated. AC, REL and MAX/MIN
+// readings, and any other mode, end the current run of readings, as does a
+// gap longer than max_gap_ms between two of them. Gaps are counted and left
+// out, never guessed.
+//
+// OL while auto ranging is the meter changing range: the reading is
+// skipped, and the readings either side of it are joined if they are close
+// enough together. OL on a manual range means the current is beyond it, so
+// the time until the next good reading is left out and counted as overload.
+//
+// The supply voltage is either configured, or 0 to use the last DC voltage
+// the meter measured before it was switched to current. Energy only adds
+// up while a voltage is known.
+class UT61E_ENERGY {
+	public:
+		UT61E_ENERGY();
+		~UT61E_ENERGY() { }
+
+		void configure(float supply_volts, uint32_t max_gap_ms);
+		void update(const ut61e_reading_t &r);
+		// Totals back to zero
+		void reset();
+
+		double charge_mah() const { return coulombs / 3.6; }
+		double energy_wh() const { return joules / 3600.0; }
+		// Supply voltage in use, 0 if there is none yet
+		float volts() const { return supply_volts > 0 ? supply_volts : measured_volts; }
+		// The totals as JSON for tele/<id>/ENERGY
+		size_t json(char *buffer, size_t size) const;
+
+		uint32_t samples;          // Current readings integrated
+		uint32_t gaps;             // Runs ended by a gap
+		uint32_t covered_ms;       // Time integrated
+		uint32_t gap_ms;           // Time left out for gaps
+		uint32_t overload_ms;      // Time left out for manual range OL
+		uint32_t range_skips;      // OL readings skipped while auto ranging
+		float last_amps;
+		float peak_amps;           // Largest magnitude seen
+	private:
+		float supply_volts;
+		float measured_volts;
+		uint32_t max_gap_ms;
+		double coulombs;
+		double joules;
+
+		bool have_last;            // last_time_ms/last_amps start an interval
+		bool overloaded;           // In a manual range OL since last_time_ms
+		uint32_t last_time_ms;
+};
+
+#endif /* UT61E_ENERGY_H_ */
@@ -0,0 +1,134 @@
+/*
+ * ut61e_fanout.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_fanout.h"
+#include <cstdio>
+#include <cstring>
+
+UT61E_FANOUT::UT61E_FANOUT() {
+    memset(refs, 0, sizeof(refs));
+    sink_count = 0;
+    total_depth = 0;
+    next_free = 0;
+    seq = 0;
+    published = 0;
+}
+
+int UT61E_FANOUT::add(const char *name, ut61e_sink_function f, uint8_t depth, ut61e_sink_policy_t policy,
+                      uint32_t max_age_ms) {
+    // Each sink holds at most depth entries, so with the depths adding up
+    // to less than the storage there is always a free entry to publish into
+    if (depth > UT61E_SINK_MAX_DEPTH)
+        depth = UT61E_SINK_MAX_DEPTH;
+    if (depth > UT61E_FANOUT_ENTRIES - 1 - total_depth)
+        depth = UT61E_FANOUT_ENTRIES - 1 - total_depth;
+    if (sink_count == UT61E_FANOUT_SINKS || depth == 0)
+        return -1;
+    sink_slot &s = sinks[sink_count];
+    s.name = name;
+    s.f = f;
+    s.depth = depth;
+    s.policy = policy;
+    s.max_age_ms = max_age_ms;
+    s.head = 0;
+    s.count = 0;
+    memset(&s.stats, 0, sizeof(s.stats));
+    total_depth += depth;
+    return sink_count++;
+}
+
+void UT61E_FANOUT::pop(sink_slot &s) {
+    refs[s.queue[s.head]]--;
+    s.head = (s.head + 1) % UT61E_SINK_MAX_DEPTH;
+    s.count--;
+}
+
+void UT61E_FANOUT::publish(const ut61e_sink_entry &entry) {
+    while (refs[next_free])
+        next_free = (next_free + 1) % UT61E_FANOUT_ENTRIES;
+    uint8_t index = next_free;
+    entries[index] = entry;
+    entries[index].seq = seq++;
+    published++;
+    for (uint8_t i = 0; i < sink_count; i++) {
+        sink_slot &s = sinks[i];
+        if (s.count == s.depth) {
+            s.stats.dropped++;
+            if (s.policy == UT61E_SINK_DROP_NEWEST)
+                continue;
+            pop(s);
+        }
+        s.queue[(s.head + s.count) % UT61E_SINK_MAX_DEPTH] = index;
+        s.count++;
+        refs[index]++;
+        if (s.count > s.stats.max_queued)
+            s.stats.max_queued = s.count;
+    }
+}
+
+bool UT61E_FANOUT::step(uint32_t now_ms) {
+    bool more = false;
+    for (uint8_t i = 0; i < sink_count; i++) {
+        sink_slot &s = sinks[i];
+        while (s.count && s.max_age_ms && now_ms - entries[s.queue[s.head]].reading.time_ms > s.max_age_ms) {
+            pop(s);
+            s.stats.expired++;
+        }
+        if (!s.count)
+            continue;
+        const ut61e_sink_entry &e = entries[s.queue[s.head]];
+        switch (s.f(e)) {
+            case UT61E_SINK_DONE: {
+                uint32_t lag = now_ms - e.reading.time_ms;
+                if (lag > s.stats.max_lag_ms)
+                    s.stats.max_lag_ms = lag;
+                s.stats.delivered++;
+                pop(s);
+                more |= s.count > 0;
+                break;
+            }
+            case UT61E_SINK_MORE:
+                more = true;
+                break;
+            case UT61E_SINK_BUSY:
+                s.stats.busy++;
+                break;
+        }
+    }
+    return more;
+}
+
+uint32_t UT61E_FANOUT::lag_ms(uint8_t id, uint32_t now_ms) const {
+    const sink_slot &s = sinks[id];
+    return s.count ? now_ms - entries[s.queue[s.head]].reading.time_ms : 0;
+}
+
+size_t UT61E_FANOUT::stats_json(char *buffer, size_t size, uint32_t now_ms) const {
+    size_t used = 0;
+    int n;
+    for (uint8_t i = 0; i < sink_count; i++) {
+        const sink_slot &s = sinks[i];
+        n = snprintf(used < size ? buffer + used : nullptr, used < size ? size - used : 0,
+                     "%s\"%s\":{\"queued\":%u,\"max_queued\":%u,\"lag_ms\":%u,\"max_lag_ms\":%u,"
+                     "\"delivered\":%u,\"dropped\":%u,\"expired\":%u,\"busy\":%u}",
+                     i ? "," : "{", s.name, s.count, s.stats.max_queued, (unsigned)lag_ms(i, now_ms),
+                     (unsigned)s.stats.max_lag_ms, (unsigned)s.stats.delivered, (unsigned)s.stats.dropped,
+                     (unsigned)s.stats.expired, (unsigned)s.stats.busy);
+        used += n > 0 ? n : 0;
+    }
+    n = snprintf(used < size ? buffer + used : nullptr, used < size ? size - used : 0, sink_count ? "}" : "{}");
+    used += n > 0 ? n : 0;
+    return used;
+}
+
+void UT61E_FANOUT::reset_stats() {
+    for (uint8_t i = 0; i < sink_count; i++) {
+        memset(&sinks[i].stats, 0, sizeof(sinks[i].stats));
+        sinks[i].stats.max_queued = sinks[i].count;
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * ut61e_fanout.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_reading.h"
+
+#ifndef UT61E_FANOUT_H_
+#define UT61E_FANOUT_H_
+
+#ifndef UT61E_FANOUT_SINKS
+#define UT61E_FANOUT_SINKS          6
+#endif
+#ifndef UT61E_FANOUT_ENTRIES
+#define UT61E_FANOUT_ENTRIES       40   // Shared by the sinks; their depths must add up to less
+#endif
+#define UT61E_SINK_MAX_DEPTH       16
+#define UT61E_SINK_PACKET_SIZE     14   // Data bytes of the longest protocol's frames (ut61e_protocol.h)
+
+// What an entry carries besides the reading
+#define UT61E_ENTRY_GOOD          0x01  // The packet decoded
+#define UT61E_ENTRY_DECODED       0x02  // For the decoded outputs: not HOLD, past the deadband, stable if asked
+#define UT61E_ENTRY_FILTERED      0x04  // filtered and UT61E_ENTRY_STABLE are set
+#define UT61E_ENTRY_STABLE        0x08
+
+// One packet from the meter, as handed to every sink
+struct ut61e_sink_entry {
+	uint32_t seq;               // Set by publish(), one up each time
+	ut61e_reading_t reading;    // time_ms is when the frame arrived, good or not
+	ut61e_shown_t shown;        // What the display showed, for the serializers
+	uint8_t packet[UT61E_SINK_PACKET_SIZE];   // As received, without any trailer
+	uint8_t flags;              // UT61E_ENTRY_*
+	float filtered;
+	uint32_t session;           // Measurement session id, 0 for none
+};
+
+enum ut61e_sink_policy_t : uint8_t {
+	UT61E_SINK_DROP_NEWEST = 0,   // A full queue turns new entries away
+	UT61E_SINK_DROP_OLDEST        // A full queue loses its oldest entry to make room
+};
+
+enum ut61e_sink_result_t : uint8_t {
+	UT61E_SINK_DONE = 0,   // Delivered: on to the next entry
+	UT61E_SINK_MORE,       // Got further, call again soon with the same entry
+	UT61E_SINK_BUSY        // Can't now (no room to write, not connected): try again later
+};
+
+// Delivers one entry, a bounded piece of work at a time. A sink that keeps
+// state between calls should key it on seq, since an entry can expire or
+// be overwritten in between.
+typedef ut61e_sink_result_t (*ut61e_sink_function)(const ut61e_sink_entry &entry);
+
+struct ut61e_sink_stats {
+	uint32_t delivered;
+	uint32_t dropped;       // Lost to a full queue, by the sink's policy
+	uint32_t expired;       // Older than the sink's max age before it got to them
+	uint32_t busy;          // Calls that returned UT61E_SINK_BUSY
+	uint32_t max_lag_ms;    // Longest from frame arrival to delivered
+	uint8_t max_queued;
+};
+
+// Fans readings out to independent sinks (serial echo, MQTT, UDP, ...).
+// Each entry is copied in once and shared; every sink has its own bounded
+// queue of them and its own policy for when that is full. A step gives
+// each sink with something queued one call, so a sink that can't keep up
+// (a full UART, a stalled socket) only ever holds up itself.
+class UT61E_FANOUT {
+	private:
+		struct sink_slot {
+			const char *name;
+			ut61e_sink_function f;
+			uint8_t depth;
+			ut61e_sink_policy_t policy;
+			uint32_t max_age_ms;
+			uint8_t queue[UT61E_SINK_MAX_DEPTH];  // Entry indices, oldest first
+			uint8_t head;
+			uint8_t count;
+			ut61e_sink_stats stats;
+		};
+		ut61e_sink_entry entries[UT61E_FANOUT_ENTRIES];
+		uint8_t refs[UT61E_FANOUT_ENTRIES];         // Sinks still holding each entry
+		sink_slot sinks[UT61E_FANOUT_SINKS];
+		uint8_t sink_count;
+		uint8_t total_depth;
+		uint8_t next_free;
+		uint32_t seq;
+
+		void pop(sink_slot &s);
+	public:
+		UT61E_FANOUT();
+		~UT61E_FANOUT() { }
+
+		// max_age_ms 0 means entries never expire. The depth is cut down to
+		// what the shared entries have left. Returns a sink id, or -1 if full.
+		int add(const char *name, ut61e_sink_function f, uint8_t depth, ut61e_sink_policy_t policy,
+		        uint32_t max_age_ms = 0);
+		// Queue a copy of the entry for every sink
+		void publish(const ut61e_sink_entry &entry);
+		// One call for each sink with something queued. Returns true if
+		// another step would get further right away: a sink delivered with
+		// more queued, or asked to be called again. Busy sinks don't count.
+		bool step(uint32_t now_ms);
+
+		uint8_t count() const { return sink_count; }
+		const char *name(uint8_t id) const { return sinks[id].name; }
+		uint8_t queued(uint8_t id) const { return sinks[id].count; }
+		const ut61e_sink_stats &stats(uint8_t id) const { return sinks[id].stats; }
+		// Age of the oldest entry a sink has yet to deliver
+		uint32_t lag_ms(uint8_t id, uint32_t now_ms) const;
+		// {"serial":{"queued":0,"lag_ms":0,"max_lag_ms":95,...},...}, like snprintf
+		size_t stats_json(char *buffer, size_t size, uint32_t now_ms) const;
+		void reset_stats();
+
+		uint32_t published;
+};
+
+#endif /* UT61E_FANOUT_H_ */
@@ -0,0 +1,151 @@
+/*
+ * ut61e_filter.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_filter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+UT61E_FILTER::UT61E_FILTER() {
+    memset(kinds, 0, sizeof(kinds));
+    memset(params, 0, sizeof(params));
+    tolerance = 0;
+    samples = 0;
+    have_last = false;
+    reset();
+    resets = 0;
+}
+
+void UT61E_FILTER::configure(const uint8_t *k, const uint8_t *p, uint16_t t, uint8_t s) {
+    if (memcmp(kinds, k, sizeof(kinds)) || memcmp(params, p, sizeof(params)) || tolerance != t || samples != s)
+        reset();
+    memcpy(kinds, k, sizeof(kinds));
+    memcpy(params, p, sizeof(params));
+    tolerance = t;
+    samples = s;
+}
+
+void UT61E_FILTER::reset() {
+    window_count = 0;
+    window_next = 0;
+    run = 0;
+    stable = false;
+    filtering = false;
+    digits = 0;
+    estimate = 0;
+    variance = 0;
+    anchor = 0;
+    have_last = false;
+    resets++;
+}
+
+float UT61E_FILTER::filter(uint8_t kind, uint8_t param, int32_t d) {
+    switch (kind) {
+        case UT61E_FILTER_MEDIAN: {
+            uint8_t n = param < UT61E_FILTER_MAX_WINDOW ? param : UT61E_FILTER_MAX_WINDOW;
+            if (n < 1)
+                n = 1;
+            window[window_next] = d;
+            window_next = (window_next + 1) % n;
+            if (window_count < n)
+                window_count++;
+            // Insertion sort of at most 15 values beats anything cleverer here
+            int32_t sorted[UT61E_FILTER_MAX_WINDOW];
+            for (uint8_t i = 0; i < window_count; i++) {
+                int32_t v = window[i];
+                uint8_t j = i;
+                for (; j > 0 && sorted[j - 1] > v; j--)
+                    sorted[j] = sorted[j - 1];
+                sorted[j] = v;
+            }
+            if (window_count & 1)
+                return sorted[window_count / 2];
+            return (sorted[window_count / 2 - 1] + sorted[window_count / 2]) / 2.0f;
+        }
+        case UT61E_FILTER_EMA:
+            if (window_count == 0) {
+                window_count = 1;
+                estimate = d;
+            } else {
+                estimate += (d - estimate) * param / 100.0f;
+            }
+            return estimate;
+        case UT61E_FILTER_KALMAN:
+            // Constant value with a random walk of one count squared per
+            // reading, measured with param times that much noise
+            if (window_count == 0) {
+                window_count = 1;
+                estimate = d;
+                variance = param;
+            } else {
+                variance += 1.0f;
+                float gain = variance / (variance + param);
+                estimate += gain * (d - estimate);
+                variance *= 1.0f - gain;
+            }
+            return estimate;
+        default:
+            return d;
+    }
+}
+
+void UT61E_FILTER::update(const ut61e_reading_t &r) {
+    bool number = !(r.flags & (UT61E_FLAG_OVERLOAD | UT61E_FLAG_UNDERLOAD));
+    if (have_last && (r.mode != last.mode || r.range != last.range || r.exponent != last.exponent))
+        reset();
+    else if (!number && (run || window_count))
+        reset();
+    last = r;
+    have_last = true;
+
+    uint8_t mode = r.mode < UT61E_MODE_COUNT ? r.mode : (uint8_t)UT61E_MODE_UNKNOWN;
+    uint8_t kind = kinds[mode] < UT61E_FILTER_COUNT ? kinds[mode] : (uint8_t)UT61E_FILTER_NONE;
+    filtering = kind != UT61E_FILTER_NONE && number;
+    if (!number) {
+        // OL/UL: nothing to smooth and nothing stable about it
+        digits = 0;
+        stable = false;
+        run = 0;
+        return;
+    }
+    digits = filter(kind, params[mode], r.digits);
+
+    if (run == 0 || (uint32_t)abs(r.digits - anchor) > tolerance) {
+        anchor = r.digits;
+        run = 1;
+    } else if (run < 0xffff) {
+        run++;
+    }
+    stable = samples && run >= samples;
+}
+
+double UT61E_FILTER::value() const {
+    if (!have_last)
+        return 0;
+    ut61e_reading_t unit = last;
+    unit.digits = 1;
+    return digits * ut61e_reading_value(unit);
+}
+
+size_t UT61E_FILTER::append_json(char *buffer, size_t length, size_t size) const {
+    return append_json(buffer, length, size, value(), stable);
+}
+
+size_t UT61E_FILTER::append_json(char *buffer, size_t length, size_t size, double filtered, bool stable) {
+    if (length == 0 || length >= size || buffer[length - 1] != '}')
+        return length;
+    int n = snprintf(buffer + length - 1, size - length + 1, ",\"filtered\":%.6g,\"stable\":%s}",
+                     filtered, stable ? "true" : "false");
+    if (n <= 0 || (size_t)n >= size - length + 1) {
+        // Didn't fit: leave the object as it was
+        buffer[length - 1] = '}';
+        buffer[length] = 0;
+        return length;
+    }
+    return length - 1 + n;
+}
@@ -0,0 +1,81 @@
+/*
+ * ut61e_filter.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_reading.h"
+
+#ifndef UT61E_FILTER_H_
+#define UT61E_FILTER_H_
+
+// Smoothing applied to a mode's readings
+enum ut61e_filter_kind_t : uint8_t {
+	UT61E_FILTER_NONE = 0,
+	UT61E_FILTER_MEDIAN,    // Median of the last N readings
+	UT61E_FILTER_EMA,       // Exponential moving average, alpha in percent
+	UT61E_FILTER_KALMAN,    // Scalar Kalman filter, measurement/process noise ratio
+	UT61E_FILTER_COUNT
+};
+
+static const char *const UT61E_FILTER_NAMES[UT61E_FILTER_COUNT] = {"none", "median", "ema", "kalman"};
+
+#define UT61E_FILTER_MAX_WINDOW   15   // Longest median window
+
+// Parameter limits and the value used when a command leaves it out
+static const uint8_t UT61E_FILTER_PARAM_MIN[UT61E_FILTER_COUNT] = {0, 3, 1, 1};
+static const uint8_t UT61E_FILTER_PARAM_MAX[UT61E_FILTER_COUNT] = {0, UT61E_FILTER_MAX_WINDOW, 100, 255};
+static const uint8_t UT61E_FILTER_PARAM_DEFAULT[UT61E_FILTER_COUNT] = {0, 5, 20, 16};
+
+// Streaming filter stage for decoded readings, in display counts. Each mode
+// has its own filter; everything starts again when the mode, range or
+// exponent changes, or on OL/UL. Separately, a reading is "stable" once the
+// display has stayed within a tolerance for some number of readings in a
+// row, like the AutoHold on some meters.
+class UT61E_FILTER {
+	public:
+		UT61E_FILTER();
+		~UT61E_FILTER() { }
+
+		// kinds/params are indexed by ut61e_mode_t. samples 0 turns the
+		// stability detector off (nothing is ever stable).
+		void configure(const uint8_t *kinds, const uint8_t *params, uint16_t tolerance, uint8_t samples);
+		void update(const ut61e_reading_t &r);
+		void reset();
+
+		// The filtered reading in base units
+		double value() const;
+		// Add "filtered" and "stable" to a JSON object of the given length,
+		// in place before its closing brace. Returns the new length.
+		size_t append_json(char *buffer, size_t length, size_t size) const;
+		// The same for a value and stability saved from earlier
+		static size_t append_json(char *buffer, size_t length, size_t size, double filtered, bool stable);
+
+		float digits;        // Filtered display counts
+		bool stable;
+		bool filtering;      // A filter is set for the current mode
+		uint16_t run;        // Readings in a row within the tolerance
+		uint32_t resets;     // Times the state started again
+	private:
+		uint8_t kinds[UT61E_MODE_COUNT];
+		uint8_t params[UT61E_MODE_COUNT];
+		uint16_t tolerance;
+		uint8_t samples;
+
+		ut61e_reading_t last;
+		bool have_last;
+		int32_t window[UT61E_FILTER_MAX_WINDOW];
+		uint8_t window_count;
+		uint8_t window_next;
+		float estimate;      // EMA or Kalman state
+		float variance;      // Kalman error variance
+		int32_t anchor;      // First reading of the current stable run
+
+		float filter(uint8_t kind, uint8_t param, int32_t d);
+};
+
+#endif /* UT61E_FILTER_H_ */
@@ -0,0 +1,65 @@
+/*
+ * ut61e_framer.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "ut61e_protocol.h"
+
+#ifndef UT61E_FRAMER_H_
+#define UT61E_FRAMER_H_
+
+// Splits the byte stream from the meter into frames of one protocol (see
+// ut61e_protocol.h). Bytes that can't be part of a well formed frame are
+// dropped (and counted) until the stream lines up with a frame boundary
+// again. UT61E_FRAMER is the UT61E one: 12 data bytes followed by CR LF.
+template <class Protocol>
+class UT61E_FRAMER_T {
+	public:
+		static const uint8_t PACKET_SIZE = Protocol::PACKET_SIZE;  // Data bytes
+		static const uint8_t FRAME_SIZE = Protocol::FRAME_SIZE;    // Data bytes + trailer
+
+		UT61E_FRAMER_T() { reset(); }
+
+		// Feed one received byte. Returns true when a full frame has been
+		// completed; it stays available through frame() until the next push().
+		bool push(uint8_t c) {
+			buffer[position++] = c;
+			int verdict = Protocol::check(buffer, position);
+			if (verdict == UT61E_FRAME_COMPLETE) {
+				memcpy(completed, buffer, FRAME_SIZE);
+				position = 0;
+				frames++;
+				return true;
+			}
+			if (verdict > 0) {
+				memmove(buffer, buffer + verdict, position - verdict);
+				position -= verdict;
+				resync_bytes += verdict;
+			}
+			return false;
+		}
+		void reset() {
+			position = 0;
+			memset(completed, 0, sizeof(completed));
+		}
+
+		const uint8_t *frame() const { return completed; }
+		const char *packet() const { return (const char *)completed; }
+
+		uint32_t frames {0};        // Complete frames seen
+		uint32_t resync_bytes {0};  // Bytes thrown away hunting for a frame boundary
+	private:
+		uint8_t buffer[FRAME_SIZE];
+		uint8_t completed[FRAME_SIZE];
+		uint8_t position;
+};
+
+typedef UT61E_FRAMER_T<ES51922> UT61E_FRAMER;
+
+#endif /* UT61E_FRAMER_H_ */
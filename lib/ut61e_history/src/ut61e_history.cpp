@@ -0,0 +1,114 @@
+/*
+ * ut61e_history.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_history.h"
+#include <cstring>
+
+UT61E_HISTORY::UT61E_HISTORY(): encoder(data[0], UT61E_HISTORY_BLOCK_SIZE) {
+    clear();
+}
+
+void UT61E_HISTORY::clear() {
+    memset(headers, 0, sizeof(headers));
+    newest = 0;
+    encoder.reset(data[0], UT61E_HISTORY_BLOCK_SIZE);
+    added = 0;
+    overwritten = 0;
+}
+
+void UT61E_HISTORY::add(const ut61e_reading_t &r) {
+    if (!encoder.add(r)) {
+        // Close this block and start again in the oldest
+        encoder.flush();
+        header(newest).length = encoder.size();
+        newest++;
+        ut61e_history_block &h = header(newest);
+        overwritten += h.count;
+        memset(&h, 0, sizeof(h));
+        encoder.reset(data[newest % UT61E_HISTORY_BLOCKS], UT61E_HISTORY_BLOCK_SIZE);
+        encoder.add(r);
+    }
+    ut61e_history_block &h = header(newest);
+    if (h.count == 0)
+        h.first_ms = r.time_ms;
+    h.last_ms = r.time_ms;
+    h.count = encoder.count;
+    h.length = encoder.size();
+    added++;
+}
+
+bool UT61E_HISTORY::block(uint32_t n, ut61e_history_block &h, const uint8_t *&stream) {
+    if (!valid(n))
+        return false;
+    if (n == newest) {
+        encoder.flush();
+        header(n).length = encoder.size();
+    }
+    h = header(n);
+    stream = data[n % UT61E_HISTORY_BLOCKS];
+    return true;
+}
+
+uint32_t UT61E_HISTORY::readings() const {
+    uint32_t n = 0;
+    for (auto &h: headers)
+        n += h.count;
+    return n;
+}
+
+uint32_t UT61E_HISTORY::first_ms() const {
+    for (uint32_t n = oldest_block(); n <= newest; n++)
+        if (headers[n % UT61E_HISTORY_BLOCKS].count)
+            return headers[n % UT61E_HISTORY_BLOCKS].first_ms;
+    return 0;
+}
+
+uint32_t UT61E_HISTORY::last_ms() const {
+    return headers[newest % UT61E_HISTORY_BLOCKS].last_ms;
+}
+
+size_t UT61E_HISTORY::bytes() const {
+    size_t n = 0;
+    for (auto &h: headers)
+        n += h.length;
+    return n;
+}
+
+static char *append(char *p, const char *text) {
+    size_t n = strlen(text);
+    memcpy(p, text, n);
+    return p + n;
+}
+
+static char *append_unsigned(char *p, uint32_t v) {
+    char text[10];
+    int n = 0;
+    do {
+        text[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (n)
+        *p++ = text[--n];
+    return p;
+}
+
+size_t UT61E_HISTORY::csv_row(char *out, const ut61e_reading_t &r) {
+    char *p = append_unsigned(out, r.time_ms);
+    *p++ = ',';
+    p += ut61e_format_value(p, r.digits, r.exponent);
+    *p++ = ',';
+    p = append(p, UT61E_UNIT_NAMES[ut61e_mode_unit(r.mode)]);
+    *p++ = ',';
+    p = append(p, UT61E_MODE_NAMES[r.mode < UT61E_MODE_COUNT ? r.mode : 0]);
+    *p++ = ',';
+    p = append_unsigned(p, r.range);
+    *p++ = ',';
+    p = append_unsigned(p, r.flags);
+    *p++ = '\n';
+    return p - out;
+}
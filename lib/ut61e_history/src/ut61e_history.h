@@ -0,0 +1,81 @@
+/*
+ * ut61e_history.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_reading.h"
+#include "ut61e_codec.h"
+
+#ifndef UT61E_HISTORY_H_
+#define UT61E_HISTORY_H_
+
+#ifndef UT61E_HISTORY_BLOCKS
+#define UT61E_HISTORY_BLOCKS       16
+#endif
+#ifndef UT61E_HISTORY_BLOCK_SIZE
+#define UT61E_HISTORY_BLOCK_SIZE 1024   // Bytes of codec stream per block
+#endif
+
+#define UT61E_HISTORY_CSV_MAX_ROW  64
+
+// In front of each block's codec stream in the binary export. Little-endian,
+// as the ESP8266 and the host both are.
+struct ut61e_history_block {
+	uint32_t first_ms;
+	uint32_t last_ms;
+	uint32_t count;       // Readings in the stream
+	uint16_t length;      // Bytes of stream that follow
+	uint16_t reserved;
+};
+
+// The most recent readings, codec compressed (see lib/ut61e_codec) into a
+// ring of fixed size blocks. Each block is an independent stream, so any
+// block can be decoded or sent on its own, straight from the ring. A full
+// block is closed and the oldest one reused. Blocks are numbered from 0
+// up as they are opened; a number stays valid until its block is reused.
+// Times are millis(), assumed not to wrap.
+class UT61E_HISTORY {
+	private:
+		uint8_t data[UT61E_HISTORY_BLOCKS][UT61E_HISTORY_BLOCK_SIZE];
+		ut61e_history_block headers[UT61E_HISTORY_BLOCKS];
+		UT61E_ENCODER encoder;
+		uint32_t newest;      // Number of the block being written
+
+		ut61e_history_block &header(uint32_t n) { return headers[n % UT61E_HISTORY_BLOCKS]; }
+	public:
+		UT61E_HISTORY();
+		~UT61E_HISTORY() { }
+
+		void add(const ut61e_reading_t &r);
+		void clear();
+
+		uint32_t oldest_block() const {
+			return newest >= UT61E_HISTORY_BLOCKS ? newest - UT61E_HISTORY_BLOCKS + 1 : 0;
+		}
+		uint32_t newest_block() const { return newest; }
+		bool valid(uint32_t n) const { return n >= oldest_block() && n <= newest; }
+		// A block's header and stream. Asking for the block still being
+		// written first flushes its pending run, so what is returned decodes
+		// to exactly count readings; later readings go after it. False if
+		// the block was reused or not opened yet.
+		bool block(uint32_t n, ut61e_history_block &h, const uint8_t *&stream);
+
+		uint32_t readings() const;
+		uint32_t first_ms() const;
+		uint32_t last_ms() const;
+		size_t bytes() const;      // Stream bytes in use
+
+		// One CSV row as UT61E_READING_CSV_HEADER names the columns, with the
+		// value exact. Needs UT61E_HISTORY_CSV_MAX_ROW bytes.
+		static size_t csv_row(char *out, const ut61e_reading_t &r);
+
+		uint32_t added;
+		uint32_t overwritten;      // Readings lost to reused blocks
+};
+
+#endif /* UT61E_HISTORY_H_ */
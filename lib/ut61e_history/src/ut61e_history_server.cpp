@@ -0,0 +1,337 @@
+/*
+ * ut61e_history_server.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_history_server.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define CLOSE_DELAY_MS      100   // Let the end of the response be acknowledged, so stop() doesn't wait
+#define READ_MAX_BYTES      512   // Request bytes read per client per loop
+#define REQUEST_TIMEOUT_MS 5000   // Drop a connection that doesn't send its request
+#define SEND_TIMEOUT_MS   10000   // Give up on a client that stops reading
+#define DECODE_MAX          256   // Readings decoded per CSV chunk, in the range or not
+
+static const char NOT_FOUND[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char LAST_CHUNK[] = "0\r\n\r\n";
+static const char CRLF[] = "\r\n";
+
+UT61E_HISTORY_SERVER::UT61E_HISTORY_SERVER(uint16_t port, UT61E_HISTORY &h): server(port), history(h) {
+    exports = 0;
+    aborted = 0;
+    rejected = 0;
+    not_found = 0;
+    bytes_sent = 0;
+    for (auto &slot: slots)
+        reset(slot);
+}
+
+void UT61E_HISTORY_SERVER::begin() {
+    server.begin();
+    server.setNoDelay(true);
+}
+
+void UT61E_HISTORY_SERVER::reset(client_slot &slot) {
+    slot.last_ms = millis();
+    slot.first_line = true;
+    slot.line_length = 0;
+    slot.blank = true;
+    slot.format = EXPORT_NONE;
+    slot.chunked = true;
+    slot.exporting = false;
+    slot.closing = false;
+    slot.decoding = false;
+    slot.header_row = false;
+    slot.body = nullptr;
+    slot.body_length = 0;
+    slot.body_in_ring = false;
+    slot.prefix_length = 0;
+    slot.suffix_length = 0;
+    slot.sent = 0;
+}
+
+void UT61E_HISTORY_SERVER::abort(client_slot &slot) {
+    aborted++;
+    slot.client.stop();
+    reset(slot);
+}
+
+void UT61E_HISTORY_SERVER::accept() {
+    if (!server.hasClient())
+        return;
+    WiFiClient incoming = server.available();
+    for (auto &slot: slots) {
+        if (!slot.client.connected()) {
+            slot.client.stop();
+            slot.client = incoming;
+            slot.client.setNoDelay(true);
+            reset(slot);
+            return;
+        }
+    }
+    incoming.stop();
+    rejected++;
+}
+
+// Only the request line matters. It is kept lower case and cut short; the
+// end of the headers finishes the request.
+bool UT61E_HISTORY_SERVER::read_request(client_slot &slot) {
+    size_t n = 0;
+    while (n++ < READ_MAX_BYTES && slot.client.available()) {
+        int c = slot.client.read();
+        if (c < 0)
+            break;
+        slot.last_ms = millis();
+        if (c == '\r')
+            continue;
+        if (c != '\n') {
+            if (!slot.first_line)
+                slot.blank = false;
+            else if (slot.line_length < sizeof(slot.line) - 1)
+                slot.line[slot.line_length++] = tolower(c);
+            continue;
+        }
+        if (slot.first_line) {
+            slot.line[slot.line_length] = 0;
+            slot.first_line = !slot.line_length;
+        } else if (slot.blank) {
+            return true;
+        }
+        slot.blank = true;
+    }
+    return false;
+}
+
+// A signed query parameter, e.g. from in "get /history.csv?from=-3600000 http/1.1"
+static bool parameter(const char *line, const char *name, int64_t &value) {
+    const char *query = strchr(line, '?');
+    const char *end = strchr(line + 4, ' ');
+    if (!query || (end && query > end))
+        return false;
+    size_t length = strlen(name);
+    for (const char *p = query; p && (!end || p < end); p = strchr(p + 1, '&')) {
+        if (!strncmp(p + 1, name, length) && p[1 + length] == '=') {
+            value = strtoll(p + 2 + length, nullptr, 10);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool path_is(const char *line, const char *path) {
+    size_t length = strlen(path);
+    return !strncmp(line, "get ", 4) && !strncmp(line + 4, path, length)
+        && (line[4 + length] == ' ' || line[4 + length] == '?' || line[4 + length] == 0);
+}
+
+void UT61E_HISTORY_SERVER::respond(client_slot &slot) {
+    if (path_is(slot.line, "/history.csv"))
+        slot.format = EXPORT_CSV;
+    else if (path_is(slot.line, "/history.bin"))
+        slot.format = EXPORT_BINARY;
+    if (slot.format == EXPORT_NONE) {
+        not_found++;
+        slot.body = (const uint8_t *)NOT_FOUND;
+        slot.body_length = sizeof(NOT_FOUND) - 1;
+        slot.closing = true;
+        write(slot);
+        return;
+    }
+    // Negative times are before now; without a range, everything up to now
+    uint32_t now = millis();
+    int64_t from = 0, to = now;
+    parameter(slot.line, "from", from);
+    parameter(slot.line, "to", to);
+    if (from < 0)
+        from = now + from > 0 ? now + from : 0;
+    if (to < 0)
+        to = now + to > 0 ? now + to : 0;
+    slot.from_ms = from < UINT32_MAX ? from : UINT32_MAX;
+    slot.to_ms = to < UINT32_MAX ? to : UINT32_MAX;
+    slot.chunked = !strstr(slot.line, "http/1.0");
+    slot.block = history.oldest_block();
+    slot.header_row = slot.format == EXPORT_CSV;
+    slot.exporting = true;
+    exports++;
+    bool csv = slot.format == EXPORT_CSV;
+    int n = snprintf(slot.chunk, sizeof(slot.chunk),
+        "HTTP/1.1 200 OK\r\nContent-Type: %s\r\n"
+        "Content-Disposition: attachment; filename=\"ut61e-history.%s\"\r\n"
+        "%sConnection: close\r\nX-UT61E-Now-Ms: %u\r\n\r\n",
+        csv ? "text/csv" : "application/octet-stream", csv ? "csv" : "bin",
+        slot.chunked ? "Transfer-Encoding: chunked\r\n" : "", (unsigned)now);
+    slot.body = (const uint8_t *)slot.chunk;
+    slot.body_length = n;
+    write(slot);
+}
+
+// The next block with readings in the range, skipping any reused before
+// we got to them. Blocks are in time order, so one after the range ends it.
+bool UT61E_HISTORY_SERVER::next_block(client_slot &slot, ut61e_history_block &h, const uint8_t *&stream) {
+    if (slot.block < history.oldest_block())
+        slot.block = history.oldest_block();
+    for (; history.block(slot.block, h, stream); slot.block++) {
+        if (!h.count || h.last_ms < slot.from_ms)
+            continue;
+        return h.first_ms <= slot.to_ms;
+    }
+    return false;
+}
+
+void UT61E_HISTORY_SERVER::next_chunk(client_slot &slot) {
+    ut61e_history_block h;
+    const uint8_t *stream;
+    if (slot.format == EXPORT_BINARY) {
+        // A whole block per chunk: its header, then its stream straight
+        // from the ring
+        if (!next_block(slot, h, stream)) {
+            slot.exporting = false;
+            return;
+        }
+        size_t n = slot.chunked ? snprintf(slot.prefix, sizeof(slot.prefix), "%X\r\n",
+                                           (unsigned)(sizeof(h) + h.length)) : 0;
+        memcpy(slot.prefix + n, &h, sizeof(h));
+        slot.prefix_length = n + sizeof(h);
+        slot.body = stream;
+        slot.body_length = h.length;
+        slot.body_in_ring = true;
+        slot.body_block = slot.block++;
+        slot.suffix_length = slot.chunked ? 2 : 0;
+        return;
+    }
+
+    // CSV: rows until the chunk is full, a little decoding at a time
+    if (slot.decoding && !history.valid(slot.block)) {
+        abort(slot);
+        return;
+    }
+    size_t used = 0, decoded = 0;
+    if (slot.header_row) {
+        used = strlen(UT61E_READING_CSV_HEADER);
+        memcpy(slot.chunk, UT61E_READING_CSV_HEADER, used);
+        slot.header_row = false;
+    }
+    while (used + UT61E_HISTORY_CSV_MAX_ROW <= sizeof(slot.chunk) && decoded < DECODE_MAX) {
+        if (!slot.decoding) {
+            if (!next_block(slot, h, stream)) {
+                slot.exporting = false;
+                break;
+            }
+            slot.decoder.reset(stream, h.length);
+            slot.decoding = true;
+        }
+        ut61e_reading_t r;
+        if (!slot.decoder.next(r)) {
+            slot.decoding = false;
+            slot.block++;
+            continue;
+        }
+        decoded++;
+        if (r.time_ms > slot.to_ms) {
+            slot.exporting = false;
+            break;
+        }
+        if (r.time_ms >= slot.from_ms)
+            used += UT61E_HISTORY::csv_row(slot.chunk + used, r);
+    }
+    if (!used)
+        return;
+    slot.prefix_length = slot.chunked ? snprintf(slot.prefix, sizeof(slot.prefix), "%X\r\n", (unsigned)used) : 0;
+    slot.body = (const uint8_t *)slot.chunk;
+    slot.body_length = used;
+    slot.suffix_length = slot.chunked ? 2 : 0;
+}
+
+bool UT61E_HISTORY_SERVER::pending(const client_slot &slot) const {
+    return slot.prefix_length + slot.body_length + slot.suffix_length > 0;
+}
+
+// Prefix, body and suffix, as far as the socket has room
+void UT61E_HISTORY_SERVER::write(client_slot &slot) {
+    if (slot.body_in_ring && !history.valid(slot.body_block)) {
+        abort(slot);
+        return;
+    }
+    size_t total = slot.prefix_length + slot.body_length + slot.suffix_length;
+    while (slot.sent < total) {
+        size_t room = slot.client.availableForWrite();
+        if (!room)
+            return;
+        const uint8_t *p;
+        size_t n;
+        if (slot.sent < slot.prefix_length) {
+            p = (const uint8_t *)slot.prefix + slot.sent;
+            n = slot.prefix_length - slot.sent;
+        } else if (slot.sent < slot.prefix_length + slot.body_length) {
+            p = slot.body + slot.sent - slot.prefix_length;
+            n = slot.prefix_length + slot.body_length - slot.sent;
+        } else {
+            p = (const uint8_t *)CRLF + slot.sent - slot.prefix_length - slot.body_length;
+            n = total - slot.sent;
+        }
+        size_t written = slot.client.write(p, n < room ? n : room);
+        if (!written)
+            return;
+        slot.sent += written;
+        bytes_sent += written;
+        slot.last_ms = millis();
+    }
+    slot.body = nullptr;
+    slot.body_length = 0;
+    slot.body_in_ring = false;
+    slot.prefix_length = 0;
+    slot.suffix_length = 0;
+    slot.sent = 0;
+}
+
+bool UT61E_HISTORY_SERVER::loop() {
+    accept();
+    uint32_t now = millis();
+    bool more = false;
+    for (auto &slot: slots) {
+        if (!slot.client.connected()) {
+            if (slot.format != EXPORT_NONE || slot.closing || !slot.first_line) {
+                if (slot.exporting || pending(slot))
+                    aborted++;
+                reset(slot);
+            }
+            continue;
+        }
+        if (pending(slot)) {
+            write(slot);
+            if (pending(slot) && now - slot.last_ms >= SEND_TIMEOUT_MS)
+                abort(slot);
+        } else if (slot.exporting) {
+            next_chunk(slot);
+            if (pending(slot))
+                write(slot);
+        } else if (slot.format != EXPORT_NONE && !slot.closing) {
+            // All of it sent
+            if (slot.chunked) {
+                slot.body = (const uint8_t *)LAST_CHUNK;
+                slot.body_length = sizeof(LAST_CHUNK) - 1;
+                write(slot);
+            }
+            slot.closing = true;
+        } else if (slot.closing) {
+            if (now - slot.last_ms >= CLOSE_DELAY_MS) {
+                slot.client.stop();
+                reset(slot);
+            }
+        } else if (read_request(slot)) {
+            respond(slot);
+        } else if (now - slot.last_ms >= REQUEST_TIMEOUT_MS) {
+            slot.client.stop();
+            reset(slot);
+        }
+        // Another chunk, or the last one, could go now
+        more |= slot.format != EXPORT_NONE && !slot.closing && !pending(slot);
+    }
+    return more;
+}
@@ -0,0 +1,94 @@
+/*
+ * ut61e_history_server.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <ESP8266WiFi.h>
+#include "ut61e_history.h"
+
+#ifndef UT61E_HISTORY_SERVER_H_
+#define UT61E_HISTORY_SERVER_H_
+
+#ifndef UT61E_HISTORY_CLIENTS
+#define UT61E_HISTORY_CLIENTS       2   // Simultaneous exports
+#endif
+#ifndef UT61E_HISTORY_CHUNK
+#define UT61E_HISTORY_CHUNK       512   // CSV bytes formatted per step
+#endif
+
+// Exports a UT61E_HISTORY over HTTP:
+//
+//   GET /history.csv?from=-3600000     the last hour as CSV
+//   GET /history.bin?from=T&to=T       blocks as stored, see README.md
+//
+// from and to are millis() on the device, or before now when negative.
+// X-UT61E-Now-Ms in the response gives now, to line them up with a clock.
+// The response is chunked (HTTP/1.1) and sent a chunk a loop(): the
+// binary export is one block per chunk, written straight from the ring;
+// the CSV export decodes a block a few rows at a time. A block reused
+// while it is being sent ends the response early, without the final
+// chunk, so the client sees it was cut short.
+class UT61E_HISTORY_SERVER {
+	private:
+		enum export_t : uint8_t { EXPORT_NONE, EXPORT_CSV, EXPORT_BINARY };
+		struct client_slot {
+			WiFiClient client;
+			uint32_t last_ms;           // Last request or response activity
+			bool first_line;
+			uint8_t line_length;
+			char line[96];              // The request line
+			bool blank;                 // No characters yet on this header line
+			export_t format;
+			bool chunked;               // HTTP/1.1; 1.0 gets the bytes until close
+			bool exporting;             // More to come after what is pending
+			bool closing;               // All sent: stop after a moment
+			uint32_t from_ms;
+			uint32_t to_ms;
+			uint32_t block;             // Next block to export, or the one being decoded
+			bool decoding;
+			bool header_row;            // CSV column names still to send
+			UT61E_DECODER decoder {nullptr, 0};
+			// Pending output, written in order: prefix, then body, then suffix
+			const uint8_t *body;
+			uint16_t body_length;
+			bool body_in_ring;          // body is a block's stream: give up if it is reused
+			uint32_t body_block;
+			uint8_t prefix_length;
+			uint8_t suffix_length;
+			uint16_t sent;
+			char prefix[32];            // Chunk size line, block header
+			char chunk[UT61E_HISTORY_CHUNK];
+		};
+		WiFiServer server;
+		UT61E_HISTORY &history;
+		client_slot slots[UT61E_HISTORY_CLIENTS];
+
+		void accept();
+		void reset(client_slot &slot);
+		bool read_request(client_slot &slot);
+		void respond(client_slot &slot);
+		void next_chunk(client_slot &slot);
+		bool next_block(client_slot &slot, ut61e_history_block &h, const uint8_t *&stream);
+		bool pending(const client_slot &slot) const;
+		void write(client_slot &slot);
+		void abort(client_slot &slot);
+	public:
+		UT61E_HISTORY_SERVER(uint16_t port, UT61E_HISTORY &history);
+		~UT61E_HISTORY_SERVER() { }
+
+		void begin();
+		// Accept clients, read requests and send at most one chunk each.
+		// Returns true while an export could go further right away.
+		bool loop();
+
+		uint32_t exports;
+		uint32_t aborted;           // Cut short: block reused, or the client stopped reading
+		uint32_t rejected;          // Connections turned away, all slots busy
+		uint32_t not_found;
+		uint32_t bytes_sent;
+};
+
+#endif /* UT61E_HISTORY_SERVER_H_ */
@@ -0,0 +1,276 @@
+/*
+ * ut61e_metrics.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_metrics.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define CLOSE_DELAY_MS      100   // Let the last response be acknowledged, so stop() doesn't wait
+#define READ_MAX_BYTES      512   // Request bytes read per client per loop
+#define SEND_TIMEOUT_MS    5000   // Give up on a scraper that stops reading, freeing the buffer
+
+static const char NOT_FOUND[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+UT61E_METRICS::UT61E_METRICS(uint16_t port, const ut61e_metric_t *m, uint8_t n):
+        server(port), metrics(m), count(n < UT61E_METRICS_MAX ? n : UT61E_METRICS_MAX) {
+    scrapes = 0;
+    renders = 0;
+    partial_writes = 0;
+    rejected = 0;
+    not_found = 0;
+    truncated = 0;
+    response = nullptr;
+    response_length = 0;
+    dirty = true;
+    for (auto &v: values) {
+        v.value = 0;
+        v.present = false;
+        v.labels[0] = 0;
+    }
+    for (auto &slot: slots)
+        reset(slot);
+}
+
+void UT61E_METRICS::begin() {
+    server.begin();
+    server.setNoDelay(true);
+}
+
+void UT61E_METRICS::set(uint8_t id, double value) {
+    if (id >= count)
+        return;
+    value_slot &v = values[id];
+    // Bitwise, so a NaN that stays NaN isn't a change
+    if (!v.present || memcmp(&v.value, &value, sizeof(value))) {
+        v.value = value;
+        v.present = true;
+        dirty = true;
+    }
+}
+
+void UT61E_METRICS::set(uint8_t id, double value, const char *labels) {
+    if (id >= count)
+        return;
+    value_slot &v = values[id];
+    if (strncmp(v.labels, labels, sizeof(v.labels) - 1)) {
+        strncpy(v.labels, labels, sizeof(v.labels) - 1);
+        v.labels[sizeof(v.labels) - 1] = 0;
+        dirty = true;
+    }
+    set(id, value);
+}
+
+void UT61E_METRICS::remove(uint8_t id) {
+    if (id < count && values[id].present) {
+        values[id].present = false;
+        dirty = true;
+    }
+}
+
+uint8_t UT61E_METRICS::clients() {
+    uint8_t n = 0;
+    for (auto &slot: slots)
+        if (slot.client.connected())
+            n++;
+    return n;
+}
+
+bool UT61E_METRICS::sending_buffer() const {
+    for (auto &slot: slots)
+        if (slot.response && slot.from_buffer)
+            return true;
+    return false;
+}
+
+// The body goes in after room for the headers, which are then written
+// right up against it once its length is known
+const char *UT61E_METRICS::render(size_t &length) {
+    if (dirty && !sending_buffer()) {
+        char *body = buffer + UT61E_METRICS_HEADER;
+        size_t size = sizeof(buffer) - UT61E_METRICS_HEADER, used = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            const value_slot &v = values[i];
+            if (!v.present)
+                continue;
+            const ut61e_metric_t &m = metrics[i];
+            char value[24];
+            if (std::isnan(v.value))
+                strcpy(value, "NaN");
+            else if (std::isinf(v.value))
+                strcpy(value, v.value < 0 ? "-Inf" : "+Inf");
+            else
+                snprintf(value, sizeof(value), "%.10g", v.value);
+            int n = snprintf(body + used, size - used, "# HELP %s %s\n# TYPE %s %s\n%s%s%s%s %s\n",
+                             m.name, m.help, m.name, m.type == UT61E_METRIC_COUNTER ? "counter" : "gauge",
+                             m.name, v.labels[0] ? "{" : "", v.labels, v.labels[0] ? "}" : "", value);
+            if (n < 0 || (size_t)n >= size - used) {
+                truncated++;
+                break;
+            }
+            used += n;
+        }
+        char header[UT61E_METRICS_HEADER];
+        int header_length = snprintf(header, sizeof(header),
+            "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Content-Length: %u\r\n\r\n", (unsigned)used);
+        response = body - header_length;
+        memcpy((char *)response, header, header_length);
+        response_length = header_length + used;
+        renders++;
+        dirty = false;
+    }
+    length = response_length;
+    return response;
+}
+
+void UT61E_METRICS::reset(client_slot &slot) {
+    slot.last_ms = millis();
+    slot.response = nullptr;
+    slot.length = 0;
+    slot.sent = 0;
+    slot.from_buffer = false;
+    slot.close = false;
+    slot.closing = false;
+    slot.first_line = true;
+    slot.metrics = false;
+    slot.line_length = 0;
+}
+
+void UT61E_METRICS::accept() {
+    if (!server.hasClient())
+        return;
+    WiFiClient incoming = server.available();
+    client_slot *free_slot = nullptr, *idle = nullptr;
+    for (auto &slot: slots) {
+        if (!slot.client.connected()) {
+            free_slot = &slot;
+            break;
+        }
+        // A kept alive connection between scrapes can make room
+        if (!slot.response && !slot.closing && slot.first_line && !slot.line_length
+            && (!idle || (int32_t)(slot.last_ms - idle->last_ms) < 0))
+            idle = &slot;
+    }
+    if (!free_slot && idle)
+        free_slot = idle;
+    if (!free_slot) {
+        incoming.stop();
+        rejected++;
+        return;
+    }
+    free_slot->client.stop();
+    free_slot->client = incoming;
+    free_slot->client.setNoDelay(true);
+    reset(*free_slot);
+}
+
+// Only the request line and a Connection header matter. Lines are kept
+// lower case and cut short; the end of the headers finishes the request.
+bool UT61E_METRICS::read_request(client_slot &slot) {
+    size_t n = 0;
+    while (n++ < READ_MAX_BYTES && slot.client.available()) {
+        int c = slot.client.read();
+        if (c < 0)
+            break;
+        slot.last_ms = millis();
+        if (c == '\r')
+            continue;
+        if (c != '\n') {
+            if (slot.line_length < sizeof(slot.line) - 1)
+                slot.line[slot.line_length++] = tolower(c);
+            continue;
+        }
+        slot.line[slot.line_length] = 0;
+        if (slot.first_line) {
+            if (slot.line_length) {
+                slot.metrics = !strncmp(slot.line, "get /metrics", 12)
+                    && (slot.line[12] == ' ' || slot.line[12] == '?' || slot.line[12] == 0);
+                slot.close = strstr(slot.line, "http/1.0") != nullptr;
+                slot.first_line = false;
+            }
+        } else if (!slot.line_length) {
+            slot.first_line = true;
+            return true;
+        } else if (!strncmp(slot.line, "connection:", 11)) {
+            if (strstr(slot.line + 11, "close"))
+                slot.close = true;
+            else if (strstr(slot.line + 11, "keep-alive"))
+                slot.close = false;
+        }
+        slot.line_length = 0;
+    }
+    return false;
+}
+
+void UT61E_METRICS::respond(client_slot &slot) {
+    if (slot.metrics) {
+        size_t length;
+        slot.response = render(length);
+        slot.length = length;
+        slot.from_buffer = true;
+        scrapes++;
+    } else {
+        slot.response = NOT_FOUND;
+        slot.length = sizeof(NOT_FOUND) - 1;
+        slot.from_buffer = false;
+        not_found++;
+    }
+    slot.sent = 0;
+    write(slot);
+}
+
+// All of it in one write when the socket has room, as it normally does
+void UT61E_METRICS::write(client_slot &slot) {
+    size_t remaining = slot.length - slot.sent;
+    size_t room = slot.client.availableForWrite();
+    if (room > remaining)
+        room = remaining;
+    if (!room)
+        return;
+    size_t written = slot.client.write((const uint8_t *)slot.response + slot.sent, room);
+    if (slot.sent == 0 && written < slot.length)
+        partial_writes++;
+    slot.sent += written;
+    slot.last_ms = millis();
+    if (slot.sent < slot.length)
+        return;
+    slot.response = nullptr;
+    slot.from_buffer = false;
+    slot.closing = slot.close;
+}
+
+void UT61E_METRICS::loop() {
+    accept();
+    uint32_t now = millis();
+    for (auto &slot: slots) {
+        if (!slot.client.connected()) {
+            if (slot.response || slot.closing || !slot.first_line)
+                reset(slot);
+            continue;
+        }
+        if (slot.response) {
+            write(slot);
+            if (slot.response && now - slot.last_ms >= SEND_TIMEOUT_MS) {
+                slot.client.stop();
+                reset(slot);
+            }
+        } else if (slot.closing) {
+            if (now - slot.last_ms >= CLOSE_DELAY_MS) {
+                slot.client.stop();
+                reset(slot);
+            }
+        } else if (read_request(slot)) {
+            respond(slot);
+        } else if (now - slot.last_ms >= UT61E_METRICS_IDLE_MS) {
+            slot.client.stop();
+            reset(slot);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * ut61e_metrics.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <ESP8266WiFi.h>
+
+#ifndef UT61E_METRICS_H_
+#define UT61E_METRICS_H_
+
+#ifndef UT61E_METRICS_MAX
+#define UT61E_METRICS_MAX          32   // Metrics that can be defined
+#endif
+#ifndef UT61E_METRICS_CLIENTS
+#define UT61E_METRICS_CLIENTS       4   // Simultaneous scrapers
+#endif
+#ifndef UT61E_METRICS_BUFFER
+#define UT61E_METRICS_BUFFER     4096   // The whole response, headers and body
+#endif
+#ifndef UT61E_METRICS_IDLE_MS
+#define UT61E_METRICS_IDLE_MS   60000   // Close keep-alive connections idle this long
+#endif
+
+#define UT61E_METRICS_LABELS       40   // Label text per metric, e.g. mode="voltage",unit="V"
+#define UT61E_METRICS_HEADER      112   // Room kept in front of the body for the HTTP headers
+
+enum ut61e_metric_type_t : uint8_t {
+	UT61E_METRIC_GAUGE = 0,
+	UT61E_METRIC_COUNTER
+};
+
+// A metric as the firmware defines it. Names and help text must outlive
+// the server.
+struct ut61e_metric_t {
+	const char *name;
+	const char *help;
+	ut61e_metric_type_t type;
+};
+
+// Serves GET /metrics in the Prometheus text format. The response, headers
+// included, is rendered into one buffer that every scraper shares, and only
+// again once a value has changed since. A scrape is then a single write()
+// from that buffer. Nothing blocks: a request is read as far as it has
+// arrived, a response that doesn't fit the socket is finished on later
+// loops, and the buffer isn't rendered over while anyone is still being
+// sent it. Connections are kept alive, as Prometheus does, and the one idle
+// longest makes room when all slots are taken.
+class UT61E_METRICS {
+	private:
+		struct value_slot {
+			double value;
+			bool present;
+			char labels[UT61E_METRICS_LABELS];
+		};
+		struct client_slot {
+			WiFiClient client;
+			uint32_t last_ms;         // Last request or response activity
+			const char *response;     // Being sent, or null
+			uint16_t length;
+			uint16_t sent;
+			bool from_buffer;         // response points into the shared buffer
+			bool close;               // Close once the response is out ...
+			bool closing;             // ... which it is: stop after a moment
+			bool first_line;
+			bool metrics;             // The request line asked for /metrics
+			uint8_t line_length;
+			char line[32];
+		};
+		WiFiServer server;
+		const ut61e_metric_t *metrics;
+		uint8_t count;
+		value_slot values[UT61E_METRICS_MAX];
+		client_slot slots[UT61E_METRICS_CLIENTS];
+		char buffer[UT61E_METRICS_BUFFER];
+		const char *response;
+		size_t response_length;
+		bool dirty;
+
+		void accept();
+		void reset(client_slot &slot);
+		bool read_request(client_slot &slot);
+		void respond(client_slot &slot);
+		void write(client_slot &slot);
+		bool sending_buffer() const;
+	public:
+		UT61E_METRICS(uint16_t port, const ut61e_metric_t *metrics, uint8_t count);
+		~UT61E_METRICS() { }
+
+		void begin();
+		// Set a metric, marking the response for rendering if it changed.
+		// Labels are the text between the braces, without them.
+		void set(uint8_t id, double value);
+		void set(uint8_t id, double value, const char *labels);
+		// Leave a metric out until it is set again
+		void remove(uint8_t id);
+		// Accept scrapers, read their requests and send responses
+		void loop();
+		// The current response, rendered first if anything changed
+		const char *render(size_t &length);
+		uint8_t clients();
+
+		uint32_t scrapes;
+		uint32_t renders;
+		uint32_t partial_writes;  // Responses that took more than one write
+		uint32_t rejected;        // Connections turned away, all slots busy
+		uint32_t not_found;       // Requests for anything but /metrics
+		uint32_t truncated;       // Renders that ran out of buffer
+};
+
+#endif /* UT61E_METRICS_H_ */
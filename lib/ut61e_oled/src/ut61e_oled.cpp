@@ -0,0 +1,364 @@
+/*
+ * ut61e_oled.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstring>
+#include "ut61e_oled.h"
+
+// Characters outside ASCII get a code of their own
+#define GLYPH_MICRO     '\x01'
+#define GLYPH_OHM       '\x02'
+#define GLYPH_DEGREE    '\x03'
+
+// 5x7 font, a byte per column, LSB at the top. Only what the meter shows.
+struct glyph_t {
+    char c;
+    uint8_t columns[5];
+};
+
+static const glyph_t FONT[] = {
+    {'0', {0x3E, 0x51, 0x49, 0x45, 0x3E}}, {'1', {0x00, 0x42, 0x7F, 0x40, 0x00}},
+    {'2', {0x42, 0x61, 0x51, 0x49, 0x46}}, {'3', {0x21, 0x41, 0x45, 0x4B, 0x31}},
+    {'4', {0x18, 0x14, 0x12, 0x7F, 0x10}}, {'5', {0x27, 0x45, 0x45, 0x45, 0x39}},
+    {'6', {0x3C, 0x4A, 0x49, 0x49, 0x30}}, {'7', {0x01, 0x71, 0x09, 0x05, 0x03}},
+    {'8', {0x36, 0x49, 0x49, 0x49, 0x36}}, {'9', {0x06, 0x49, 0x49, 0x29, 0x1E}},
+    {'A', {0x7E, 0x11, 0x11, 0x11, 0x7E}}, {'C', {0x3E, 0x41, 0x41, 0x41, 0x22}},
+    {'D', {0x7F, 0x41, 0x41, 0x22, 0x1C}}, {'E', {0x7F, 0x49, 0x49, 0x49, 0x41}},
+    {'F', {0x7F, 0x09, 0x09, 0x09, 0x01}}, {'H', {0x7F, 0x08, 0x08, 0x08, 0x7F}},
+    {'I', {0x00, 0x41, 0x7F, 0x41, 0x00}}, {'L', {0x7F, 0x40, 0x40, 0x40, 0x40}},
+    {'M', {0x7F, 0x02, 0x0C, 0x02, 0x7F}}, {'N', {0x7F, 0x04, 0x08, 0x10, 0x7F}},
+    {'O', {0x3E, 0x41, 0x41, 0x41, 0x3E}}, {'P', {0x7F, 0x09, 0x09, 0x09, 0x06}},
+    {'Q', {0x3E, 0x41, 0x51, 0x21, 0x5E}}, {'R', {0x7F, 0x09, 0x19, 0x29, 0x46}},
+    {'T', {0x01, 0x01, 0x7F, 0x01, 0x01}}, {'U', {0x3F, 0x40, 0x40, 0x40, 0x3F}},
+    {'V', {0x1F, 0x20, 0x40, 0x20, 0x1F}}, {'X', {0x63, 0x14, 0x08, 0x14, 0x63}},
+    {'Y', {0x07, 0x08, 0x70, 0x08, 0x07}}, {'k', {0x7F, 0x10, 0x28, 0x44, 0x00}},
+    {'m', {0x7C, 0x04, 0x18, 0x04, 0x78}}, {'n', {0x7C, 0x08, 0x04, 0x04, 0x78}},
+    {'z', {0x44, 0x64, 0x54, 0x4C, 0x44}}, {'%', {0x23, 0x13, 0x08, 0x64, 0x62}},
+    {'-', {0x08, 0x08, 0x08, 0x08, 0x08}}, {'?', {0x02, 0x01, 0x51, 0x09, 0x06}},
+    {GLYPH_MICRO,  {0xFC, 0x20, 0x20, 0x10, 0x3C}},
+    {GLYPH_OHM,    {0x5E, 0x61, 0x01, 0x61, 0x5E}},
+    {GLYPH_DEGREE, {0x00, 0x06, 0x09, 0x09, 0x06}},
+};
+
+// Seven segment patterns, bit 0 = a (top) round to bit 6 = g (middle)
+static uint8_t segments(char c) {
+    static const uint8_t DIGITS[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+    if (c >= '0' && c <= '9')
+        return DIGITS[c - '0'];
+    switch (c) {
+        case '-': return 0x40;
+        case 'L': return 0x38;
+        case 'U': return 0x3E;
+        case 'E': return 0x79;
+        default:  return 0;
+    }
+}
+
+static const glyph_t *glyph(char c) {
+    for (const glyph_t &g : FONT)
+        if (g.c == c)
+            return &g;
+    return c == ' ' ? nullptr : glyph('?');
+}
+
+// Screen geometry. Flags on the top row, the digits below, mode and unit on
+// the bottom row.
+#define DIGIT_X(i)      (10 + (i) * 23)
+#define DIGIT_Y         12
+#define DIGIT_W         17
+#define DIGIT_H         34
+#define SEGMENT         3
+
+struct slot_area_t {
+    uint8_t x, y, w, h;
+};
+
+static slot_area_t slot_area(uint8_t id) {
+    // Order as the slot enum: sign, 5 digits, 4 decimal points, current
+    // type, auto, hold, rel, peak, battery, mode, unit
+    static const slot_area_t AREAS[] = {
+        {0, DIGIT_Y, 8, DIGIT_H},
+        {DIGIT_X(0), DIGIT_Y, DIGIT_W, DIGIT_H}, {DIGIT_X(1), DIGIT_Y, DIGIT_W, DIGIT_H},
+        {DIGIT_X(2), DIGIT_Y, DIGIT_W, DIGIT_H}, {DIGIT_X(3), DIGIT_Y, DIGIT_W, DIGIT_H},
+        {DIGIT_X(4), DIGIT_Y, DIGIT_W, DIGIT_H},
+        {DIGIT_X(0) + 18, DIGIT_Y + DIGIT_H - 3, 3, 3}, {DIGIT_X(1) + 18, DIGIT_Y + DIGIT_H - 3, 3, 3},
+        {DIGIT_X(2) + 18, DIGIT_Y + DIGIT_H - 3, 3, 3}, {DIGIT_X(3) + 18, DIGIT_Y + DIGIT_H - 3, 3, 3},
+        {0, 0, 12, 8}, {16, 0, 24, 8}, {44, 0, 24, 8}, {72, 0, 18, 8}, {94, 0, 18, 8}, {116, 0, 12, 8},
+        {0, 56, 60, 8},
+        {64, 50, 64, 14},
+    };
+    return AREAS[id];
+}
+
+// Short names for the bottom row, by ut61e_mode_t
+static const char *const MODE_LABELS[UT61E_MODE_COUNT] = {
+    "", "VOLT", "AMP", "OHM", "CONT", "DIODE", "FREQ", "CAP", "TEMP", "ADP", "DUTY"
+};
+
+// The unit as the font has it: µ, Ω and deg to their glyph codes
+static void unit_glyphs(const string &unit, char *out, size_t size) {
+    size_t n = 0;
+    for (size_t i = 0; i < unit.size() && n + 1 < size; i++) {
+        if (!unit.compare(i, 2, "µ")) {
+            out[n++] = GLYPH_MICRO;
+            i++;
+        } else if (!unit.compare(i, 2, "Ω")) {
+            out[n++] = GLYPH_OHM;
+            i++;
+        } else if (!unit.compare(i, 3, "deg")) {
+            out[n++] = GLYPH_DEGREE;
+            i += 2;
+        } else
+            out[n++] = unit[i];
+    }
+    out[n] = 0;
+}
+
+UT61E_OLED::UT61E_OLED(UT61E_OLED_BUS &bus):
+    updates(0), glyphs_drawn(0), bytes_sent(0), bus(bus) {
+    memset(frame, 0, sizeof(frame));
+    memset(shown, 0, sizeof(shown));
+    memset(drawn, 0, sizeof(drawn));
+    memset(dirty_from, 0xff, sizeof(dirty_from));
+    memset(dirty_to, 0, sizeof(dirty_to));
+}
+
+// Whatever the panel held at power up is cleared here, in full, so the
+// incremental updates after this start from a known blank screen
+bool UT61E_OLED::begin() {
+    if (!bus.begin())
+        return false;
+    memset(frame, 0, sizeof(frame));
+    memset(shown, 0, sizeof(shown));
+    memset(drawn, 0, sizeof(drawn));
+    memset(dirty_from, 0xff, sizeof(dirty_from));
+    memset(dirty_to, 0, sizeof(dirty_to));
+    for (uint8_t page = 0; page < UT61E_OLED_PAGES; page++)
+        for (uint8_t column = 0; column < UT61E_OLED_WIDTH; column += UT61E_OLED_CHUNK)
+            if (!bus.write(page, column, shown[page] + column, UT61E_OLED_CHUNK))
+                return false;
+    return true;
+}
+
+void UT61E_OLED::show(const UT61E_DISP &dmm) {
+    ut61e_shown_t s;
+    dmm.shown(s);
+    show(dmm.reading, s);
+}
+
+void UT61E_OLED::show(const ut61e_reading_t &r, const ut61e_shown_t &s) {
+    uint32_t drawn_before = glyphs_drawn;
+    uint16_t flags = r.flags;
+
+    // The digits, sign, decimal points and unit stay as they were in HOLD
+    if (!(flags & UT61E_FLAG_HOLD)) {
+        char digits[5] = {' ', ' ', ' ', ' ', ' '};
+        bool point[4] = {false, false, false, false};
+        if (flags & (UT61E_FLAG_OVERLOAD | UT61E_FLAG_UNDERLOAD)) {
+            // The meter shows 0.L or U.L
+            digits[1] = flags & UT61E_FLAG_OVERLOAD ? '0' : 'U';
+            digits[2] = 'L';
+            point[1] = true;
+        } else {
+            int n = 0;
+            for (const char *p = s.display_string; *p && n <= 5; p++) {
+                if (*p == '.') {
+                    if (n >= 1 && n <= 4)
+                        point[n - 1] = true;
+                } else if (n < 5)
+                    digits[n++] = *p;
+            }
+        }
+        char one[2] = {0, 0};
+        slot(SLOT_SIGN, flags & UT61E_FLAG_NEGATIVE ? "-" : "");
+        for (uint8_t i = 0; i < 5; i++) {
+            one[0] = digits[i];
+            slot(SLOT_DIGIT + i, one);
+        }
+        for (uint8_t i = 0; i < 4; i++)
+            slot(SLOT_DP + i, point[i] ? "." : "");
+
+        char unit[12];
+        if (r.mode == UT61E_MODE_DUTY_CYCLE)
+            strcpy(unit, "%");
+        else
+            unit_glyphs(s.display_unit, unit, sizeof(unit));
+        slot(SLOT_UNIT, unit);
+    }
+
+    slot(SLOT_CURRENT, flags & UT61E_FLAG_AC ? "AC" : flags & UT61E_FLAG_DC ? "DC" : "");
+    slot(SLOT_AUTO, flags & UT61E_FLAG_AUTO ? "AUTO" : "MAN");
+    slot(SLOT_HOLD, flags & UT61E_FLAG_HOLD ? "HOLD" : "");
+    slot(SLOT_REL, flags & UT61E_FLAG_RELATIVE ? "REL" : "");
+    slot(SLOT_PEAK, flags & UT61E_FLAG_PEAK_MAX ? "MAX" : flags & UT61E_FLAG_PEAK_MIN ? "MIN" : "");
+    slot(SLOT_BATTERY, flags & UT61E_FLAG_BATTERY_LOW ? "B" : "");
+    slot(SLOT_MODE, r.mode < UT61E_MODE_COUNT ? MODE_LABELS[r.mode] : "");
+
+    if (glyphs_drawn != drawn_before)
+        updates++;
+}
+
+// Redraw one part of the screen if what it should show has changed
+void UT61E_OLED::slot(uint8_t id, const char *content) {
+    if (!strncmp(drawn[id], content, sizeof(drawn[id]) - 1))
+        return;
+    strncpy(drawn[id], content, sizeof(drawn[id]) - 1);
+    glyphs_drawn++;
+
+    slot_area_t a = slot_area(id);
+    fill(a.x, a.y, a.w, a.h, false);
+    mark(a.x, a.y, a.w, a.h);
+    if (!*content)
+        return;
+
+    if (id == SLOT_SIGN)
+        fill(a.x, DIGIT_Y + (DIGIT_H - SEGMENT) / 2, 7, SEGMENT, true);
+    else if (id >= SLOT_DIGIT && id < SLOT_DP)
+        seven_segment(a.x, *content);
+    else if (id >= SLOT_DP && id < SLOT_CURRENT)
+        fill(a.x, a.y, a.w, a.h, true);
+    else if (id == SLOT_BATTERY) {
+        // A battery outline with a terminal nub
+        fill(a.x, a.y + 1, 10, 6, true);
+        fill(a.x + 1, a.y + 2, 8, 4, false);
+        fill(a.x + 10, a.y + 3, 2, 2, true);
+    } else if (id == SLOT_UNIT)
+        text(a.x, a.y, content, 2, true, a.x + a.w);
+    else
+        text(a.x, a.y, content, 1, false, 0);
+}
+
+void UT61E_OLED::fill(int x, int y, int w, int h, bool on) {
+    for (int col = x; col < x + w && col < UT61E_OLED_WIDTH; col++)
+        for (int row = y; row < y + h && row < UT61E_OLED_PAGES * 8; row++) {
+            uint8_t bit = 1 << (row % 8);
+            if (on)
+                frame[row / 8][col] |= bit;
+            else
+                frame[row / 8][col] &= ~bit;
+        }
+}
+
+// Font text at scale times size, left aligned at x or right aligned to right
+void UT61E_OLED::text(int x, int y, const char *s, uint8_t scale, bool right_align, int right) {
+    int advance = 6 * scale;
+    if (right_align)
+        x = right - (int)strlen(s) * advance + scale;
+    for (; *s; s++, x += advance) {
+        const glyph_t *g = glyph(*s);
+        if (!g)
+            continue;
+        for (int col = 0; col < 5; col++)
+            for (int row = 0; row < 8; row++)
+                if (g->columns[col] & (1 << row))
+                    fill(x + col * scale, y + row * scale, scale, scale, true);
+    }
+}
+
+void UT61E_OLED::seven_segment(int x, char c) {
+    uint8_t s = segments(c);
+    int y = DIGIT_Y;
+    int middle = y + (DIGIT_H - SEGMENT) / 2;
+    int upper = middle - y - SEGMENT;
+    int lower = y + DIGIT_H - SEGMENT - middle - SEGMENT;
+    if (s & 0x01) fill(x + SEGMENT, y, DIGIT_W - 2 * SEGMENT, SEGMENT, true);
+    if (s & 0x02) fill(x + DIGIT_W - SEGMENT, y + SEGMENT, SEGMENT, upper, true);
+    if (s & 0x04) fill(x + DIGIT_W - SEGMENT, middle + SEGMENT, SEGMENT, lower, true);
+    if (s & 0x08) fill(x + SEGMENT, y + DIGIT_H - SEGMENT, DIGIT_W - 2 * SEGMENT, SEGMENT, true);
+    if (s & 0x10) fill(x, middle + SEGMENT, SEGMENT, lower, true);
+    if (s & 0x20) fill(x, y + SEGMENT, SEGMENT, upper, true);
+    if (s & 0x40) fill(x + SEGMENT, middle, DIGIT_W - 2 * SEGMENT, SEGMENT, true);
+}
+
+// Widen the dirty column range of every page the area touches
+void UT61E_OLED::mark(int x, int y, int w, int h) {
+    int right = x + w - 1 < UT61E_OLED_WIDTH ? x + w - 1 : UT61E_OLED_WIDTH - 1;
+    int bottom = y + h - 1 < UT61E_OLED_PAGES * 8 ? y + h - 1 : UT61E_OLED_PAGES * 8 - 1;
+    for (int page = y / 8; page <= bottom / 8; page++) {
+        if (dirty_from[page] > dirty_to[page]) {
+            dirty_from[page] = x;
+            dirty_to[page] = right;
+        } else {
+            if (x < dirty_from[page])
+                dirty_from[page] = x;
+            if (right > dirty_to[page])
+                dirty_to[page] = right;
+        }
+    }
+}
+
+bool UT61E_OLED::dirty() const {
+    for (uint8_t page = 0; page < UT61E_OLED_PAGES; page++)
+        if (dirty_from[page] <= dirty_to[page])
+            return true;
+    return false;
+}
+
+// Within the dirty range only the runs of bytes that actually differ from
+// the panel are sent. Runs closer together than the cost of addressing a
+// new one are joined.
+bool UT61E_OLED::flush(uint16_t max_bytes) {
+    const int JOIN = 4;
+    for (uint8_t page = 0; page < UT61E_OLED_PAGES && max_bytes; page++) {
+        while (dirty_from[page] <= dirty_to[page] && max_bytes) {
+            int column = dirty_from[page];
+            int end = dirty_to[page];
+            while (column <= end && frame[page][column] == shown[page][column])
+                column++;
+            if (column > end) {
+                dirty_from[page] = 0xff;
+                dirty_to[page] = 0;
+                break;
+            }
+            int limit = column + (max_bytes < UT61E_OLED_CHUNK ? max_bytes : UT61E_OLED_CHUNK) - 1;
+            if (limit > end)
+                limit = end;
+            int last = column;
+            for (int c = column + 1; c <= limit && c - last <= JOIN; c++)
+                if (frame[page][c] != shown[page][c])
+                    last = c;
+            uint8_t length = last - column + 1;
+            if (!bus.write(page, column, frame[page] + column, length))
+                return true;
+            memcpy(shown[page] + column, frame[page] + column, length);
+            bytes_sent += length;
+            max_bytes -= length;
+            if (last >= end) {
+                dirty_from[page] = 0xff;
+                dirty_to[page] = 0;
+            } else
+                dirty_from[page] = last + 1;
+        }
+    }
+    return dirty();
+}
+
+bool UT61E_OLED_FRAMEBUFFER::begin() {
+    memset(memory, 0xa5, sizeof(memory));   // Power up noise, begin() has to clear it
+    return true;
+}
+
+// On I2C a write is two transactions: address, control byte and three page
+// addressing commands, then address, control byte and the pixel bytes
+bool UT61E_OLED_FRAMEBUFFER::write(uint8_t page, uint8_t column, const uint8_t *data, uint8_t length) {
+    if (page >= UT61E_OLED_PAGES || column + length > UT61E_OLED_WIDTH)
+        return false;
+    memcpy(memory[page] + column, data, length);
+    writes++;
+    bus_bytes += 5 + 2 + length;
+    return true;
+}
+
+size_t UT61E_OLED_FRAMEBUFFER::ascii(char *out, size_t size) const {
+    size_t n = 0;
+    for (uint8_t y = 0; y < UT61E_OLED_PAGES * 8; y++)
+        for (uint8_t x = 0; x <= UT61E_OLED_WIDTH && n + 1 < size; x++)
+            out[n++] = x == UT61E_OLED_WIDTH ? '\n' : pixel(x, y) ? '#' : '.';
+    if (size)
+        out[n] = 0;
+    return n;
+}
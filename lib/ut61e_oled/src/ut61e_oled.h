@@ -0,0 +1,92 @@
+/*
+ * ut61e_oled.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_display.h"
+
+#ifndef UT61E_OLED_H_
+#define UT61E_OLED_H_
+
+#define UT61E_OLED_WIDTH        128
+#define UT61E_OLED_PAGES        8       // 8 pixel rows each, 64 rows
+#define UT61E_OLED_CHUNK        32      // Most pixel bytes in one bus write
+
+// Where the pixels go. SSD1306/SH1106 memory is organised in pages: one
+// byte is a column of 8 pixels, LSB at the top.
+class UT61E_OLED_BUS {
+	public:
+		virtual ~UT61E_OLED_BUS() { }
+		virtual bool begin() = 0;
+		// Write length bytes into page starting at column
+		virtual bool write(uint8_t page, uint8_t column, const uint8_t *data, uint8_t length) = 0;
+
+		uint32_t writes {0};
+		uint32_t bus_bytes {0};   // Including addressing, as they go over the wire
+};
+
+// Host backend: keeps what a panel would show, and counts bytes as an I2C
+// SSD1306 would take them (see UT61E_OLED_I2C)
+class UT61E_OLED_FRAMEBUFFER: public UT61E_OLED_BUS {
+	public:
+		bool begin() override;
+		bool write(uint8_t page, uint8_t column, const uint8_t *data, uint8_t length) override;
+		bool pixel(uint8_t x, uint8_t y) const { return memory[y / 8][x] & (1 << (y % 8)); }
+		// The screen as text, '#' per lit pixel, a line per row
+		size_t ascii(char *out, size_t size) const;
+
+		uint8_t memory[UT61E_OLED_PAGES][UT61E_OLED_WIDTH];
+};
+
+// Mirrors the meter's LCD on a 128x64 OLED: flags along the top, the five
+// seven-segment digits with sign and decimal point, the mode and the unit
+// underneath.
+//
+// show() works out which parts of the display changed since the last
+// reading and redraws only those into a framebuffer, marking the columns it
+// touched. flush() then sends only the bytes that differ from what the panel
+// already has, a bounded number at a time, so a slow I2C bus can be fed from
+// a low priority task without holding up serial capture.
+//
+// In HOLD the meter carries on sending live readings, not what its display
+// shows, so the digits and unit stay frozen until HOLD is released.
+class UT61E_OLED {
+	public:
+		UT61E_OLED(UT61E_OLED_BUS &bus);
+		~UT61E_OLED() { }
+
+		// Initialise the panel and clear it
+		bool begin();
+		// Draw what changed since the last call
+		void show(const ut61e_reading_t &r, const ut61e_shown_t &s);
+		void show(const UT61E_DISP &dmm);
+		// Send up to max_bytes of changed pixels. True while more are waiting.
+		bool flush(uint16_t max_bytes = 0xffff);
+		bool dirty() const;
+
+		uint8_t frame[UT61E_OLED_PAGES][UT61E_OLED_WIDTH];   // What the panel should show
+		uint32_t updates;          // show() calls that changed something
+		uint32_t glyphs_drawn;
+		uint32_t bytes_sent;       // Pixel bytes
+	private:
+		enum { SLOT_SIGN, SLOT_DIGIT, SLOT_DP = SLOT_DIGIT + 5, SLOT_CURRENT = SLOT_DP + 4, SLOT_AUTO,
+		       SLOT_HOLD, SLOT_REL, SLOT_PEAK, SLOT_BATTERY, SLOT_MODE, SLOT_UNIT, SLOT_COUNT };
+		UT61E_OLED_BUS &bus;
+		char drawn[SLOT_COUNT][12];                          // Content of each slot as last drawn
+		uint8_t shown[UT61E_OLED_PAGES][UT61E_OLED_WIDTH];   // What the panel has
+		uint8_t dirty_from[UT61E_OLED_PAGES];                // Column range to compare, from > to if clean
+		uint8_t dirty_to[UT61E_OLED_PAGES];
+
+		void slot(uint8_t id, const char *content);
+		void fill(int x, int y, int w, int h, bool on);
+		void text(int x, int y, const char *s, uint8_t scale, bool right_align, int right);
+		void seven_segment(int x, char c);
+		void mark(int x, int y, int w, int h);
+};
+
+#endif /* UT61E_OLED_H_ */
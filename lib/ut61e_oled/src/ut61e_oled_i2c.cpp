@@ -0,0 +1,77 @@
+/*
+ * ut61e_oled_i2c.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_oled_i2c.h"
+
+// Control bytes: the rest of the transaction is commands, or display data
+#define CONTROL_COMMAND     0x00
+#define CONTROL_DATA        0x40
+
+UT61E_OLED_I2C::UT61E_OLED_I2C(TwoWire &wire, uint8_t address, ut61e_oled_controller_t controller):
+    wire(wire), address(address), controller(controller) { }
+
+bool UT61E_OLED_I2C::commands(const uint8_t *bytes, uint8_t length) {
+    wire.beginTransmission(address);
+    wire.write(CONTROL_COMMAND);
+    wire.write(bytes, length);
+    bus_bytes += 2 + length;
+    if (wire.endTransmission() != 0) {
+        errors++;
+        return false;
+    }
+    return true;
+}
+
+bool UT61E_OLED_I2C::begin() {
+    static const uint8_t SSD1306_INIT[] = {
+        0xAE,           // Display off
+        0xD5, 0x80,     // Clock divide
+        0xA8, 0x3F,     // 64 rows
+        0xD3, 0x00,     // No display offset
+        0x40,           // Start line 0
+        0x8D, 0x14,     // Charge pump on
+        0x20, 0x02,     // Page addressing
+        0xA1, 0xC8,     // Column and row scan flipped: connector at the top
+        0xDA, 0x12,     // COM pins
+        0x81, 0xCF,     // Contrast
+        0xD9, 0xF1,     // Precharge
+        0xDB, 0x40,     // VCOMH
+        0xA4, 0xA6,     // Show RAM, not inverted
+        0xAF            // Display on
+    };
+    static const uint8_t SH1106_INIT[] = {
+        0xAE, 0xD5, 0x80, 0xA8, 0x3F, 0xD3, 0x00, 0x40,
+        0xAD, 0x8B,     // DC-DC on
+        0xA1, 0xC8, 0xDA, 0x12, 0x81, 0xCF, 0xD9, 0x1F, 0xDB, 0x40, 0xA4, 0xA6,
+        0xAF
+    };
+    if (controller == UT61E_OLED_SH1106)
+        return commands(SH1106_INIT, sizeof(SH1106_INIT));
+    return commands(SSD1306_INIT, sizeof(SSD1306_INIT));
+}
+
+// Position with three commands, then the pixel bytes in one transaction.
+// UT61E_OLED never sends more than UT61E_OLED_CHUNK at once, well inside the
+// Wire buffer.
+bool UT61E_OLED_I2C::write(uint8_t page, uint8_t column, const uint8_t *data, uint8_t length) {
+    if (controller == UT61E_OLED_SH1106)
+        column += 2;
+    uint8_t position[3] = {(uint8_t)(0xB0 | page), (uint8_t)(column & 0x0F), (uint8_t)(0x10 | column >> 4)};
+    if (!commands(position, sizeof(position)))
+        return false;
+    wire.beginTransmission(address);
+    wire.write(CONTROL_DATA);
+    wire.write(data, length);
+    writes++;
+    bus_bytes += 2 + length;
+    if (wire.endTransmission() != 0) {
+        errors++;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+/*
+ * ut61e_oled_i2c.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <Wire.h>
+#include "ut61e_oled.h"
+
+#ifndef UT61E_OLED_I2C_H_
+#define UT61E_OLED_I2C_H_
+
+enum ut61e_oled_controller_t {
+	UT61E_OLED_SSD1306,
+	UT61E_OLED_SH1106        // 132 column memory, the 128 visible start at 2
+};
+
+// SSD1306 or SH1106 panel on I2C, in page addressing mode (the only one the
+// SH1106 has). Wire must already be started on the right pins.
+class UT61E_OLED_I2C: public UT61E_OLED_BUS {
+	public:
+		UT61E_OLED_I2C(TwoWire &wire, uint8_t address, ut61e_oled_controller_t controller = UT61E_OLED_SSD1306);
+		bool begin() override;
+		bool write(uint8_t page, uint8_t column, const uint8_t *data, uint8_t length) override;
+
+		uint32_t errors {0};     // Transactions the panel didn't acknowledge
+	private:
+		TwoWire &wire;
+		uint8_t address;
+		ut61e_oled_controller_t controller;
+		bool commands(const uint8_t *bytes, uint8_t length);
+};
+
+#endif /* UT61E_OLED_I2C_H_ */
@@ -0,0 +1,416 @@
+/*
+ * ut61e_protocol.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Meter protocol policies. Each one describes a DMM chipset's serial frames:
+ * how to find frame boundaries in the byte stream and how to turn a frame
+ * into a ut61e_reading_t (and back, for simulation and tests). The framer
+ * (ut61e_framer.h) and UT61E_PROTOCOL_DECODER below are templates on the
+ * policy, so a build for one meter has no virtual calls and only that
+ * meter's tables.
+ *
+ *   ES51922  UT61E: 12 data bytes + CR LF, 22000 counts
+ *   FS9721   UT60/UT61B/C/D style LCD segment frames: 14 bytes whose high
+ *            nibbles count 1-14, 4000 counts
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "ut61e_reading.h"
+
+#ifndef UT61E_PROTOCOL_H_
+#define UT61E_PROTOCOL_H_
+
+// What a policy's check() says about the bytes collected so far
+#define UT61E_FRAME_MORE       0    // Keep collecting
+#define UT61E_FRAME_COMPLETE  -1    // The buffer holds a whole frame
+// Anything above 0: drop that many bytes from the front and keep looking
+
+#define UT61E_NO_RANGE       127    // Range table entry that doesn't exist
+
+// Framing of the protocols that end every frame with CR LF
+template <uint8_t SIZE>
+struct ut61e_crlf_framing {
+	static int check(const uint8_t *buffer, uint8_t length) {
+		if (length >= 2 && buffer[length - 2] == 13 && buffer[length - 1] == 10)
+			// CR LF early means what we had was a partial packet
+			return length == SIZE ? UT61E_FRAME_COMPLETE : length;
+		// No CR LF where one should be: slide along by a byte
+		return length == SIZE ? 1 : UT61E_FRAME_MORE;
+	}
+};
+
+// Exponent of the last digit for each of a function's range codes
+struct ut61e_function_t {
+	uint8_t code;
+	uint8_t mode;             // ut61e_mode_t
+	int8_t exponent[8];
+};
+
+// The Cyrustek ES519xx family: ASCII-ish bytes 0x30 | value
+struct ut61e_ascii_family {
+	static int32_t digit(uint8_t b) { return b >= 0x30 && b <= 0x39 ? b - 0x30 : 0; }
+	// Every data byte 0x30 | value, digits 0-9 unless the display shows OL/UL
+	// (same test as UT61E_DISP::check())
+	static bool sane(const uint8_t *f, uint8_t size, uint8_t digits, bool out_of_range) {
+		for (uint8_t i = 0; i < size; i++)
+			if ((f[i] & 0xf0) != 0x30)
+				return false;
+		for (uint8_t i = 1; i <= digits && !out_of_range; i++)
+			if (f[i] > 0x39)
+				return false;
+		return true;
+	}
+	static const ut61e_function_t *find(const ut61e_function_t *table, uint8_t count, uint8_t code) {
+		for (uint8_t i = 0; i < count; i++)
+			if (table[i].code == code)
+				return &table[i];
+		return nullptr;
+	}
+	// Function and range code for a mode and exponent
+	static bool find(const ut61e_function_t *table, uint8_t count, uint8_t mode, int8_t exponent,
+	                 uint8_t &code, uint8_t &range) {
+		for (uint8_t i = 0; i < count; i++) {
+			if (table[i].mode != mode)
+				continue;
+			for (uint8_t r = 0; r < 8; r++) {
+				if (table[i].exponent[r] == exponent) {
+					code = table[i].code;
+					range = r;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+};
+
+// Cyrustek ES51922, as used by the UT61E. The same tables as UT61E_DISP, in
+// numeric form: decode() gives the reading UT61E_DISP fills in, except that
+// AC/DC is only reported when the packet says so (UT61E_DISP keeps the
+// previous current type otherwise).
+struct ES51922: ut61e_crlf_framing<14>, ut61e_ascii_family {
+	static const uint8_t FRAME_SIZE = 14;
+	static const uint8_t PACKET_SIZE = 12;
+	static const uint8_t DIGITS = 5;
+	static const int32_t COUNTS = 22000;
+	static const uint16_t FLAGS = 0x07ff;   // Every UT61E_FLAG_*
+	static const char *name() { return "ES51922"; }
+
+	static const ut61e_function_t *functions(uint8_t &count) {
+		static const int8_t X = UT61E_NO_RANGE;
+		static const ut61e_function_t table[] = {
+			{0x3b, UT61E_MODE_VOLTAGE,     {-4, -3, -2, -1, -5, X, X, X}},
+			{0x3d, UT61E_MODE_CURRENT,     {-8, -7, X, X, X, X, X, X}},      // Auto uA
+			{0x3f, UT61E_MODE_CURRENT,     {-6, -5, X, X, X, X, X, X}},      // Auto mA
+			{0x30, UT61E_MODE_CURRENT,     {-3, X, X, X, X, X, X, X}},       // 22 A
+			{0x39, UT61E_MODE_CURRENT,     {-4, -3, -2, -1, 0, X, X, X}},    // Manual A
+			{0x33, UT61E_MODE_RESISTANCE,  {-2, -1, 0, 1, 2, 3, 4, X}},
+			{0x35, UT61E_MODE_CONTINUITY,  {-2, X, X, X, X, X, X, X}},
+			{0x31, UT61E_MODE_DIODE,       {-4, X, X, X, X, X, X, X}},
+			{0x32, UT61E_MODE_FREQUENCY,   {-2, -1, X, 0, 1, 2, 3, 4}},
+			{0x36, UT61E_MODE_CAPACITANCE, {-12, -11, -10, -9, -8, -7, -6, -5}},
+			{0x34, UT61E_MODE_TEMPERATURE, {-2, X, X, X, X, X, X, X}},
+			{0x3e, UT61E_MODE_ADP,         {0, 0, 0, 0, 0, X, X, X}},
+		};
+		count = sizeof(table) / sizeof(table[0]);
+		return table;
+	}
+
+	// VAHZ: Hz/% pressed on a voltage or current setting
+	static uint8_t function_code(const uint8_t *f) { return (f[10] & 0x01) ? 0x32 : f[6]; }
+
+	// Mode, exponent and range from the function table entry (null if the
+	// code is unknown), the range byte and the status and option4 bytes
+	static void apply_function(const ut61e_function_t *function, uint8_t range, uint8_t status, uint8_t option4,
+	                           ut61e_reading_t &r) {
+		int8_t exponent = function && (range & 0xf8) == 0x30 ? function->exponent[range & 0x07] : UT61E_NO_RANGE;
+		r.mode = function ? function->mode : (uint8_t)UT61E_MODE_UNKNOWN;
+		if (r.mode == UT61E_MODE_FREQUENCY && (status & 0x08)) {
+			r.mode = UT61E_MODE_DUTY_CYCLE;
+			exponent = -1;
+		}
+		if (r.mode == UT61E_MODE_TEMPERATURE)
+			exponent = (option4 & 0x04) ? -1 : -2;
+		r.exponent = exponent == UT61E_NO_RANGE ? 0 : exponent;
+		r.range = range & 0x07;
+		r.reserved = 0;
+	}
+
+	static bool decode(const uint8_t *f, ut61e_reading_t &r) {
+		uint8_t count;
+		const ut61e_function_t *table = functions(count);
+		uint8_t status = f[7], option1 = f[8], option2 = f[9], option3 = f[10], option4 = f[11];
+		const ut61e_function_t *function = find(table, count, function_code(f));
+		apply_function(function, f[0], status, option4, r);
+		r.flags = ((status & 0x04) ? UT61E_FLAG_NEGATIVE : 0)
+			| ((option1 & 0x02) ? UT61E_FLAG_RELATIVE : 0)
+			| ((option4 & 0x02) ? UT61E_FLAG_HOLD : 0)
+			| ((status & 0x02) ? UT61E_FLAG_BATTERY_LOW : 0)
+			| ((option3 & 0x02) ? UT61E_FLAG_AUTO : 0)
+			| ((option1 & 0x08) ? UT61E_FLAG_PEAK_MAX : (option1 & 0x04) ? UT61E_FLAG_PEAK_MIN : 0)
+			| ((option3 & 0x0c) == 0x04 ? UT61E_FLAG_AC : 0)
+			| ((option3 & 0x0c) == 0x08 ? UT61E_FLAG_DC : 0);
+		if (option2 & 0x08)
+			r.flags |= UT61E_FLAG_UNDERLOAD;
+		else if (status & 0x01)
+			r.flags |= UT61E_FLAG_OVERLOAD;
+		int32_t digits = 0;
+		for (uint8_t i = 1; i <= 5; i++)
+			digits = digits * 10 + digit(f[i]);
+		if (r.flags & (UT61E_FLAG_OVERLOAD | UT61E_FLAG_UNDERLOAD))
+			digits = 0;
+		r.digits = (r.flags & UT61E_FLAG_NEGATIVE) ? -digits : digits;
+		return function != nullptr && sane(f, PACKET_SIZE, DIGITS, (status & 0x01) || (option2 & 0x08));
+	}
+
+	static bool encode(const ut61e_reading_t &r, uint8_t *f) {
+		uint8_t count, code, range;
+		const ut61e_function_t *table = functions(count);
+		uint8_t status = 0, option4 = 0;
+		if (r.mode == UT61E_MODE_DUTY_CYCLE) {
+			code = 0x32;
+			range = 0;
+			status |= 0x08;
+		} else if (r.mode == UT61E_MODE_TEMPERATURE) {
+			code = 0x34;
+			range = 0;
+			option4 |= r.exponent == -1 ? 0x04 : 0;
+		} else if (!find(table, count, r.mode, r.exponent, code, range)) {
+			return false;
+		}
+		int32_t digits = r.digits < 0 ? -r.digits : r.digits;
+		f[0] = 0x30 | range;
+		for (int i = 5; i >= 1; i--) {
+			f[i] = 0x30 + digits % 10;
+			digits /= 10;
+		}
+		f[6] = code;
+		f[7] = 0x30 | status | ((r.flags & UT61E_FLAG_NEGATIVE) ? 0x04 : 0)
+			| ((r.flags & UT61E_FLAG_BATTERY_LOW) ? 0x02 : 0) | ((r.flags & UT61E_FLAG_OVERLOAD) ? 0x01 : 0);
+		f[8] = 0x30 | ((r.flags & UT61E_FLAG_PEAK_MAX) ? 0x08 : 0) | ((r.flags & UT61E_FLAG_PEAK_MIN) ? 0x04 : 0)
+			| ((r.flags & UT61E_FLAG_RELATIVE) ? 0x02 : 0);
+		f[9] = 0x30 | ((r.flags & UT61E_FLAG_UNDERLOAD) ? 0x08 : 0);
+		f[10] = 0x30 | ((r.flags & UT61E_FLAG_DC) ? 0x08 : 0) | ((r.flags & UT61E_FLAG_AC) ? 0x04 : 0)
+			| ((r.flags & UT61E_FLAG_AUTO) ? 0x02 : 0);
+		f[11] = 0x30 | option4 | ((r.flags & UT61E_FLAG_HOLD) ? 0x02 : 0);
+		f[12] = '\r';
+		f[13] = '\n';
+		return true;
+	}
+};
+
+// Fortune FS9721_LP3: the LCD segments themselves. Every byte carries its
+// position (1-14) in the high nibble and four segment/annunciator bits in
+// the low one. There are no range codes; range is always 0. Which of the
+// user annunciators (last byte) means degrees C varies by meter, bit 1 is
+// the common choice.
+struct FS9721 {
+	static const uint8_t FRAME_SIZE = 14;
+	static const uint8_t PACKET_SIZE = 14;
+	static const uint8_t DIGITS = 4;
+	static const int32_t COUNTS = 4000;
+	static const uint16_t FLAGS = UT61E_FLAG_NEGATIVE | UT61E_FLAG_RELATIVE | UT61E_FLAG_HOLD
+		| UT61E_FLAG_BATTERY_LOW | UT61E_FLAG_AUTO | UT61E_FLAG_OVERLOAD | UT61E_FLAG_AC | UT61E_FLAG_DC;
+	static const char *name() { return "FS9721"; }
+
+	static int check(const uint8_t *buffer, uint8_t length) {
+		uint8_t c = buffer[length - 1];
+		if ((c >> 4) != length)
+			// Out of sequence: start again, from this byte if it can begin a frame
+			return (c >> 4) == 1 ? length - 1 : length;
+		return length == FRAME_SIZE ? UT61E_FRAME_COMPLETE : UT61E_FRAME_MORE;
+	}
+
+	// Seven segments as the two nibbles carry them; 0x68 is the "L" of "0L"
+	static int8_t segments_digit(uint8_t s) {
+		static const uint8_t patterns[10] = {0x7d, 0x05, 0x5b, 0x1f, 0x27, 0x3e, 0x7e, 0x15, 0x7f, 0x3f};
+		for (int8_t d = 0; d < 10; d++)
+			if (patterns[d] == s)
+				return d;
+		return s == 0x00 ? 0 : s == 0x68 ? 10 : -1;
+	}
+
+	static bool decode(const uint8_t *f, ut61e_reading_t &r) {
+		for (uint8_t i = 0; i < FRAME_SIZE; i++)
+			if ((f[i] >> 4) != i + 1)
+				return false;
+		bool overload = false;
+		int32_t digits = 0;
+		for (uint8_t i = 0; i < 4; i++) {
+			int8_t d = segments_digit(((f[1 + 2 * i] & 0x07) << 4) | (f[2 + 2 * i] & 0x0f));
+			if (d < 0)
+				return false;
+			if (d == 10) {
+				overload = true;
+				d = 0;
+			}
+			digits = digits * 10 + d;
+		}
+		int decimals = (f[3] & 0x08) ? 3 : (f[5] & 0x08) ? 2 : (f[7] & 0x08) ? 1 : 0;
+		int prefix = (f[9] & 0x08) ? -6 : (f[9] & 0x04) ? -9 : (f[9] & 0x02) ? 3
+		           : (f[10] & 0x08) ? -3 : (f[10] & 0x02) ? 6 : 0;
+		bool diode = f[9] & 0x01, beep = f[10] & 0x01;
+		if (f[12] & 0x04)
+			r.mode = diode ? UT61E_MODE_DIODE : UT61E_MODE_VOLTAGE;
+		else if (f[12] & 0x08)
+			r.mode = UT61E_MODE_CURRENT;
+		else if (f[11] & 0x04)
+			r.mode = beep ? UT61E_MODE_CONTINUITY : UT61E_MODE_RESISTANCE;
+		else if (f[11] & 0x08)
+			r.mode = UT61E_MODE_CAPACITANCE;
+		else if (f[12] & 0x02)
+			r.mode = UT61E_MODE_FREQUENCY;
+		else if (f[10] & 0x04)
+			r.mode = UT61E_MODE_DUTY_CYCLE;
+		else if (f[13] & 0x02)
+			r.mode = UT61E_MODE_TEMPERATURE;
+		else
+			r.mode = UT61E_MODE_UNKNOWN;
+		r.exponent = (int8_t)(prefix - decimals);
+		r.range = 0;
+		r.reserved = 0;
+		r.flags = ((f[1] & 0x08) ? UT61E_FLAG_NEGATIVE : 0)
+			| ((f[11] & 0x02) ? UT61E_FLAG_RELATIVE : 0)
+			| ((f[11] & 0x01) ? UT61E_FLAG_HOLD : 0)
+			| ((f[12] & 0x01) ? UT61E_FLAG_BATTERY_LOW : 0)
+			| ((f[0] & 0x02) ? UT61E_FLAG_AUTO : 0)
+			| ((f[0] & 0x08) ? UT61E_FLAG_AC : 0)
+			| ((f[0] & 0x04) ? UT61E_FLAG_DC : 0)
+			| (overload ? UT61E_FLAG_OVERLOAD : 0);
+		if (overload)
+			digits = 0;
+		r.digits = (r.flags & UT61E_FLAG_NEGATIVE) ? -digits : digits;
+		return true;
+	}
+
+	static bool encode(const ut61e_reading_t &r, uint8_t *f) {
+		static const uint8_t patterns[10] = {0x7d, 0x05, 0x5b, 0x1f, 0x27, 0x3e, 0x7e, 0x15, 0x7f, 0x3f};
+		int32_t digits = r.digits < 0 ? -r.digits : r.digits;
+		if (digits >= 10000 || r.exponent < -12 || r.exponent > 6)
+			return false;
+		// Smallest SI prefix that leaves at most three decimals
+		int prefix = r.exponent >= 0 ? (r.exponent + 2) / 3 * 3 : -(-r.exponent / 3 * 3);
+		if (prefix < -9)
+			prefix = -9;
+		int decimals = prefix - r.exponent;
+		if (decimals < 0 || decimals > 3 || (prefix != 0 && prefix != -9 && prefix != -6 && prefix != -3
+		                                     && prefix != 3 && prefix != 6))
+			return false;
+		for (uint8_t i = 0; i < FRAME_SIZE; i++)
+			f[i] = (uint8_t)((i + 1) << 4);
+		uint8_t seg[4];
+		if (r.flags & UT61E_FLAG_OVERLOAD) {
+			seg[0] = 0x00; seg[1] = patterns[0]; seg[2] = 0x68; seg[3] = 0x00;
+		} else {
+			for (int i = 3; i >= 0; i--) {
+				seg[i] = patterns[digits % 10];
+				digits /= 10;
+			}
+		}
+		for (uint8_t i = 0; i < 4; i++) {
+			f[1 + 2 * i] |= seg[i] >> 4;
+			f[2 + 2 * i] |= seg[i] & 0x0f;
+		}
+		if (r.flags & UT61E_FLAG_NEGATIVE)
+			f[1] |= 0x08;
+		if (decimals)
+			f[1 + 2 * (4 - decimals)] |= 0x08;
+		switch (prefix) {
+			case -6: f[9] |= 0x08; break;
+			case -9: f[9] |= 0x04; break;
+			case 3:  f[9] |= 0x02; break;
+			case -3: f[10] |= 0x08; break;
+			case 6:  f[10] |= 0x02; break;
+		}
+		switch (r.mode) {
+			case UT61E_MODE_DIODE:       f[9] |= 0x01; f[12] |= 0x04; break;
+			case UT61E_MODE_VOLTAGE:     f[12] |= 0x04; break;
+			case UT61E_MODE_CURRENT:     f[12] |= 0x08; break;
+			case UT61E_MODE_CONTINUITY:  f[10] |= 0x01; f[11] |= 0x04; break;
+			case UT61E_MODE_RESISTANCE:  f[11] |= 0x04; break;
+			case UT61E_MODE_CAPACITANCE: f[11] |= 0x08; break;
+			case UT61E_MODE_FREQUENCY:   f[12] |= 0x02; break;
+			case UT61E_MODE_DUTY_CYCLE:  f[10] |= 0x04; break;
+			case UT61E_MODE_TEMPERATURE: f[13] |= 0x02; break;
+			default: return false;
+		}
+		f[0] |= ((r.flags & UT61E_FLAG_AC) ? 0x08 : 0) | ((r.flags & UT61E_FLAG_DC) ? 0x04 : 0)
+			| ((r.flags & UT61E_FLAG_AUTO) ? 0x02 : 0) | 0x01;   // RS232 annunciator
+		f[11] |= ((r.flags & UT61E_FLAG_RELATIVE) ? 0x02 : 0) | ((r.flags & UT61E_FLAG_HOLD) ? 0x01 : 0);
+		f[12] |= (r.flags & UT61E_FLAG_BATTERY_LOW) ? 0x01 : 0;
+		return true;
+	}
+};
+
+// Frames to readings for one protocol. Like UT61E_DISP it remembers the last
+// frame and skips decoding repeats.
+template <class Protocol>
+class UT61E_PROTOCOL_DECODER {
+	public:
+		// False if the frame isn't valid for this protocol (garbled, or an unknown
+		// function code); r is filled anyway
+		bool decode(const uint8_t *frame, ut61e_reading_t &r) {
+			if (valid && memcmp(frame, last, Protocol::PACKET_SIZE) == 0) {
+				hits++;
+				uint32_t time = r.time_ms;
+				r = reading;
+				r.time_ms = time;
+				return result;
+			}
+			uint32_t time = r.time_ms;
+			result = Protocol::decode(frame, r);
+			r.time_ms = time;
+			reading = r;
+			memcpy(last, frame, Protocol::PACKET_SIZE);
+			valid = true;
+			if (result)
+				decoded++;
+			else
+				errors++;
+			return result;
+		}
+		void forget() { valid = false; } // Next decode works the frame out again
+		// What the meter's display shows for r: its digits, in the SI prefix
+		// that leaves one to three of them before the point. UT61E_DISP's
+		// range tables say the same for the UT61E.
+		static void shown(const ut61e_reading_t &r, ut61e_shown_t &s) {
+			static const char *const prefixes[] = {"p", "n", "µ", "m", "", "k", "M"};
+			uint8_t unit = ut61e_mode_unit(r.mode);
+			int prefix = 0;
+			if (unit != UT61E_UNIT_NONE && unit != UT61E_UNIT_DEGREE && unit != UT61E_UNIT_PERCENT) {
+				int first = r.exponent + Protocol::DIGITS - 1;   // Power of ten of the first digit
+				prefix = first >= 0 ? first / 3 * 3 : -((2 - first) / 3 * 3);
+				prefix = prefix < -12 ? -12 : prefix > 6 ? 6 : prefix;
+			}
+			int decimals = prefix - r.exponent > 0 ? prefix - r.exponent : 0;
+			ut61e_reading_t display = r;
+			display.exponent = (int8_t)-decimals;
+			s.value = (float)ut61e_reading_value(r);
+			s.display_value = (float)ut61e_reading_value(display);
+			char digits[12];
+			int width = decimals + 1 > Protocol::DIGITS ? decimals + 1 : Protocol::DIGITS;
+			int n = snprintf(digits, sizeof(digits), "%0*ld", width, (long)(r.digits < 0 ? -r.digits : r.digits));
+			if (decimals)
+				snprintf(s.display_string, sizeof(s.display_string), "%.*s.%s", n - decimals, digits,
+				         digits + n - decimals);
+			else
+				snprintf(s.display_string, sizeof(s.display_string), "%s", digits);
+			snprintf(s.display_unit, sizeof(s.display_unit), "%s%s", prefixes[prefix / 3 + 4], UT61E_UNIT_NAMES[unit]);
+		}
+
+		uint32_t decoded {0};   // Frames decoded in full
+		uint32_t hits {0};      // Repeats of the previous frame
+		uint32_t errors {0};    // Frames the protocol rejected
+	private:
+		uint8_t last[Protocol::PACKET_SIZE];   // Only the data bytes decide the reading
+		ut61e_reading_t reading;
+		bool result {false};
+		bool valid {false};
+};
+
+#endif /* UT61E_PROTOCOL_H_ */
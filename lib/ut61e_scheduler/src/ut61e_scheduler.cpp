@@ -0,0 +1,117 @@
+/*
+ * ut61e_scheduler.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_scheduler.h"
+#include <cstdio>
+
+UT61E_SCHEDULER::UT61E_SCHEDULER() {
+    task_count = 0;
+    receiver = -1;
+    window_start = micros();
+}
+
+int UT61E_SCHEDULER::add(const char *name, task_function f, uint8_t priority, uint32_t budget_us, uint32_t period_ms) {
+    if (task_count >= UT61E_SCHEDULER_MAX_TASKS)
+        return -1;
+    uint8_t id = task_count++;
+    task &t = tasks[id];
+    t.run = f;
+    t.priority = priority;
+    t.budget_us = budget_us;
+    t.period_ms = period_ms;
+    t.last_ms = millis() - period_ms;
+    t.pending = false;
+    t.stats = {name, 0, 0, 0, 0};
+
+    // Keep order[] sorted by priority, highest first; equal priorities in
+    // the order they were added
+    uint8_t i = id;
+    while (i > 0 && tasks[order[i - 1]].priority < priority) {
+        order[i] = order[i - 1];
+        i--;
+    }
+    order[i] = id;
+    return id;
+}
+
+int UT61E_SCHEDULER::set_receiver(const char *name, task_function f, uint32_t budget_us) {
+    receiver = add(name, f, 255, budget_us);
+    return receiver;
+}
+
+void UT61E_SCHEDULER::step(task &t) {
+    uint32_t start = micros();
+    t.pending = t.run(start + t.budget_us);
+    uint32_t elapsed = micros() - start;
+    t.stats.runs++;
+    t.stats.total_us += elapsed;
+    if (elapsed > t.stats.max_us)
+        t.stats.max_us = elapsed;
+    if (elapsed > t.budget_us)
+        t.stats.overruns++;
+}
+
+void UT61E_SCHEDULER::receive() {
+    if (receiver >= 0)
+        step(tasks[receiver]);
+}
+
+void UT61E_SCHEDULER::loop() {
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < task_count; i++) {
+        task &t = tasks[order[i]];
+        if (order[i] == receiver)
+            continue;
+        if (!t.pending && now - t.last_ms < t.period_ms)
+            continue;
+        receive();
+        t.last_ms = now;
+        step(t);
+    }
+    // Even with nothing else due the receiver keeps running
+    receive();
+}
+
+float UT61E_SCHEDULER::share(uint8_t id) const {
+    uint32_t window = window_us();
+    return window ? 100.0f * tasks[id].stats.total_us / window : 0;
+}
+
+float UT61E_SCHEDULER::idle_share() const {
+    uint32_t window = window_us(), busy = 0;
+    for (uint8_t i = 0; i < task_count; i++)
+        busy += tasks[i].stats.total_us;
+    return window && busy < window ? 100.0f * (window - busy) / window : 0;
+}
+
+void UT61E_SCHEDULER::reset_stats() {
+    for (uint8_t i = 0; i < task_count; i++) {
+        tasks[i].stats.runs = 0;
+        tasks[i].stats.total_us = 0;
+        tasks[i].stats.max_us = 0;
+        tasks[i].stats.overruns = 0;
+    }
+    window_start = micros();
+}
+
+size_t UT61E_SCHEDULER::stats_json(char *buffer, size_t size) const {
+    size_t used = 0;
+    int n = snprintf(buffer, size, "{\"window_ms\":%u,\"idle\":%.1f,\"tasks\":{",
+                     (unsigned)(window_us() / 1000), idle_share());
+    used += n > 0 ? n : 0;
+    for (uint8_t i = 0; i < task_count; i++) {
+        const task_stats &s = tasks[i].stats;
+        n = snprintf(used < size ? buffer + used : nullptr, used < size ? size - used : 0,
+                     "%s\"%s\":{\"share\":%.1f,\"runs\":%u,\"max_us\":%u,\"overruns\":%u}",
+                     i ? "," : "", s.name, share(i), (unsigned)s.runs, (unsigned)s.max_us, (unsigned)s.overruns);
+        used += n > 0 ? n : 0;
+    }
+    n = snprintf(used < size ? buffer + used : nullptr, used < size ? size - used : 0, "}}");
+    used += n > 0 ? n : 0;
+    return used;
+}
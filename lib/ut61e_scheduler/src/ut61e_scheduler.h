@@ -0,0 +1,86 @@
+/*
+ * ut61e_scheduler.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <Arduino.h>
+
+#ifndef UT61E_SCHEDULER_H_
+#define UT61E_SCHEDULER_H_
+
+#ifndef UT61E_SCHEDULER_MAX_TASKS
+#define UT61E_SCHEDULER_MAX_TASKS   8
+#endif
+
+// Cooperative scheduler for loop().
+//
+// Tasks are plain functions that do one bounded step of work and return.
+// They are given a deadline (micros()) from their time budget and should
+// return once it passes; returning true means "more work is pending" and the
+// task is stepped again next round regardless of its period.
+//
+// One task is the receiver: it runs before every other task step, so serial
+// reception is never more than one step away. Other tasks run in priority
+// order (highest first) whenever they are due. Time spent in each task is
+// accumulated so CPU share can be reported per window.
+class UT61E_SCHEDULER {
+	public:
+		typedef bool (*task_function)(uint32_t deadline_us);
+
+		struct task_stats {
+			const char *name;
+			uint32_t runs;
+			uint32_t total_us;     // In the current stats window
+			uint32_t max_us;       // Longest single step in the window
+			uint32_t overruns;     // Steps that ran past their budget
+		};
+
+		UT61E_SCHEDULER();
+		~UT61E_SCHEDULER() { }
+
+		// period_ms 0 means step every round. Returns a task id, or -1 if full.
+		int add(const char *name, task_function f, uint8_t priority, uint32_t budget_us, uint32_t period_ms = 0);
+		// The receive task; also counted in the stats as a task
+		int set_receiver(const char *name, task_function f, uint32_t budget_us);
+
+		// One round: each due task gets a step, each preceded by the receiver
+		void loop();
+		// Step the receiver now. Long running tasks can call this between
+		// their own steps.
+		void receive();
+
+		uint8_t count() const { return task_count; }
+		const task_stats &stats(uint8_t id) const { return tasks[id].stats; }
+		// Percentage of the stats window spent in a task / in nothing
+		float share(uint8_t id) const;
+		float idle_share() const;
+		uint32_t window_us() const { return micros() - window_start; }
+		// For tasks: true until their step's deadline has passed
+		static bool before(uint32_t deadline_us) { return (int32_t)(micros() - deadline_us) < 0; }
+		// Start a new stats window
+		void reset_stats();
+		// {"window_ms":..,"idle":..,"tasks":{"rx":{"share":..,"runs":..,"max_us":..,"overruns":..},..}}
+		size_t stats_json(char *buffer, size_t size) const;
+	private:
+		struct task {
+			task_function run;
+			uint8_t priority;
+			uint32_t budget_us;
+			uint32_t period_ms;
+			uint32_t last_ms;
+			bool pending;
+			task_stats stats;
+		};
+		task tasks[UT61E_SCHEDULER_MAX_TASKS];
+		uint8_t order[UT61E_SCHEDULER_MAX_TASKS];   // Task ids by priority
+		uint8_t task_count;
+		int receiver;
+		uint32_t window_start;
+
+		void step(task &t);
+};
+
+#endif /* UT61E_SCHEDULER_H_ */
@@ -0,0 +1,125 @@
+/*
+ * ut61e_session.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_session.h"
+#include <cstdio>
+
+// The flags that are a setting on the meter rather than part of the reading
+#define SESSION_FLAGS   (UT61E_FLAG_AC | UT61E_FLAG_DC | UT61E_FLAG_AUTO | UT61E_FLAG_RELATIVE \
+                         | UT61E_FLAG_HOLD | UT61E_FLAG_PEAK_MAX | UT61E_FLAG_PEAK_MIN)
+
+UT61E_SESSION::UT61E_SESSION() {
+    idle_gap_ms = 0;
+    open = false;
+    next_id = 1;
+    values = 0;
+    current = {};
+    pending_head = 0;
+    pending_count = 0;
+    sessions = 0;
+    lost = 0;
+}
+
+void UT61E_SESSION::configure(uint32_t gap) {
+    idle_gap_ms = gap;
+}
+
+void UT61E_SESSION::close(uint8_t end) {
+    current.end = end;
+    if (pending_count == UT61E_SESSION_PENDING) {
+        pop();
+        lost++;
+    }
+    closed[(pending_head + pending_count++) % UT61E_SESSION_PENDING] = current;
+    sessions++;
+    open = false;
+}
+
+void UT61E_SESSION::pop() {
+    if (!pending_count)
+        return;
+    pending_head = (pending_head + 1) % UT61E_SESSION_PENDING;
+    pending_count--;
+}
+
+void UT61E_SESSION::update(const ut61e_reading_t &r) {
+    uint16_t flags = r.flags & SESSION_FLAGS;
+    if (open) {
+        uint16_t changed = flags ^ current.flags;
+        if (r.mode != current.mode || (changed & (UT61E_FLAG_AC | UT61E_FLAG_DC)))
+            close(UT61E_SESSION_END_FUNCTION);
+        else if (changed & UT61E_FLAG_AUTO)
+            close(UT61E_SESSION_END_RANGE_MODE);
+        else if (changed & UT61E_FLAG_RELATIVE)
+            close(UT61E_SESSION_END_RELATIVE);
+        else if (changed & UT61E_FLAG_HOLD)
+            close(UT61E_SESSION_END_HOLD);
+        else if (changed & (UT61E_FLAG_PEAK_MAX | UT61E_FLAG_PEAK_MIN))
+            close(UT61E_SESSION_END_PEAK);
+        else if (idle_gap_ms && r.time_ms - current.end_ms > idle_gap_ms)
+            close(UT61E_SESSION_END_IDLE);
+    }
+    if (!open) {
+        current = {};
+        current.id = next_id++;
+        current.start_ms = r.time_ms;
+        current.flags = flags;
+        current.mode = r.mode;
+        values = 0;
+        open = true;
+    }
+    current.end_ms = r.time_ms;
+    current.count++;
+    if (r.flags & (UT61E_FLAG_OVERLOAD | UT61E_FLAG_UNDERLOAD)) {
+        current.overloads++;
+        return;
+    }
+    double v = ut61e_reading_value(r);
+    if (!values || v < current.min)
+        current.min = v;
+    if (!values || v > current.max)
+        current.max = v;
+    // Running mean: no sum to grow or lose precision over a long session
+    current.mean += (v - current.mean) / ++values;
+}
+
+void UT61E_SESSION::idle(uint32_t now_ms) {
+    if (open && idle_gap_ms && now_ms - current.end_ms > idle_gap_ms)
+        close(UT61E_SESSION_END_IDLE);
+}
+
+size_t UT61E_SESSION::json(const ut61e_session_summary &s, char *buffer, size_t size) {
+    const char *type = s.flags & UT61E_FLAG_AC ? "AC" : s.flags & UT61E_FLAG_DC ? "DC" : "";
+    const char *peak = s.flags & UT61E_FLAG_PEAK_MAX ? "max" : s.flags & UT61E_FLAG_PEAK_MIN ? "min" : "";
+    char stats[80] = "\"min\":null,\"max\":null,\"mean\":null";
+    if (s.count > s.overloads)
+        snprintf(stats, sizeof(stats), "\"min\":%.6g,\"max\":%.6g,\"mean\":%.7g", s.min, s.max, s.mean);
+    int n = snprintf(buffer, size,
+        "{\"session\":%u,\"mode\":\"%s\",\"unit\":\"%s\",\"currentType\":\"%s\",\"range\":\"%s\","
+        "\"relative\":%s,\"hold\":%s,\"peak\":\"%s\",\"start_ms\":%u,\"end_ms\":%u,\"duration_s\":%.3f,"
+        "\"count\":%u,\"overloads\":%u,%s,\"end\":\"%s\"}",
+        s.id, UT61E_MODE_NAMES[s.mode < UT61E_MODE_COUNT ? s.mode : 0], UT61E_UNIT_NAMES[ut61e_mode_unit(s.mode)],
+        type, s.flags & UT61E_FLAG_AUTO ? "auto" : "manual",
+        s.flags & UT61E_FLAG_RELATIVE ? "true" : "false", s.flags & UT61E_FLAG_HOLD ? "true" : "false", peak,
+        s.start_ms, s.end_ms, (s.end_ms - s.start_ms) / 1000.0, s.count, s.overloads, stats,
+        UT61E_SESSION_END_NAMES[s.end < UT61E_SESSION_END_COUNT ? s.end : 0]);
+    return n > 0 ? n : 0;
+}
+
+size_t UT61E_SESSION::append_json(char *buffer, size_t length, size_t size, uint32_t id) {
+    if (length == 0 || length >= size || buffer[length - 1] != '}')
+        return length;
+    int n = snprintf(buffer + length - 1, size - length + 1, ",\"session\":%u}", id);
+    if (n <= 0 || (size_t)n >= size - length + 1) {
+        // Didn't fit: leave the object as it was
+        buffer[length - 1] = '}';
+        buffer[length] = 0;
+        return length;
+    }
+    return length - 1 + n;
+}
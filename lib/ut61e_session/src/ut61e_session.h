@@ -0,0 +1,102 @@
+/*
+ * ut61e_session.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_reading.h"
+
+#ifndef UT61E_SESSION_H_
+#define UT61E_SESSION_H_
+
+#ifndef UT61E_SESSION_PENDING
+#define UT61E_SESSION_PENDING   4   // Closed sessions waiting to be published
+#endif
+
+// Why a session ended
+enum ut61e_session_end_t : uint8_t {
+	UT61E_SESSION_END_FUNCTION = 0,   // Dial turned, or AC/DC changed
+	UT61E_SESSION_END_RANGE_MODE,     // Auto/manual range
+	UT61E_SESSION_END_RELATIVE,
+	UT61E_SESSION_END_HOLD,
+	UT61E_SESSION_END_PEAK,           // MAX/MIN
+	UT61E_SESSION_END_IDLE,           // No readings for the idle gap
+	UT61E_SESSION_END_COUNT
+};
+
+static const char *const UT61E_SESSION_END_NAMES[UT61E_SESSION_END_COUNT] = {
+	"function", "range_mode", "relative", "hold", "peak", "idle"
+};
+
+// What a session measured. min, max and mean are in base units and leave
+// out OL/UL readings, which are only counted.
+struct ut61e_session_summary {
+	uint32_t id;
+	uint32_t start_ms;     // Capture times of the first and last readings
+	uint32_t end_ms;
+	uint32_t count;        // All readings, OL/UL included
+	uint32_t overloads;    // OL/UL readings
+	double min;
+	double max;
+	double mean;
+	uint16_t flags;        // The UT61E_FLAG_* the session was split on
+	uint8_t mode;          // ut61e_mode_t
+	uint8_t end;           // ut61e_session_end_t, once closed
+};
+
+// Splits the stream of good readings into measurement sessions: one test
+// each, as far as the meter can tell. A session ends when the function or
+// AC/DC changes, when the range goes between auto and manual, when REL,
+// HOLD or MAX/MIN goes on or off, or when no reading comes for the idle
+// gap. Manual range steps and OL don't end one.
+//
+// Each session gets the next id, counting from 1 at boot. The summary is
+// kept up as readings come in, so closing one costs nothing; closed ones
+// wait in a small queue to be published, the oldest lost when it is full.
+class UT61E_SESSION {
+	public:
+		UT61E_SESSION();
+		~UT61E_SESSION() { }
+
+		// idle_gap_ms 0: only the meter's settings end a session
+		void configure(uint32_t idle_gap_ms);
+		void update(const ut61e_reading_t &r);
+		// Close the open session if nothing has come for the idle gap, so
+		// its summary goes out without waiting for the next reading
+		void idle(uint32_t now_ms);
+
+		// The open session's id, 0 if none is open
+		uint32_t id() const { return open ? current.id : 0; }
+		const ut61e_session_summary &summary() const { return current; }
+
+		// Closed sessions, oldest first
+		bool pending() const { return pending_count > 0; }
+		const ut61e_session_summary &oldest() const { return closed[pending_head]; }
+		void pop();
+
+		// A summary as JSON for tele/<id>/SESSION
+		static size_t json(const ut61e_session_summary &s, char *buffer, size_t size);
+		// Add "session" to a reading's JSON object of the given length, in
+		// place before its closing brace. Returns the new length.
+		static size_t append_json(char *buffer, size_t length, size_t size, uint32_t id);
+
+		uint32_t sessions;     // Closed since boot
+		uint32_t lost;         // Summaries pushed out of a full queue
+	private:
+		uint32_t idle_gap_ms;
+		bool open;
+		uint32_t next_id;
+		uint32_t values;       // Readings in the mean, i.e. not OL/UL
+		ut61e_session_summary current;
+		ut61e_session_summary closed[UT61E_SESSION_PENDING];
+		uint8_t pending_head;
+		uint8_t pending_count;
+
+		void close(uint8_t end);
+};
+
+#endif /* UT61E_SESSION_H_ */
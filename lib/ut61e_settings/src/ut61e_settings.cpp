@@ -0,0 +1,417 @@
+/*
+ * ut61e_settings.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_settings.h"
+#include <EEPROM.h>
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+#define SETTINGS_MAGIC       0x55543631   // "UT61"
+#define SETTINGS_VERSION     4
+#define SETTINGS_ADDRESS     0
+#define MAX_COMMAND_LENGTH   128
+#define MAX_KEY_LENGTH       32
+
+// Done once the whole batch has been accepted
+#define ACTION_SAVE          0x01
+#define ACTION_ENERGY_RESET  0x02
+#define ACTION_PERSIST       0x04   // Changed with Persist on
+
+struct stored_settings {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    ut61e_settings_t settings;
+    uint32_t checksum;
+};
+
+static const struct {
+    const char *name;
+    uint8_t bit;
+} TOPIC_NAMES[] = {
+    {"raw", UT61E_TOPIC_RAW}, {"hex", UT61E_TOPIC_HEX}, {"json", UT61E_TOPIC_JSON},
+    {"json_x", UT61E_TOPIC_JSON_X}, {"influx", UT61E_TOPIC_INFLUX}, {"csv", UT61E_TOPIC_CSV},
+};
+
+// FNV-1a over the settings, enough to catch blank or stale flash
+static uint32_t checksum(const ut61e_settings_t &s) {
+    const uint8_t *p = (const uint8_t *)&s;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(s); i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+// A JSON reply built an entry at a time, keeping a byte back for the
+// closing brace. Once an entry doesn't fit, it and all after it are left out.
+struct UT61E_SETTINGS::reply_buffer {
+    char *text;
+    size_t size;
+    size_t used;
+    bool full;
+
+    bool add(const char *format, ...) {
+        size_t room = used + 1 < size ? size - used - 1 : 0;
+        if (full || !room) {
+            full = true;
+            return false;
+        }
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(text + used, room, format, args);
+        va_end(args);
+        if (n < 0 || (size_t)n >= room) {
+            text[used] = 0;
+            full = true;
+            return false;
+        }
+        used += n;
+        return true;
+    }
+};
+
+// Copy up to max characters of s as the inside of a JSON string
+static void json_escape(const char *s, size_t max, char *out, size_t size) {
+    size_t o = 0;
+    for (size_t i = 0; s[i] && i < max && o + 7 <= size; i++) {
+        unsigned char c = s[i];
+        if (c == '"' || c == '\\') {
+            out[o++] = '\\';
+            out[o++] = c;
+        } else if (c < 0x20) {
+            o += snprintf(out + o, size - o, "\\u%04x", c);
+        } else {
+            out[o++] = c;
+        }
+    }
+    out[o] = 0;
+}
+
+UT61E_SETTINGS::UT61E_SETTINGS() {
+    memset(&current, 0, sizeof(current));
+    memset(&defaults, 0, sizeof(defaults));
+    generation = 0;
+    energy_reset = false;
+}
+
+void UT61E_SETTINGS::begin(const ut61e_settings_t &d) {
+    defaults = d;
+    current = d;
+    EEPROM.begin(sizeof(stored_settings));
+    load();
+}
+
+bool UT61E_SETTINGS::load() {
+    stored_settings stored;
+    EEPROM.get(SETTINGS_ADDRESS, stored);
+    if (stored.magic != SETTINGS_MAGIC || stored.version != SETTINGS_VERSION
+        || stored.size != sizeof(ut61e_settings_t) || stored.checksum != checksum(stored.settings))
+        return false;
+    current = stored.settings;
+    generation++;
+    return true;
+}
+
+bool UT61E_SETTINGS::save() {
+    stored_settings stored;
+    stored.magic = SETTINGS_MAGIC;
+    stored.version = SETTINGS_VERSION;
+    stored.size = sizeof(ut61e_settings_t);
+    stored.settings = current;
+    stored.checksum = checksum(current);
+    EEPROM.put(SETTINGS_ADDRESS, stored);
+    return EEPROM.commit();
+}
+
+size_t UT61E_SETTINGS::status_json(char *buffer, size_t size) const {
+    char topics[64] = "";
+    size_t t = 0;
+    for (auto &n: TOPIC_NAMES)
+        if (current.topics & n.bit)
+            t += snprintf(topics + t, sizeof(topics) - t, "%s%s", t ? "," : "", n.name);
+    // Only the modes that have a filter, e.g. "voltage:median 5,current:ema 20",
+    // or "all:median 5" when every mode has the same one
+    char filters[240] = "";
+    size_t f = 0;
+    bool same = true;
+    for (uint8_t m = 2; m < UT61E_MODE_COUNT; m++)
+        same &= current.filter[m] == current.filter[1] && current.filter_param[m] == current.filter_param[1];
+    if (same && current.filter[1] != UT61E_FILTER_NONE && current.filter[1] < UT61E_FILTER_COUNT)
+        f = snprintf(filters, sizeof(filters), "all:%s %u", UT61E_FILTER_NAMES[current.filter[1]],
+                     current.filter_param[1]);
+    for (uint8_t m = 1; m < UT61E_MODE_COUNT && !same; m++) {
+        uint8_t kind = current.filter[m];
+        if (kind == UT61E_FILTER_NONE || kind >= UT61E_FILTER_COUNT || f >= sizeof(filters))
+            continue;
+        f += snprintf(filters + f, sizeof(filters) - f, "%s%s:%s %u", f ? "," : "", UT61E_MODE_NAMES[m],
+                      UT61E_FILTER_NAMES[kind], current.filter_param[m]);
+    }
+    int n = snprintf(buffer, size,
+        "{\"Topics\":\"%s\",\"Batch\":%u,\"Deadband\":%u,\"Heartbeat\":%u,\"StatsWindow\":%u,"
+        "\"Debug\":%u,\"Persist\":%u,\"Filter\":\"%s\",\"Stable\":\"%u %u\",\"StableOnly\":%u,"
+        "\"Supply\":%u,\"EnergyGap\":%u,\"EnergyReport\":%u,\"SessionGap\":%u}",
+        topics, current.batch, current.deadband, (unsigned)current.heartbeat_ms,
+        (unsigned)current.stats_window_ms, current.debug, current.persist,
+        filters, current.stable_tolerance, current.stable_samples, current.stable_only,
+        current.supply_mv, current.energy_gap_ms, (unsigned)current.energy_report_ms,
+        (unsigned)current.session_gap_ms);
+    return n > 0 ? n : 0;
+}
+
+// "raw,json" sets exactly those, "+influx" / "-hex" switch one on or off
+bool UT61E_SETTINGS::parse_topics(const char *value, uint8_t &topics) {
+    char list[MAX_COMMAND_LENGTH];
+    strncpy(list, value, sizeof(list) - 1);
+    list[sizeof(list) - 1] = 0;
+    bool relative = value[0] == '+' || value[0] == '-';
+    uint8_t result = relative ? topics : 0;
+    for (char *item = strtok(list, ", "); item; item = strtok(nullptr, ", ")) {
+        char op = 0;
+        if (*item == '+' || *item == '-')
+            op = *item++;
+        uint8_t bit = 0;
+        for (auto &n: TOPIC_NAMES)
+            if (!strcasecmp(item, n.name))
+                bit = n.bit;
+        if (!bit && !strcasecmp(item, "none"))
+            continue;
+        if (!bit)
+            return false;
+        if (op == '-')
+            result &= ~bit;
+        else
+            result |= bit;
+    }
+    topics = result;
+    return true;
+}
+
+// "<mode|all> <none|median|ema|kalman> [parameter]"
+bool UT61E_SETTINGS::parse_filter(char *value, ut61e_settings_t &next) {
+    char *mode = strtok(value, " ");
+    char *kind_name = strtok(nullptr, " ");
+    char *param = strtok(nullptr, " ");
+    if (!mode || !kind_name || strtok(nullptr, " "))
+        return false;
+    uint8_t first = 1, last = UT61E_MODE_COUNT - 1;
+    if (strcasecmp(mode, "all")) {
+        first = ut61e_mode_code(mode, strlen(mode));
+        if (first == UT61E_MODE_UNKNOWN)
+            return false;
+        last = first;
+    }
+    uint8_t kind = UT61E_FILTER_COUNT;
+    for (uint8_t k = 0; k < UT61E_FILTER_COUNT; k++)
+        if (!strcasecmp(kind_name, UT61E_FILTER_NAMES[k]))
+            kind = k;
+    if (kind == UT61E_FILTER_COUNT)
+        return false;
+    unsigned long number = UT61E_FILTER_PARAM_DEFAULT[kind];
+    if (param) {
+        char *end = nullptr;
+        number = strtoul(param, &end, 10);
+        if (!end || *end || kind == UT61E_FILTER_NONE)
+            return false;
+    }
+    if (number < UT61E_FILTER_PARAM_MIN[kind] || number > UT61E_FILTER_PARAM_MAX[kind])
+        return false;
+    for (uint8_t m = first; m <= last; m++) {
+        next.filter[m] = kind;
+        next.filter_param[m] = (uint8_t)number;
+    }
+    return true;
+}
+
+// Apply one "Key value" command to next, the batch's staged settings. Save
+// and EnergyReset are added to actions. Appends its part of the reply.
+bool UT61E_SETTINGS::apply(char *command, ut61e_settings_t &next, uint8_t &actions, reply_buffer &reply) {
+    while (isspace((unsigned char)*command))
+        command++;
+    char *value = command;
+    while (*value && !isspace((unsigned char)*value))
+        value++;
+    if (*value)
+        *value++ = 0;
+    while (isspace((unsigned char)*value))
+        value++;
+    char *end = value + strlen(value);
+    while (end > value && isspace((unsigned char)end[-1]))
+        *--end = 0;
+
+    ut61e_settings_t before = next;
+    char *number_end = nullptr;
+    unsigned long number = strtoul(value, &number_end, 10);
+    bool has_value = *value != 0;
+    bool numeric = has_value && number_end && *number_end == 0;
+    const char *error = nullptr;
+    const char *key = command;
+
+    if (!strcasecmp(key, "Topics")) {
+        if (!has_value || !parse_topics(value, next.topics))
+            error = "Topics takes raw,hex,json,json_x,influx,csv (or +name/-name)";
+    } else if (!strcasecmp(key, "Batch")) {
+        if (!numeric || number < 1 || number > 8)
+            error = "Batch must be 1..8";
+        else
+            next.batch = (uint8_t)number;
+    } else if (!strcasecmp(key, "Deadband")) {
+        if (!numeric || number > 10000)
+            error = "Deadband must be 0..10000 counts";
+        else
+            next.deadband = (uint16_t)number;
+    } else if (!strcasecmp(key, "Heartbeat")) {
+        if (!numeric || (number != 0 && (number < 1000 || number > 3600000)))
+            error = "Heartbeat must be 0 or 1000..3600000 ms";
+        else
+            next.heartbeat_ms = number;
+    } else if (!strcasecmp(key, "StatsWindow")) {
+        if (!numeric || number < 1000 || number > 3600000)
+            error = "StatsWindow must be 1000..3600000 ms";
+        else
+            next.stats_window_ms = number;
+    } else if (!strcasecmp(key, "Debug")) {
+        if (!numeric || number > 2)
+            error = "Debug must be 0..2";
+        else
+            next.debug = (uint8_t)number;
+    } else if (!strcasecmp(key, "Persist")) {
+        if (!numeric || number > 1)
+            error = "Persist must be 0 or 1";
+        else
+            next.persist = (uint8_t)number;
+    } else if (!strcasecmp(key, "Filter")) {
+        if (!has_value || !parse_filter(value, next))
+            error = "Filter takes <mode|all> none, median 3..15, ema 1..100 or kalman 1..255";
+    } else if (!strcasecmp(key, "Stable")) {
+        // "<tolerance counts> <readings>"
+        char *samples_end = nullptr;
+        unsigned long samples = number_end ? strtoul(number_end, &samples_end, 10) : 0;
+        if (!has_value || number_end == value || !samples_end || samples_end == number_end || *samples_end
+            || number > 10000 || samples > 255)
+            error = "Stable takes a tolerance of 0..10000 counts and 0..255 readings";
+        else {
+            next.stable_tolerance = (uint16_t)number;
+            next.stable_samples = (uint8_t)samples;
+        }
+    } else if (!strcasecmp(key, "StableOnly")) {
+        if (!numeric || number > 1)
+            error = "StableOnly must be 0 or 1";
+        else
+            next.stable_only = (uint8_t)number;
+    } else if (!strcasecmp(key, "Supply")) {
+        if (!numeric || number > 60000)
+            error = "Supply must be 0..60000 mV (0 = last measured)";
+        else
+            next.supply_mv = (uint16_t)number;
+    } else if (!strcasecmp(key, "EnergyGap")) {
+        if (!numeric || number < 100 || number > 60000)
+            error = "EnergyGap must be 100..60000 ms";
+        else
+            next.energy_gap_ms = (uint16_t)number;
+    } else if (!strcasecmp(key, "EnergyReport")) {
+        if (!numeric || (number != 0 && (number < 1000 || number > 3600000)))
+            error = "EnergyReport must be 0 or 1000..3600000 ms";
+        else
+            next.energy_report_ms = number;
+    } else if (!strcasecmp(key, "EnergyReset")) {
+        actions |= ACTION_ENERGY_RESET;
+    } else if (!strcasecmp(key, "SessionGap")) {
+        if (!numeric || (number != 0 && (number < 1000 || number > 3600000)))
+            error = "SessionGap must be 0 or 1000..3600000 ms";
+        else
+            next.session_gap_ms = number;
+    } else if (!strcasecmp(key, "Save")) {
+        actions |= ACTION_SAVE;
+    } else if (!strcasecmp(key, "Reset")) {
+        next = defaults;
+    } else if (!strcasecmp(key, "Status")) {
+    } else {
+        error = "Unknown command";
+    }
+    // Nothing is ever stable with the detector off, so the decoded topics
+    // would go silent
+    if (!error && next.stable_only && !next.stable_samples)
+        error = "StableOnly 1 needs Stable with 1..255 readings";
+
+    if (error) {
+        char escaped[MAX_KEY_LENGTH * 6 + 1];
+        json_escape(key, MAX_KEY_LENGTH, escaped, sizeof(escaped));
+        reply.add("\"Command\":\"Error\",\"Key\":\"%s\",\"Message\":\"%s\",", escaped, error);
+        next = before;
+        return false;
+    }
+    return true;
+}
+
+// The commands are staged on a copy and take effect together, only if
+// every one was accepted, so what runs and what is saved can't drift apart
+bool UT61E_SETTINGS::command(const char *payload, size_t length, char *reply, size_t reply_size) {
+    char buffer[MAX_COMMAND_LENGTH * 2];
+    if (length >= sizeof(buffer)) {
+        snprintf(reply, reply_size, "{\"Command\":\"Error\",\"Message\":\"Command too long\"}");
+        return false;
+    }
+    memcpy(buffer, payload, length);
+    buffer[length] = 0;
+
+    ut61e_settings_t staged = current;
+    uint8_t actions = 0;
+    bool ok = true;
+    reply_buffer out = {reply, reply_size, 0, false};
+    if (!out.add("{"))
+        return false;
+    for (char *p = buffer, *next; p; p = next) {
+        next = strchr(p, ';');
+        if (next)
+            *next++ = 0;
+        if (!*p)
+            continue;
+        if (!apply(p, staged, actions, out))
+            ok = false;
+    }
+
+    if (!ok) {
+        out.add("\"Applied\":\"None\",");
+    } else {
+        // "Persist 0" and "Reset" are saved too
+        bool persist = current.persist || staged.persist;
+        if (memcmp(&staged, &current, sizeof(staged)) != 0) {
+            current = staged;
+            generation++;
+            if (persist)
+                actions |= ACTION_PERSIST;
+        }
+        if (actions & ACTION_ENERGY_RESET)
+            energy_reset = true;
+        if (actions & (ACTION_SAVE | ACTION_PERSIST)) {
+            if (!save()) {
+                out.add("\"Save\":\"Error\",\"Message\":\"Flash write failed\",");
+                ok = false;
+            } else if (actions & ACTION_SAVE) {
+                out.add("\"Save\":\"Done\",");
+            }
+        }
+    }
+
+    // Finish with the resulting settings so every reply is self describing
+    size_t entries = out.used;
+    if (out.add("\"Settings\":")) {
+        size_t room = reply_size - out.used - 1;
+        size_t n = status_json(reply + out.used, room);
+        out.used = n > 0 && n < room ? out.used + n : entries;
+    }
+    if (out.used == entries && reply[out.used - 1] == ',')
+        out.used--;    // Didn't fit: close the object after the last entry that did
+    reply[out.used++] = '}';
+    reply[out.used] = 0;
+    return ok;
+}
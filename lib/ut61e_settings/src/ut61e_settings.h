@@ -0,0 +1,85 @@
+/*
+ * ut61e_settings.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "ut61e_filter.h"
+
+#ifndef UT61E_SETTINGS_H_
+#define UT61E_SETTINGS_H_
+
+// Output topics that can be switched on and off
+#define UT61E_TOPIC_RAW      0x01
+#define UT61E_TOPIC_HEX      0x02
+#define UT61E_TOPIC_JSON     0x04
+#define UT61E_TOPIC_JSON_X   0x08
+#define UT61E_TOPIC_INFLUX   0x10
+#define UT61E_TOPIC_CSV      0x20
+
+// Reporting knobs that can be changed at runtime. Stored as-is in flash.
+struct ut61e_settings_t {
+	uint8_t topics;            // UT61E_TOPIC_* bits
+	uint8_t batch;             // Readings per extended JSON message (1 = no batching)
+	uint16_t deadband;         // Decoded topics skip changes of this many display counts or less
+	uint32_t heartbeat_ms;     // Publish anyway after this long (0 = only on change)
+	uint32_t stats_window_ms;  // Statistics reporting window
+	uint8_t debug;             // 0 quiet, 1 echo readings to Serial, 2 also decoder dumps
+	uint8_t persist;           // 1 = save every accepted change to flash
+	uint8_t filter[UT61E_MODE_COUNT];        // UT61E_FILTER_* for each ut61e_mode_t
+	uint8_t filter_param[UT61E_MODE_COUNT];  // Median window, EMA percent or Kalman noise ratio
+	uint16_t stable_tolerance; // Stable once within this many counts ...
+	uint8_t stable_samples;    // ... for this many readings in a row (0 = off)
+	uint8_t stable_only;       // 1 = decoded topics only carry stable readings
+	uint16_t supply_mv;        // Supply voltage for energy (0 = last measured DC voltage)
+	uint16_t energy_gap_ms;    // Longer gaps between current readings aren't integrated
+	uint32_t energy_report_ms; // Publish charge and energy totals this often (0 = never)
+	uint32_t session_gap_ms;   // End a measurement session after this long without readings (0 = never)
+};
+
+// Runtime settings, changed by commands such as
+//   "Deadband 2"   "Topics raw,json_x"   "Topics -hex"   "Batch 4; Save"
+// Keys are case insensitive, several commands can be separated by ';'. Each
+// command is checked against its allowed range. The commands in a payload
+// take effect together or, if any fails, not at all; the reply says why.
+// Save and EnergyReset also wait for the whole payload. Commands:
+//   Topics Batch Deadband Heartbeat StatsWindow Debug Persist
+//   Filter (e.g. "Filter voltage median 5", "Filter all none") Stable StableOnly
+//   Supply EnergyGap EnergyReport  EnergyReset (sets energy_reset)  SessionGap
+//   Save (write to flash now)  Reset (back to defaults)  Status (report all)
+class UT61E_SETTINGS {
+	public:
+		UT61E_SETTINGS();
+		~UT61E_SETTINGS() { }
+
+		// Remember the defaults and load saved settings if there are valid ones
+		void begin(const ut61e_settings_t &defaults);
+
+		// Apply a command payload (need not be NUL terminated). A JSON reply
+		// for stat/<id>/RESULT is written to reply, cut short after the last
+		// entry that fits. Returns true if every command in the payload was
+		// accepted and applied.
+		bool command(const char *payload, size_t length, char *reply, size_t reply_size);
+		// The full settings as JSON
+		size_t status_json(char *buffer, size_t size) const;
+
+		bool load();
+		bool save();
+
+		ut61e_settings_t current;
+		uint32_t generation;   // Bumped on every accepted change
+		bool energy_reset;     // EnergyReset was sent; the firmware clears it
+	private:
+		ut61e_settings_t defaults;
+
+		struct reply_buffer;
+		bool apply(char *command, ut61e_settings_t &next, uint8_t &actions, reply_buffer &reply);
+		bool parse_topics(const char *value, uint8_t &topics);
+		bool parse_filter(char *value, ut61e_settings_t &next);
+};
+
+#endif /* UT61E_SETTINGS_H_ */
@@ -0,0 +1,90 @@
+/*
+ * ut61e_status_led.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_status_led.h"
+
+UT61E_STATUS_LED::UT61E_STATUS_LED(Adafruit_NeoPixel &p, uint16_t interval, uint16_t quiet, uint16_t idle)
+    :pixels(p),min_interval_ms(interval),quiet_window_ms(quiet),idle_ms(idle) {
+    shows = 0;
+    coalesced = 0;
+    deferred = 0;
+    bytes_lost = 0;
+    steady = 0;
+    flash_colour = 0;
+    flash_until = 0;
+    flashing = false;
+    shown = 0;
+    shown_valid = false;
+    last_show_ms = 0;
+    last_frame_ms = 0;
+    frames_seen = false;
+    shown_since_frame = false;
+    last_resync = 0;
+}
+
+// Called before serial reception starts, so it may write the LED directly
+void UT61E_STATUS_LED::begin(uint8_t brightness) {
+    pixels.begin();
+    pixels.clear();
+    pixels.setBrightness(brightness);
+    pixels.show();
+    shown = 0;
+    shown_valid = true;
+}
+
+void UT61E_STATUS_LED::set(uint32_t colour) {
+    if (!flashing && shown_valid && wanted() != shown && colour != wanted())
+        coalesced++;
+    steady = colour;
+}
+
+void UT61E_STATUS_LED::flash(uint32_t colour, uint16_t ms) {
+    if (shown_valid && wanted() != shown && colour != wanted())
+        coalesced++;
+    flash_colour = colour;
+    flash_until = millis() + ms;
+    flashing = true;
+}
+
+void UT61E_STATUS_LED::frame_end(uint32_t resync_bytes) {
+    if (shown_since_frame && resync_bytes > last_resync)
+        bytes_lost += resync_bytes - last_resync;
+    shown_since_frame = false;
+    last_resync = resync_bytes;
+    last_frame_ms = millis();
+    frames_seen = true;
+}
+
+bool UT61E_STATUS_LED::update(bool rx_pending) {
+    uint32_t now = millis();
+    if (flashing && (int32_t)(now - flash_until) >= 0)
+        flashing = false;
+    uint32_t colour = wanted();
+    if (shown_valid && colour == shown)
+        return false;
+
+    bool idle = !frames_seen || now - last_frame_ms > idle_ms;
+    bool in_gap = now - last_frame_ms <= quiet_window_ms;
+    if (!idle && !in_gap)
+        return false;
+    if (rx_pending) {
+        deferred++;
+        return false;
+    }
+    if (shown_valid && now - last_show_ms < min_interval_ms)
+        return false;
+
+    pixels.setPixelColor(0, colour);
+    pixels.show();
+    shown = colour;
+    shown_valid = true;
+    last_show_ms = now;
+    shows++;
+    shown_since_frame = true;
+    return true;
+}
@@ -0,0 +1,71 @@
+/*
+ * ut61e_status_led.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+
+#ifndef UT61E_STATUS_LED_H_
+#define UT61E_STATUS_LED_H_
+
+// Drives the WS2812 status LED without corrupting serial reception.
+//
+// Adafruit_NeoPixel::show() turns interrupts off while it bit-bangs the LED,
+// and SoftwareSerial needs its edge interrupts, so a show() while a byte is
+// arriving can corrupt it. Colour changes are therefore only recorded by
+// set()/flash(); update() pushes the latest one to the LED just after a
+// packet's CR LF (when the meter is quiet until its next packet), at most
+// once per min_interval. If no packets arrive at all the line is idle and
+// updates go out straight away.
+//
+// A push is followed by checking the next packet: any bytes the framer had to
+// throw away in it are counted in bytes_lost.
+class UT61E_STATUS_LED {
+	public:
+		UT61E_STATUS_LED(Adafruit_NeoPixel &pixels, uint16_t min_interval_ms = 50,
+		                 uint16_t quiet_window_ms = 20, uint16_t idle_ms = 1000);
+		~UT61E_STATUS_LED() { }
+
+		void begin(uint8_t brightness);
+		// Steady colour, shown whenever no flash is active
+		void set(uint32_t colour);
+		// Show colour for at least ms, then go back to the steady colour
+		void flash(uint32_t colour, uint16_t ms);
+		// Call as soon as a frame's CR LF has been received, with the framer's
+		// running resync_bytes count
+		void frame_end(uint32_t resync_bytes);
+		// Push a pending change if it is safe to. rx_pending: bytes are
+		// waiting in the serial buffer. Returns true if the LED was written.
+		bool update(bool rx_pending);
+
+		static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return Adafruit_NeoPixel::Color(r, g, b); }
+
+		uint32_t shows;       // Writes to the LED
+		uint32_t coalesced;   // Colour changes replaced before they were shown
+		uint32_t deferred;    // Updates held back because serial data was pending
+		uint32_t bytes_lost;  // Bytes discarded in packets following an LED write
+	private:
+		Adafruit_NeoPixel &pixels;
+		uint16_t min_interval_ms;
+		uint16_t quiet_window_ms;
+		uint16_t idle_ms;
+		uint32_t steady;
+		uint32_t flash_colour;
+		uint32_t flash_until;
+		bool flashing;
+		uint32_t shown;
+		bool shown_valid;
+		uint32_t last_show_ms;
+		uint32_t last_frame_ms;
+		bool frames_seen;
+		bool shown_since_frame;
+		uint32_t last_resync;
+
+		uint32_t wanted() const { return flashing ? flash_colour : steady; }
+};
+
+#endif /* UT61E_STATUS_LED_H_ */
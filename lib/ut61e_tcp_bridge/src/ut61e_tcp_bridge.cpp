@@ -0,0 +1,240 @@
+/*
+ * ut61e_tcp_bridge.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_tcp_bridge.h"
+#include <cstring>
+
+// Telnet (RFC854) and COM port control (RFC2217) codes we use
+#define TELNET_IAC          255
+#define TELNET_DONT         254
+#define TELNET_DO           253
+#define TELNET_WONT         252
+#define TELNET_WILL         251
+#define TELNET_SB           250
+#define TELNET_SE           240
+#define TELNET_BINARY       0
+#define TELNET_SGA          3
+#define TELNET_COM_PORT     44
+
+#define CPC_SIGNATURE       0
+#define CPC_SET_BAUDRATE    1
+#define CPC_SET_DATASIZE    2
+#define CPC_SET_PARITY      3
+#define CPC_SET_STOPSIZE    4
+#define CPC_SET_CONTROL     5
+#define CPC_PURGE_DATA      12
+#define CPC_SERVER_OFFSET   100   // Server replies are the client command + 100
+
+#define CPC_PARITY_ODD      2
+
+// Telnet receive states
+enum { TS_DATA, TS_IAC, TS_OPTION_WILL, TS_OPTION_WONT, TS_OPTION_DO, TS_OPTION_DONT, TS_SB, TS_SB_IAC };
+
+UT61E_TCP_BRIDGE::UT61E_TCP_BRIDGE(uint16_t port, bool r):server(port),rfc2217(r) {
+    frames_sent = 0;
+    frames_dropped = 0;
+    for (auto &slot: slots) {
+        slot.head = 0;
+        slot.count = 0;
+        slot.telnet_state = TS_DATA;
+        slot.sb_length = 0;
+    }
+};
+
+void UT61E_TCP_BRIDGE::begin() {
+    server.begin();
+    server.setNoDelay(true);
+}
+
+uint8_t UT61E_TCP_BRIDGE::clients() {
+    uint8_t n = 0;
+    for (auto &slot: slots)
+        if (slot.client.connected())
+            n++;
+    return n;
+}
+
+void UT61E_TCP_BRIDGE::accept() {
+    if (!server.hasClient())
+        return;
+    WiFiClient incoming = server.available();
+    for (auto &slot: slots) {
+        if (!slot.client.connected()) {
+            slot.client.stop();
+            slot.client = incoming;
+            slot.client.setNoDelay(true);
+            slot.head = 0;
+            slot.count = 0;
+            slot.telnet_state = TS_DATA;
+            if (rfc2217) {
+                // Only binary: the client offers the COM port option (WILL)
+                // and telnet_option() answers DO
+                const uint8_t hello[] = {TELNET_IAC, TELNET_WILL, TELNET_BINARY};
+                slot.client.write(hello, sizeof(hello));
+            }
+            return;
+        }
+    }
+    // No free slot
+    incoming.stop();
+}
+
+void UT61E_TCP_BRIDGE::enqueue(const uint8_t *frame) {
+    for (auto &slot: slots) {
+        if (!slot.client.connected())
+            continue;
+        uint8_t tail = (slot.head + slot.count) % UT61E_TCP_QUEUE_FRAMES;
+        if (slot.count == UT61E_TCP_QUEUE_FRAMES) {
+            // Full: overwrite the oldest frame
+            slot.head = (slot.head + 1) % UT61E_TCP_QUEUE_FRAMES;
+            frames_dropped++;
+        } else {
+            slot.count++;
+        }
+        memcpy(slot.queue[tail], frame, UT61E_TCP_FRAME_SIZE);
+    }
+}
+
+void UT61E_TCP_BRIDGE::flush(client_slot &slot) {
+    // Meter data is 7 bit so it never contains IAC and needs no escaping
+    while (slot.count && slot.client.availableForWrite() >= UT61E_TCP_FRAME_SIZE) {
+        slot.client.write(slot.queue[slot.head], UT61E_TCP_FRAME_SIZE);
+        slot.head = (slot.head + 1) % UT61E_TCP_QUEUE_FRAMES;
+        slot.count--;
+        frames_sent++;
+    }
+}
+
+void UT61E_TCP_BRIDGE::telnet_option(client_slot &slot, uint8_t verb, uint8_t option) {
+    uint8_t reply[3] = {TELNET_IAC, 0, option};
+    bool supported = option == TELNET_COM_PORT || option == TELNET_BINARY || option == TELNET_SGA;
+    switch (verb) {
+        case TS_OPTION_WILL:
+            reply[1] = supported ? TELNET_DO : TELNET_DONT;
+            break;
+        case TS_OPTION_DO:
+            // We already announced binary in accept()
+            if (option == TELNET_BINARY)
+                return;
+            reply[1] = supported ? TELNET_WILL : TELNET_WONT;
+            break;
+        default:
+            // WONT/DONT need no answer
+            return;
+    }
+    slot.client.write(reply, sizeof(reply));
+}
+
+// The meter link is fixed at 19200 7O1, so every "set" is answered with what
+// we actually run at, which RFC2217 allows the access server to do.
+void UT61E_TCP_BRIDGE::com_port_command(client_slot &slot) {
+    if (slot.sb_length < 2 || slot.sb[0] != TELNET_COM_PORT)
+        return;
+    uint8_t command = slot.sb[1];
+    uint8_t reply[12] = {TELNET_IAC, TELNET_SB, TELNET_COM_PORT, (uint8_t)(command + CPC_SERVER_OFFSET)};
+    uint8_t length = 4;
+    switch (command) {
+        case CPC_SET_BAUDRATE: {
+            const uint32_t baud = 19200;
+            reply[length++] = (uint8_t)(baud >> 24);
+            reply[length++] = (uint8_t)(baud >> 16);
+            reply[length++] = (uint8_t)(baud >> 8);
+            reply[length++] = (uint8_t)baud;
+            break;
+        }
+        case CPC_SET_DATASIZE:
+            reply[length++] = 7;
+            break;
+        case CPC_SET_PARITY:
+            reply[length++] = CPC_PARITY_ODD;
+            break;
+        case CPC_SET_STOPSIZE:
+            reply[length++] = 1;
+            break;
+        case CPC_SET_CONTROL:
+        case CPC_PURGE_DATA:
+            // Echo the request, there is nothing to control on a receive only link
+            reply[length++] = slot.sb_length > 2 ? slot.sb[2] : 0;
+            break;
+        case CPC_SIGNATURE:
+            memcpy(reply + length, "UT61E", 5);
+            length += 5;
+            break;
+        default:
+            // Line/modem state masks and flow control: acknowledge with no value
+            reply[length++] = slot.sb_length > 2 ? slot.sb[2] : 0;
+            break;
+    }
+    reply[length++] = TELNET_IAC;
+    reply[length++] = TELNET_SE;
+    slot.client.write(reply, length);
+}
+
+void UT61E_TCP_BRIDGE::service_telnet(client_slot &slot) {
+    while (slot.client.available()) {
+        uint8_t c = slot.client.read();
+        if (!rfc2217)
+            continue; // Raw mode: the meter can't be written to, so discard
+        switch (slot.telnet_state) {
+            case TS_DATA:
+                if (c == TELNET_IAC)
+                    slot.telnet_state = TS_IAC;
+                break;
+            case TS_IAC:
+                switch (c) {
+                    case TELNET_WILL: slot.telnet_state = TS_OPTION_WILL; break;
+                    case TELNET_WONT: slot.telnet_state = TS_OPTION_WONT; break;
+                    case TELNET_DO:   slot.telnet_state = TS_OPTION_DO; break;
+                    case TELNET_DONT: slot.telnet_state = TS_OPTION_DONT; break;
+                    case TELNET_SB:
+                        slot.sb_length = 0;
+                        slot.telnet_state = TS_SB;
+                        break;
+                    default:
+                        slot.telnet_state = TS_DATA;
+                }
+                break;
+            case TS_OPTION_WILL:
+            case TS_OPTION_WONT:
+            case TS_OPTION_DO:
+            case TS_OPTION_DONT:
+                telnet_option(slot, slot.telnet_state, c);
+                slot.telnet_state = TS_DATA;
+                break;
+            case TS_SB:
+                if (c == TELNET_IAC)
+                    slot.telnet_state = TS_SB_IAC;
+                else if (slot.sb_length < sizeof(slot.sb))
+                    slot.sb[slot.sb_length++] = c;
+                break;
+            case TS_SB_IAC:
+                if (c == TELNET_SE) {
+                    com_port_command(slot);
+                    slot.telnet_state = TS_DATA;
+                } else {
+                    // Escaped 255 inside the subnegotiation
+                    if (slot.sb_length < sizeof(slot.sb))
+                        slot.sb[slot.sb_length++] = c;
+                    slot.telnet_state = TS_SB;
+                }
+                break;
+        }
+    }
+}
+
+void UT61E_TCP_BRIDGE::loop() {
+    accept();
+    for (auto &slot: slots) {
+        if (!slot.client.connected()) {
+            slot.count = 0;
+            continue;
+        }
+        service_telnet(slot);
+        flush(slot);
+    }
+}
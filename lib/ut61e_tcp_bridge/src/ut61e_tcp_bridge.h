@@ -0,0 +1,64 @@
+/*
+ * ut61e_tcp_bridge.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <ESP8266WiFi.h>
+
+#ifndef UT61E_TCP_BRIDGE_H_
+#define UT61E_TCP_BRIDGE_H_
+
+#ifndef UT61E_TCP_MAX_CLIENTS
+#define UT61E_TCP_MAX_CLIENTS       3    // Simultaneous PC connections
+#endif
+#ifndef UT61E_TCP_QUEUE_FRAMES
+#define UT61E_TCP_QUEUE_FRAMES      8    // Frames held per client before dropping the oldest
+#endif
+
+#define UT61E_TCP_FRAME_SIZE        14   // 12 data bytes + CR LF
+
+// Serves the raw meter byte stream (as it arrives on the RX pin) to TCP
+// clients such as sigrok or vendor logging software. Each frame is queued per
+// client and written with a single write() so a packet never gets split
+// across TCP segments. With rfc2217 enabled the port also speaks enough of
+// the RFC2217 telnet COM port option for clients to "open" a 19200 7O1 port.
+class UT61E_TCP_BRIDGE {
+	private:
+		struct client_slot {
+			WiFiClient client;
+			uint8_t queue[UT61E_TCP_QUEUE_FRAMES][UT61E_TCP_FRAME_SIZE];
+			uint8_t head;
+			uint8_t count;
+			uint8_t telnet_state;
+			uint8_t sb_length;
+			uint8_t sb[8];
+		};
+		WiFiServer server;
+		bool rfc2217;
+		client_slot slots[UT61E_TCP_MAX_CLIENTS];
+
+		void accept();
+		void flush(client_slot &slot);
+		void service_telnet(client_slot &slot);
+		void telnet_option(client_slot &slot, uint8_t verb, uint8_t option);
+		void com_port_command(client_slot &slot);
+	public:
+		UT61E_TCP_BRIDGE(uint16_t port, bool rfc2217 = false);
+		~UT61E_TCP_BRIDGE() { }
+
+		void begin();
+		// Queue one complete frame (including CR LF) for every connected client
+		void enqueue(const uint8_t *frame);
+		// Accept clients, answer telnet negotiation and push out queued frames.
+		// Never blocks: a client that can't take a whole frame is skipped.
+		void loop();
+		uint8_t clients();
+
+		uint32_t frames_sent;
+		uint32_t frames_dropped;  // Oldest frames overwritten because a client fell behind
+};
+
+#endif /* UT61E_TCP_BRIDGE_H_ */
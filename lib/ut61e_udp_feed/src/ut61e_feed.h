@@ -0,0 +1,110 @@
+/*
+ * ut61e_feed.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Datagram format of the UDP reading feed, shared by the firmware sender
+ * and host receivers. Plain C++, no Arduino dependencies.
+ *
+ *   offset  size
+ *        0     2  magic 0x4655 ("UF")
+ *        2     1  version
+ *        3     1  count: readings that follow
+ *        4     4  device id (ESP chip id)
+ *        8     4  sequence: datagram number since boot
+ *       12     4  number of the first reading since boot
+ *       16  16*n  ut61e_reading_t, time_ms = sender millis() when the
+ *                 frame's CR LF arrived, however late it was decoded
+ *
+ * All fields little-endian. A gap in sequence is a lost datagram, a gap in
+ * the reading numbers the readings it carried. Both start again from 0 when
+ * the sender reboots.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "ut61e_reading.h"
+
+#ifndef UT61E_FEED_H_
+#define UT61E_FEED_H_
+
+#define UT61E_FEED_MAGIC          0x4655
+#define UT61E_FEED_VERSION        1
+#define UT61E_FEED_MAX_READINGS   32     // 528 bytes, well inside one WiFi frame
+
+struct ut61e_feed_header {
+	uint16_t magic;
+	uint8_t version;
+	uint8_t count;
+	uint32_t device_id;
+	uint32_t sequence;
+	uint32_t first_reading;
+};
+
+#define UT61E_FEED_HEADER_SIZE    16
+#define UT61E_FEED_MAX_SIZE       (UT61E_FEED_HEADER_SIZE + UT61E_FEED_MAX_READINGS * 16)
+
+static_assert(sizeof(ut61e_feed_header) == UT61E_FEED_HEADER_SIZE && sizeof(ut61e_reading_t) == 16,
+              "feed datagram layout");
+
+// Check a received datagram and point at its readings (copy them out with
+// memcpy, they may be unaligned). Returns the number of readings, or -1 if
+// it isn't a feed datagram.
+inline int ut61e_feed_parse(const uint8_t *data, size_t length, ut61e_feed_header &header,
+                            const uint8_t *&readings) {
+	if (length < UT61E_FEED_HEADER_SIZE)
+		return -1;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != UT61E_FEED_MAGIC || header.version != UT61E_FEED_VERSION
+	    || header.count > UT61E_FEED_MAX_READINGS
+	    || length != UT61E_FEED_HEADER_SIZE + (size_t)header.count * sizeof(ut61e_reading_t))
+		return -1;
+	readings = data + UT61E_FEED_HEADER_SIZE;
+	return header.count;
+}
+
+// Collects readings into datagrams of up to batch readings
+class UT61E_FEED_ENCODER {
+	public:
+		UT61E_FEED_ENCODER(uint32_t device_id = 0, uint8_t batch = 1) { configure(device_id, batch); }
+		~UT61E_FEED_ENCODER() { }
+
+		void configure(uint32_t id, uint8_t readings_per_datagram) {
+			device_id = id;
+			batch = readings_per_datagram < 1 ? 1
+			      : readings_per_datagram > UT61E_FEED_MAX_READINGS ? UT61E_FEED_MAX_READINGS
+			      : readings_per_datagram;
+		}
+		// Add a reading. True when the datagram is full: send it, then next().
+		bool add(const ut61e_reading_t &r) {
+			memcpy(buffer + UT61E_FEED_HEADER_SIZE + count * sizeof(r), &r, sizeof(r));
+			return ++count >= batch;
+		}
+		uint8_t pending() const { return count; }
+		// The datagram so far, header filled in
+		const uint8_t *data() {
+			ut61e_feed_header h = {UT61E_FEED_MAGIC, UT61E_FEED_VERSION, count, device_id, sequence, readings};
+			memcpy(buffer, &h, sizeof(h));
+			return buffer;
+		}
+		size_t size() const { return UT61E_FEED_HEADER_SIZE + count * sizeof(ut61e_reading_t); }
+		// Start the next datagram
+		void next() {
+			sequence++;
+			readings += count;
+			count = 0;
+		}
+
+		uint32_t sequence = 0;     // Of the datagram being filled
+		uint32_t readings = 0;     // Readings in the datagrams before it
+	private:
+		uint8_t buffer[UT61E_FEED_MAX_SIZE];
+		uint32_t device_id;
+		uint8_t batch;
+		uint8_t count = 0;
+};
+
+#endif /* UT61E_FEED_H_ */
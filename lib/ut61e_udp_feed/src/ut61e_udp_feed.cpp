@@ -0,0 +1,47 @@
+/*
+ * ut61e_udp_feed.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ut61e_udp_feed.h"
+
+UT61E_UDP_FEED::UT61E_UDP_FEED(IPAddress group, uint16_t port, uint8_t batch, uint16_t max_age_ms)
+    :group(group),port(port),batch(batch),max_age_ms(max_age_ms),started_ms(0),encoder(0, batch),
+     datagrams_sent(0),send_errors(0) {
+}
+
+void UT61E_UDP_FEED::begin(uint32_t device_id) {
+    encoder.configure(device_id, batch);
+}
+
+void UT61E_UDP_FEED::add(const ut61e_reading_t &r) {
+    if (encoder.pending() == 0)
+        started_ms = millis();
+    if (encoder.add(r))
+        flush();
+}
+
+void UT61E_UDP_FEED::loop() {
+    if (encoder.pending() && millis() - started_ms >= max_age_ms)
+        flush();
+}
+
+void UT61E_UDP_FEED::flush() {
+    if (encoder.pending() == 0)
+        return;
+    bool multicast = group[0] >= 224 && group[0] <= 239;
+    int ok = multicast ? udp.beginPacketMulticast(group, port, WiFi.localIP()) : udp.beginPacket(group, port);
+    if (ok) {
+        udp.write(encoder.data(), encoder.size());
+        ok = udp.endPacket();
+    }
+    if (ok)
+        datagrams_sent++;
+    else
+        send_errors++;
+    // The sequence number moves on either way, so receivers see the loss
+    encoder.next();
+}
@@ -0,0 +1,45 @@
+/*
+ * ut61e_udp_feed.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "ut61e_feed.h"
+
+#ifndef UT61E_UDP_FEED_H_
+#define UT61E_UDP_FEED_H_
+
+// Sends decoded readings to a multicast group (or any unicast address) as
+// ut61e_feed.h datagrams, batch readings at a time. A partial batch goes
+// out once its first reading is max_age_ms old. Sending never waits: a
+// datagram lwIP can't take is counted and dropped, and the receivers see
+// the gap in the sequence numbers.
+class UT61E_UDP_FEED {
+	private:
+		WiFiUDP udp;
+		IPAddress group;
+		uint16_t port;
+		uint8_t batch;
+		uint16_t max_age_ms;
+		uint32_t started_ms;     // When the pending batch got its first reading
+		UT61E_FEED_ENCODER encoder;
+	public:
+		UT61E_UDP_FEED(IPAddress group, uint16_t port, uint8_t batch = 1, uint16_t max_age_ms = 1000);
+		~UT61E_UDP_FEED() { }
+
+		void begin(uint32_t device_id);
+		// Queue a reading; sends when the batch is full
+		void add(const ut61e_reading_t &r);
+		// Send a partial batch that has waited max_age_ms
+		void loop();
+		void flush();
+
+		uint32_t datagrams_sent;
+		uint32_t send_errors;     // Datagrams lwIP refused (no buffer, no WiFi)
+};
+
+#endif /* UT61E_UDP_FEED_H_ */
@@ -0,0 +1,42 @@
+/*
+ * Adafruit_NeoPixel.h - host stand-in for the Adafruit NeoPixel library
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Keeps the pixel colours and counts show() calls; nothing is driven.
+ */
+
+#ifndef NATIVE_ADAFRUIT_NEOPIXEL_H_
+#define NATIVE_ADAFRUIT_NEOPIXEL_H_
+
+#include "Arduino.h"
+#include <vector>
+
+#define NEO_GRB     0x52
+#define NEO_RGB     0x06
+#define NEO_KHZ800  0x0000
+
+class Adafruit_NeoPixel {
+	public:
+		Adafruit_NeoPixel(uint16_t n, int16_t pin, uint16_t type):shown(n, 0), pixels(n, 0) { }
+
+		void begin() { }
+		void show() { shown = pixels; shows++; }
+		void clear() { std::fill(pixels.begin(), pixels.end(), 0); }
+		void setBrightness(uint8_t b) { brightness = b; }
+		void setPixelColor(uint16_t n, uint32_t c) { if (n < pixels.size()) pixels[n] = c; }
+		uint32_t getPixelColor(uint16_t n) const { return n < pixels.size() ? pixels[n] : 0; }
+		uint16_t numPixels() const { return (uint16_t)pixels.size(); }
+		static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+
+		// Native runtime
+		uint64_t shows = 0;
+		uint8_t brightness = 255;
+		std::vector<uint32_t> shown;   // Colours as last shown
+	private:
+		std::vector<uint32_t> pixels;
+};
+
+#endif /* NATIVE_ADAFRUIT_NEOPIXEL_H_ */
@@ -0,0 +1,57 @@
+/*
+ * Arduino.h - host stand-in for the Arduino core
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Enough of the ESP8266 Arduino core for the firmware to run on Linux (see
+ * native/README.md). Time runs on the native clock, which can be sped up.
+ */
+
+#ifndef NATIVE_ARDUINO_H_
+#define NATIVE_ARDUINO_H_
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+#include "IPAddress.h"
+#include "WString.h"
+
+typedef uint8_t byte;
+
+// D1 mini pin names
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+class EspClass {
+	public:
+		uint32_t getChipId();
+		uint32_t getFreeHeap();
+		uint32_t getMaxFreeBlockSize();
+		uint8_t getHeapFragmentation();
+		uint32_t getCycleCount();
+		void restart();
+};
+
+extern EspClass ESP;
+
+#endif /* NATIVE_ARDUINO_H_ */
@@ -0,0 +1,44 @@
+/*
+ * EEPROM.h - host stand-in for the ESP8266 EEPROM emulation
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Backed by the file named with --eeprom, or memory only without one.
+ */
+
+#ifndef NATIVE_EEPROM_H_
+#define NATIVE_EEPROM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+class EEPROMClass {
+	public:
+		void begin(size_t size);
+		bool commit();
+		void end() { commit(); }
+		size_t length() const { return data.size(); }
+		uint8_t read(int address) const { return (size_t)address < data.size() ? data[address] : 0; }
+		void write(int address, uint8_t value) { if ((size_t)address < data.size()) data[address] = value; }
+
+		template <typename T> T &get(int address, T &t) {
+			if (address >= 0 && address + sizeof(T) <= data.size())
+				memcpy(&t, data.data() + address, sizeof(T));
+			return t;
+		}
+		template <typename T> const T &put(int address, const T &t) {
+			if (address >= 0 && address + sizeof(T) <= data.size())
+				memcpy(data.data() + address, &t, sizeof(T));
+			return t;
+		}
+	private:
+		std::vector<uint8_t> data;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif /* NATIVE_EEPROM_H_ */
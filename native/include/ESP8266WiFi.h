@@ -0,0 +1,86 @@
+/*
+ * ESP8266WiFi.h - host stand-in for the ESP8266 WiFi library
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * WiFi "connects" at once (unless the native runtime says not to).
+ * WiFiClient and WiFiServer are real non-blocking TCP sockets; copies of a
+ * client share its socket, as on the ESP8266. The client given to
+ * PubSubClient reports on the MQTT connection, so the firmware can check
+ * its send space with availableForWrite().
+ */
+
+#ifndef NATIVE_ESP8266WIFI_H_
+#define NATIVE_ESP8266WIFI_H_
+
+#include "Arduino.h"
+#include <functional>
+#include <memory>
+
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4,
+                   WL_DISCONNECTED = 6 };
+
+class WiFiClass {
+	public:
+		wl_status_t status() { return state; }
+		void begin(const char *ssid, const char *password);
+		void disconnect() { state = WL_DISCONNECTED; }
+		void setAutoConnect(bool) { }
+		IPAddress localIP() { return state == WL_CONNECTED ? IPAddress(127, 0, 0, 1) : IPAddress(); }
+		int32_t RSSI() { return state == WL_CONNECTED ? -60 : 31; }  // 31 is the ESP8266's "not connected"
+	private:
+		wl_status_t state = WL_IDLE_STATUS;
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient: public Stream {
+	public:
+		WiFiClient() { }
+		explicit WiFiClient(int fd);
+
+		int connect(const char *host, uint16_t port);
+		uint8_t connected();
+		void stop();
+		void setNoDelay(bool on);
+		operator bool() { return connected(); }
+
+		int available() override;
+		int read() override;
+		int peek() override;
+		using Print::write;
+		size_t write(uint8_t c) override { return write(&c, 1); }
+		size_t write(const uint8_t *buffer, size_t size) override;
+		int availableForWrite() override;
+
+		// Native only: stand for a socket owned elsewhere (PubSubClient's)
+		void borrow(std::function<int()> f) { borrowed = std::move(f); }
+	private:
+		struct socket {
+			int fd;
+			~socket();
+		};
+		std::shared_ptr<socket> sock;
+		std::function<int()> borrowed;
+		int fd() const { return sock ? sock->fd : borrowed ? borrowed() : -1; }
+};
+
+class WiFiServer {
+	public:
+		explicit WiFiServer(uint16_t port):port(port) { }
+		~WiFiServer();
+
+		void begin();
+		void setNoDelay(bool on) { nodelay = on; }
+		bool hasClient();
+		WiFiClient available();
+	private:
+		uint16_t port;
+		int listen_fd = -1;
+		int pending = -1;
+		bool nodelay = false;
+};
+
+#endif /* NATIVE_ESP8266WIFI_H_ */
@@ -0,0 +1,38 @@
+/*
+ * HardwareSerial.h - host stand-in for the Arduino hardware UART
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Output goes to out (stdout unless changed, nullptr discards it); there is
+ * no input. Once begin() sets the baud rate, bytes leave a 128 byte FIFO at
+ * that rate and write() waits for room, as the ESP8266's UART does.
+ */
+
+#ifndef NATIVE_HARDWARESERIAL_H_
+#define NATIVE_HARDWARESERIAL_H_
+
+#include "Stream.h"
+
+class HardwareSerial: public Stream {
+	public:
+		void begin(unsigned long baud) { this->baud = baud; }
+		using Print::write;
+		size_t write(uint8_t c) override { return write(&c, 1); }
+		size_t write(const uint8_t *buffer, size_t size) override;
+		int availableForWrite() override;
+		int available() override { return 0; }
+		int read() override { return -1; }
+
+		FILE *out = stdout;
+		uint64_t bytes = 0;
+		uint64_t blocked_us = 0;   // Time write() spent waiting for room in the FIFO
+	private:
+		unsigned long baud = 0;
+		uint64_t sent_until_us = 0;  // When the last byte queued leaves the FIFO
+};
+
+extern HardwareSerial Serial;
+
+#endif /* NATIVE_HARDWARESERIAL_H_ */
@@ -0,0 +1,25 @@
+/*
+ * IPAddress.h - host stand-in for the Arduino IPAddress class
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#ifndef NATIVE_IPADDRESS_H_
+#define NATIVE_IPADDRESS_H_
+
+#include "Print.h"
+
+class IPAddress: public Printable {
+	public:
+		IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0):octets{a, b, c, d} { }
+		uint8_t operator[](int i) const { return octets[i]; }
+		size_t printTo(Print &p) const override {
+			return p.printf("%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+		}
+	private:
+		uint8_t octets[4];
+};
+
+#endif /* NATIVE_IPADDRESS_H_ */
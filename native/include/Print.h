@@ -0,0 +1,68 @@
+/*
+ * Print.h - host stand-in for the Arduino Print class
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Just enough of the Arduino core for the project libraries to build on the
+ * host (PlatformIO `native` environments).
+ */
+
+#ifndef NATIVE_PRINT_H_
+#define NATIVE_PRINT_H_
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "WString.h"
+#include "Printable.h"
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+	public:
+		virtual ~Print() { }
+		virtual size_t write(uint8_t c) = 0;
+		virtual size_t write(const uint8_t *buffer, size_t size) {
+			size_t n = 0;
+			while (size--)
+				n += write(*buffer++);
+			return n;
+		}
+		size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+		size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+		virtual int availableForWrite() { return 0; }
+		virtual void flush() { }
+
+		size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+			char buffer[256];
+			va_list args;
+			va_start(args, format);
+			int n = vsnprintf(buffer, sizeof(buffer), format, args);
+			va_end(args);
+			if (n < 0)
+				return 0;
+			return write((const uint8_t *)buffer, (size_t)n < sizeof(buffer) ? n : sizeof(buffer) - 1);
+		}
+		size_t print(const char *s) { return write(s); }
+		size_t print(const String &s) { return write(s.c_str(), s.length()); }
+		size_t print(const Printable &p) { return p.printTo(*this); }
+		size_t print(char c) { return write((uint8_t)c); }
+		size_t print(long v, int base = DEC) { return number(v, base); }
+		size_t print(int v, int base = DEC) { return number(v, base); }
+		size_t print(unsigned long v, int base = DEC) { return unumber(v, base); }
+		size_t print(unsigned int v, int base = DEC) { return unumber(v, base); }
+		size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+		size_t println() { return write("\r\n"); }
+		template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+		template <typename T> size_t println(T v, int format) { size_t n = print(v, format); return n + println(); }
+	private:
+		size_t number(long v, int base) { return base == HEX ? printf("%lX", v) : printf("%ld", v); }
+		size_t unumber(unsigned long v, int base) { return base == HEX ? printf("%lX", v) : printf("%lu", v); }
+};
+
+#endif /* NATIVE_PRINT_H_ */
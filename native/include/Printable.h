@@ -0,0 +1,22 @@
+/*
+ * Printable.h - host stand-in for the Arduino Printable interface
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#ifndef NATIVE_PRINTABLE_H_
+#define NATIVE_PRINTABLE_H_
+
+#include <cstddef>
+
+class Print;
+
+class Printable {
+	public:
+		virtual ~Printable() { }
+		virtual size_t printTo(Print &p) const = 0;
+};
+
+#endif /* NATIVE_PRINTABLE_H_ */
@@ -0,0 +1,73 @@
+/*
+ * PubSubClient.h - host stand-in for Nick O'Leary's MQTT client
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Talks to a real broker through mqtt_lite (tools/common) instead of the
+ * WiFiClient it is given, which then reports on that connection. QoS 0,
+ * like the firmware uses it.
+ */
+
+#ifndef NATIVE_PUBSUBCLIENT_H_
+#define NATIVE_PUBSUBCLIENT_H_
+
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "mqtt_lite.h"
+#include <string>
+
+#define MQTT_CONNECTION_TIMEOUT  -4
+#define MQTT_CONNECTION_LOST     -3
+#define MQTT_CONNECT_FAILED      -2
+#define MQTT_DISCONNECTED        -1
+#define MQTT_CONNECTED            0
+
+class PubSubClient: public Print {
+	public:
+		typedef void (*callback_t)(char *topic, uint8_t *payload, unsigned int length);
+
+		explicit PubSubClient(Stream &net) {
+			if (WiFiClient *c = dynamic_cast<WiFiClient *>(&net))
+				c->borrow([this] { return mqtt.fd(); });
+		}
+
+		PubSubClient &setServer(const char *host, uint16_t port);
+		PubSubClient &setCallback(callback_t c) { callback = c; return *this; }
+		bool setBufferSize(uint16_t size) { buffer_size = size; return true; }
+		PubSubClient &setSocketTimeout(uint16_t) { return *this; }   // Connects block until done here
+
+		bool connect(const char *id, const char *user = nullptr, const char *pass = nullptr);
+		bool connected();
+		void disconnect();
+		int state() { return status; }
+		bool loop();
+		bool subscribe(const char *topic);
+
+		bool publish(const char *topic, const char *payload, bool retained = false);
+		bool publish(const char *topic, const uint8_t *payload, unsigned int length, bool retained = false);
+		bool beginPublish(const char *topic, unsigned int length, bool retained);
+		using Print::write;
+		size_t write(uint8_t c) override;
+		size_t write(const uint8_t *buffer, size_t size) override;
+		int endPublish();
+
+		// Native runtime statistics
+		uint64_t published = 0;
+		uint64_t oversize = 0;   // Publishes the real 256 byte buffer would have refused
+	private:
+		mqtt_lite mqtt;
+		std::string host;
+		uint16_t port = 1883;
+		callback_t callback = nullptr;
+		uint16_t buffer_size = 256;
+		int status = MQTT_DISCONNECTED;
+		std::string pending_topic;
+		std::string pending_payload;
+		bool pending_retain = false;
+		std::string rx_topic;
+		std::string rx_payload;
+};
+
+#endif /* NATIVE_PUBSUBCLIENT_H_ */
@@ -0,0 +1,63 @@
+/*
+ * SoftwareSerial.h - host stand-in for EspSoftwareSerial
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Receives the meter stream the native runtime replays: captures or a
+ * synthetic meter, one packet every interval, the bytes paced at the baud
+ * rate on the virtual clock. Like the real driver it only buffers
+ * bufCapacity bytes; anything older is lost and overflow() reports it.
+ */
+
+#ifndef NATIVE_SOFTWARESERIAL_H_
+#define NATIVE_SOFTWARESERIAL_H_
+
+#include "Arduino.h"
+#include <vector>
+
+// Same encoding as EspSoftwareSerial: data bits - 5 in the low bits, parity above
+enum SoftwareSerialParity { SWSERIAL_PARITY_NONE = 000, SWSERIAL_PARITY_EVEN = 020, SWSERIAL_PARITY_ODD = 030,
+                            SWSERIAL_PARITY_MARK = 040, SWSERIAL_PARITY_SPACE = 070 };
+enum SoftwareSerialConfig {
+	SWSERIAL_5N1 = SWSERIAL_PARITY_NONE, SWSERIAL_6N1, SWSERIAL_7N1, SWSERIAL_8N1,
+	SWSERIAL_5E1 = SWSERIAL_PARITY_EVEN, SWSERIAL_6E1, SWSERIAL_7E1, SWSERIAL_8E1,
+	SWSERIAL_5O1 = SWSERIAL_PARITY_ODD, SWSERIAL_6O1, SWSERIAL_7O1, SWSERIAL_8O1,
+};
+
+class SoftwareSerial: public Stream {
+	public:
+		SoftwareSerial(int rx_pin, int tx_pin, bool invert = false);
+
+		void begin(uint32_t baud, SoftwareSerialConfig config = SWSERIAL_8N1, int rx_pin = -1,
+		           int tx_pin = -1, bool invert = false, int bufCapacity = 64);
+		int available() override;
+		int read() override;
+		int peek() override;
+		using Print::write;
+		size_t write(uint8_t) override { return 1; }   // Nothing listens on TX
+		// True if bytes were lost since the last call
+		bool overflow();
+		// Parity bit of the byte last read
+		bool readParity() { return last_parity; }
+		static bool parityEven(uint8_t byte) { return __builtin_parity(byte); }
+		static bool parityOdd(uint8_t byte) { return !__builtin_parity(byte); }
+
+		// Native runtime
+		bool finished() const;
+		uint64_t bytes_lost = 0;
+	private:
+		std::vector<uint8_t> stream;   // One pass of the meter stream
+		uint64_t position;             // Bytes read, over all passes
+		uint64_t byte_us;              // Time on the wire per byte
+		uint64_t start_us;
+		size_t capacity;
+		bool lost;
+		bool last_parity;
+		bool odd;
+
+		uint64_t arrived();   // Bytes the meter has sent so far
+};
+
+#endif /* NATIVE_SOFTWARESERIAL_H_ */
@@ -0,0 +1,30 @@
+/*
+ * Stream.h - host stand-in for the Arduino Stream class
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#ifndef NATIVE_STREAM_H_
+#define NATIVE_STREAM_H_
+
+#include "Print.h"
+
+class Stream: public Print {
+	public:
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() { return -1; }
+		size_t readBytes(uint8_t *buffer, size_t length) {
+			size_t n = 0;
+			while (n < length && available() > 0)
+				buffer[n++] = (uint8_t)read();
+			return n;
+		}
+		void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+	protected:
+		unsigned long timeout = 1000;
+};
+
+#endif /* NATIVE_STREAM_H_ */
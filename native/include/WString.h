@@ -0,0 +1,28 @@
+/*
+ * WString.h - host stand-in for the Arduino String class
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#ifndef NATIVE_WSTRING_H_
+#define NATIVE_WSTRING_H_
+
+#include <string>
+
+class String: public std::string {
+	public:
+		String() { }
+		String(const char *s):std::string(s ? s : "") { }
+		String(const std::string &s):std::string(s) { }
+		String(int v):std::string(std::to_string(v)) { }
+		String(unsigned v):std::string(std::to_string(v)) { }
+		String(long v):std::string(std::to_string(v)) { }
+		String(unsigned long v):std::string(std::to_string(v)) { }
+		String(double v):std::string(std::to_string(v)) { }
+		unsigned int length() const { return (unsigned int)size(); }
+		bool concat(const String &s) { append(s); return true; }
+};
+
+#endif /* NATIVE_WSTRING_H_ */
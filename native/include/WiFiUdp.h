@@ -0,0 +1,41 @@
+/*
+ * WiFiUdp.h - host stand-in for the ESP8266 WiFiUDP class
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Sending only, over a real non-blocking UDP socket. Multicast goes out on
+ * the loopback interface with loopback enabled, so receivers on the same
+ * machine see it.
+ */
+
+#ifndef NATIVE_WIFIUDP_H_
+#define NATIVE_WIFIUDP_H_
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class WiFiUDP {
+	public:
+		WiFiUDP() { }
+		~WiFiUDP() { stop(); }
+		WiFiUDP(const WiFiUDP &) = delete;
+		WiFiUDP &operator=(const WiFiUDP &) = delete;
+
+		int beginPacket(IPAddress ip, uint16_t port);
+		int beginPacketMulticast(IPAddress group, uint16_t port, IPAddress interface, int ttl = 1);
+		size_t write(uint8_t c) { return write(&c, 1); }
+		size_t write(const uint8_t *buffer, size_t size);
+		int endPacket();
+		void stop();
+	private:
+		int fd = -1;
+		uint8_t destination[4] = {0};
+		uint16_t port = 0;
+		uint8_t packet[1472];
+		size_t length = 0;
+		bool open(IPAddress interface, int ttl);
+};
+
+#endif /* NATIVE_WIFIUDP_H_ */
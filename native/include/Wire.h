@@ -0,0 +1,38 @@
+/*
+ * Wire.h - host stand-in for the Arduino I2C library
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Nothing is attached: every transmission is acknowledged and counted.
+ * endTransmission() blocks for as long as the bytes would take on the wire
+ * at the set clock, 9 bit times each, as the ESP8266's bit-banged Wire does.
+ */
+
+#ifndef NATIVE_WIRE_H_
+#define NATIVE_WIRE_H_
+
+#include "Arduino.h"
+
+class TwoWire {
+	public:
+		void begin() { }
+		void begin(int sda, int scl) { }
+		void setClock(uint32_t hz) { clock = hz; }
+		void beginTransmission(uint8_t address) { pending = 1; }
+		size_t write(uint8_t b) { pending++; return 1; }
+		size_t write(const uint8_t *data, size_t length) { pending += length; return length; }
+		uint8_t endTransmission(bool stop = true);
+
+		// Native runtime
+		uint64_t transmissions = 0;
+		uint64_t bytes = 0;         // Including the address bytes
+		uint32_t clock = 100000;
+	private:
+		size_t pending = 0;
+};
+
+extern TwoWire Wire;
+
+#endif /* NATIVE_WIRE_H_ */
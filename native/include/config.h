@@ -0,0 +1,12 @@
+/*
+ * config.h - configuration for native builds
+ *
+ * Only used when include/config.h hasn't been created: native builds run
+ * with the example settings. Point them at a broker with --broker.
+ */
+#include "../../include/config.h-example"
+
+// Off by default to save the ESP8266's RAM; the host has plenty
+#ifndef HISTORY_PORT
+#define HISTORY_PORT 8080
+#endif
@@ -0,0 +1,44 @@
+/*
+ * native.h - runtime of the native firmware build
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Options set from the command line before setup() runs, and the virtual
+ * clock every shim shares.
+ */
+
+#ifndef NATIVE_H_
+#define NATIVE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct native_options {
+	std::vector<std::string> captures;  // Meter streams to replay; synthetic if empty
+	uint64_t packets = 1000;            // Synthetic packets per pass
+	unsigned loops = 1;                 // Passes over the stream (0 = forever)
+	double speed = 1.0;                 // Virtual seconds per real second
+	unsigned interval_ms = 500;         // Packet cadence of the meter
+	std::string broker;                 // Overrides the configured broker ("host" or "host:port")
+	uint32_t chip_id = 0xC0FFEE;
+	std::string eeprom;                 // File backing the EEPROM emulation
+	uint16_t bridge_port = 0;           // Overrides TCP_BRIDGE_PORT when set
+	uint16_t metrics_port = 0;          // Overrides METRICS_PORT when set
+	uint16_t history_port = 0;          // Overrides HISTORY_PORT when set
+	bool wifi = true;                   // Pretend WiFi connects
+	unsigned line_errors = 0;           // Corrupt every nth byte, parity wrong (0 = clean line)
+};
+
+namespace native {
+	extern native_options options;
+
+	// Virtual time since start, in microseconds
+	uint64_t now_us();
+	// True once the meter stream has been sent and read completely
+	bool serial_finished();
+}
+
+#endif /* NATIVE_H_ */
@@ -0,0 +1,112 @@
+/*
+ * arduino.cpp - native Arduino core: virtual clock, Serial, ESP, Wire
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "native.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+static const auto start_time = std::chrono::steady_clock::now();
+
+namespace native {
+
+native_options options;
+
+uint64_t now_us() {
+    double real = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count();
+    return (uint64_t)(real * options.speed);
+}
+
+} // namespace native
+
+HardwareSerial Serial;
+
+#define UART_FIFO_SIZE  128
+
+int HardwareSerial::availableForWrite() {
+    if (!baud)
+        return UART_FIFO_SIZE;
+    uint64_t now = native::now_us();
+    if (sent_until_us <= now)
+        return UART_FIFO_SIZE;
+    // 10 bits a byte
+    uint64_t queued = ((sent_until_us - now) * baud + 10000000 - 1) / 10000000;
+    return queued >= UART_FIFO_SIZE ? 0 : UART_FIFO_SIZE - (int)queued;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    if (baud) {
+        uint64_t byte_us = 10000000ULL / baud;
+        for (size_t i = 0; i < size; i++) {
+            uint64_t start = native::now_us();
+            while (availableForWrite() == 0)
+                ;
+            blocked_us += native::now_us() - start;
+            sent_until_us = std::max(sent_until_us, native::now_us()) + byte_us;
+        }
+    }
+    bytes += size;
+    return out ? fwrite(buffer, 1, size, out) : size;
+}
+
+EspClass ESP;
+TwoWire Wire;
+
+unsigned long millis() {
+    return (unsigned long)(uint32_t)(native::now_us() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)native::now_us();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms / native::options.speed));
+}
+
+void yield() { }
+
+// Busy, like the bit-banged original: the time is the caller's
+uint8_t TwoWire::endTransmission(bool stop) {
+    uint64_t until = native::now_us() + pending * 9 * 1000000ULL / clock;
+    while (native::now_us() < until)
+        ;
+    transmissions++;
+    bytes += pending;
+    pending = 0;
+    return 0;
+}
+
+uint32_t EspClass::getChipId() {
+    return native::options.chip_id;
+}
+
+// The host has no heap worth reporting; these are typical D1 mini figures
+uint32_t EspClass::getFreeHeap() {
+    return 40000;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize() {
+    return 36000;
+}
+
+uint8_t EspClass::getHeapFragmentation() {
+    return 10;
+}
+
+// 80 MHz cycles on the virtual clock
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(native::now_us() * 80);
+}
+
+void EspClass::restart() {
+    fprintf(stderr, "ESP.restart()\n");
+    exit(0);
+}
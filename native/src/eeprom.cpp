@@ -0,0 +1,38 @@
+/*
+ * eeprom.cpp - native EEPROM emulation
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "EEPROM.h"
+#include "native.h"
+#include <cstdio>
+
+EEPROMClass EEPROM;
+
+// Blank flash reads as 0xFF, like the ESP8266's
+void EEPROMClass::begin(size_t size) {
+    data.assign(size, 0xFF);
+    const std::string &path = native::options.eeprom;
+    if (path.empty())
+        return;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return;
+    size_t n = fread(data.data(), 1, data.size(), f);
+    (void)n;
+    fclose(f);
+}
+
+bool EEPROMClass::commit() {
+    const std::string &path = native::options.eeprom;
+    if (path.empty())
+        return true;
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
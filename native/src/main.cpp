@@ -0,0 +1,135 @@
+/*
+ * main.cpp - native firmware build
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Runs the unmodified firmware (src/UT61EWiFiD1Mini.ino) on Linux against
+ * the shims in native/include:
+ *
+ *   native [--broker host[:port]] [--speed x] [--interval ms] [--loops n]
+ *          [--packets n] [--id hex] [--eeprom file] [--bridge-port port]
+ *          [--metrics-port port] [--history-port port] [--line-errors n]
+ *          [--no-wifi] [--quiet] [capture files...]
+ *
+ * The meter stream (captures, or --packets synthetic ones) is replayed
+ * --loops times, then the firmware gets a moment to publish what is queued
+ * and a summary goes to stderr.
+ */
+
+#include "native.h"
+#include "UT61EWiFiD1Mini.ino"
+#include <chrono>
+#include <csignal>
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int) {
+    g_stop = 1;
+}
+
+static void usage() {
+    fprintf(stderr,
+        "usage: native [--broker host[:port]] [--speed x] [--interval ms] [--loops n]\n"
+        "              [--packets n] [--id hex] [--eeprom file] [--bridge-port port]\n"
+        "              [--metrics-port port] [--history-port port] [--line-errors n]\n"
+        "              [--no-wifi] [--quiet] [capture files...]\n");
+}
+
+static bool parse_options(int argc, char **argv, native_options &o, bool &quiet) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if (!strcmp(a, "--broker") && has_arg)
+            o.broker = argv[++i];
+        else if (!strcmp(a, "--speed") && has_arg)
+            o.speed = atof(argv[++i]);
+        else if (!strcmp(a, "--interval") && has_arg)
+            o.interval_ms = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "--loops") && has_arg)
+            o.loops = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "--packets") && has_arg)
+            o.packets = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "--id") && has_arg)
+            o.chip_id = strtoul(argv[++i], nullptr, 16);
+        else if (!strcmp(a, "--eeprom") && has_arg)
+            o.eeprom = argv[++i];
+        else if (!strcmp(a, "--bridge-port") && has_arg)
+            o.bridge_port = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--metrics-port") && has_arg)
+            o.metrics_port = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--history-port") && has_arg)
+            o.history_port = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "--line-errors") && has_arg)
+            o.line_errors = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "--no-wifi"))
+            o.wifi = false;
+        else if (!strcmp(a, "--quiet"))
+            quiet = true;
+        else if (a[0] != '-')
+            o.captures.push_back(a);
+        else
+            return false;
+    }
+    return o.speed > 0;
+}
+
+int main(int argc, char **argv) {
+    bool quiet = false;
+    if (!parse_options(argc, argv, native::options, quiet)) {
+        usage();
+        return 1;
+    }
+    if (quiet)
+        Serial.out = nullptr;
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    auto start = std::chrono::steady_clock::now();
+    setup();
+    while (!g_stop && !native::serial_finished())
+        loop();
+    // Let the last packets through decode and publish
+    uint64_t drain_until = native::now_us() + 2000ULL * native::options.interval_ms + 1000000;
+    while (!g_stop && native::now_us() < drain_until)
+        loop();
+    double real = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stderr, "\n%.3f s real, %.3f s virtual (x%.0f)\n", real, native::now_us() / 1e6,
+            native::options.speed);
+    fprintf(stderr, "frames %u, resync bytes %u, serial bytes lost %llu, frames dropped %u\n",
+            framer.frames, framer.resync_bytes, (unsigned long long)ut61e.bytes_lost, g_frames_dropped);
+    fprintf(stderr, "parity errors %u, overflows %u, check failures %u, unknown function %u, range %u\n",
+            g_parity_errors, g_overflows, meter.check_failures(), meter.unknown_function(),
+            meter.unknown_range());
+    fprintf(stderr, "MQTT %s, %llu published, %llu over the 256 byte buffer\n",
+            client.connected() ? "connected" : "not connected",
+            (unsigned long long)client.published, (unsigned long long)client.oversize);
+    fanout.stats_json(g_json_message_buffer, sizeof(g_json_message_buffer), millis());
+    fprintf(stderr, "sinks %s\n", g_json_message_buffer);
+    fprintf(stderr, "serial console %llu bytes, %.3f s waiting for the UART\n",
+            (unsigned long long)Serial.bytes, Serial.blocked_us / 1e6);
+    fprintf(stderr, "decode memo: %u hits, %u partial, %u misses\n",
+            meter.dmm.memo_hits, meter.dmm.memo_partial, meter.dmm.memo_misses);
+    fprintf(stderr, "LED shows %llu\n", (unsigned long long)pixels.shows);
+#ifdef OLED_I2C_ADDRESS
+    fprintf(stderr, "OLED %u updates, %u glyphs, %u pixel bytes, %llu I2C bytes in %llu transmissions\n",
+            oled.updates, oled.glyphs_drawn, oled.bytes_sent,
+            (unsigned long long)Wire.bytes, (unsigned long long)Wire.transmissions);
+#endif
+#ifdef METRICS_PORT
+    fprintf(stderr, "metrics %u scrapes, %u renders, %u partial writes, %u rejected, %u not found\n",
+            metrics.scrapes, metrics.renders, metrics.partial_writes, metrics.rejected, metrics.not_found);
+#endif
+#ifdef HISTORY_PORT
+    fprintf(stderr, "history %u readings in %u bytes (%u overwritten), %u exports, %u aborted, %u bytes sent\n",
+            history.readings(), (unsigned)history.bytes(), history.overwritten, history_server.exports,
+            history_server.aborted, history_server.bytes_sent);
+#endif
+    fprintf(stderr, "sessions %u closed (%u summaries lost), %u readings in open session %u\n",
+            session.sessions, session.lost, session.id() ? session.summary().count : 0, session.id());
+    scheduler.stats_json(g_json_message_buffer, sizeof(g_json_message_buffer));
+    fprintf(stderr, "scheduler %s\n", g_json_message_buffer);
+    return 0;
+}
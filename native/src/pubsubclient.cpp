@@ -0,0 +1,112 @@
+/*
+ * pubsubclient.cpp - native PubSubClient over mqtt_lite
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "PubSubClient.h"
+#include "native.h"
+
+#define MQTT_HEADER_SIZE  5   // Fixed header + length bytes PubSubClient reserves
+
+PubSubClient &PubSubClient::setServer(const char *h, uint16_t p) {
+    host = h;
+    port = p;
+    // --broker host[:port] wins over the configuration
+    const std::string &b = native::options.broker;
+    if (!b.empty()) {
+        size_t colon = b.rfind(':');
+        host = b.substr(0, colon);
+        if (colon != std::string::npos)
+            port = (uint16_t)atoi(b.c_str() + colon + 1);
+    }
+    return *this;
+}
+
+bool PubSubClient::connect(const char *id, const char *user, const char *pass) {
+    if (!mqtt.connect(host.c_str(), port, id, user, pass, 15)) {
+        status = MQTT_CONNECT_FAILED;
+        return false;
+    }
+    mqtt.on_message([this](std::string_view topic, std::string_view payload) {
+        if (!callback)
+            return;
+        // The firmware expects a NUL terminated topic and a writable payload
+        rx_topic.assign(topic);
+        rx_payload.assign(payload);
+        callback(&rx_topic[0], (uint8_t *)&rx_payload[0], (unsigned int)rx_payload.size());
+    });
+    status = MQTT_CONNECTED;
+    return true;
+}
+
+bool PubSubClient::connected() {
+    if (!mqtt.connected() && status == MQTT_CONNECTED)
+        status = MQTT_CONNECTION_LOST;
+    return mqtt.connected();
+}
+
+void PubSubClient::disconnect() {
+    mqtt.disconnect();
+    status = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::loop() {
+    if (!mqtt.connected())
+        return false;
+    if (mqtt.poll(0) < 0) {
+        status = MQTT_CONNECTION_LOST;
+        return false;
+    }
+    return true;
+}
+
+bool PubSubClient::subscribe(const char *topic) {
+    return mqtt.connected() && mqtt.subscribe(topic);
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained) {
+    return publish(topic, (const uint8_t *)payload, payload ? strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int length, bool retained) {
+    // The real client can't send what doesn't fit its buffer; count it so
+    // native runs show the firmware would have lost the message
+    if (MQTT_HEADER_SIZE + 2 + strlen(topic) + length > buffer_size) {
+        oversize++;
+        return false;
+    }
+    if (!mqtt.publish(topic, std::string_view((const char *)payload, length), retained))
+        return false;
+    published++;
+    return true;
+}
+
+bool PubSubClient::beginPublish(const char *topic, unsigned int length, bool retained) {
+    if (!mqtt.connected())
+        return false;
+    pending_topic = topic;
+    pending_payload.clear();
+    pending_payload.reserve(length);
+    pending_retain = retained;
+    return true;
+}
+
+size_t PubSubClient::write(uint8_t c) {
+    pending_payload.push_back((char)c);
+    return 1;
+}
+
+size_t PubSubClient::write(const uint8_t *buffer, size_t size) {
+    pending_payload.append((const char *)buffer, size);
+    return size;
+}
+
+int PubSubClient::endPublish() {
+    if (!mqtt.publish(pending_topic, pending_payload, pending_retain))
+        return 0;
+    published++;
+    return 1;
+}
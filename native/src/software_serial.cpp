@@ -0,0 +1,104 @@
+/*
+ * software_serial.cpp - native EspSoftwareSerial
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "SoftwareSerial.h"
+#include "native.h"
+#include "capture.h"
+
+static SoftwareSerial *meter_port = nullptr;
+
+namespace native {
+
+bool serial_finished() {
+    return meter_port && meter_port->finished();
+}
+
+} // namespace native
+
+SoftwareSerial::SoftwareSerial(int, int, bool):position(0),byte_us(0),start_us(0),capacity(64),lost(false),
+                                               last_parity(false),odd(false) {}
+
+void SoftwareSerial::begin(uint32_t baud, SoftwareSerialConfig config, int, int, bool, int bufCapacity) {
+    const native_options &o = native::options;
+    std::vector<packet_t> packets;
+    for (auto &f: o.captures)
+        if (!load_packets(f, packets))
+            fprintf(stderr, "Can't read %s\n", f.c_str());
+    if (o.captures.empty()) {
+        synthetic_meter meter;
+        for (uint64_t i = 0; i < o.packets; i++)
+            packets.push_back(meter.next_packet());
+    }
+    stream.clear();
+    for (auto &p: packets) {
+        stream.insert(stream.end(), p.begin(), p.end());
+        stream.push_back('\r');
+        stream.push_back('\n');
+    }
+    // Start bit, data bits, parity, stop bit
+    unsigned bits = 1 + 5 + (config & 07) + ((config & 070) ? 1 : 0) + 1;
+    byte_us = 1000000ULL * bits / (baud ? baud : 19200);
+    odd = (config & 070) == SWSERIAL_PARITY_ODD;
+    capacity = bufCapacity > 0 ? bufCapacity : 64;
+    position = 0;
+    start_us = native::now_us();
+    meter_port = this;
+}
+
+uint64_t SoftwareSerial::arrived() {
+    const size_t frame = 14;
+    if (stream.empty())
+        return 0;
+    uint64_t interval = std::max<uint64_t>(native::options.interval_ms * 1000ULL, frame * byte_us);
+    uint64_t t = native::now_us() - start_us;
+    uint64_t packet = t / interval;
+    uint64_t bytes = packet * frame + std::min<uint64_t>(frame, (t % interval) / byte_us);
+    if (native::options.loops)
+        bytes = std::min<uint64_t>(bytes, (uint64_t)native::options.loops * stream.size());
+    return bytes;
+}
+
+int SoftwareSerial::available() {
+    uint64_t a = arrived();
+    if (a - position > capacity) {
+        // The receive buffer filled up: the oldest bytes are gone
+        bytes_lost += a - position - capacity;
+        position = a - capacity;
+        lost = true;
+    }
+    return (int)(a - position);
+}
+
+int SoftwareSerial::peek() {
+    if (available() <= 0)
+        return -1;
+    return stream[position % stream.size()];
+}
+
+int SoftwareSerial::read() {
+    int c = peek();
+    if (c < 0)
+        return -1;
+    position++;
+    last_parity = odd ? parityOdd((uint8_t)c) : parityEven((uint8_t)c);
+    // A noisy line: one data bit flipped, so the parity bit no longer matches
+    if (native::options.line_errors && position % native::options.line_errors == 0)
+        c ^= 0x01;
+    return c;
+}
+
+bool SoftwareSerial::overflow() {
+    bool was = lost;
+    lost = false;
+    return was;
+}
+
+bool SoftwareSerial::finished() const {
+    return native::options.loops && !stream.empty()
+        && position >= (uint64_t)native::options.loops * stream.size();
+}
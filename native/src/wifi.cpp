@@ -0,0 +1,251 @@
+/*
+ * wifi.cpp - native WiFi, WiFiClient, WiFiServer and WiFiUDP
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ESP8266WiFi.h"
+#include "WiFiUdp.h"
+#include "native.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#define SOCKET_SEND_BUFFER  8192   // Roughly what lwIP gives a connection
+
+// The firmware's configuration, for the ports --bridge-port,
+// --metrics-port and --history-port override. Its variables stay in here.
+namespace firmware_config {
+#include "config.h"
+}
+
+WiFiClass WiFi;
+
+void WiFiClass::begin(const char *, const char *) {
+    state = native::options.wifi ? WL_CONNECTED : WL_NO_SSID_AVAIL;
+}
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+WiFiClient::socket::~socket() {
+    if (fd >= 0)
+        ::close(fd);
+}
+
+WiFiClient::WiFiClient(int fd) {
+    if (fd < 0)
+        return;
+    int size = SOCKET_SEND_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    set_nonblocking(fd);
+    sock = std::make_shared<socket>();
+    sock->fd = fd;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+    stop();
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &res) != 0)
+        return 0;
+    int fd = -1;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    *this = WiFiClient(fd);
+    return fd >= 0;
+}
+
+uint8_t WiFiClient::connected() {
+    if (fd() < 0)
+        return 0;
+    if (available() > 0)
+        return 1;
+    // A readable socket with nothing to read has been closed by the peer
+    char c;
+    ssize_t n = ::recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiClient::stop() {
+    if (sock && sock->fd >= 0) {
+        ::close(sock->fd);
+        sock->fd = -1;
+    }
+    sock.reset();
+}
+
+void WiFiClient::setNoDelay(bool on) {
+    int flag = on;
+    if (fd() >= 0)
+        setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+int WiFiClient::available() {
+    int n = 0;
+    if (fd() < 0 || ioctl(fd(), FIONREAD, &n) < 0)
+        return 0;
+    return n;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    if (fd() < 0 || ::recv(fd(), &c, 1, MSG_DONTWAIT) != 1)
+        return -1;
+    return c;
+}
+
+int WiFiClient::peek() {
+    uint8_t c;
+    if (fd() < 0 || ::recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1)
+        return -1;
+    return c;
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size) {
+    if (fd() < 0)
+        return 0;
+    ssize_t n = ::send(fd(), buffer, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+    return n > 0 ? n : 0;
+}
+
+int WiFiClient::availableForWrite() {
+    if (fd() < 0)
+        return 0;
+    int queued = 0, size = 0;
+    socklen_t length = sizeof(size);
+    ioctl(fd(), TIOCOUTQ, &queued);
+    getsockopt(fd(), SOL_SOCKET, SO_SNDBUF, &size, &length);
+    // Linux reports twice the buffer asked for; half of it is bookkeeping
+    return std::max(0, size / 2 - queued);
+}
+
+WiFiServer::~WiFiServer() {
+    if (pending >= 0)
+        ::close(pending);
+    if (listen_fd >= 0)
+        ::close(listen_fd);
+}
+
+void WiFiServer::begin() {
+#ifdef TCP_BRIDGE_PORT
+    if (native::options.bridge_port && port == TCP_BRIDGE_PORT)
+        port = native::options.bridge_port;
+#endif
+#ifdef METRICS_PORT
+    if (native::options.metrics_port && port == METRICS_PORT)
+        port = native::options.metrics_port;
+#endif
+#ifdef HISTORY_PORT
+    if (native::options.history_port && port == HISTORY_PORT)
+        port = native::options.history_port;
+#endif
+    listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(listen_fd, (sockaddr *)&address, sizeof(address)) < 0 || ::listen(listen_fd, 4) < 0) {
+        fprintf(stderr, "Can't listen on port %u: %s\n", port, strerror(errno));
+        ::close(listen_fd);
+        listen_fd = -1;
+        return;
+    }
+    set_nonblocking(listen_fd);
+}
+
+bool WiFiServer::hasClient() {
+    if (pending < 0 && listen_fd >= 0)
+        pending = ::accept(listen_fd, nullptr, nullptr);
+    return pending >= 0;
+}
+
+WiFiClient WiFiServer::available() {
+    if (!hasClient())
+        return WiFiClient();
+    WiFiClient client(pending);
+    pending = -1;
+    client.setNoDelay(nodelay);
+    return client;
+}
+
+bool WiFiUDP::open(IPAddress interface, int ttl) {
+    if (fd < 0) {
+        fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0)
+            return false;
+        set_nonblocking(fd);
+    }
+    // Loopback stands in for the WiFi interface
+    (void)interface;
+    in_addr loopback;
+    loopback.s_addr = htonl(INADDR_LOOPBACK);
+    unsigned char hops = (unsigned char)ttl, loop = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    return true;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t to_port) {
+    return beginPacketMulticast(ip, to_port, IPAddress(127, 0, 0, 1), 64);
+}
+
+int WiFiUDP::beginPacketMulticast(IPAddress group, uint16_t to_port, IPAddress interface, int ttl) {
+    if (WiFi.status() != WL_CONNECTED || !open(interface, ttl))
+        return 0;
+    for (int i = 0; i < 4; i++)
+        destination[i] = group[i];
+    port = to_port;
+    length = 0;
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size) {
+    if (size > sizeof(packet) - length)
+        size = sizeof(packet) - length;
+    memcpy(packet + length, buffer, size);
+    length += size;
+    return size;
+}
+
+int WiFiUDP::endPacket() {
+    if (fd < 0)
+        return 0;
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    memcpy(&address.sin_addr.s_addr, destination, 4);
+    ssize_t sent = ::sendto(fd, packet, length, 0, (sockaddr *)&address, sizeof(address));
+    length = 0;
+    return sent >= 0;
+}
+
+void WiFiUDP::stop() {
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
@@ -27,30 +27,247 @@
 #include <Adafruit_NeoPixel.h>        // For status LED
 #include <SoftwareSerial.h>           // Must be the EspSoftwareSerial library
 #include "ut61e_display.h"
+#include "ut61e_serializer.h"
+#include "ut61e_meter.h"
+#include "ut61e_scheduler.h"
+#include "ut61e_status_led.h"
+#include "ut61e_settings.h"
+#include "ut61e_filter.h"
+#include "ut61e_energy.h"
+#include "ut61e_session.h"
+#include "ut61e_fanout.h"
+#ifdef TCP_BRIDGE_PORT
+#include "ut61e_tcp_bridge.h"
+#endif
+#ifdef UDP_FEED_PORT
+#include "ut61e_udp_feed.h"
+#endif
+#ifdef OLED_I2C_ADDRESS
+#include "ut61e_oled_i2c.h"
+#endif
+#ifdef DEEP_SLEEP_MS
+#include "ut61e_duty_cycle.h"
+#endif
+#ifdef METRICS_PORT
+#include "ut61e_metrics.h"
+#endif
+#ifdef HISTORY_PORT
+#include "ut61e_history_server.h"
+#endif
 
 
 /*--------------------------- Global Variables ---------------------------*/
 // MQTT
 char g_raw_packet_buffer[150];      // General purpose buffer for MQTT messages
-char g_packet_buffer[12];             // Buffer for single DMM packet
-uint8_t g_buffer_position = 0;
 char g_command_topic[50];             // MQTT topic for receiving commands
+char g_result_topic[50];              // MQTT topic for acknowledging commands
 char g_mqtt_raw_topic[50];            // MQTT topic for reporting the raw data packet
 char g_mqtt_hex_topic[50];            // MQTT topic for reporting the hex formatted data packet
 char g_mqtt_json_topic[50];           // MQTT topic for reporting the decoded reading
 char g_mqtt_json_extended_topic[50];  // MQTT topic for reporting the decoded reading
+char g_mqtt_influx_topic[50];         // MQTT topic for reporting InfluxDB line protocol
+char g_mqtt_csv_topic[50];            // MQTT topic for reporting CSV rows
+char g_device_id_string[12];          // Device ID as printed in topics and tags
 char g_json_message_buffer[512];      // MQTT JSON data for reporting JSON format
 
 // Wifi
 #define WIFI_CONNECT_INTERVAL          500   // Wait 500ms intervals for wifi connection
 #define WIFI_CONNECT_MAX_ATTEMPTS       10   // Number of attempts/intervals to wait
 
+// MQTT reconnection
+#define MQTT_RETRY_INTERVAL           5000   // Wait 5s between connection attempts
+#define MQTT_CONNECT_TIMEOUT           200   // Longest DNS lookup or TCP connect (ms)
+#define MQTT_CONNACK_TIMEOUT             1   // Longest wait for the broker's CONNACK (s)
+uint32_t g_mqtt_last_attempt = 0;
+
+// Scheduler
+#define FRAME_QUEUE_LENGTH               8   // Received frames waiting to be decoded
+#ifndef SCHEDULER_STATS_INTERVAL
+#define SCHEDULER_STATS_INTERVAL     60000   // Publish per-task CPU share this often (ms)
+#endif
+#ifndef ENERGY_REPORT_INTERVAL
+#define ENERGY_REPORT_INTERVAL       60000   // Publish charge and energy totals this often (ms)
+#endif
+#ifndef ENERGY_MAX_GAP
+#define ENERGY_MAX_GAP                2000   // Don't integrate across longer gaps (ms)
+#endif
+#ifndef SUPPLY_VOLTAGE_MV
+#define SUPPLY_VOLTAGE_MV                0   // Supply for energy, 0 = last measured DC voltage
+#endif
+#ifndef SESSION_IDLE_GAP
+#define SESSION_IDLE_GAP             10000   // End a measurement session after this long without readings (ms)
+#endif
+// Serial bytes held while a task blocks. The meter sends about 28 bytes/s,
+// so this covers a connect to the broker (at most 2 * MQTT_CONNECT_TIMEOUT
+// + MQTT_CONNACK_TIMEOUT) several times over.
+#define UT61E_RX_BUFFER                256
+// Meter
+#ifndef UT61E_PROTOCOL
+#define UT61E_PROTOCOL             ES51922   // Chipset of the meter, a policy in ut61e_protocol.h
+#endif
+#ifndef UT61E_SERIAL_CONFIG
+#define UT61E_SERIAL_CONFIG   SWSERIAL_7O1   // Its serial format
+#endif
+typedef UT61E_METER<UT61E_PROTOCOL> meter_t;
+static_assert(meter_t::PACKET_SIZE <= UT61E_SINK_PACKET_SIZE, "the meter's packets don't fit a sink entry");
+uint8_t g_frame_queue[FRAME_QUEUE_LENGTH][meter_t::FRAME_SIZE];
+uint32_t g_frame_time_ms[FRAME_QUEUE_LENGTH];  // millis() when each frame's CR LF arrived
+uint8_t g_frame_head = 0;
+uint8_t g_frame_count = 0;
+uint32_t g_frames_dropped = 0;                // Frames lost because decode fell behind
+char g_mqtt_sched_topic[50];                  // MQTT topic for scheduler statistics
+// Where the network and status tasks carry on when a step runs out of time
+enum { NETWORK_CONNECT, NETWORK_MQTT, NETWORK_BRIDGE, NETWORK_METRICS,
+       NETWORK_DONE } g_network_stage = NETWORK_CONNECT;
+enum { STATUS_HOUSEKEEPING, STATUS_ENERGY, STATUS_SESSION, STATUS_SCHED, STATUS_LED, STATUS_DIAG,
+       STATUS_SINKS, STATUS_DONE } g_status_stage = STATUS_HOUSEKEEPING;
+
+// Sinks: every decoded packet is queued once for each output, which then
+// takes it at its own pace (see lib/ut61e_fanout)
+#ifndef SINK_SERIAL_DEPTH
+#define SINK_SERIAL_DEPTH                4   // Packets waiting for the debug echo
+#endif
+#ifndef SINK_MQTT_DEPTH
+#define SINK_MQTT_DEPTH                 16   // Packets waiting for the broker
+#endif
+#ifndef SINK_MQTT_POLICY
+#define SINK_MQTT_POLICY    UT61E_SINK_DROP_OLDEST
+#endif
+#ifndef SINK_MQTT_MAX_AGE
+#define SINK_MQTT_MAX_AGE            10000   // Don't publish packets older than this (ms, 0 = any age)
+#endif
+#ifndef SINK_UDP_DEPTH
+#define SINK_UDP_DEPTH                   4   // Readings waiting for the UDP feed
+#endif
+#define SINK_HISTORY_DEPTH               4   // Readings waiting to go into the history
+#define MQTT_SEND_ROOM                 600   // Socket space a publish stage needs to go ahead
+#define SERIAL_SINK_BUFFER_SIZE       1024   // One packet's debug lines
+enum { PUBLISH_IDLE, PUBLISH_RAW, PUBLISH_HEX, PUBLISH_JSON, PUBLISH_JSON_EXTENDED,
+       PUBLISH_INFLUX, PUBLISH_CSV } g_publish_stage = PUBLISH_IDLE;
+uint32_t g_publish_seq = 0;                   // Entry the MQTT stages are on
+char g_serial_sink_buffer[SERIAL_SINK_BUFFER_SIZE];
+uint32_t g_serial_sink_seq = 0;               // Entry in the buffer ...
+size_t g_serial_sink_length = 0;
+size_t g_serial_sink_sent = 0;                // ... and how much of it the UART has taken
+bool g_serial_sink_ready = false;
+char g_mqtt_sinks_topic[50];                  // MQTT topic for per-sink queue statistics
+
+// Runtime settings (see lib/ut61e_settings)
+#define BATCH_BUFFER_SIZE             2048   // Room for a batch of extended JSON readings
+#define BATCH_MAX_AGE                 2000   // Send a partial batch after this long (ms)
+char g_batch_buffer[BATCH_BUFFER_SIZE];
+size_t g_batch_length = 0;
+uint8_t g_batch_count = 0;
+uint32_t g_batch_started = 0;
+ut61e_reading_t g_last_decoded = {};          // Last reading sent on the decoded topics
+uint32_t g_last_decoded_ms = 0;
+bool g_have_decoded = false;
+bool g_filter_enabled = false;                // Extended JSON carries "filtered" and "stable"
+
+// Link quality, published on the DIAG topic every statistics window
+uint32_t g_bytes_received = 0;                // Bytes read from the meter
+uint32_t g_parity_errors = 0;                 // Bytes whose 7O1 parity bit was wrong
+uint32_t g_overflows = 0;                     // Times the serial receive buffer overflowed
+char g_mqtt_diag_topic[50];                   // MQTT topic for link quality counters
+
+// Heap watermarks since boot, also on DIAG. Measuring walks the heap, so
+// only every HEAP_SAMPLE_INTERVAL.
+#define HEAP_SAMPLE_INTERVAL          1000   // ms
+uint32_t g_heap_sampled_ms = 0;
+uint32_t g_heap_free_min = 0xFFFFFFFF;        // Lowest ESP.getFreeHeap()
+uint32_t g_heap_block_min = 0xFFFFFFFF;       // Lowest ESP.getMaxFreeBlockSize()
+uint8_t g_heap_fragmentation_max = 0;         // Highest ESP.getHeapFragmentation()
+
+// Charge and energy totals, published every EnergyReport ms
+char g_mqtt_energy_topic[50];
+uint32_t g_energy_reported_ms = 0;
+
+// A summary of each measurement session as it ends
+char g_mqtt_session_topic[50];
+
+// Deep sleep capture for battery operation: readings kept in RTC memory
+// go out on this topic every few wakes
+char g_mqtt_batch_topic[50];
+
+#ifdef METRICS_PORT
+// Prometheus metrics on /metrics (see lib/ut61e_metrics), in the order of
+// METRIC_DEFINITIONS
+enum { METRIC_READING, METRIC_OVERLOAD, METRIC_HOLD, METRIC_RELATIVE, METRIC_BATTERY_LOW,
+       METRIC_READING_TIME, METRIC_FILTERED, METRIC_STABLE, METRIC_FRAMES, METRIC_FRAMES_DROPPED,
+       METRIC_CHECK_FAILURES, METRIC_BYTES, METRIC_PARITY_ERRORS, METRIC_OVERFLOWS,
+       METRIC_RESYNC_BYTES, METRIC_CHARGE, METRIC_ENERGY, METRIC_HEAP_FREE, METRIC_HEAP_FREE_MIN,
+       METRIC_HEAP_BLOCK_MIN, METRIC_HEAP_FRAGMENTATION_MAX, METRIC_UPTIME, METRIC_WIFI_RSSI,
+       METRIC_MQTT_CONNECTED, METRIC_COUNT };
+const ut61e_metric_t METRIC_DEFINITIONS[METRIC_COUNT] = {
+  {"ut61e_reading", "Latest reading in base units, NaN while OL.", UT61E_METRIC_GAUGE},
+  {"ut61e_reading_overload", "1 while the meter shows OL.", UT61E_METRIC_GAUGE},
+  {"ut61e_reading_hold", "1 in HOLD mode.", UT61E_METRIC_GAUGE},
+  {"ut61e_reading_relative", "1 in REL mode.", UT61E_METRIC_GAUGE},
+  {"ut61e_battery_low", "1 while the meter's battery is low.", UT61E_METRIC_GAUGE},
+  {"ut61e_reading_time_seconds", "Uptime when the latest reading arrived.", UT61E_METRIC_GAUGE},
+  {"ut61e_reading_filtered", "Latest reading through the configured filter.", UT61E_METRIC_GAUGE},
+  {"ut61e_reading_stable", "1 once the reading has settled.", UT61E_METRIC_GAUGE},
+  {"ut61e_frames_total", "Frames received from the meter.", UT61E_METRIC_COUNTER},
+  {"ut61e_frames_dropped_total", "Frames lost because decoding fell behind.", UT61E_METRIC_COUNTER},
+  {"ut61e_check_failures_total", "Frames that failed to decode.", UT61E_METRIC_COUNTER},
+  {"ut61e_serial_bytes_total", "Bytes read from the meter.", UT61E_METRIC_COUNTER},
+  {"ut61e_serial_parity_errors_total", "Bytes with a parity error.", UT61E_METRIC_COUNTER},
+  {"ut61e_serial_overflows_total", "Serial receive buffer overflows.", UT61E_METRIC_COUNTER},
+  {"ut61e_serial_resync_bytes_total", "Bytes skipped finding frame boundaries.", UT61E_METRIC_COUNTER},
+  {"ut61e_charge_mah", "Charge integrated from DC current readings.", UT61E_METRIC_GAUGE},
+  {"ut61e_energy_wh", "Energy integrated from DC current readings.", UT61E_METRIC_GAUGE},
+  {"ut61e_heap_free_bytes", "Free heap.", UT61E_METRIC_GAUGE},
+  {"ut61e_heap_free_min_bytes", "Lowest free heap since boot.", UT61E_METRIC_GAUGE},
+  {"ut61e_heap_block_min_bytes", "Smallest largest free block since boot.", UT61E_METRIC_GAUGE},
+  {"ut61e_heap_fragmentation_max_percent", "Highest heap fragmentation since boot.", UT61E_METRIC_GAUGE},
+  {"ut61e_uptime_seconds", "Time since boot.", UT61E_METRIC_COUNTER},
+  {"ut61e_wifi_rssi_dbm", "WiFi signal strength.", UT61E_METRIC_GAUGE},
+  {"ut61e_mqtt_connected", "1 while connected to the MQTT broker.", UT61E_METRIC_GAUGE},
+};
+#endif
+
+// Status LED
+#define LED_MIN_INTERVAL                50   // Write the LED at most this often (ms)
+#define LED_FLASH_TIME                  50   // Packet flash length (ms)
+char g_mqtt_led_topic[50];                    // MQTT topic for status LED statistics
+
 // General
 uint32_t g_device_id;                        // Unique ID from ESP chip ID
 
 /*--------------------------- Function Signatures ---------------------------*/
 bool initWifi();
 void reconnectMqtt();
+bool publishLarge(const char *topic, const char *payload, size_t length);
+void callback(char* topic, byte* message, unsigned int length);
+void applySettings();
+bool decodedDue(const ut61e_reading_t &r);
+void flushBatch();
+ut61e_sink_result_t serialSink(const ut61e_sink_entry &entry);
+ut61e_sink_result_t mqttSink(const ut61e_sink_entry &entry);
+#ifdef UDP_FEED_PORT
+ut61e_sink_result_t udpSink(const ut61e_sink_entry &entry);
+#endif
+#ifdef HISTORY_PORT
+ut61e_sink_result_t historySink(const ut61e_sink_entry &entry);
+bool historyTask(uint32_t deadline_us);
+#endif
+bool rxTask(uint32_t deadline_us);
+bool decodeTask(uint32_t deadline_us);
+void decodeFrame();
+bool publishTask(uint32_t deadline_us);
+bool networkTask(uint32_t deadline_us);
+bool statusTask(uint32_t deadline_us);
+void sampleHeap();
+#ifdef OLED_I2C_ADDRESS
+bool displayTask(uint32_t deadline_us);
+#endif
+#ifdef DEEP_SLEEP_MS
+void dutyCycle();
+#endif
+#ifdef METRICS_PORT
+void setReadingMetrics(const ut61e_reading_t &r);
+void setStatusMetrics();
+#endif
 
 /*--------------------------- Instantiate Global Objects --------------------*/
 // MQTT
@@ -58,12 +275,37 @@ WiFiClient esp_client;
 PubSubClient client(esp_client);
 SoftwareSerial ut61e(UT61E_RX_PIN, -1); // RX, TX
 Adafruit_NeoPixel pixels(1, STATUS_LED_PIN, NEO_GRB + NEO_KHZ800);
+UT61E_STATUS_LED status_led(pixels, LED_MIN_INTERVAL);
+meter_t::framer_t framer;
+UT61E_SCHEDULER scheduler;
+UT61E_JSON_SERIALIZER json_basic(false);
+UT61E_JSON_SERIALIZER json_extended(true);
+UT61E_CSV_SERIALIZER csv;
+UT61E_INFLUX_SERIALIZER influx("ut61e", g_device_id_string);
+UT61E_SETTINGS settings;
+UT61E_FILTER filter;
+UT61E_ENERGY energy;
+UT61E_SESSION session;
+UT61E_FANOUT fanout;
+#ifdef TCP_BRIDGE_PORT
+UT61E_TCP_BRIDGE tcp_bridge(TCP_BRIDGE_PORT, TCP_BRIDGE_RFC2217);
+#endif
+#ifdef UDP_FEED_PORT
+UT61E_UDP_FEED udp_feed(IPAddress(UDP_FEED_GROUP), UDP_FEED_PORT, UDP_FEED_BATCH, BATCH_MAX_AGE);
+#endif
+#ifdef OLED_I2C_ADDRESS
+UT61E_OLED_I2C oled_bus(Wire, OLED_I2C_ADDRESS, OLED_CONTROLLER);
+UT61E_OLED oled(oled_bus);
+#endif
+#ifdef METRICS_PORT
+UT61E_METRICS metrics(METRICS_PORT, METRIC_DEFINITIONS, METRIC_COUNT);
+#endif
+#ifdef HISTORY_PORT
+UT61E_HISTORY history;
+UT61E_HISTORY_SERVER history_server(HISTORY_PORT, history);
+#endif
 // HardwareSerial Serial;
-#ifdef DEBUG
-UT61E_DISP dmm(Serial);
-#else
-UT61E_DISP dmm;
-#endif // DEBUG
+meter_t meter;  // Decoder dumps to Serial are switched on by the Debug setting
 
 /*--------------------------- Program ---------------------------------------*/
 /**
@@ -71,12 +313,9 @@ UT61E_DISP dmm;
 */
 void setup()
 {
-  pixels.begin();
-  pixels.clear();
-  pixels.show();
-  pixels.setBrightness(50);
-  pixels.setPixelColor(0, pixels.Color(100, 0, 0));  // Red
-  pixels.show();
+  status_led.begin(50);
+  status_led.set(status_led.Color(100, 0, 0));  // Red
+  status_led.update(false);
 
   Serial.begin(SERIAL_BAUD_RATE);
   Serial.println();
@@ -86,7 +325,7 @@ void setup()
 
 
   // Open a connection to the PMS and put it into passive mode
-  ut61e.begin(UT61E_BAUD_RATE, SWSERIAL_7O1, UT61E_RX_PIN, -1);  // Connection for multimeter
+  ut61e.begin(UT61E_BAUD_RATE, UT61E_SERIAL_CONFIG, UT61E_RX_PIN, -1, false, UT61E_RX_BUFFER);  // Connection for multimeter
 
   // We need a unique device ID for our MQTT client connection
   g_device_id = ESP.getChipId();  // Get the unique ID of the ESP8266 chip
@@ -96,26 +335,71 @@ void setup()
   // Set up the topics for publishing sensor readings. By inserting the unique ID,
   // the result is of the form: "device/d9616f/PM1P0" etc
   sprintf(g_command_topic,            "cmnd/%X/COMMAND",   g_device_id);  // For receiving commands
+  sprintf(g_result_topic,             "stat/%X/RESULT",    g_device_id);  // Command acknowledgements
   sprintf(g_mqtt_raw_topic,           "tele/%X/RAW",       g_device_id);  // Data from multimeter
   sprintf(g_mqtt_hex_topic,           "tele/%X/HEX",       g_device_id);  // Data from multimeter
   sprintf(g_mqtt_json_topic,          "tele/%X/JSON",      g_device_id);  // Data from multimeter
   sprintf(g_mqtt_json_extended_topic, "tele/%X_x/JSON",    g_device_id);  // Extended data from multimeter
+  sprintf(g_mqtt_influx_topic,        "tele/%X/INFLUX",    g_device_id);  // Line protocol for Telegraf
+  sprintf(g_mqtt_csv_topic,           "tele/%X/CSV",       g_device_id);  // CSV rows
+  sprintf(g_mqtt_sched_topic,         "tele/%X/SCHED",     g_device_id);  // Scheduler statistics
+  sprintf(g_mqtt_led_topic,           "tele/%X/LED",       g_device_id);  // Status LED statistics
+  sprintf(g_mqtt_diag_topic,          "tele/%X/DIAG",      g_device_id);  // Link quality counters
+  sprintf(g_mqtt_energy_topic,        "tele/%X/ENERGY",    g_device_id);  // Charge and energy totals
+  sprintf(g_mqtt_session_topic,       "tele/%X/SESSION",   g_device_id);  // Measurement session summaries
+  sprintf(g_mqtt_batch_topic,         "tele/%X/BATCH",     g_device_id);  // Readings saved up in deep sleep
+  sprintf(g_mqtt_sinks_topic,         "tele/%X/SINKS",     g_device_id);  // Output queue statistics
+  sprintf(g_device_id_string,         "%X",                g_device_id);
 
   // Report the MQTT topics to the serial console
   Serial.println("MQTT command topics:");
   Serial.println(g_command_topic);       // For receiving messages
+  Serial.println(g_result_topic);        // Replies to commands
   Serial.println("MQTT topics:");
   Serial.println(g_mqtt_raw_topic);               // From PMS
   Serial.println(g_mqtt_hex_topic);               // From PMS
   Serial.println(g_mqtt_json_topic);              // From PMS
   Serial.println(g_mqtt_json_extended_topic);     // From PMS
+  Serial.println(g_mqtt_influx_topic);            // When enabled
+  Serial.println(g_mqtt_csv_topic);               // When enabled
+
+  // Runtime settings: compiled in defaults, replaced by any saved in flash
+  ut61e_settings_t defaults = {};
+  defaults.topics = UT61E_TOPIC_RAW | UT61E_TOPIC_HEX | UT61E_TOPIC_JSON | UT61E_TOPIC_JSON_X;
+#if REPORT_MQTT_INFLUX
+  defaults.topics |= UT61E_TOPIC_INFLUX;
+#endif
+#if REPORT_MQTT_CSV
+  defaults.topics |= UT61E_TOPIC_CSV;
+#endif
+  defaults.batch = 1;
+  defaults.stats_window_ms = SCHEDULER_STATS_INTERVAL;
+  defaults.supply_mv = SUPPLY_VOLTAGE_MV;
+  defaults.energy_gap_ms = ENERGY_MAX_GAP;
+  defaults.energy_report_ms = ENERGY_REPORT_INTERVAL;
+  defaults.session_gap_ms = SESSION_IDLE_GAP;
+#ifdef DEBUG
+  defaults.debug = 2;
+#else
+  defaults.debug = 1;
+#endif
+  settings.begin(defaults);
+  applySettings();
+  settings.status_json(g_json_message_buffer, sizeof(g_json_message_buffer));
+  Serial.print("Settings: ");
+  Serial.println(g_json_message_buffer);
+
+#ifdef DEEP_SLEEP_MS
+  // Capture, maybe publish, and back to sleep: the rest never runs
+  dutyCycle();
+#endif
 
   // Connect to WiFi
   if (initWifi())
   {
     Serial.println(WiFi.localIP());
-    pixels.setPixelColor(0, pixels.Color(0, 0, 100));  // Blue
-    pixels.show();
+    status_led.set(status_led.Color(0, 0, 100));  // Blue
+    status_led.update(false);
   } else {
     Serial.println("WiFi connection failed");
   }
@@ -123,95 +407,528 @@ void setup()
   /* Set up the MQTT client */
   client.setServer(mqtt_broker, 1883);
   client.setCallback(callback);
+  // Bound how long reconnectMqtt() blocks the scheduler
+  esp_client.setTimeout(MQTT_CONNECT_TIMEOUT);
+  client.setSocketTimeout(MQTT_CONNACK_TIMEOUT);
+
+#ifdef TCP_BRIDGE_PORT
+  /* Raw serial-over-TCP bridge for PC logging software */
+  tcp_bridge.begin();
+  Serial.print("Raw TCP bridge on port ");
+  Serial.println(TCP_BRIDGE_PORT);
+#endif
+
+#ifdef UDP_FEED_PORT
+  /* Binary reading datagrams for LAN subscribers, no broker in the way */
+  udp_feed.begin(g_device_id);
+  Serial.print("UDP reading feed on port ");
+  Serial.println(UDP_FEED_PORT);
+#endif
+
+#ifdef METRICS_PORT
+  /* Prometheus scrapes */
+  metrics.begin();
+  Serial.print("Prometheus metrics on port ");
+  Serial.println(METRICS_PORT);
+#endif
+
+#ifdef HISTORY_PORT
+  /* Recent readings for download, no broker needed */
+  history_server.begin();
+  Serial.print("History export on port ");
+  Serial.println(HISTORY_PORT);
+#endif
+
+#ifdef OLED_I2C_ADDRESS
+  /* Local copy of the meter's display */
+  Wire.begin(OLED_SDA_PIN, OLED_SCL_PIN);
+  Wire.setClock(OLED_I2C_CLOCK);
+  if (!oled.begin())
+    Serial.println("OLED not found");
+#endif
+
+  /* Outputs, each with its own queue: name, function, depth, policy when full, max age (ms) */
+  fanout.add("serial", serialSink, SINK_SERIAL_DEPTH, UT61E_SINK_DROP_OLDEST);
+  fanout.add("mqtt", mqttSink, SINK_MQTT_DEPTH, SINK_MQTT_POLICY, SINK_MQTT_MAX_AGE);
+#ifdef UDP_FEED_PORT
+  fanout.add("udp", udpSink, SINK_UDP_DEPTH, UT61E_SINK_DROP_OLDEST);
+#endif
+#ifdef HISTORY_PORT
+  fanout.add("history", historySink, SINK_HISTORY_DEPTH, UT61E_SINK_DROP_OLDEST);
+#endif
+
+  /* Tasks: name, function, priority, time budget (us), period (ms) */
+  scheduler.set_receiver("rx", rxTask, 1000);
+  scheduler.add("decode", decodeTask, 50, 5000);
+  scheduler.add("publish", publishTask, 40, 10000);
+  scheduler.add("network", networkTask, 20, 10000);
+  scheduler.add("status", statusTask, 10, 2000, 100);
+#ifdef OLED_I2C_ADDRESS
+  scheduler.add("display", displayTask, 30, 4000);
+#endif
+#ifdef HISTORY_PORT
+  scheduler.add("history", historyTask, 15, 4000);
+#endif
 }
 
 /*
   Main loop
 */
 void loop() {
-  if (WiFi.status() == WL_CONNECTED)
+  scheduler.loop();
+}
+
+/*--------------------------- Tasks -----------------------------------------*/
+/**
+  Receive: move bytes from the meter into the framer, queueing whole frames.
+  Runs before every other task step.
+*/
+bool rxTask(uint32_t deadline_us) {
+  if (ut61e.overflow())
+    g_overflows++;
+  while (ut61e.available() && UT61E_SCHEDULER::before(deadline_us))
   {
-    if (!client.connected()) {
-      reconnectMqtt();
+    byte this_character = ut61e.read();
+    g_bytes_received++;
+    if ((UT61E_SERIAL_CONFIG & 070) == SWSERIAL_PARITY_ODD && ut61e.readParity() != ut61e.parityOdd(this_character))
+      g_parity_errors++;
+    if(framer.push(this_character)) {
+#ifdef TCP_BRIDGE_PORT
+      // Hand the whole frame to the PC clients before we spend time decoding it
+      tcp_bridge.enqueue(framer.frame());
+#endif
+      uint8_t tail = (g_frame_head + g_frame_count) % FRAME_QUEUE_LENGTH;
+      if (g_frame_count == FRAME_QUEUE_LENGTH) {
+        // Decode has fallen behind: lose the oldest frame, never the serial data
+        g_frame_head = (g_frame_head + 1) % FRAME_QUEUE_LENGTH;
+        g_frames_dropped++;
+      } else {
+        g_frame_count++;
+      }
+      memcpy(g_frame_queue[tail], framer.frame(), meter_t::FRAME_SIZE);
+      g_frame_time_ms[tail] = millis();
+      // The meter is quiet until its next packet: the safe moment for the LED
+      status_led.frame_end(framer.resync_bytes);
+      status_led.update(ut61e.available());
     }
   }
-  client.loop();  // Process any outstanding MQTT messages
+  return ut61e.available() > 0;
+}
 
-  /* Report value */
-  String message_string;
-  if (ut61e.available())
-  {
-    byte this_character = ut61e.read();
-    g_raw_packet_buffer[g_buffer_position] = this_character;
-    g_buffer_position++;
-    if((13 == g_raw_packet_buffer[g_buffer_position-2]) && (10 == g_raw_packet_buffer[g_buffer_position-1]) ) {
-      // Copy only the data for parsing
-      strncpy(g_packet_buffer,g_raw_packet_buffer,12);
-      // If we successfully parse the packet, send it to the various destinations
-      if(dmm.parse(g_packet_buffer,false)) {
-        // Turn on LED to flash for each good packet we process
-        pixels.setPixelColor(0, pixels.Color(0, 255, 0));  // Green
-        pixels.show();
-
-        // Truncate the raw packet buffer to suit being printed as a string
-        g_raw_packet_buffer[g_buffer_position-2] = 0;
-
-        // Reset index for the next packet
-        g_buffer_position = 0;
-
-        // Publish a raw packet to MQTT
+/**
+  Decode: parse the queued frames and hand them to the sinks, until the
+  queue is empty or the step's time is up
+*/
+bool decodeTask(uint32_t deadline_us) {
+  while (g_frame_count && UT61E_SCHEDULER::before(deadline_us))
+    decodeFrame();
+  return g_frame_count > 0;
+}
+
+/**
+  Parse the oldest queued frame and hand it to the sinks
+*/
+void decodeFrame() {
+  const uint8_t *frame = g_frame_queue[g_frame_head];
+  ut61e_sink_entry entry = {};
+  memcpy(entry.packet, frame, meter_t::PACKET_SIZE);
+  uint32_t frame_time_ms = g_frame_time_ms[g_frame_head];
+  g_frame_head = (g_frame_head + 1) % FRAME_QUEUE_LENGTH;
+  g_frame_count--;
+
+  ut61e_reading_t reading;
+  ut61e_shown_t shown;
+  reading.time_ms = frame_time_ms;  // When it arrived, not when we got round to it
+  bool good = meter.decode(frame, reading, shown);
+  if (good) {
+    filter.update(reading);
+    energy.update(reading);
+    session.update(reading);
+#ifdef OLED_I2C_ADDRESS
+    oled.show(reading, shown);  // Only draws into RAM; displayTask sends it
+#endif
+#ifdef METRICS_PORT
+    setReadingMetrics(reading);
+#endif
+    entry.reading = reading;
+    entry.shown = shown;
+    entry.flags = UT61E_ENTRY_GOOD;
+    entry.session = session.id();
+    // When in 'HOLD' mode, the DMM continues to transmit
+    // what it's reading and not what is on the display
+    // So we don't send any further JSON until this changes.
+    // Readings within the deadband skip the decoded topics too.
+    if (!(reading.flags & UT61E_FLAG_HOLD) && (!settings.current.stable_only || filter.stable)
+        && decodedDue(reading))
+      entry.flags |= UT61E_ENTRY_DECODED;
+    if (g_filter_enabled) {
+      entry.flags |= UT61E_ENTRY_FILTERED | (filter.stable ? UT61E_ENTRY_STABLE : 0);
+      entry.filtered = filter.value();
+    }
+  }
+  entry.reading.time_ms = frame_time_ms;
+  fanout.publish(entry);
+  // Flash the LED for each packet we process, then leave it off. The LED
+  // manager only writes it in the gap after a packet's CR LF.
+  status_led.set(0);  // Off
+  if (good) {
+    status_led.flash(status_led.Color(0, 255, 0), LED_FLASH_TIME);  // Green
+  } else { // Data error
+    status_led.flash(status_led.Color(255, 0, 0), LED_FLASH_TIME);  // Red
+  }
+  status_led.update(ut61e.available());
+}
+
+/**
+  Publish: give each sink with packets queued one go a round, so a slow
+  one (a full UART, a stalled broker) holds up only itself. Rounds go on
+  while the sinks make progress and the step has time.
+*/
+bool publishTask(uint32_t deadline_us) {
+  while (fanout.step(millis())) {
+    if (!UT61E_SCHEDULER::before(deadline_us))
+      return true;
+  }
+  return false;
+}
+
+/**
+  Network: keep WiFi/MQTT up and service the MQTT and TCP clients, a
+  stage at a time. A step that runs out of time carries on from the next
+  stage in the following step.
+*/
+bool networkTask(uint32_t deadline_us) {
+  do {
+    switch (g_network_stage) {
+      case NETWORK_CONNECT:
+        if (WiFi.status() == WL_CONNECTED && !client.connected())
+          reconnectMqtt();
+        g_network_stage = NETWORK_MQTT;
+        break;
+      case NETWORK_MQTT:
+        client.loop();  // Process any outstanding MQTT messages
+        g_network_stage = NETWORK_BRIDGE;
+        break;
+      case NETWORK_BRIDGE:
+#ifdef TCP_BRIDGE_PORT
+        tcp_bridge.loop();  // Accept clients and push out queued raw frames
+#endif
+        g_network_stage = NETWORK_METRICS;
+        break;
+      case NETWORK_METRICS:
+#ifdef METRICS_PORT
+        metrics.loop();  // Answer scrapes from the pre-rendered response
+#endif
+        g_network_stage = NETWORK_DONE;
+        break;
+      case NETWORK_DONE:
+        break;
+    }
+  } while (g_network_stage != NETWORK_DONE && UT61E_SCHEDULER::before(deadline_us));
+  if (g_network_stage != NETWORK_DONE)
+    return true;
+  g_network_stage = NETWORK_CONNECT;
+  return false;
+}
+
+/**
+  Status: end LED flashes while the meter is idle, send batches (MQTT and
+  UDP) that have waited too long, publish the charge and energy totals and
+  the summaries of ended measurement sessions, track the heap watermarks,
+  and report per-task CPU share, LED statistics, link quality, heap and the
+  sink queues every statistics window. Each publish is a stage of its own;
+  a step that runs out of time carries on from the next stage in the
+  following step.
+*/
+bool statusTask(uint32_t deadline_us) {
+  do {
+    switch (g_status_stage) {
+      case STATUS_HOUSEKEEPING:
+        status_led.update(ut61e.available());
+        if (g_batch_count && (millis() - g_batch_started >= BATCH_MAX_AGE
+                              || g_batch_count >= settings.current.batch))
+          flushBatch();
+#ifdef UDP_FEED_PORT
+        udp_feed.loop();  // Send a partial batch of readings that has waited too long
+#endif
+        if (millis() - g_heap_sampled_ms >= HEAP_SAMPLE_INTERVAL)
+          sampleHeap();
+#ifdef METRICS_PORT
+        setStatusMetrics();
+#endif
+        g_status_stage = STATUS_ENERGY;
+        break;
+
+      case STATUS_ENERGY:
+        if (settings.current.energy_report_ms && energy.samples
+            && millis() - g_energy_reported_ms >= settings.current.energy_report_ms) {
+          g_energy_reported_ms = millis();
+          size_t energy_length = energy.json(g_json_message_buffer, sizeof(g_json_message_buffer));
+          publishLarge(g_mqtt_energy_topic, g_json_message_buffer, energy_length);
+        }
+        g_status_stage = STATUS_SESSION;
+        break;
+
+      case STATUS_SESSION:
+        // One session summary a run; they wait in the session's queue while
+        // the broker is away
+        session.idle(millis());
+        if (session.pending() && client.connected()) {
+          size_t session_length = UT61E_SESSION::json(session.oldest(), g_json_message_buffer,
+                                                      sizeof(g_json_message_buffer));
+          if (publishLarge(g_mqtt_session_topic, g_json_message_buffer, session_length))
+            session.pop();
+        }
+        g_status_stage = scheduler.window_us() / 1000 < settings.current.stats_window_ms
+                         ? STATUS_DONE : STATUS_SCHED;
+        break;
+
+      case STATUS_SCHED: {
+        size_t length = scheduler.stats_json(g_json_message_buffer, sizeof(g_json_message_buffer));
+        if (length < sizeof(g_json_message_buffer))
+          publishLarge(g_mqtt_sched_topic, g_json_message_buffer, length);
+        if (settings.current.debug) {
+          Serial.print("Scheduler: ");
+          Serial.println(g_json_message_buffer);
+        }
+        g_status_stage = STATUS_LED;
+        break;
+      }
+
+      case STATUS_LED: {
+        size_t led_length = snprintf(g_json_message_buffer, sizeof(g_json_message_buffer),
+          "{\"shows\":%u,\"coalesced\":%u,\"deferred\":%u,\"bytes_lost\":%u}",
+          status_led.shows, status_led.coalesced, status_led.deferred, status_led.bytes_lost);
+        publishLarge(g_mqtt_led_topic, g_json_message_buffer, led_length);
+        g_status_stage = STATUS_DIAG;
+        break;
+      }
+
+      case STATUS_DIAG: {
+        // Link quality since boot: a bad cable shows as parity errors and
+        // resyncs, an overloaded board as overflows and dropped frames. The
+        // heap figures are now and the worst since boot: a slow leak or
+        // fragmentation shows as the minimums creeping down over days.
+        sampleHeap();
+        size_t diag_length = snprintf(g_json_message_buffer, sizeof(g_json_message_buffer),
+          "{\"bytes\":%u,\"frames\":%u,\"parity_errors\":%u,\"overflows\":%u,\"resync_bytes\":%u,"
+          "\"check_failures\":%u,\"unknown_function\":%u,\"unknown_range\":%u,\"frames_dropped\":%u,"
+          "\"heap_free\":%u,\"heap_free_min\":%u,\"heap_block_min\":%u,\"heap_fragmentation_max\":%u}",
+          g_bytes_received, framer.frames, g_parity_errors, g_overflows, framer.resync_bytes,
+          meter.check_failures(), meter.unknown_function(), meter.unknown_range(), g_frames_dropped,
+          ESP.getFreeHeap(), g_heap_free_min, g_heap_block_min, g_heap_fragmentation_max);
+#ifdef METRICS_PORT
+        // The scrape counters go inside the same object
+        diag_length--;
+        diag_length += snprintf(g_json_message_buffer + diag_length, sizeof(g_json_message_buffer) - diag_length,
+          ",\"scrapes\":%u,\"scrape_renders\":%u,\"scrape_partial_writes\":%u,\"scrapes_rejected\":%u}",
+          metrics.scrapes, metrics.renders, metrics.partial_writes, metrics.rejected);
+#endif
+        publishLarge(g_mqtt_diag_topic, g_json_message_buffer, diag_length);
+        g_status_stage = STATUS_SINKS;
+        break;
+      }
+
+      case STATUS_SINKS: {
+        // Queue depth, lag and losses for each output
+        size_t sinks_length = fanout.stats_json(g_json_message_buffer, sizeof(g_json_message_buffer), millis());
+        if (sinks_length < sizeof(g_json_message_buffer))
+          publishLarge(g_mqtt_sinks_topic, g_json_message_buffer, sinks_length);
+        fanout.reset_stats();
+        if (g_frames_dropped) {
+          Serial.print("Frames dropped: ");
+          Serial.println(g_frames_dropped);
+        }
+        scheduler.reset_stats();
+        g_status_stage = STATUS_DONE;
+        break;
+      }
+
+      case STATUS_DONE:
+        break;
+    }
+  } while (g_status_stage != STATUS_DONE && UT61E_SCHEDULER::before(deadline_us));
+  if (g_status_stage != STATUS_DONE)
+    return true;
+  g_status_stage = STATUS_HOUSEKEEPING;
+  return false;
+}
+
+#ifdef HISTORY_PORT
+/*
+  History: serve exports a chunk at a time until the step's time is up, so
+  reception carries on between steps however long the download
+*/
+bool historyTask(uint32_t deadline_us) {
+  while (history_server.loop()) {
+    if (!UT61E_SCHEDULER::before(deadline_us))
+      return true;
+  }
+  return false;
+}
+#endif
+
+#ifdef OLED_I2C_ADDRESS
+/*
+  Display: send the OLED what changed since its last reading, a few dozen
+  bytes at a time until the step's time is up, so the I2C transfers never
+  keep rx waiting for long
+*/
+bool displayTask(uint32_t deadline_us) {
+  while (oled.flush(OLED_BYTES_PER_STEP)) {
+    if (!UT61E_SCHEDULER::before(deadline_us))
+      return true;
+  }
+  return false;
+}
+#endif
+
+
+/**
+  Update the heap watermarks
+*/
+void sampleHeap() {
+  g_heap_sampled_ms = millis();
+  uint32_t free_heap = ESP.getFreeHeap();
+  uint32_t block = ESP.getMaxFreeBlockSize();
+  uint8_t fragmentation = ESP.getHeapFragmentation();
+  if (free_heap < g_heap_free_min)
+    g_heap_free_min = free_heap;
+  if (block < g_heap_block_min)
+    g_heap_block_min = block;
+  if (fragmentation > g_heap_fragmentation_max)
+    g_heap_fragmentation_max = fragmentation;
+}
+
+/*--------------------------- Sinks -----------------------------------------*/
+/**
+  Serial echo with the Debug setting on: the raw packet and the JSON that
+  goes to MQTT, written as far as the UART has room so a slow console
+  never blocks
+*/
+ut61e_sink_result_t serialSink(const ut61e_sink_entry &entry) {
+  if (!settings.current.debug)
+    return UT61E_SINK_DONE;
+  char *buffer = g_serial_sink_buffer;
+  const size_t size = sizeof(g_serial_sink_buffer);
+  if (!g_serial_sink_ready || entry.seq != g_serial_sink_seq) {
+    size_t length = 0;
+    if (!(entry.flags & UT61E_ENTRY_GOOD)) {
+      length = snprintf(buffer, size, "JSON: {\"error\":\"invalid data!\"}\r\n");
+    } else {
+      memcpy(buffer, entry.packet, meter_t::PACKET_SIZE);
+      length = meter_t::PACKET_SIZE;
+      buffer[length++] = '\r';
+      buffer[length++] = '\n';
+      if (entry.flags & UT61E_ENTRY_DECODED) {
+        // Each line is a prefix, the JSON (cut short if it has to be) and CR LF
+        if (settings.current.topics & UT61E_TOPIC_JSON) {
+          length += snprintf(buffer + length, size - length, "Squirrel JSON: ");
+          size_t room = size - length - 2;
+          size_t json_length = json_basic.write(entry.reading, entry.shown, buffer + length, room);
+          length += json_length < room ? json_length : room - 1;
+          buffer[length++] = '\r';
+          buffer[length++] = '\n';
+        }
+        if (settings.current.topics & UT61E_TOPIC_JSON_X) {
+          length += snprintf(buffer + length, size - length, "JSON: ");
+          size_t room = size - length - 2;
+          size_t json_length = json_extended.write(entry.reading, entry.shown, buffer + length, room);
+          if (entry.flags & UT61E_ENTRY_FILTERED)
+            json_length = UT61E_FILTER::append_json(buffer + length, json_length, room,
+                                                    entry.filtered, entry.flags & UT61E_ENTRY_STABLE);
+          json_length = UT61E_SESSION::append_json(buffer + length, json_length, room, entry.session);
+          length += json_length < room ? json_length : room - 1;
+          buffer[length++] = '\r';
+          buffer[length++] = '\n';
+        }
+      }
+    }
+    g_serial_sink_seq = entry.seq;
+    g_serial_sink_length = length;
+    g_serial_sink_sent = 0;
+    g_serial_sink_ready = true;
+  }
+  size_t room = Serial.availableForWrite();
+  if (room == 0)
+    return UT61E_SINK_BUSY;
+  size_t left = g_serial_sink_length - g_serial_sink_sent;
+  g_serial_sink_sent += Serial.write((const uint8_t *)buffer + g_serial_sink_sent, left < room ? left : room);
+  if (g_serial_sink_sent < g_serial_sink_length)
+    return UT61E_SINK_MORE;
+  g_serial_sink_ready = false;
+  return UT61E_SINK_DONE;
+}
+
+/**
+  MQTT: the raw and hex topics for every packet, then the decoded topics
+  for readings that are due, one topic a call. Waits while the broker is
+  away or the socket is backed up; the queue's max age and policy decide
+  what is lost meanwhile.
+*/
+ut61e_sink_result_t mqttSink(const ut61e_sink_entry &entry) {
+  if (!client.connected() || esp_client.availableForWrite() < MQTT_SEND_ROOM)
+    return UT61E_SINK_BUSY;
+  if (g_publish_stage == PUBLISH_IDLE || entry.seq != g_publish_seq) {
+    g_publish_seq = entry.seq;
+    g_publish_stage = PUBLISH_RAW;
+  }
+  switch (g_publish_stage) {
+    case PUBLISH_IDLE:
+    case PUBLISH_RAW:
+      // Publish a raw packet to MQTT
+      if (settings.current.topics & UT61E_TOPIC_RAW) {
+        memcpy(g_raw_packet_buffer, entry.packet, meter_t::PACKET_SIZE);
+        g_raw_packet_buffer[meter_t::PACKET_SIZE] = 0;
         client.publish(g_mqtt_raw_topic, g_raw_packet_buffer);
+      }
+      if (!(entry.flags & UT61E_ENTRY_GOOD))
+        break;
+      g_publish_stage = PUBLISH_HEX;
+      return UT61E_SINK_MORE;
 
-        // Publish a HEX version of the raw packet to MQTT
-        sprintf(g_json_message_buffer,"%x",g_raw_packet_buffer);
+    case PUBLISH_HEX:
+      // Publish a HEX version of the raw packet to MQTT
+      if (settings.current.topics & UT61E_TOPIC_HEX) {
+        for (uint8_t i = 0; i < meter_t::PACKET_SIZE; i++)
+          sprintf(g_json_message_buffer + 2 * i, "%02X", entry.packet[i]);
         client.publish(g_mqtt_hex_topic, g_json_message_buffer);
+      }
+      if (!(entry.flags & UT61E_ENTRY_DECODED))
+        break;
+      g_publish_stage = PUBLISH_JSON;
+      return UT61E_SINK_MORE;
 
-        // Echo to serial port
-        Serial.println(g_raw_packet_buffer);
-
-        // Now turn off LED
-        pixels.setPixelColor(0, pixels.Color(0, 0, 0));  // Off
-        pixels.show();
-
-        // When in 'HOLD' mode, the DMM continues to transmit 
-        // what it's reading and not what is on the display
-        // So we don't send any further JSON until this changes
-        if (!dmm.hold)         
-        { 
-          // The parsed values are published as a unified JSON message containing
-          // various fields. The fields are:
-
-          //  * value (float): the measured value, including sign if the value is negative.
-          //  * currentType (string): ?
-          //  * unit (string): the units for the measured value.
-          //  * absValue (float): the absolute value of the latest measurement, with no sign.
-          //  * negative (boolean): whether the measured value is negative.
-          // {
-          //   "currentType":"AC",
-          //   "unit":"V",
-          //   "value":-24.318,
-          //   "absValue":"24.419",
-          //   "negative":true
-          // }
-
-          // Basic measurement data
-          char _value[16];
-          char _display_value[16];
-
-          snprintf(_value, dmm.sign?8:7, "%f", dmm.value);
-          snprintf(_display_value, 7, "%f", abs(dmm.display_value));
-
-          sprintf(g_json_message_buffer,"{\"currentType\":\"%s\",\"unit\":\"%s\",\"value\":%s,\"absValue\":%s,\"negative\":%s}",
-          dmm.currentType.c_str(), dmm.mode.c_str(), _value, _display_value, dmm.sign?"true":"false");
-          Serial.print("Squirrel JSON: ");
-          Serial.println(g_json_message_buffer);
-          // Official @superhousetv JSON spec.
-          client.publish(g_mqtt_json_topic, g_json_message_buffer);
+    case PUBLISH_JSON:
+      // The parsed values are published as a unified JSON message containing
+      // various fields. The fields are:
+
+      //  * value (float): the measured value, including sign if the value is negative.
+      //  * currentType (string): ?
+      //  * unit (string): the units for the measured value.
+      //  * absValue (float): the absolute value of the latest measurement, with no sign.
+      //  * negative (boolean): whether the measured value is negative.
+      // {
+      //   "currentType":"AC",
+      //   "unit":"V",
+      //   "value":-24.318,
+      //   "absValue":"24.419",
+      //   "negative":true
+      // }
+      if (settings.current.topics & UT61E_TOPIC_JSON) {
+        json_basic.write(entry.reading, entry.shown, g_json_message_buffer, sizeof(g_json_message_buffer));
+        // Official @superhousetv JSON spec.
+        client.publish(g_mqtt_json_topic, g_json_message_buffer);
+      }
+      g_publish_stage = PUBLISH_JSON_EXTENDED;
+      return UT61E_SINK_MORE;
+
+    case PUBLISH_JSON_EXTENDED: {
 /* 
- * value: Floating point actual value of reading. No multipliers. eg 1000 Ω not 1.000 kΩ
- * unit: One of V,A,Ω,Hz,F,deg,% with no prefix
- * display_value: Numerical value of the display digits. e.g 1 for when 1 kΩ or 220 for 220uF
- * display_unit: One of V,A,Ω,Hz,F,deg,% with multiplier prefix such as M,k,m,u,n
+ * value: Floating point actual value of reading. No multipliers. eg 1000 Ω not 1.000 kΩ
+ * unit: One of V,A,Ω,Hz,F,deg,% with no prefix
+ * display_value: Numerical value of the display digits. e.g 1 for when 1 kΩ or 220 for 220uF
+ * display_unit: One of V,A,Ω,Hz,F,deg,% with multiplier prefix such as M,k,m,u,n
  * mode: Function selector mode. One of "voltage", "current", "resistance", "continuity",
  *       "diode", "frequency", "capacitance", or  "temperature"
  * currentType: "AC" or "DC"
@@ -222,37 +939,264 @@ void loop() {
  * operation: "Normal", "overload" or "underload"
  * battery_low: true or false
  * sign: Negative sign on, true or false
+ * filtered: value after the mode's filter (only when a Filter or Stable is set)
+ * stable: true once the display has settled (likewise)
+ * session: id of the measurement session the reading belongs to
  */
-          snprintf(_value, dmm.sign?8:7, "%f", dmm.value);
-          snprintf(_display_value, dmm.sign?8:7, "%f", dmm.display_value);
+      g_publish_stage = PUBLISH_INFLUX;
+      if (!(settings.current.topics & UT61E_TOPIC_JSON_X))
+        return UT61E_SINK_MORE;
+      size_t msg_length = json_extended.write(entry.reading, entry.shown, g_json_message_buffer,
+                                             sizeof(g_json_message_buffer));
+      if (entry.flags & UT61E_ENTRY_FILTERED)
+        msg_length = UT61E_FILTER::append_json(g_json_message_buffer, msg_length, sizeof(g_json_message_buffer),
+                                               entry.filtered, entry.flags & UT61E_ENTRY_STABLE);
+      msg_length = UT61E_SESSION::append_json(g_json_message_buffer, msg_length, sizeof(g_json_message_buffer),
+                                              entry.session);
 
-          sprintf(g_json_message_buffer,"{\"value\":%s,\"unit\":\"%s\",\"display_value\":%s,\"display_unit\":\"%s\",\"display_string\":\"%s\",\"mode\":\"%s\",\"currentType\":\"%s\",\"peak\":\"%s\",\"relative\":\"%i\",\"hold\":\"%i\",\"range\":\"%s\",\"operation\":\"%s\",\"battery_low\":\"%i\",\"negative\":%s}", _value, dmm.unit.c_str(), _display_value , dmm.display_unit.c_str(),dmm.display_string, dmm.mode.c_str() , dmm.currentType.c_str() , dmm.peak.c_str(),dmm.relative,dmm.hold,dmm.mrange.c_str(),dmm.operation.c_str(),dmm.battery_low, dmm.sign?"true":"false");
+      // Extended @cabletie spec
+      if (settings.current.batch <= 1) {
+        publishLarge(g_mqtt_json_extended_topic, g_json_message_buffer, msg_length);
+        return UT61E_SINK_MORE;
+      }
+      // Batched: a JSON array of readings, sent when full or too old
+      if (g_batch_length + msg_length + 2 > sizeof(g_batch_buffer))
+        flushBatch();
+      if (g_batch_count == 0) {
+        g_batch_buffer[0] = '[';
+        g_batch_length = 1;
+        g_batch_started = millis();
+      } else {
+        g_batch_buffer[g_batch_length++] = ',';
+      }
+      memcpy(g_batch_buffer + g_batch_length, g_json_message_buffer, msg_length);
+      g_batch_length += msg_length;
+      if (++g_batch_count >= settings.current.batch)
+        flushBatch();
+      return UT61E_SINK_MORE;
+    }
 
-          size_t msg_length = strlen(g_json_message_buffer);
+    case PUBLISH_INFLUX:
+      if (settings.current.topics & UT61E_TOPIC_INFLUX) {
+        // InfluxDB line protocol, straight into Telegraf's mqtt_consumer
+        influx.write(entry.reading, entry.shown, g_json_message_buffer, sizeof(g_json_message_buffer));
+        client.publish(g_mqtt_influx_topic, g_json_message_buffer);
+      }
+      g_publish_stage = PUBLISH_CSV;
+      return UT61E_SINK_MORE;
 
-          Serial.print("JSON: ");
-          Serial.println(g_json_message_buffer);
-          // Extended @cabletie spec
-          client.beginPublish(g_mqtt_json_extended_topic, msg_length,false);
-          client.print(g_json_message_buffer);
-          // client.publish(g_mqtt_json_extended_topic, g_json_message_buffer);
-          client.endPublish();
+    case PUBLISH_CSV:
+      if (settings.current.topics & UT61E_TOPIC_CSV) {
+        csv.write(entry.reading, entry.shown, g_json_message_buffer, sizeof(g_json_message_buffer));
+        client.publish(g_mqtt_csv_topic, g_json_message_buffer);
+      }
+      break;
+  }
+  g_publish_stage = PUBLISH_IDLE;
+  return UT61E_SINK_DONE;
+}
+
+#ifdef UDP_FEED_PORT
+/**
+  UDP feed: every good reading, deadband or not, since the feed is for
+  live displays
+*/
+ut61e_sink_result_t udpSink(const ut61e_sink_entry &entry) {
+  if (entry.flags & UT61E_ENTRY_GOOD)
+    udp_feed.add(entry.reading);
+  return UT61E_SINK_DONE;
+}
+#endif
+
+#ifdef HISTORY_PORT
+/**
+  History: every good reading, compressed into RAM for /history.csv and
+  /history.bin
+*/
+ut61e_sink_result_t historySink(const ut61e_sink_entry &entry) {
+  if (entry.flags & UT61E_ENTRY_GOOD)
+    history.add(entry.reading);
+  return UT61E_SINK_DONE;
+}
+#endif
+
+#ifdef DEEP_SLEEP_MS
+/**
+  Battery operation. Capture DUTY_PACKETS readings or for DUTY_CAPTURE_MS
+  into RTC memory, publish everything buffered on tele/<id>/BATCH every
+  DUTY_PUBLISH_EVERY wakes, and deep sleep for DEEP_SLEEP_MS. Wakes that
+  don't publish leave the radio off. Never returns.
+*/
+void dutyCycle() {
+  ut61e_duty_config config = { DUTY_PACKETS, DUTY_CAPTURE_MS, DEEP_SLEEP_MS, DUTY_PUBLISH_EVERY };
+  ut61e_duty_power power;
+  UT61E_DUTY_CYCLE duty(config);
+  ESP.rtcUserMemoryRead(UT61E_RTC_OFFSET_BLOCKS, (uint32_t *)&duty.state, sizeof(duty.state));
+  if (!duty.begin())
+    Serial.println("Deep sleep: no saved state, starting afresh");
+  bool publish = duty.publish_due();
+  if (!publish)
+    WiFi.forceSleepBegin();  // Only after a power on; wakes come up without RF
+
+  uint16_t readings = 0;
+  while (duty.capturing(millis(), readings)) {
+    while (ut61e.available()) {
+      if (framer.push(ut61e.read())) {
+        ut61e_reading_t reading = {};
+        ut61e_shown_t shown;
+        if (meter.decode(framer.frame(), reading, shown)) {
+          duty.add(reading, millis());
+          readings++;
         }
-      } else { // Data error
-        pixels.setPixelColor(0, pixels.Color(255, 0, 0));  // Red
-        pixels.show();
-        g_buffer_position = 0;
-        client.publish(g_mqtt_raw_topic, g_raw_packet_buffer);
-        sprintf(g_json_message_buffer,"{\"error\":\"invalid data!\"}");
-        Serial.print("JSON: ");
-        Serial.println(g_json_message_buffer);
-        pixels.setPixelColor(0, pixels.Color(0, 0, 0));  // Off
-        pixels.show();
       }
     }
+    delay(1);
+  }
+
+  uint32_t radio_ms = 0;
+  if (publish) {
+    uint32_t radio_started = millis();
+    size_t length = duty.json(g_batch_buffer, sizeof(g_batch_buffer), power);
+    bool sent = false;
+    if (initWifi()) {
+      client.setServer(mqtt_broker, 1883);
+      reconnectMqtt();
+      sent = client.connected() && publishLarge(g_mqtt_batch_topic, g_batch_buffer, length);
+      client.disconnect();
+    }
+    if (sent)
+      duty.published();
+    else
+      duty.publish_failed();  // Kept for the next try; the oldest go if it fills
+    radio_ms = millis() - radio_started;
+  }
+
+  uint32_t sleep_ms = duty.sleep(millis(), radio_ms);
+  ESP.rtcUserMemoryWrite(UT61E_RTC_OFFSET_BLOCKS, (uint32_t *)&duty.state, sizeof(duty.state));
+  Serial.print("Deep sleep: ");
+  Serial.print(readings);
+  Serial.print(" readings, ");
+  Serial.print(duty.state.count);
+  Serial.println(" buffered");
+  ESP.deepSleep((uint64_t)sleep_ms * 1000, duty.next_publishes() ? WAKE_RF_DEFAULT : WAKE_RF_DISABLED);
+}
+#endif
+
+#ifdef METRICS_PORT
+/**
+  Give the metrics server the reading just decoded. Only changes make it
+  render the response again.
+*/
+void setReadingMetrics(const ut61e_reading_t &r) {
+  char labels[UT61E_METRICS_LABELS];
+  snprintf(labels, sizeof(labels), "mode=\"%s\",unit=\"%s\"",
+           UT61E_MODE_NAMES[r.mode < UT61E_MODE_COUNT ? r.mode : 0], UT61E_UNIT_NAMES[ut61e_mode_unit(r.mode)]);
+  bool out_of_range = r.flags & (UT61E_FLAG_OVERLOAD | UT61E_FLAG_UNDERLOAD);
+  metrics.set(METRIC_READING, out_of_range ? NAN : ut61e_reading_value(r), labels);
+  metrics.set(METRIC_OVERLOAD, (r.flags & UT61E_FLAG_OVERLOAD) != 0);
+  metrics.set(METRIC_HOLD, (r.flags & UT61E_FLAG_HOLD) != 0);
+  metrics.set(METRIC_RELATIVE, (r.flags & UT61E_FLAG_RELATIVE) != 0);
+  metrics.set(METRIC_BATTERY_LOW, (r.flags & UT61E_FLAG_BATTERY_LOW) != 0);
+  metrics.set(METRIC_READING_TIME, r.time_ms / 1000.0);
+  if (g_filter_enabled) {
+    metrics.set(METRIC_FILTERED, filter.value(), labels);
+    metrics.set(METRIC_STABLE, filter.stable);
+  } else {
+    metrics.remove(METRIC_FILTERED);
+    metrics.remove(METRIC_STABLE);
+  }
+}
+
+/**
+  Counters, heap and connection state for the metrics server. The heap
+  watermarks are the ones sampleHeap() keeps, not measured here.
+*/
+void setStatusMetrics() {
+  metrics.set(METRIC_FRAMES, framer.frames);
+  metrics.set(METRIC_FRAMES_DROPPED, g_frames_dropped);
+  metrics.set(METRIC_CHECK_FAILURES, meter.check_failures());
+  metrics.set(METRIC_BYTES, g_bytes_received);
+  metrics.set(METRIC_PARITY_ERRORS, g_parity_errors);
+  metrics.set(METRIC_OVERFLOWS, g_overflows);
+  metrics.set(METRIC_RESYNC_BYTES, framer.resync_bytes);
+  metrics.set(METRIC_CHARGE, energy.charge_mah());
+  metrics.set(METRIC_ENERGY, energy.energy_wh());
+  metrics.set(METRIC_HEAP_FREE, ESP.getFreeHeap());
+  if (g_heap_free_min != 0xFFFFFFFF) {
+    metrics.set(METRIC_HEAP_FREE_MIN, g_heap_free_min);
+    metrics.set(METRIC_HEAP_BLOCK_MIN, g_heap_block_min);
+    metrics.set(METRIC_HEAP_FRAGMENTATION_MAX, g_heap_fragmentation_max);
   }
+  metrics.set(METRIC_UPTIME, millis() / 1000);
+  if (WiFi.status() == WL_CONNECTED)
+    metrics.set(METRIC_WIFI_RSSI, WiFi.RSSI());
+  else
+    metrics.remove(METRIC_WIFI_RSSI);
+  metrics.set(METRIC_MQTT_CONNECTED, client.connected());
 }
+#endif
 
+/**
+  Publish a message that may be longer than PubSubClient's packet buffer
+*/
+bool publishLarge(const char *topic, const char *payload, size_t length) {
+  if (!client.beginPublish(topic, length, false))
+    return false;
+  client.write((const uint8_t *)payload, length);
+  return client.endPublish();
+}
+
+/**
+  Send the readings collected so far as one extended JSON array
+*/
+void flushBatch() {
+  if (g_batch_count == 0)
+    return;
+  g_batch_buffer[g_batch_length++] = ']';
+  publishLarge(g_mqtt_json_extended_topic, g_batch_buffer, g_batch_length);
+  g_batch_count = 0;
+  g_batch_length = 0;
+}
+
+/**
+  Decide whether the reading just parsed goes out on the decoded topics.
+  Anything but a change of the display digits always does; a digits change
+  must be bigger than the deadband, unless the heartbeat is due. With
+  neither set every reading is published.
+*/
+bool decodedDue(const ut61e_reading_t &r) {
+  const ut61e_settings_t &s = settings.current;
+  uint32_t now = millis();
+  bool due = !g_have_decoded || (s.deadband == 0 && s.heartbeat_ms == 0)
+    || r.mode != g_last_decoded.mode || r.range != g_last_decoded.range
+    || r.flags != g_last_decoded.flags || r.exponent != g_last_decoded.exponent
+    || (uint32_t)abs(r.digits - g_last_decoded.digits) > s.deadband
+    || (s.heartbeat_ms && now - g_last_decoded_ms >= s.heartbeat_ms);
+  if (due) {
+    g_last_decoded = r;
+    g_last_decoded_ms = now;
+    g_have_decoded = true;
+  }
+  return due;
+}
+
+/**
+  Make the current settings take effect
+*/
+void applySettings() {
+  const ut61e_settings_t &s = settings.current;
+  meter.set_serial(s.debug >= 2 ? &Serial : 0);
+  filter.configure(s.filter, s.filter_param, s.stable_tolerance, s.stable_samples);
+  energy.configure(s.supply_mv / 1000.0f, s.energy_gap_ms);
+  session.configure(s.session_gap_ms);
+  if (settings.energy_reset) {
+    energy.reset();
+    settings.energy_reset = false;
+  }
+  g_filter_enabled = s.stable_samples > 0;
+  for (uint8_t m = 0; m < UT61E_MODE_COUNT; m++)
+    g_filter_enabled |= s.filter[m] != UT61E_FILTER_NONE;
+}
 
 /**
   Report the most recent values to MQTT if enough time has passed
@@ -325,8 +1269,12 @@ void reconnectMqtt() {
   char mqtt_client_id[20];
   sprintf(mqtt_client_id, "esp8266-%X", g_device_id);
 
-  // Loop until we're reconnected
-  while (!client.connected()) {
+  // One attempt at a time; the network task calls back until we're connected.
+  // Waiting here would stall everything else.
+  if (g_mqtt_last_attempt && millis() - g_mqtt_last_attempt < MQTT_RETRY_INTERVAL)
+    return;
+  g_mqtt_last_attempt = millis();
+  if (!client.connected()) {
     Serial.print("Attempting MQTT connection to ");
     Serial.print(mqtt_broker);
     Serial.print(" as ");
@@ -338,33 +1286,33 @@ void reconnectMqtt() {
       // Once connected, publish an announcement
       sprintf(g_raw_packet_buffer, "Device %s starting up", mqtt_client_id);
       client.publish(status_topic, g_raw_packet_buffer);
-      pixels.setPixelColor(0, pixels.Color(0, 50, 0));  // Dim green
-      pixels.show();
+      status_led.set(status_led.Color(0, 50, 0));  // Dim green
       // Resubscribe
-      //client.subscribe(g_command_topic);
+      client.subscribe(g_command_topic);
       Serial.println("success");
     } else {
       //Serial.print("failed, rc=");
       //Serial.print(client.state());
       //Serial.println(" try again in 5 seconds");
-      // Wait 5 seconds before retrying
+      // Try again in MQTT_RETRY_INTERVAL
       Serial.println("FAILED");
-      delay(5000);
     }
   }
 }
 
 /*
-  This callback is invoked when an MQTT message is received. It's not important
-  right now for this project because we don't receive commands via MQTT. You
-  can modify this function to make the device act on commands that you send it.
+  This callback is invoked when an MQTT message is received. Commands on
+  cmnd/<id>/COMMAND change the runtime settings (see lib/ut61e_settings) and
+  are acknowledged on stat/<id>/RESULT.
 */
 void callback(char* topic, byte* message, unsigned int length) {
-  //Serial.print("Message arrived [");
-  //Serial.print(topic);
-  //Serial.print("] ");
-  //for (int i = 0; i < length; i++) {
-  //  Serial.print((char)payload[i]);
-  //}
-  //Serial.println();
+  if (strcmp(topic, g_command_topic) != 0)
+    return;
+  // PubSubClient's buffer is still in use: reply from our own
+  char reply[512];
+  settings.command((const char *)message, length, reply, sizeof(reply));
+  applySettings();
+  Serial.print("Command: ");
+  Serial.println(reply);
+  publishLarge(g_result_topic, reply, strlen(reply));
 }
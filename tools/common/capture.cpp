@@ -0,0 +1,114 @@
+/*
+ * capture.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "capture.h"
+#include <cstdio>
+#include <cstring>
+
+void split_packets(const uint8_t *data, size_t length, std::vector<packet_t> &out) {
+    const uint8_t *p = data, *end = data + length;
+    while ((p = (const uint8_t *)memchr(p, '\n', end - p))) {
+        const uint8_t *start = packet_before_lf(data, p - data);
+        if (start) {
+            packet_t packet;
+            memcpy(packet.data(), start, 12);
+            out.push_back(packet);
+        }
+        p++;
+    }
+}
+
+bool load_packets(const std::string &path, std::vector<packet_t> &out) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    std::vector<uint8_t> data;
+    uint8_t buffer[1 << 16];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        data.insert(data.end(), buffer, buffer + n);
+    fclose(f);
+    split_packets(data.data(), data.size(), out);
+    return true;
+}
+
+void build_frame(uint8_t frame[14], uint8_t function, uint8_t range, int32_t digits, bool negative,
+                 uint8_t status, uint8_t option1, uint8_t option2, uint8_t option3, uint8_t option4) {
+    frame[0] = 0x30 | (range & 0x07);
+    for (int i = 5; i >= 1; i--) {
+        frame[i] = 0x30 + digits % 10;
+        digits /= 10;
+    }
+    frame[6] = function;
+    frame[7] = 0x30 | (status & 0x0f) | (negative ? 0x04 : 0);
+    frame[8] = 0x30 | (option1 & 0x0f);
+    frame[9] = 0x30 | (option2 & 0x0e);
+    frame[10] = 0x30 | (option3 & 0x0f);
+    frame[11] = 0x30 | (option4 & 0x07);
+    frame[12] = '\r';
+    frame[13] = '\n';
+}
+
+// Dial settings the synthetic meter moves between: function byte, number of
+// ranges, option3 bits (DC/AC/AUTO)
+static const struct {
+    uint8_t function, ranges, options3;
+} SETTINGS[] = {
+    {0x3b, 4, 0x0a},  // DC voltage, auto
+    {0x3b, 4, 0x06},  // AC voltage, auto
+    {0x33, 7, 0x02},  // Resistance, auto
+    {0x36, 8, 0x02},  // Capacitance, auto
+    {0x32, 7, 0x03},  // Frequency, auto
+    {0x3f, 2, 0x0a},  // DC mA, auto
+    {0x35, 1, 0x00},  // Continuity
+    {0x31, 1, 0x00},  // Diode
+};
+
+synthetic_meter::synthetic_meter(uint32_t seed):rng(seed),remaining(0) {
+    pick_setting();
+}
+
+void synthetic_meter::pick_setting() {
+    const auto &s = SETTINGS[rng() % (sizeof(SETTINGS) / sizeof(SETTINGS[0]))];
+    function = s.function;
+    ranges = s.ranges;
+    range = (uint8_t)(rng() % s.ranges);
+    options3 = s.options3;
+    digits = (int32_t)(rng() % 22000);
+    negative = (options3 & 0x08) && (rng() % 4 == 0);
+    remaining = 50 + rng() % 400;
+}
+
+void synthetic_meter::next(uint8_t frame[14]) {
+    if (remaining-- == 0)
+        pick_setting();
+    uint32_t roll = rng() % 1000;
+    uint8_t status = 0;
+    if (roll < 150) {
+        // Last digit or two wander
+        digits += (int32_t)(rng() % 7) - 3;
+        if (digits < 0)
+            digits = 0;
+        if (digits > 21999)
+            digits = 21999;
+    } else if (roll < 153 && (options3 & 0x02)) {
+        // Auto range step
+        range = (uint8_t)((range + 1) % ranges);
+    } else if (roll < 158) {
+        status |= 0x01; // OL for this packet
+    }
+    build_frame(frame, function, range, digits, negative, status, 0, 0, options3, 0);
+}
+
+packet_t synthetic_meter::next_packet() {
+    uint8_t frame[14];
+    next(frame);
+    packet_t p;
+    memcpy(p.data(), frame, 12);
+    return p;
+}
@@ -0,0 +1,69 @@
+/*
+ * capture.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Loading meter packets for the host tools, either from captures or from a
+ * synthetic meter.
+ *
+ * Two capture layouts are recognised, mixed freely in one file:
+ *   - raw serial captures: 12 data bytes + CR LF per packet
+ *   - RAW topic dumps (mosquitto_sub -t tele/+/RAW): 12 bytes + LF per line
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::array<uint8_t, 12> packet_t;
+
+// Find the packet ending at the LF at data[lf]; returns a pointer to its first
+// byte or nullptr if the line isn't a packet.
+inline const uint8_t *packet_before_lf(const uint8_t *data, size_t lf) {
+	if (lf >= 13 && data[lf - 1] == '\r')
+		return data + lf - 13;
+	if (lf >= 12)
+		return data + lf - 12;
+	return nullptr;
+}
+
+// Extract every packet from a buffer
+void split_packets(const uint8_t *data, size_t length, std::vector<packet_t> &out);
+// Read a capture file; false if it can't be read
+bool load_packets(const std::string &path, std::vector<packet_t> &out);
+
+// Produces a plausible UT61E stream: the dial moves between functions every
+// few hundred packets, and within a setting the reading mostly repeats with
+// an occasional small change, range change or overload.
+class synthetic_meter {
+	public:
+		explicit synthetic_meter(uint32_t seed = 1);
+		// Next 14 byte frame, CR LF included
+		void next(uint8_t frame[14]);
+		packet_t next_packet();
+	private:
+		std::mt19937 rng;
+		uint32_t remaining;   // Packets left in the current dial setting
+		uint8_t function;
+		uint8_t ranges;
+		uint8_t range;
+		uint8_t options3;
+		int32_t digits;
+		bool negative;
+
+		void pick_setting();
+};
+
+// Build a 14 byte ES51922 frame from its fields
+void build_frame(uint8_t frame[14], uint8_t function, uint8_t range, int32_t digits, bool negative,
+                 uint8_t status, uint8_t option1, uint8_t option2, uint8_t option3, uint8_t option4);
+
+#endif /* CAPTURE_H_ */
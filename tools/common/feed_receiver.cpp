@@ -0,0 +1,119 @@
+/*
+ * feed_receiver.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "feed_receiver.h"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// Further back than this is a reboot rather than a late datagram
+#define FEED_REORDER_WINDOW  1024
+
+bool feed_receiver::open(const char *group, uint16_t port, const char *interface) {
+    close();
+    in_addr group_address, interface_address;
+    interface_address.s_addr = htonl(INADDR_ANY);
+    if (inet_pton(AF_INET, group, &group_address) != 1
+        || (interface && inet_pton(AF_INET, interface, &interface_address) != 1)) {
+        error = "bad address";
+        return false;
+    }
+    fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+    int one = 1, size = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    socklen_t length = sizeof(address);
+    if (::bind(fd, (sockaddr *)&address, sizeof(address)) < 0
+        || getsockname(fd, (sockaddr *)&address, &length) < 0) {
+        error = strerror(errno);
+        close();
+        return false;
+    }
+    bound_port = ntohs(address.sin_port);
+    if (IN_MULTICAST(ntohl(group_address.s_addr))) {
+        ip_mreq membership;
+        membership.imr_multiaddr = group_address;
+        membership.imr_interface = interface_address;
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+            error = std::string("can't join group: ") + strerror(errno);
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void feed_receiver::close() {
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    bound_port = 0;
+}
+
+feed_source &feed_receiver::account(const ut61e_feed_header &h) {
+    feed_source *s = nullptr;
+    for (auto &sender: senders)
+        if (sender.device_id == h.device_id)
+            s = &sender;
+    if (!s) {
+        senders.push_back(feed_source{h.device_id, h.sequence, h.first_reading, 0, 0, 0, 0, 0, 0});
+        s = &senders.back();
+    }
+    uint32_t ahead = h.sequence - s->next_sequence;
+    if (ahead < 0x80000000u) {
+        // In order, or after a gap
+        s->lost_datagrams += ahead;
+        s->lost_readings += h.first_reading - s->next_reading;
+    } else if (h.sequence != 0 && s->next_sequence - h.sequence <= FEED_REORDER_WINDOW) {
+        // Late: it was counted as lost when the gap opened
+        s->late++;
+        s->lost_datagrams -= s->lost_datagrams ? 1 : 0;
+        s->lost_readings -= s->lost_readings < h.count ? s->lost_readings : h.count;
+        s->datagrams++;
+        s->readings += h.count;
+        return *s;
+    } else {
+        s->restarts++;
+    }
+    s->next_sequence = h.sequence + 1;
+    s->next_reading = h.first_reading + h.count;
+    s->datagrams++;
+    s->readings += h.count;
+    return *s;
+}
+
+int feed_receiver::receive(ut61e_reading_t *out, ut61e_feed_header &header, const feed_source *&source,
+                           int timeout_ms) {
+    uint8_t datagram[UT61E_FEED_MAX_SIZE + 1];
+    pollfd p = {fd, POLLIN, 0};
+    while (fd >= 0 && poll(&p, 1, timeout_ms) > 0) {
+        ssize_t n = recv(fd, datagram, sizeof(datagram), 0);
+        const uint8_t *readings;
+        int count = n > 0 ? ut61e_feed_parse(datagram, n, header, readings) : -1;
+        if (count < 0) {
+            invalid++;
+            continue;
+        }
+        memcpy(out, readings, count * sizeof(ut61e_reading_t));
+        source = &account(header);
+        return count;
+    }
+    return -1;
+}
@@ -0,0 +1,67 @@
+/*
+ * feed_receiver.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Receives the firmware's UDP reading feed (lib/ut61e_udp_feed) and keeps
+ * loss statistics per sending device from the datagram and reading
+ * sequence numbers.
+ */
+
+#ifndef FEED_RECEIVER_H_
+#define FEED_RECEIVER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ut61e_feed.h"
+
+#define FEED_DEFAULT_GROUP  "239.255.61.1"
+#define FEED_DEFAULT_PORT   6161
+
+// What one sender's sequence numbers say
+struct feed_source {
+	uint32_t device_id;
+	uint32_t next_sequence;    // Expected next
+	uint32_t next_reading;
+	uint64_t datagrams;        // Received
+	uint64_t readings;
+	uint64_t lost_datagrams;   // Gaps not (yet) filled
+	uint64_t lost_readings;
+	uint64_t late;             // Arrived after a later one (or twice)
+	uint64_t restarts;         // Sender rebooted, numbering started again
+};
+
+class feed_receiver {
+	public:
+		feed_receiver() { }
+		~feed_receiver() { close(); }
+
+		// Join group (a multicast address, or 0.0.0.0 for unicast) on port;
+		// port 0 picks a free one, see port(). interface is the local address
+		// to join on, INADDR_ANY when null.
+		bool open(const char *group = FEED_DEFAULT_GROUP, uint16_t port = FEED_DEFAULT_PORT,
+		          const char *interface = nullptr);
+		void close();
+		uint16_t port() const { return bound_port; }
+
+		// Wait up to timeout_ms for a feed datagram and copy its readings to
+		// out (room for UT61E_FEED_MAX_READINGS). Returns the number of
+		// readings, or -1 on timeout. source is the sender's statistics.
+		int receive(ut61e_reading_t *out, ut61e_feed_header &header, const feed_source *&source,
+		            int timeout_ms);
+
+		const std::vector<feed_source> &sources() const { return senders; }
+		uint64_t invalid = 0;       // Datagrams that weren't feed datagrams
+		std::string error;
+	private:
+		int fd = -1;
+		uint16_t bound_port = 0;
+		std::vector<feed_source> senders;
+
+		feed_source &account(const ut61e_feed_header &header);
+};
+
+#endif /* FEED_RECEIVER_H_ */
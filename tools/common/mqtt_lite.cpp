@@ -0,0 +1,297 @@
+/*
+ * mqtt_lite.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "mqtt_lite.h"
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define MQTT_CONNECT     1
+#define MQTT_CONNACK     2
+#define MQTT_PUBLISH     3
+#define MQTT_SUBSCRIBE   8
+#define MQTT_SUBACK      9
+#define MQTT_PINGREQ     12
+#define MQTT_PINGRESP    13
+#define MQTT_DISCONNECT  14
+
+namespace mqtt_codec {
+
+size_t put_length(uint8_t *out, size_t length) {
+    size_t n = 0;
+    do {
+        uint8_t b = length % 128;
+        length /= 128;
+        if (length)
+            b |= 0x80;
+        out[n++] = b;
+    } while (length && n < 4);
+    return n;
+}
+
+size_t packet_size(const uint8_t *p, size_t available, size_t &header_size) {
+    size_t length = 0, multiplier = 1;
+    for (size_t i = 1; i <= 4; i++) {
+        if (i >= available)
+            return 0;
+        length += (p[i] & 0x7f) * multiplier;
+        multiplier *= 128;
+        if (!(p[i] & 0x80)) {
+            header_size = i + 1;
+            return header_size + length;
+        }
+    }
+    return SIZE_MAX;
+}
+
+void put_string(std::vector<uint8_t> &out, std::string_view s) {
+    out.push_back((uint8_t)(s.size() >> 8));
+    out.push_back((uint8_t)s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+bool topic_matches(std::string_view filter, std::string_view topic) {
+    size_t f = 0, t = 0;
+    while (f < filter.size()) {
+        if (filter[f] == '#')
+            return true;
+        if (filter[f] == '+') {
+            while (t < topic.size() && topic[t] != '/')
+                t++;
+            f++;
+            continue;
+        }
+        if (t >= topic.size() || filter[f] != topic[t])
+            return false;
+        f++;
+        t++;
+    }
+    return t == topic.size();
+}
+
+int64_t now_ms() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace mqtt_codec
+
+using namespace mqtt_codec;
+
+mqtt_lite::mqtt_lite():bytes_in(0),bytes_out(0),sock(-1),next_id(1),keepalive_s(60),last_tx_ms(0) {}
+
+mqtt_lite::~mqtt_lite() {
+    disconnect();
+}
+
+bool mqtt_lite::connect(const char *host, uint16_t port, const char *client_id,
+                        const char *username, const char *password, uint16_t keepalive) {
+    disconnect();
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &res) != 0)
+        return false;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        sock = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock < 0)
+            continue;
+        if (::connect(sock, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        ::close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(res);
+    if (sock < 0)
+        return false;
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    keepalive_s = keepalive;
+    std::vector<uint8_t> body;
+    put_string(body, "MQTT");
+    body.push_back(4); // Protocol level 3.1.1
+    uint8_t flags = 0x02; // Clean session
+    if (username && *username)
+        flags |= 0x80;
+    if (password && *password)
+        flags |= 0x40;
+    body.push_back(flags);
+    body.push_back((uint8_t)(keepalive >> 8));
+    body.push_back((uint8_t)keepalive);
+    put_string(body, client_id);
+    if (flags & 0x80)
+        put_string(body, username);
+    if (flags & 0x40)
+        put_string(body, password);
+    if (!send_packet(MQTT_CONNECT << 4, body.data(), body.size()) || !wait_for(MQTT_CONNACK, 5000)) {
+        disconnect();
+        return false;
+    }
+    // Return code lives in the 4th byte of CONNACK
+    bool accepted = rx.size() >= 4 && rx[3] == 0;
+    rx.erase(rx.begin(), rx.begin() + 4);
+    if (!accepted)
+        disconnect();
+    return accepted;
+}
+
+void mqtt_lite::disconnect() {
+    if (sock < 0)
+        return;
+    send_packet(MQTT_DISCONNECT << 4, nullptr, 0);
+    ::close(sock);
+    sock = -1;
+    rx.clear();
+}
+
+bool mqtt_lite::send_packet(uint8_t type, const uint8_t *body, size_t length) {
+    if (sock < 0)
+        return false;
+    tx.resize(5 + length);
+    tx[0] = type;
+    size_t header = 1 + put_length(&tx[1], length);
+    if (length)
+        memcpy(&tx[header], body, length);
+    size_t total = header + length, sent = 0;
+    while (sent < total) {
+        ssize_t n = ::send(sock, &tx[sent], total - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            ::close(sock);
+            sock = -1;
+            return false;
+        }
+        sent += n;
+    }
+    bytes_out += total;
+    last_tx_ms = now_ms();
+    return true;
+}
+
+bool mqtt_lite::read_some(int timeout_ms) {
+    pollfd p = {sock, POLLIN, 0};
+    int r = ::poll(&p, 1, timeout_ms);
+    if (r <= 0)
+        return r == 0;
+    size_t old = rx.size();
+    rx.resize(old + 65536);
+    ssize_t n = ::recv(sock, &rx[old], 65536, 0);
+    if (n <= 0) {
+        rx.resize(old);
+        ::close(sock);
+        sock = -1;
+        return false;
+    }
+    rx.resize(old + n);
+    bytes_in += n;
+    return true;
+}
+
+bool mqtt_lite::wait_for(uint8_t type, int timeout_ms) {
+    int64_t deadline = now_ms() + timeout_ms;
+    while (sock >= 0 && now_ms() < deadline) {
+        if (!rx.empty() && (rx[0] >> 4) == type) {
+            size_t header;
+            size_t size = packet_size(rx.data(), rx.size(), header);
+            if (size && size != SIZE_MAX && size <= rx.size())
+                return true;
+        }
+        if (!read_some((int)(deadline - now_ms())))
+            return false;
+    }
+    return false;
+}
+
+bool mqtt_lite::subscribe(const char *filter) {
+    std::vector<uint8_t> body;
+    uint16_t id = next_id++;
+    body.push_back((uint8_t)(id >> 8));
+    body.push_back((uint8_t)id);
+    put_string(body, filter);
+    body.push_back(0); // QoS 0
+    if (!send_packet((MQTT_SUBSCRIBE << 4) | 0x02, body.data(), body.size()))
+        return false;
+    // Messages may already be arriving ahead of the SUBACK, poll() deals with both
+    return true;
+}
+
+bool mqtt_lite::publish(std::string_view topic, std::string_view payload, bool retain) {
+    if (sock < 0)
+        return false;
+    size_t length = 2 + topic.size() + payload.size();
+    tx.resize(5 + length);
+    tx[0] = (MQTT_PUBLISH << 4) | (retain ? 1 : 0);
+    size_t header = 1 + put_length(&tx[1], length);
+    uint8_t *p = &tx[header];
+    *p++ = (uint8_t)(topic.size() >> 8);
+    *p++ = (uint8_t)topic.size();
+    memcpy(p, topic.data(), topic.size());
+    memcpy(p + topic.size(), payload.data(), payload.size());
+    size_t total = header + length, sent = 0;
+    while (sent < total) {
+        ssize_t n = ::send(sock, &tx[sent], total - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            ::close(sock);
+            sock = -1;
+            return false;
+        }
+        sent += n;
+    }
+    bytes_out += total;
+    last_tx_ms = now_ms();
+    return true;
+}
+
+size_t mqtt_lite::dispatch() {
+    size_t offset = 0, messages = 0;
+    while (offset < rx.size()) {
+        size_t header;
+        size_t size = packet_size(&rx[offset], rx.size() - offset, header);
+        if (size == SIZE_MAX) {
+            disconnect();
+            return messages;
+        }
+        if (size == 0 || offset + size > rx.size())
+            break;
+        const uint8_t *p = &rx[offset];
+        if ((p[0] >> 4) == MQTT_PUBLISH) {
+            const uint8_t *v = p + header;
+            size_t topic_length = (v[0] << 8) | v[1];
+            size_t skip = 2 + topic_length + (((p[0] >> 1) & 3) ? 2 : 0); // Packet id for QoS>0
+            if (skip <= size - header) {
+                std::string_view topic((const char *)v + 2, topic_length);
+                std::string_view payload((const char *)v + skip, size - header - skip);
+                if (handler)
+                    handler(topic, payload);
+                messages++;
+            }
+        }
+        // CONNACK/SUBACK/PINGRESP need no action
+        offset += size;
+    }
+    rx.erase(rx.begin(), rx.begin() + offset);
+    return messages;
+}
+
+int mqtt_lite::poll(int timeout_ms) {
+    if (sock < 0)
+        return -1;
+    if (keepalive_s && now_ms() - last_tx_ms > keepalive_s * 500)
+        send_packet(MQTT_PINGREQ << 4, nullptr, 0);
+    if (!read_some(timeout_ms))
+        return -1;
+    size_t n = dispatch();
+    return sock < 0 ? -1 : (int)n;
+}
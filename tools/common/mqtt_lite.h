@@ -0,0 +1,79 @@
+/*
+ * mqtt_lite.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Minimal MQTT 3.1.1 client for the host tools. QoS 0 only, blocking socket,
+ * one connection per object. Received messages are handed to the handler as
+ * views into the receive buffer, valid only for the duration of the call.
+ */
+
+#ifndef MQTT_LITE_H_
+#define MQTT_LITE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+class mqtt_lite {
+	public:
+		typedef std::function<void(std::string_view topic, std::string_view payload)> message_handler;
+
+		mqtt_lite();
+		~mqtt_lite();
+		mqtt_lite(const mqtt_lite &) = delete;
+		mqtt_lite &operator=(const mqtt_lite &) = delete;
+
+		bool connect(const char *host, uint16_t port, const char *client_id,
+		             const char *username = nullptr, const char *password = nullptr,
+		             uint16_t keepalive = 60);
+		void disconnect();
+		bool connected() const { return sock >= 0; }
+
+		bool subscribe(const char *filter);
+		bool publish(std::string_view topic, std::string_view payload, bool retain = false);
+
+		// Wait up to timeout_ms for traffic and dispatch every complete message
+		// received. Returns the number of messages dispatched, or -1 if the
+		// connection was lost.
+		int poll(int timeout_ms);
+
+		void on_message(message_handler h) { handler = std::move(h); }
+		int fd() const { return sock; }
+
+		uint64_t bytes_in;
+		uint64_t bytes_out;
+	private:
+		int sock;
+		uint16_t next_id;
+		uint16_t keepalive_s;
+		int64_t last_tx_ms;
+		std::vector<uint8_t> rx;
+		std::vector<uint8_t> tx;
+		message_handler handler;
+
+		bool send_packet(uint8_t type, const uint8_t *body, size_t length);
+		bool read_some(int timeout_ms);
+		bool wait_for(uint8_t type, int timeout_ms);
+		size_t dispatch();
+};
+
+// Helpers shared with the broker stand-in
+namespace mqtt_codec {
+	// Encode the MQTT variable length "remaining length"; returns bytes used
+	size_t put_length(uint8_t *out, size_t length);
+	// Decode a packet header at p. Returns total packet size, 0 if incomplete,
+	// or SIZE_MAX if malformed. header_size receives fixed header length.
+	size_t packet_size(const uint8_t *p, size_t available, size_t &header_size);
+	void put_string(std::vector<uint8_t> &out, std::string_view s);
+	// Topic filter match with '+' and '#' wildcards
+	bool topic_matches(std::string_view filter, std::string_view topic);
+	int64_t now_ms();
+}
+
+#endif /* MQTT_LITE_H_ */
@@ -0,0 +1,221 @@
+/*
+ * mqtt_standin.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "mqtt_standin.h"
+#include "mqtt_lite.h"
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define STANDIN_MAX_BACKLOG  (64u << 20)  // Bytes queued per subscriber before dropping
+
+using namespace mqtt_codec;
+
+mqtt_standin::mqtt_standin(uint16_t p):messages_in(0),messages_out(0),messages_dropped(0),
+    subscriptions(0),listen_fd(-1),listen_port(p),running(false) {}
+
+mqtt_standin::~mqtt_standin() {
+    stop();
+}
+
+bool mqtt_standin::start() {
+    listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        return false;
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(listen_port);
+    if (::bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(listen_fd, 1024) < 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    socklen_t length = sizeof(addr);
+    getsockname(listen_fd, (sockaddr *)&addr, &length);
+    listen_port = ntohs(addr.sin_port);
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+    running = true;
+    worker = std::thread(&mqtt_standin::run, this);
+    return true;
+}
+
+void mqtt_standin::stop() {
+    if (!running)
+        return;
+    running = false;
+    worker.join();
+    for (auto &c: clients)
+        ::close(c.fd);
+    clients.clear();
+    ::close(listen_fd);
+    listen_fd = -1;
+}
+
+void mqtt_standin::route(const uint8_t *packet, size_t size, size_t header) {
+    const uint8_t *v = packet + header;
+    size_t topic_length = (v[0] << 8) | v[1];
+    if (2 + topic_length > size - header)
+        return;
+    std::string_view topic((const char *)v + 2, topic_length);
+    uint8_t qos = (packet[0] >> 1) & 3;
+    messages_in++;
+    for (auto &c: clients) {
+        bool match = false;
+        for (auto &f: c.filters)
+            if ((match = topic_matches(f, topic)))
+                break;
+        if (!match)
+            continue;
+        if (c.tx.size() - c.tx_offset > STANDIN_MAX_BACKLOG) {
+            messages_dropped++;
+            continue;
+        }
+        if (qos == 0) {
+            c.tx.insert(c.tx.end(), packet, packet + size);
+        } else {
+            // Deliver at QoS 0: drop the packet id
+            size_t skip = 2 + topic_length;
+            size_t payload = size - header - skip - 2;
+            uint8_t fixed[5] = {(uint8_t)(packet[0] & 0xf1)};
+            size_t n = 1 + put_length(fixed + 1, skip + payload);
+            c.tx.insert(c.tx.end(), fixed, fixed + n);
+            c.tx.insert(c.tx.end(), v, v + skip);
+            c.tx.insert(c.tx.end(), v + skip + 2, v + skip + 2 + payload);
+        }
+        messages_out++;
+    }
+}
+
+// Process everything buffered for one client. Returns false to drop it.
+bool mqtt_standin::handle(size_t index) {
+    size_t offset = 0;
+    while (true) {
+        client &c = clients[index];
+        size_t header;
+        size_t size = packet_size(c.rx.data() + offset, c.rx.size() - offset, header);
+        if (size == SIZE_MAX)
+            return false;
+        if (size == 0 || offset + size > c.rx.size())
+            break;
+        const uint8_t *p = c.rx.data() + offset;
+        switch (p[0] >> 4) {
+            case 1: { // CONNECT
+                const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+                c.tx.insert(c.tx.end(), connack, connack + sizeof(connack));
+                break;
+            }
+            case 3: // PUBLISH
+                route(p, size, header);
+                break;
+            case 8: { // SUBSCRIBE
+                const uint8_t *v = p + header, *end = p + size;
+                std::vector<uint8_t> suback = {0x90, 0, v[0], v[1]};
+                v += 2;
+                while (v + 2 <= end) {
+                    size_t length = (v[0] << 8) | v[1];
+                    if (v + 3 + length > end)
+                        break;
+                    c.filters.emplace_back((const char *)v + 2, length);
+                    subscriptions++;
+                    suback.push_back(0);
+                    v += 3 + length;
+                }
+                suback[1] = (uint8_t)(suback.size() - 2);
+                c.tx.insert(c.tx.end(), suback.begin(), suback.end());
+                break;
+            }
+            case 12: { // PINGREQ
+                const uint8_t pingresp[] = {0xd0, 0x00};
+                c.tx.insert(c.tx.end(), pingresp, pingresp + sizeof(pingresp));
+                break;
+            }
+            case 14: // DISCONNECT
+                return false;
+            default:
+                break;
+        }
+        offset += size;
+    }
+    client &c = clients[index];
+    c.rx.erase(c.rx.begin(), c.rx.begin() + offset);
+    return true;
+}
+
+void mqtt_standin::run() {
+    std::vector<pollfd> fds;
+    uint8_t buffer[65536];
+    while (running) {
+        fds.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (auto &c: clients)
+            fds.push_back({c.fd, (short)(POLLIN | (c.tx.size() > c.tx_offset ? POLLOUT : 0)), 0});
+        if (::poll(fds.data(), fds.size(), 20) <= 0)
+            continue;
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = ::accept(listen_fd, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                clients.push_back({fd, {}, {}, 0, {}});
+            }
+        }
+
+        std::vector<size_t> dead;
+        for (size_t i = 0; i + 1 < fds.size(); i++) {
+            short ev = fds[i + 1].revents;
+            client &c = clients[i];
+            if (ev & (POLLERR | POLLHUP | POLLNVAL)) {
+                dead.push_back(i);
+                continue;
+            }
+            if (ev & POLLIN) {
+                ssize_t n = ::recv(c.fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    dead.push_back(i);
+                    continue;
+                }
+                c.rx.insert(c.rx.end(), buffer, buffer + n);
+                if (!handle(i)) {
+                    dead.push_back(i);
+                    continue;
+                }
+            }
+        }
+        // Flush after routing so one poll round fans out to every subscriber
+        for (size_t i = 0; i < clients.size(); i++) {
+            client &c = clients[i];
+            if (c.tx.size() == c.tx_offset)
+                continue;
+            ssize_t n = ::send(c.fd, c.tx.data() + c.tx_offset, c.tx.size() - c.tx_offset, MSG_NOSIGNAL);
+            if (n > 0)
+                c.tx_offset += n;
+            if (c.tx_offset == c.tx.size()) {
+                c.tx.clear();
+                c.tx_offset = 0;
+            } else if (c.tx_offset > (1u << 20)) {
+                c.tx.erase(c.tx.begin(), c.tx.begin() + c.tx_offset);
+                c.tx_offset = 0;
+            }
+        }
+        for (auto it = dead.rbegin(); it != dead.rend(); ++it) {
+            ::close(clients[*it].fd);
+            clients.erase(clients.begin() + *it);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * mqtt_standin.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * A tiny in-process MQTT 3.1.1 broker standing in for mosquitto when the host
+ * tools are benchmarked on a machine without one. QoS 0, no retained
+ * messages, no authentication; '+' and '#' subscriptions are routed.
+ */
+
+#ifndef MQTT_STANDIN_H_
+#define MQTT_STANDIN_H_
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+
+class mqtt_standin {
+	public:
+		// Port 0 picks a free ephemeral port, see port() after start()
+		explicit mqtt_standin(uint16_t port = 0);
+		~mqtt_standin();
+
+		bool start();
+		void stop();
+		uint16_t port() const { return listen_port; }
+
+		std::atomic<uint64_t> messages_in;
+		std::atomic<uint64_t> messages_out;
+		std::atomic<uint64_t> messages_dropped;  // Subscriber output buffer overflowed
+		std::atomic<uint64_t> subscriptions;     // Topic filters subscribed to
+	private:
+		struct client {
+			int fd;
+			std::vector<uint8_t> rx;
+			std::vector<uint8_t> tx;
+			size_t tx_offset;
+			std::vector<std::string> filters;
+		};
+		int listen_fd;
+		uint16_t listen_port;
+		std::atomic<bool> running;
+		std::thread worker;
+		std::vector<client> clients;
+
+		void run();
+		bool handle(size_t index);
+		void route(const uint8_t *packet, size_t size, size_t header);
+};
+
+#endif /* MQTT_STANDIN_H_ */
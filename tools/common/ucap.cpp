@@ -0,0 +1,251 @@
+/*
+ * ucap.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "ucap.h"
+#include "ut61e_protocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bool ucap_decode(const uint8_t *packet, ut61e_reading_t &r) {
+    r.time_ms = 0;
+    return ES51922::decode(packet, r);
+}
+
+void ucap_index_block(const ucap_block_header &block, const ucap_record *records, uint64_t offset,
+                      ucap_block_index &entry) {
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = offset;
+    entry.count = block.count;
+    entry.first_ms = block.base_ms;
+    entry.last_ms = block.base_ms + (block.count ? records[block.count - 1].delta_ms : 0);
+    for (uint32_t i = 0; i < block.count; i++) {
+        const uint8_t *p = records[i].packet;
+        ut61e_reading_t r;
+        bool valid = ucap_decode(p, r);
+        entry.valid += valid;
+        entry.modes |= 1 << (r.mode & 0x0f);
+        entry.flags |= r.flags;
+        unsigned code = (p[6] & 0x0f) * 8 + (p[0] & 0x07);
+        entry.codes[code >> 6] |= 1ull << (code & 63);
+    }
+}
+
+bool ucap_filter::matches(const ucap_block_index &b) const {
+    if (b.last_ms < from_ms || b.first_ms > to_ms)
+        return false;
+    if (!(b.modes & modes) || (flags && !(b.flags & flags)) || (valid_only && !b.valid))
+        return false;
+    if (function >= 0 || range >= 0) {
+        // Any of the function/range combinations asked for present?
+        bool any = false;
+        for (unsigned f = 0; f < 16 && !any; f++) {
+            if (function >= 0 && (unsigned)(function & 0x0f) != f)
+                continue;
+            for (unsigned r = 0; r < 8 && !any; r++) {
+                unsigned code = f * 8 + r;
+                any = (range < 0 || (unsigned)range == r) && (b.codes[code >> 6] & (1ull << (code & 63)));
+            }
+        }
+        return any;
+    }
+    return true;
+}
+
+bool ucap_filter::matches(const uint8_t *packet, bool valid, const ut61e_reading_t &r) const {
+    return (valid || !valid_only) && (modes & (1 << (r.mode & 0x0f))) && (!flags || (r.flags & flags))
+        && (function < 0 || packet[6] == function) && (range < 0 || (packet[0] & 0x07) == range);
+}
+
+bool ucap_writer::open(const std::string &path, uint32_t records_per_block) {
+    close();
+    if (records_per_block == 0) {
+        error = "block size must be at least one record";
+        return false;
+    }
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    block_records = records_per_block;
+    buffer.clear();
+    buffer.reserve(block_records);
+    index.clear();
+    records = 0;
+    last_ms = INT64_MIN;
+    error.clear();
+    ucap_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, UCAP_MAGIC, 8);
+    h.version = UCAP_VERSION;
+    h.block_records = block_records;
+    h.created_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (fwrite(&h, sizeof(h), 1, file) != 1) {
+        error = "write failed";
+        return false;
+    }
+    return true;
+}
+
+bool ucap_writer::write_block() {
+    if (buffer.empty())
+        return true;
+    block.magic = UCAP_BLOCK_MAGIC;
+    block.count = (uint32_t)buffer.size();
+    ucap_block_index entry;
+    ucap_index_block(block, buffer.data(), (uint64_t)ftello(file), entry);
+    // Fixed size on disk: pad a short block out to block_records
+    buffer.resize(block_records, ucap_record{0, {0}});
+    if (fwrite(&block, sizeof(block), 1, file) != 1
+        || fwrite(buffer.data(), sizeof(ucap_record), block_records, file) != block_records) {
+        error = "write failed";
+        return false;
+    }
+    index.push_back(entry);
+    buffer.clear();
+    return true;
+}
+
+bool ucap_writer::add(int64_t time_ms, const uint8_t packet[12]) {
+    if (!file)
+        return false;
+    if (time_ms < last_ms)
+        time_ms = last_ms;
+    if (!buffer.empty() && (buffer.size() == block_records || time_ms - block.base_ms > UINT32_MAX))
+        if (!write_block())
+            return false;
+    if (buffer.empty())
+        block.base_ms = time_ms;
+    ucap_record record;
+    record.delta_ms = (uint32_t)(time_ms - block.base_ms);
+    memcpy(record.packet, packet, 12);
+    buffer.push_back(record);
+    last_ms = time_ms;
+    records++;
+    return true;
+}
+
+bool ucap_writer::close() {
+    if (!file)
+        return true;
+    bool ok = write_block();
+    ucap_footer footer;
+    memset(&footer, 0, sizeof(footer));
+    memcpy(footer.magic, UCAP_FOOTER_MAGIC, 8);
+    footer.index_offset = (uint64_t)ftello(file);
+    footer.records = records;
+    footer.blocks = (uint32_t)index.size();
+    footer.version = UCAP_VERSION;
+    if (ok && (fwrite(index.data(), sizeof(ucap_block_index), index.size(), file) != index.size()
+               || fwrite(&footer, sizeof(footer), 1, file) != 1)) {
+        error = "write failed";
+        ok = false;
+    }
+    if (fclose(file) != 0 && ok) {
+        error = "close failed";
+        ok = false;
+    }
+    file = nullptr;
+    return ok;
+}
+
+bool ucap_reader::open(const std::string &path) {
+    close();
+    error.clear();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(ucap_header)) {
+        ::close(fd);
+        error = path + ": not a capture file";
+        return false;
+    }
+    void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    map = (const uint8_t *)m;
+    size = st.st_size;
+    // Queries jump around: don't let the kernel read ahead a long way
+    madvise(m, size, MADV_RANDOM);
+    head = (const ucap_header *)map;
+    if (memcmp(head->magic, UCAP_MAGIC, 8) != 0 || head->version != UCAP_VERSION || head->block_records == 0) {
+        error = path + ": not a capture file";
+        close();
+        return false;
+    }
+    uint64_t block_size = sizeof(ucap_block_header) + (uint64_t)head->block_records * sizeof(ucap_record);
+
+    const ucap_footer *footer = (const ucap_footer *)(map + size - sizeof(ucap_footer));
+    if (size >= sizeof(ucap_header) + sizeof(ucap_footer) && !memcmp(footer->magic, UCAP_FOOTER_MAGIC, 8)
+        && footer->index_offset + (uint64_t)footer->blocks * sizeof(ucap_block_index) + sizeof(ucap_footer) == size) {
+        const ucap_block_index *entries = (const ucap_block_index *)(map + footer->index_offset);
+        index.assign(entries, entries + footer->blocks);
+        total = footer->records;
+        for (auto &entry: index) {
+            if (entry.offset + block_size > footer->index_offset || entry.count > head->block_records) {
+                error = path + ": corrupt index";
+                close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // No footer: the writer didn't finish. Rebuild from the block headers.
+    rebuilt = true;
+    for (uint64_t offset = sizeof(ucap_header); offset + block_size <= size; offset += block_size) {
+        const ucap_block_header *block = (const ucap_block_header *)(map + offset);
+        if (block->magic != UCAP_BLOCK_MAGIC || block->count == 0 || block->count > head->block_records)
+            break;
+        ucap_block_index entry;
+        ucap_index_block(*block, (const ucap_record *)(block + 1), offset, entry);
+        index.push_back(entry);
+        total += entry.count;
+    }
+    return true;
+}
+
+void ucap_reader::close() {
+    if (map)
+        munmap((void *)map, size);
+    map = nullptr;
+    head = nullptr;
+    size = 0;
+    index.clear();
+    total = 0;
+    rebuilt = false;
+}
+
+size_t ucap_reader::first_block(int64_t from_ms) const {
+    // Blocks are in time order, so last_ms is too
+    return std::lower_bound(index.begin(), index.end(), from_ms,
+                            [](const ucap_block_index &b, int64_t t) { return b.last_ms < t; }) - index.begin();
+}
+
+uint32_t ucap_reader::first_record(const ucap_block_index &b, int64_t from_ms) const {
+    if (from_ms <= b.first_ms)
+        return 0;
+    const ucap_block_header *block = (const ucap_block_header *)(map + b.offset);
+    const ucap_record *records = (const ucap_record *)(block + 1);
+    uint32_t delta = (uint32_t)(from_ms - block->base_ms);
+    return std::lower_bound(records, records + b.count, delta,
+                            [](const ucap_record &r, uint32_t d) { return r.delta_ms < d; }) - records;
+}
@@ -0,0 +1,212 @@
+/*
+ * ucap.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Indexed capture files (.ucap): timestamped raw packets in fixed-size
+ * blocks, a per-block index and a footer, so a reader can mmap the file
+ * and go straight to the blocks a time range or mode filter needs.
+ *
+ *   header    64 bytes, ucap_header
+ *   blocks    each a ucap_block_header and block_records 16 byte records,
+ *             full size on disk even when the block isn't; records are in
+ *             time order
+ *   index     one ucap_block_index per block
+ *   footer    32 bytes, ucap_footer, at the very end of the file
+ *
+ * Everything is little-endian. A record holds its time as ms after its
+ * block's base time, so a block is also closed early when that no longer
+ * fits 32 bits. A file whose writer never got to close() has no footer; the
+ * reader rebuilds the index from the block headers (losing the block that
+ * was still in memory).
+ */
+
+#ifndef UCAP_H_
+#define UCAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ut61e_reading.h"
+
+#define UCAP_MAGIC          "UT61ECAP"
+#define UCAP_FOOTER_MAGIC   "UT61EIDX"
+#define UCAP_BLOCK_MAGIC    0x4b4c4255   // "UBLK"
+#define UCAP_VERSION        1
+
+struct ucap_header {
+	char magic[8];             // UCAP_MAGIC
+	uint32_t version;
+	uint32_t block_records;    // Records per block
+	int64_t created_ms;        // Wall clock when the writer opened the file
+	uint8_t reserved[40];
+};
+
+struct ucap_block_header {
+	uint32_t magic;            // UCAP_BLOCK_MAGIC
+	uint32_t count;            // Records used
+	int64_t base_ms;           // Time of the first record
+};
+
+struct ucap_record {
+	uint32_t delta_ms;         // After the block's base_ms
+	uint8_t packet[12];        // As received, packet_u_t
+};
+
+struct ucap_block_index {
+	uint64_t offset;           // File offset of the ucap_block_header
+	int64_t first_ms;
+	int64_t last_ms;
+	uint32_t count;
+	uint16_t modes;            // Bit per ut61e_mode_t decoded in the block
+	uint16_t flags;            // UT61E_FLAG_* seen on any record
+	uint64_t codes[2];         // Bit (function & 0x0f) * 8 + (range & 7) per record
+	uint32_t valid;            // Records that decoded cleanly
+	uint8_t reserved[12];
+};
+
+struct ucap_footer {
+	char magic[8];             // UCAP_FOOTER_MAGIC
+	uint64_t index_offset;
+	uint64_t records;
+	uint32_t blocks;
+	uint32_t version;
+};
+
+static_assert(sizeof(ucap_header) == 64 && sizeof(ucap_block_header) == 16 && sizeof(ucap_record) == 16
+              && sizeof(ucap_block_index) == 64 && sizeof(ucap_footer) == 32, "ucap layout");
+
+// What a query wants. Every condition must hold.
+struct ucap_filter {
+	int64_t from_ms = INT64_MIN;     // Inclusive
+	int64_t to_ms = INT64_MAX;       // Inclusive
+	uint16_t modes = 0xffff;         // Bit per ut61e_mode_t
+	uint16_t flags = 0;              // Any one of these flags, 0 = don't care
+	int function = -1;               // Function byte (packet[6]), -1 = any
+	int range = -1;                  // Range code 0-7, -1 = any
+	bool valid_only = true;          // Skip packets that don't decode
+
+	bool matches(const ucap_block_index &b) const;
+	bool matches(const uint8_t *packet, bool valid, const ut61e_reading_t &r) const;
+};
+
+// A record handed to a query callback
+struct ucap_match {
+	int64_t time_ms;
+	const uint8_t *packet;
+	bool valid;
+	ut61e_reading_t reading;         // time_ms is the low 32 bits of the above
+};
+
+class ucap_writer {
+	public:
+		ucap_writer() { }
+		~ucap_writer() { close(); }
+
+		bool open(const std::string &path, uint32_t block_records = 4096);
+		// Records must come in time order; an earlier time is stored as the
+		// previous one.
+		bool add(int64_t time_ms, const uint8_t packet[12]);
+		// Writes the last block, the index and the footer
+		bool close();
+
+		uint64_t records = 0;
+		std::string error;
+	private:
+		FILE *file = nullptr;
+		uint32_t block_records = 0;
+		ucap_block_header block;
+		std::vector<ucap_record> buffer;
+		std::vector<ucap_block_index> index;
+		int64_t last_ms = 0;
+
+		bool write_block();
+};
+
+struct ucap_query_stats {
+	uint64_t blocks_read = 0;        // Blocks whose records were looked at
+	uint64_t blocks_skipped = 0;     // Blocks in the time range the index ruled out
+	uint64_t records_read = 0;
+	uint64_t matches = 0;
+};
+
+class ucap_reader {
+	public:
+		ucap_reader() { }
+		~ucap_reader() { close(); }
+
+		bool open(const std::string &path);
+		void close();
+
+		const ucap_header &header() const { return *head; }
+		const std::vector<ucap_block_index> &blocks() const { return index; }
+		uint64_t records() const { return total; }
+		bool recovered() const { return rebuilt; }   // No footer, index rebuilt
+
+		// Calls fn(const ucap_match &) for every matching record in time
+		// order; fn returns false to stop. Returns the number of matches.
+		template <class F>
+		uint64_t query(const ucap_filter &filter, F fn, ucap_query_stats *stats = nullptr) const;
+
+		std::string error;
+	private:
+		const uint8_t *map = nullptr;
+		size_t size = 0;
+		const ucap_header *head = nullptr;
+		std::vector<ucap_block_index> index;
+		uint64_t total = 0;
+		bool rebuilt = false;
+
+		// First block that can hold a record at or after from_ms
+		size_t first_block(int64_t from_ms) const;
+		// First record in block b at or after from_ms
+		uint32_t first_record(const ucap_block_index &b, int64_t from_ms) const;
+};
+
+// Index entry for a block of records
+void ucap_index_block(const ucap_block_header &block, const ucap_record *records, uint64_t offset,
+                      ucap_block_index &entry);
+// Decode a packet for filtering; false if garbled or unknown
+bool ucap_decode(const uint8_t *packet, ut61e_reading_t &r);
+
+template <class F>
+uint64_t ucap_reader::query(const ucap_filter &filter, F fn, ucap_query_stats *stats) const {
+	ucap_query_stats local;
+	ucap_query_stats &s = stats ? *stats : local;
+	uint64_t matches = 0;
+	for (size_t b = first_block(filter.from_ms); b < index.size(); b++) {
+		const ucap_block_index &entry = index[b];
+		if (entry.first_ms > filter.to_ms)
+			break;
+		if (!filter.matches(entry)) {
+			s.blocks_skipped++;
+			continue;
+		}
+		s.blocks_read++;
+		const ucap_block_header *block = (const ucap_block_header *)(map + entry.offset);
+		const ucap_record *records = (const ucap_record *)(block + 1);
+		for (uint32_t i = first_record(entry, filter.from_ms); i < entry.count; i++) {
+			ucap_match m;
+			m.time_ms = block->base_ms + records[i].delta_ms;
+			if (m.time_ms > filter.to_ms)
+				break;
+			s.records_read++;
+			m.packet = records[i].packet;
+			m.valid = ucap_decode(m.packet, m.reading);
+			if (!filter.matches(m.packet, m.valid, m.reading))
+				continue;
+			m.reading.time_ms = (uint32_t)m.time_ms;
+			matches++;
+			s.matches++;
+			if (!fn(m))
+				return matches;
+		}
+	}
+	return matches;
+}
+
+#endif /* UCAP_H_ */
@@ -0,0 +1,48 @@
+/*
+ * bench.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Benchmarks for the project libraries, one subcommand each.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "capture.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Command line shared by the subcommands:
+//   [capture files...] [-n packets] [-i interval_ms]
+// Without capture files a synthetic stream of -n packets is used.
+struct bench_options {
+	std::vector<std::string> files;
+	size_t packets = 1000000;
+	unsigned interval_ms = 100;
+	std::vector<std::string> extra;   // Anything else, for the subcommand
+};
+
+bool parse_bench_options(int argc, char **argv, bench_options &options);
+// Packets from the capture files, or synthetic ones
+std::vector<packet_t> bench_packets(const bench_options &options);
+
+inline double seconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int bench_batch(const bench_options &options);
+int bench_codec(const bench_options &options);
+int bench_decode(const bench_options &options);
+int bench_duty(const bench_options &options);
+int bench_energy(const bench_options &options);
+int bench_fanout(const bench_options &options);
+int bench_feed(const bench_options &options);
+int bench_oled(const bench_options &options);
+int bench_protocol(const bench_options &options);
+int bench_session(const bench_options &options);
+
+#endif /* BENCH_H_ */
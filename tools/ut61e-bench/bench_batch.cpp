@@ -0,0 +1,135 @@
+/*
+ * bench_batch.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * ut61e_decode_batch() with each instruction set the CPU has: every column
+ * checked against the scalar path and every packet against UT61E_DISP, on
+ * the bench packets and on random ones that exercise every
+ * status and option bit, every function/range code and garbled bytes.
+ */
+
+#include "bench.h"
+#include "ut61e_batch.h"
+#include "ut61e_display.h"
+#include "ut61e_protocol.h"
+#include <cstdio>
+#include <cstring>
+
+static_assert(sizeof(packet_t) == 12, "packet_t arrays must be back to back 12 byte packets");
+
+struct batch_result {
+    std::vector<int32_t> digits;
+    std::vector<double> values;
+    std::vector<int8_t> exponents;
+    std::vector<uint8_t> modes, ranges, valid;
+    std::vector<uint16_t> flags;
+
+    explicit batch_result(size_t n): digits(n), values(n), exponents(n), modes(n), ranges(n), valid(n), flags(n) {}
+    ut61e_batch_columns columns() {
+        return {digits.data(), values.data(), exponents.data(), modes.data(), ranges.data(), flags.data(),
+                valid.data()};
+    }
+    bool operator==(const batch_result &o) const {
+        return digits == o.digits && values == o.values && exponents == o.exponents && modes == o.modes
+            && ranges == o.ranges && valid == o.valid && flags == o.flags;
+    }
+};
+
+// Mostly well formed packets with random fields, some bytes garbled
+static std::vector<packet_t> fuzz_packets(size_t n) {
+    std::vector<packet_t> packets(n);
+    uint32_t seed = 12345;
+    for (auto &p: packets) {
+        for (auto &b: p) {
+            seed = seed * 1103515245 + 12345;
+            b = (seed >> 24) < 2 ? (uint8_t)(seed >> 8) : 0x30 | ((seed >> 16) & 0x0f);
+        }
+    }
+    return packets;
+}
+
+// Against UT61E_DISP, for every packet. The two must agree on which packets
+// are good, except that the batch also rejects unknown function codes,
+// which UT61E_DISP decodes with no mode; those rows must still hold what
+// UT61E_DISP decoded.
+static size_t compare_display(const std::vector<packet_t> &packets, batch_result &r, size_t &unknown_function) {
+    UT61E_DISP dmm;
+    uint8_t count;
+    const ut61e_function_t *table = ES51922::functions(count);
+    size_t mismatches = 0;
+    unknown_function = 0;
+    for (size_t i = 0; i < packets.size(); i++) {
+        bool accepted = dmm.parse(packets[i].data(), false);
+        if (accepted != (bool)r.valid[i]) {
+            if (accepted && !ES51922::find(table, count, ES51922::function_code(packets[i].data())))
+                unknown_function++;
+            else
+                mismatches++;
+        }
+        if (!accepted)
+            continue;
+        ut61e_reading_t expected = dmm.reading;
+        // UT61E_DISP keeps the last AC/DC when the packet has neither or both
+        uint8_t current = packets[i][10] & 0x0c;
+        if (current == 0 || current == 0x0c)
+            expected.flags &= ~(UT61E_FLAG_AC | UT61E_FLAG_DC);
+        if (expected.digits != r.digits[i] || expected.exponent != r.exponents[i] || expected.mode != r.modes[i]
+            || expected.range != r.ranges[i] || expected.flags != r.flags[i]
+            || ut61e_reading_value(expected) != r.values[i])
+            mismatches++;
+    }
+    return mismatches;
+}
+
+static bool run(const char *label, const std::vector<packet_t> &packets) {
+    size_t n = packets.size();
+    const uint8_t *data = packets[0].data();
+    batch_result scalar(n);
+    size_t good = ut61e_decode_batch(data, n, scalar.columns(), UT61E_BATCH_SCALAR);
+    size_t unknown_function, display_mismatches = compare_display(packets, scalar, unknown_function);
+    printf("%-7s: %zu packets, %zu valid, %zu unknown function, against UT61E_DISP: ", label, n, good,
+           unknown_function);
+    if (display_mismatches)
+        printf("%zu MISMATCHES\n", display_mismatches);
+    else
+        printf("identical\n");
+    bool ok = !display_mismatches;
+
+    // Repeat small inputs so each timing covers a decent number of packets
+    size_t rounds = n >= 4000000 ? 1 : 4000000 / n;
+    for (int isa = UT61E_BATCH_SCALAR; isa <= ut61e_batch_best_isa(); isa++) {
+        batch_result r(n);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < rounds; k++)
+            ut61e_decode_batch(data, n, r.columns(), (ut61e_batch_isa_t)isa);
+        double s = seconds_since(start);
+        bool same = r == scalar;
+        ok &= same;
+        printf("  %-6s: %7.2f M packets/s, %s\n", ut61e_batch_isa_name((ut61e_batch_isa_t)isa),
+               n * rounds / s / 1e6, same ? "identical to scalar" : "MISMATCH with scalar");
+    }
+
+    UT61E_DISP dmm;
+    dmm.memoise = false;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < rounds; k++)
+        for (auto &p: packets)
+            dmm.parse(p.data(), false);
+    printf("  %-6s: %7.2f M packets/s\n", "disp", n * rounds / seconds_since(start) / 1e6);
+    return ok;
+}
+
+int bench_batch(const bench_options &options) {
+    std::vector<packet_t> packets = bench_packets(options);
+    if (packets.empty()) {
+        fprintf(stderr, "No packets\n");
+        return 1;
+    }
+    bool ok = run("packets", packets);
+    // Odd length so the scalar tail gets some too
+    ok &= run("fuzz", fuzz_packets(packets.size() | 1));
+    return ok ? 0 : 2;
+}
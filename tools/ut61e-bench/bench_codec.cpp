@@ -0,0 +1,91 @@
+/*
+ * bench_codec.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Compression ratio and speed of ut61e_codec on replayed captures. Packets
+ * are decoded with UT61E_DISP and stamped at the capture cadence with a
+ * little jitter, as millis() would on the device.
+ */
+
+#include "bench.h"
+#include "ut61e_codec.h"
+#include "ut61e_display.h"
+#include <cstdio>
+#include <random>
+
+#define BLOCK_SIZE  4096   // Encode in blocks like a flash/RTC backlog would
+
+int bench_codec(const bench_options &options) {
+    std::vector<packet_t> packets = bench_packets(options);
+    if (packets.empty()) {
+        fprintf(stderr, "No packets\n");
+        return 1;
+    }
+
+    UT61E_DISP dmm;
+    std::vector<ut61e_reading_t> readings;
+    readings.reserve(packets.size());
+    std::mt19937 rng(7);
+    uint32_t t = 0;
+    for (auto &p: packets) {
+        t += options.interval_ms + (rng() % 5) - 2;
+        dmm.parse(p.data(), false);
+        ut61e_reading_t r = dmm.reading;
+        r.time_ms = t;
+        readings.push_back(r);
+    }
+
+    // Encode into fixed size blocks
+    std::vector<std::vector<uint8_t>> blocks;
+    std::vector<uint8_t> block(BLOCK_SIZE);
+    size_t encoded = 0;
+    auto start = std::chrono::steady_clock::now();
+    UT61E_ENCODER encoder(block.data(), block.size());
+    for (auto &r: readings) {
+        if (!encoder.add(r)) {
+            encoder.flush();
+            blocks.emplace_back(encoder.data(), encoder.data() + encoder.size());
+            encoded += encoder.size();
+            encoder.reset();
+            encoder.add(r);
+        }
+    }
+    encoder.flush();
+    blocks.emplace_back(encoder.data(), encoder.data() + encoder.size());
+    encoded += encoder.size();
+    double encode_s = seconds_since(start);
+
+    // Decode and verify
+    size_t index = 0, mismatches = 0;
+    bool corrupt = false;
+    start = std::chrono::steady_clock::now();
+    for (auto &b: blocks) {
+        UT61E_DECODER decoder(b.data(), b.size());
+        ut61e_reading_t r;
+        while (decoder.next(r)) {
+            const ut61e_reading_t &e = readings[index++];
+            if (r.time_ms != e.time_ms || !ut61e_same_reading(r, e))
+                mismatches++;
+        }
+        corrupt |= decoder.error;
+    }
+    double decode_s = seconds_since(start);
+
+    size_t n = readings.size();
+    size_t raw = n * 14, records = n * sizeof(ut61e_reading_t);
+    printf("readings           : %zu (%zu blocks of %d bytes)\n", n, blocks.size(), BLOCK_SIZE);
+    printf("raw frames         : %zu bytes\n", raw);
+    printf("reading records    : %zu bytes\n", records);
+    printf("encoded            : %zu bytes, %.3f bytes/reading\n", encoded, (double)encoded / n);
+    printf("ratio vs raw       : %.1f : 1\n", (double)raw / encoded);
+    printf("ratio vs records   : %.1f : 1\n", (double)records / encoded);
+    printf("encode             : %.1f M readings/s, %.0f MB/s of records\n",
+           n / encode_s / 1e6, records / encode_s / 1e6);
+    printf("decode             : %.1f M readings/s, %.0f MB/s of records\n",
+           n / decode_s / 1e6, records / decode_s / 1e6);
+    printf("round trip         : %s\n", !mismatches && index == n && !corrupt ? "exact" : "MISMATCH");
+    return !mismatches && index == n && !corrupt ? 0 : 2;
+}
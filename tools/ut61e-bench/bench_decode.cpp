@@ -0,0 +1,60 @@
+/*
+ * bench_decode.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * UT61E_DISP decode speed with and without the last-packet memo, and a check
+ * that both give the same results for every packet.
+ */
+
+#include "bench.h"
+#include "ut61e_display.h"
+#include "ut61e_serializer.h"
+#include <cstdio>
+#include <cstring>
+
+int bench_decode(const bench_options &options) {
+    std::vector<packet_t> packets = bench_packets(options);
+    if (packets.empty()) {
+        fprintf(stderr, "No packets\n");
+        return 1;
+    }
+    size_t n = packets.size();
+
+    UT61E_DISP full, memo;
+    full.memoise = false;
+    auto start = std::chrono::steady_clock::now();
+    for (auto &p: packets)
+        full.parse(p.data(), false);
+    double full_s = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (auto &p: packets)
+        memo.parse(p.data(), false);
+    double memo_s = seconds_since(start);
+
+    // Same answers, packet by packet, down to the extended JSON
+    UT61E_DISP a, b;
+    a.memoise = false;
+    UT61E_JSON_SERIALIZER json(true);
+    char ja[512], jb[512];
+    size_t mismatches = 0;
+    for (auto &p: packets) {
+        bool ga = a.parse(p.data(), false), gb = b.parse(p.data(), false);
+        json.write(a, ja, sizeof(ja));
+        json.write(b, jb, sizeof(jb));
+        if (ga != gb || !ut61e_same_reading(a.reading, b.reading) || strcmp(ja, jb) != 0)
+            mismatches++;
+    }
+
+    printf("packets            : %zu\n", n);
+    printf("full decode        : %.2f M packets/s\n", n / full_s / 1e6);
+    printf("memoised           : %.2f M packets/s (%.1fx)\n", n / memo_s / 1e6, full_s / memo_s);
+    printf("hits               : %.1f%%\n", 100.0 * memo.memo_hits / n);
+    printf("partial            : %.1f%% (digits only)\n", 100.0 * memo.memo_partial / n);
+    printf("misses             : %.1f%%\n", 100.0 * memo.memo_misses / n);
+    printf("results            : %s\n", mismatches ? "MISMATCH" : "identical");
+    return mismatches ? 2 : 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * bench_duty.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * The deep sleep schedule (UT61E_DUTY_CYCLE) run wake by wake on the
+ * packet stream, the state going through a stand-in for RTC memory each
+ * time, with some publishes failing. Every reading must be published once,
+ * in order, or counted as dropped; publishes must come at least every Kth
+ * wake and match the radio mode chosen the wake before. Then the energy
+ * model for a few configurations, checked against the timings measured in
+ * the run.
+ */
+
+#include "bench.h"
+#include "ut61e_display.h"
+#include "ut61e_duty_cycle.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define BATCH_BUFFER_SIZE   2048    // As in the firmware
+#define CONNECT_MS          3000    // Radio time of a publish, as ut61e_duty_power
+
+// Publish attempts that fail: now and then, and one long outage
+static bool publish_fails(uint32_t attempt) {
+    return attempt % 7 == 3 || (attempt >= 100 && attempt < 106);
+}
+
+static bool run(const ut61e_duty_config &config, const std::vector<packet_t> &packets, size_t wakes, bool failures) {
+    const ut61e_duty_power power;
+    uint32_t rtc[128] = {};   // RTC user memory, 512 bytes
+    UT61E_DISP dmm;
+    char json[BATCH_BUFFER_SIZE];
+
+    std::vector<uint32_t> captured, published;
+    size_t next_packet = 0, attempts = 0, sent = 0, late = 0, rf_wrong = 0, json_wrong = 0, clock_wrong = 0;
+    uint32_t dropped = 0, clock_ms = 0, since_publish = 0, max_json = 0;
+    bool rf_on = true, ok = true;
+    double measured_uah = 0;
+    size_t measured_n = 0;
+
+    for (size_t w = 0; w < wakes; w++) {
+        UT61E_DUTY_CYCLE duty(config);
+        memcpy(&duty.state, rtc + UT61E_RTC_OFFSET_BLOCKS, sizeof(duty.state));
+        if (duty.begin() != (w > 0)) {
+            printf("  wake %zu: saved state %s\n", w, w ? "rejected" : "accepted before any was saved");
+            return false;
+        }
+        if (duty.state.clock_ms != clock_ms)
+            clock_wrong++;
+        bool publish = duty.publish_due();
+        if (publish && !rf_on)
+            rf_wrong++;
+
+        // The first packet is caught partway, then one every 500 ms.
+        // Polled every 50 ms.
+        uint32_t awake = 0;
+        uint16_t n = 0;
+        while (duty.capturing(awake, n)) {
+            awake += 50;
+            if (awake < 1000 || awake % 500)
+                continue;
+            if (!dmm.parse(packets[next_packet++ % packets.size()].data(), false))
+                continue;
+            duty.add(dmm.reading, awake);
+            captured.push_back(clock_ms + awake);
+            n++;
+        }
+
+        uint32_t radio = 0;
+        if (publish) {
+            if (!failures || !publish_fails(attempts)) {
+                // The timings since the first publish cover whole cycles
+                if (sent++) {
+                    measured_uah += duty.uah_per_reading(power) * duty.state.count;
+                    measured_n += duty.state.count;
+                }
+                size_t length = duty.json(json, sizeof(json), power);
+                size_t items = 0;
+                for (size_t i = 0; i + 1 < length; i++)
+                    items += json[i] == '[' && json[i + 1] != '{';
+                if (length >= sizeof(json) - 1 || items != duty.state.count + 1u)
+                    json_wrong++;
+                if (length > max_json)
+                    max_json = length;
+                for (uint8_t i = 0; i < duty.state.count; i++)
+                    published.push_back(duty.state.readings[i].time_ms);
+                dropped += duty.state.dropped;
+                duty.published();
+            } else {
+                duty.publish_failed();
+            }
+            attempts++;
+            radio = CONNECT_MS;
+            since_publish = 0;
+        } else if (++since_publish >= config.publish_every) {
+            late++;
+        }
+
+        uint32_t sleep_ms = duty.sleep(awake + radio, radio);
+        clock_ms += awake + radio + sleep_ms;
+        rf_on = duty.next_publishes();
+        memcpy(rtc + UT61E_RTC_OFFSET_BLOCKS, &duty.state, sizeof(duty.state));
+        if (w + 1 == wakes) {
+            dropped += duty.state.dropped;
+            for (uint8_t i = 0; i < duty.state.count; i++)
+                published.push_back(duty.state.readings[i].time_ms);
+        }
+    }
+
+    // Published (and still buffered) must be the captured readings in
+    // order, with exactly the dropped ones missing
+    size_t c = 0, skipped = 0, lost = 0;
+    for (uint32_t t: published) {
+        while (c < captured.size() && captured[c] < t) {
+            c++;
+            skipped++;
+        }
+        if (c == captured.size() || captured[c] != t)
+            lost++;
+        else
+            c++;
+    }
+    skipped += captured.size() - c;
+
+    printf("%u packets or %u ms a wake, publish every %u: %zu wakes, %zu readings, %zu publishes tried, "
+           "largest BATCH %u bytes\n", config.packets, (unsigned)config.capture_ms, config.publish_every,
+           wakes, captured.size(), attempts, (unsigned)max_json);
+    auto check = [&](const char *label, size_t got, size_t expected) {
+        bool good = got == expected;
+        printf("  %-40s %8zu, expected %8zu: %s\n", label, got, expected, good ? "ok" : "WRONG");
+        ok &= good;
+    };
+    check("readings not captured or out of order", lost, 0);
+    check("readings missing", skipped, dropped);
+    if (!failures)
+        check("readings dropped", dropped, 0);
+    check("wakes past the Kth without a publish", late, 0);
+    check("publishes with the radio off", rf_wrong, 0);
+    check("wrong clock after sleep", clock_wrong, 0);
+    check("malformed BATCH messages", json_wrong, 0);
+    if (!failures && measured_n) {
+        double estimated = UT61E_DUTY_CYCLE::estimate(config, power).uah_per_reading;
+        double measured = measured_uah / measured_n;
+        bool good = fabs(measured - estimated) <= 0.03 * estimated;
+        printf("  %-40s %8.2f, estimate %8.2f: %s\n", "uAh per reading measured", measured, estimated,
+               good ? "ok" : "WRONG");
+        ok &= good;
+    }
+    return ok;
+}
+
+int bench_duty(const bench_options &options) {
+    std::vector<packet_t> packets = bench_packets(options);
+    if (packets.empty())
+        return 1;
+    bool ok = true;
+
+    // The state must not survive a changed byte anywhere
+    {
+        UT61E_DUTY_CYCLE duty({5, 4000, 60000, 10});
+        duty.begin();
+        ut61e_reading_t r = {};
+        for (int i = 0; i < 20; i++) {
+            r.digits = i * 123;
+            duty.add(r, i * 500);
+        }
+        duty.sleep(10000, 0);
+        ut61e_rtc_state saved = duty.state;
+        size_t accepted = 0;
+        for (size_t i = 0; i < sizeof(saved); i++) {
+            for (uint8_t bit = 1; bit; bit <<= 1) {
+                duty.state = saved;
+                ((uint8_t *)&duty.state)[i] ^= bit;
+                accepted += duty.begin();
+            }
+        }
+        duty.state = saved;
+        bool kept = duty.begin() && duty.state.count == 20 && duty.state.readings[19].digits == 19 * 123;
+        printf("RTC state, %zu bytes: %zu of %zu single bit flips accepted, unchanged state %s\n",
+               sizeof(saved), accepted, sizeof(saved) * 8, kept ? "accepted" : "REJECTED");
+        ok &= accepted == 0 && kept;
+    }
+
+    static const ut61e_duty_config CONFIGS[] = {
+        {5, 4000, 60000, 10},
+        {3, 1000, 10000, 4},    // Capture time runs out first
+        {10, 10000, 30000, 10}, // The buffer fills every 2nd wake
+        {20, 15000, 60000, 3},  // Publishes every wake
+        {1, 2000, 300000, 29},
+    };
+    size_t wakes = options.packets / 10;
+    if (wakes < 200)
+        wakes = 200;
+    if (wakes > 50000)
+        wakes = 50000;
+    auto start = std::chrono::steady_clock::now();
+    for (auto &config: CONFIGS) {
+        ok &= run(config, packets, wakes, false);
+        ok &= run(config, packets, wakes, true);
+    }
+    printf("schedules run in %.2f s\n", seconds_since(start));
+
+    // The model: current of each phase times its share of a publish cycle
+    const ut61e_duty_power power;
+    printf("\nenergy model (awake %.0f mA, radio %.0f mA for %u ms, asleep %.2f mA, boot %u ms)\n",
+           power.awake_ma, power.radio_ma, (unsigned)power.connect_ms, power.sleep_ma, (unsigned)power.boot_ms);
+    printf("  %7s %9s %8s %2s %9s %9s %10s %10s %12s\n", "packets", "capture", "sleep", "K", "awake ms",
+           "cycle s", "avg mA", "uAh/read", "readings/h");
+    for (auto &config: CONFIGS) {
+        ut61e_duty_estimate e = UT61E_DUTY_CYCLE::estimate(config, power);
+        printf("  %7u %9u %8u %2u %9u %9.1f %10.3f %10.2f %12.1f\n", config.packets, (unsigned)config.capture_ms,
+               (unsigned)config.sleep_ms, config.publish_every, (unsigned)e.capture_ms, e.cycle_ms / 1000.0,
+               e.average_ma, e.uah_per_reading, e.readings_per_hour);
+    }
+    printf("%s\n", ok ? "all correct" : "ERRORS");
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,133 @@
+/*
+ * bench_energy.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * UT61E_ENERGY against currents with known integrals: a ramp with jittered
+ * timestamps (exact under the trapezoidal rule), a constant current with a
+ * measured supply, a gap, OL while auto ranging and on a manual range, and
+ * readings that must end a run. Then readings/s.
+ */
+
+#include "bench.h"
+#include "ut61e_energy.h"
+#include <cmath>
+#include <cstdio>
+
+// A DC current reading in 0.1 mA counts
+static ut61e_reading_t current(uint32_t time_ms, double amps, uint16_t flags = UT61E_FLAG_DC | UT61E_FLAG_AUTO) {
+    ut61e_reading_t r = {};
+    r.time_ms = time_ms;
+    r.digits = (int32_t)lround(amps * 1e4);
+    r.exponent = -4;
+    r.mode = UT61E_MODE_CURRENT;
+    r.flags = flags | (r.digits < 0 ? UT61E_FLAG_NEGATIVE : 0);
+    return r;
+}
+
+static bool check(const char *label, double got, double expected, double tolerance) {
+    bool ok = fabs(got - expected) <= tolerance;
+    printf("  %-44s %12.6f, expected %12.6f: %s\n", label, got, expected, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+int bench_energy(const bench_options &options) {
+    bool ok = true;
+    uint32_t seed = 1;
+    auto jitter = [&]() { seed = seed * 1103515245 + 12345; return (seed >> 16) % 41; };   // 0..40 ms
+
+    // Ramp from 0 to 1 A over an hour: 500 mAh. Quantised to 0.1 mA.
+    {
+        UT61E_ENERGY e;
+        e.configure(12.0f, 2000);
+        uint32_t t = 0;
+        while (t <= 3600000) {
+            e.update(current(t, t / 3600000.0));
+            t += 480 + jitter();
+        }
+        double hours = e.covered_ms / 3600000.0;
+        printf("ramp 0..1 A, 12 V configured, %u readings\n", e.samples);
+        ok &= check("mAh", e.charge_mah(), 500.0 * hours * hours, 0.01);
+        ok &= check("Wh", e.energy_wh(), 6.0 * hours * hours, 0.0001);
+    }
+
+    // Measure 5 V, then 2 A for an hour, with a 10 s gap and a range change
+    {
+        UT61E_ENERGY e;
+        e.configure(0, 2000);
+        ut61e_reading_t v = {};
+        v.digits = 50000;
+        v.exponent = -4;
+        v.mode = UT61E_MODE_VOLTAGE;
+        v.flags = UT61E_FLAG_DC | UT61E_FLAG_AUTO;
+        e.update(v);
+        for (uint32_t t = 0; t <= 3600000; t += 500) {
+            if (t > 1000000 && t < 1010000)
+                continue;                                            // Lost readings
+            if (t == 2000000 || t == 2000500)
+                e.update(current(t - 250, 0, UT61E_FLAG_DC | UT61E_FLAG_AUTO | UT61E_FLAG_OVERLOAD));
+            e.update(current(t, 2.0));
+        }
+        printf("2 A, 5 V measured, a 10 s gap, OL while auto ranging\n");
+        ok &= check("mAh", e.charge_mah(), 2000.0 * (3600000 - 10000) / 3600000.0, 1e-6);
+        ok &= check("Wh", e.energy_wh(), 10.0 * (3600000 - 10000) / 3600000.0, 1e-6);
+        ok &= check("gaps", e.gaps, 1, 0);
+        ok &= check("gap s", e.gap_ms / 1000.0, 10.0, 0);
+        ok &= check("range skips", e.range_skips, 2, 0);
+        ok &= check("volts", e.volts(), 5.0, 1e-6);
+    }
+
+    // Manual range: 5 s of OL is left out and counted
+    {
+        UT61E_ENERGY e;
+        e.configure(0, 2000);
+        uint16_t manual = UT61E_FLAG_DC;
+        for (uint32_t t = 0; t <= 60000; t += 500)
+            e.update(current(t, 1.0, manual | (t > 20000 && t < 25000 ? UT61E_FLAG_OVERLOAD : 0)));
+        printf("1 A on a manual range with 5 s of OL, no voltage\n");
+        ok &= check("mAh", e.charge_mah(), 1000.0 * 55000 / 3600000.0, 1e-6);
+        ok &= check("overload s", e.overload_ms / 1000.0, 5.0, 0);
+        ok &= check("Wh", e.energy_wh(), 0, 0);
+    }
+
+    // AC, REL and MAX end the run; the interval either side isn't integrated
+    {
+        UT61E_ENERGY e;
+        e.configure(1.0f, 2000);
+        for (uint32_t t = 0; t <= 10000; t += 500) {
+            uint16_t flags = UT61E_FLAG_DC | UT61E_FLAG_AUTO;
+            if (t == 2000)
+                flags = UT61E_FLAG_AC | UT61E_FLAG_AUTO;
+            else if (t == 5000)
+                flags |= UT61E_FLAG_RELATIVE;
+            else if (t == 8000)
+                flags |= UT61E_FLAG_PEAK_MAX;
+            e.update(current(t, -3.6, flags));
+        }
+        printf("-3.6 A, run ended by AC, REL and MAX readings\n");
+        ok &= check("mAh", e.charge_mah(), -3600.0 * 7 / 3600.0, 1e-6);
+    }
+
+    // Throughput
+    {
+        UT61E_ENERGY e;
+        e.configure(5.0f, 2000);
+        size_t n = options.packets < 1000 ? 1000 : options.packets;
+        std::vector<ut61e_reading_t> readings;
+        readings.reserve(1000);
+        for (uint32_t i = 0; i < 1000; i++)
+            readings.push_back(current(i * 500, (i % 97) / 10.0));
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; i++) {
+            ut61e_reading_t r = readings[i % 1000];
+            r.time_ms = (uint32_t)(i * 500);
+            e.update(r);
+        }
+        double s = seconds_since(start);
+        printf("%zu readings: %.1f M readings/s (%.1f mAh)\n", n, n / s / 1e6, e.charge_mah());
+    }
+    printf("%s\n", ok ? "all correct" : "ERRORS");
+    return ok ? 0 : 2;
+}
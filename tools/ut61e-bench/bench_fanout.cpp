@@ -0,0 +1,198 @@
+/*
+ * bench_fanout.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * The sink fan-out (UT61E_FANOUT) on the packet stream, with a virtual
+ * clock: packets every interval, a step every 10 ms. One sink always
+ * keeps up, one takes three calls a packet, and two stall for seconds at a
+ * time, one with each policy, one of them with a max age. Every sink must
+ * get its packets intact and in order, account for every packet published
+ * (delivered, dropped, expired or still queued), and lose exactly the ones
+ * a plain queue model with its policy does. The fast sinks' lag must not
+ * change when the others stall.
+ */
+
+#include "bench.h"
+#include "ut61e_display.h"
+#include "ut61e_fanout.h"
+#include <cstdio>
+#include <cstring>
+#include <deque>
+
+#define STEP_MS     10
+
+struct sink_check {
+    uint32_t calls = 0;        // In the current entry, for the staged sink
+    int64_t last_seq = -1;
+    size_t received = 0;
+    size_t out_of_order = 0;
+    size_t corrupt = 0;
+    std::vector<uint32_t> seqs;
+};
+
+// What a stalled sink should get, from a std::deque per sink
+struct sink_model {
+    uint8_t depth;
+    ut61e_sink_policy_t policy;
+    uint32_t max_age_ms;
+    bool (*busy)(uint32_t now_ms);
+    std::deque<std::pair<uint32_t, uint32_t>> queue;   // seq, time
+    std::vector<uint32_t> delivered;
+
+    void publish(uint32_t seq, uint32_t now_ms) {
+        if (queue.size() == depth) {
+            if (policy == UT61E_SINK_DROP_NEWEST)
+                return;
+            queue.pop_front();
+        }
+        queue.push_back({seq, now_ms});
+    }
+    void step(uint32_t now_ms) {
+        while (!queue.empty() && max_age_ms && now_ms - queue.front().second > max_age_ms)
+            queue.pop_front();
+        if (queue.empty() || busy(now_ms))
+            return;
+        delivered.push_back(queue.front().first);
+        queue.pop_front();
+    }
+};
+
+static const std::vector<packet_t> *g_packets;
+static uint32_t g_now_ms;
+static sink_check g_checks[4];
+
+static bool stalled(uint32_t now_ms) {
+    return now_ms % 20000 < 6000;   // 6 s in every 20
+}
+
+static bool stalled_later(uint32_t now_ms) {
+    return stalled(now_ms + 10000);  // Out of step with the other
+}
+
+static void receive(sink_check &c, const ut61e_sink_entry &e) {
+    const packet_t &p = (*g_packets)[e.seq % g_packets->size()];
+    if (memcmp(e.packet, p.data(), sizeof(e.packet)))
+        c.corrupt++;
+    if ((int64_t)e.seq <= c.last_seq)
+        c.out_of_order++;
+    c.last_seq = e.seq;
+    c.received++;
+    c.seqs.push_back(e.seq);
+}
+
+static ut61e_sink_result_t fast_sink(const ut61e_sink_entry &e) {
+    receive(g_checks[0], e);
+    return UT61E_SINK_DONE;
+}
+
+static ut61e_sink_result_t staged_sink(const ut61e_sink_entry &e) {
+    if (++g_checks[1].calls < 3)
+        return UT61E_SINK_MORE;
+    g_checks[1].calls = 0;
+    receive(g_checks[1], e);
+    return UT61E_SINK_DONE;
+}
+
+static ut61e_sink_result_t stalled_newest_sink(const ut61e_sink_entry &e) {
+    if (stalled(g_now_ms))
+        return UT61E_SINK_BUSY;
+    receive(g_checks[2], e);
+    return UT61E_SINK_DONE;
+}
+
+static ut61e_sink_result_t stalled_oldest_sink(const ut61e_sink_entry &e) {
+    if (stalled_later(g_now_ms))
+        return UT61E_SINK_BUSY;
+    receive(g_checks[3], e);
+    return UT61E_SINK_DONE;
+}
+
+int bench_fanout(const bench_options &options) {
+    std::vector<packet_t> packets = bench_packets(options);
+    if (packets.empty())
+        return 1;
+    g_packets = &packets;
+    UT61E_DISP dmm;
+    static UT61E_FANOUT fanout;
+    const uint8_t DEPTH = 8;
+    const uint32_t MAX_AGE_MS = 3000;
+    fanout.add("fast", fast_sink, 4, UT61E_SINK_DROP_OLDEST);
+    fanout.add("staged", staged_sink, 4, UT61E_SINK_DROP_OLDEST);
+    fanout.add("newest", stalled_newest_sink, DEPTH, UT61E_SINK_DROP_NEWEST);
+    fanout.add("oldest", stalled_oldest_sink, DEPTH, UT61E_SINK_DROP_OLDEST, MAX_AGE_MS);
+    sink_model models[2] = {{DEPTH, UT61E_SINK_DROP_NEWEST, 0, stalled},
+                            {DEPTH, UT61E_SINK_DROP_OLDEST, MAX_AGE_MS, stalled_later}};
+
+    uint32_t fast_max_lag = 0, fast_max_lag_stalled = 0;
+    size_t steps = 0;
+    auto start = std::chrono::steady_clock::now();
+    g_now_ms = 0;
+    for (size_t i = 0; i < options.packets; i++) {
+        ut61e_sink_entry entry = {};
+        memcpy(entry.packet, packets[i % packets.size()].data(), sizeof(entry.packet));
+        if (dmm.parse(entry.packet, false)) {
+            entry.reading = dmm.reading;
+            entry.flags = UT61E_ENTRY_GOOD;
+        }
+        entry.reading.time_ms = g_now_ms;
+        fanout.publish(entry);
+        for (sink_model &m: models)
+            m.publish(i, g_now_ms);
+        for (uint32_t t = 0; t < options.interval_ms; t += STEP_MS, g_now_ms += STEP_MS) {
+            bool more;
+            do {
+                more = fanout.step(g_now_ms);
+                for (sink_model &m: models)
+                    m.step(g_now_ms);
+                steps++;
+            } while (more);
+            uint32_t lag = fanout.stats(0).max_lag_ms;
+            if (stalled(g_now_ms) || stalled_later(g_now_ms))
+                fast_max_lag_stalled = lag > fast_max_lag_stalled ? lag : fast_max_lag_stalled;
+            else
+                fast_max_lag = lag > fast_max_lag ? lag : fast_max_lag;
+        }
+    }
+    double elapsed = seconds_since(start);
+
+    bool ok = true;
+    printf("%zu packets every %u ms, %zu steps in %.2f s: %.2f M packets/s through 4 sinks\n",
+           options.packets, options.interval_ms, steps, elapsed, options.packets / elapsed / 1e6);
+    printf("  %-8s %9s %9s %9s %7s %7s %10s %6s %7s\n", "sink", "delivered", "dropped", "expired", "queued",
+           "busy", "max lag ms", "order", "corrupt");
+    for (uint8_t id = 0; id < fanout.count(); id++) {
+        const ut61e_sink_stats &s = fanout.stats(id);
+        const sink_check &c = g_checks[id];
+        bool accounted = s.delivered + s.dropped + s.expired + fanout.queued(id) == fanout.published
+                         && c.received == s.delivered;
+        bool good = accounted && c.out_of_order == 0 && c.corrupt == 0;
+        printf("  %-8s %9u %9u %9u %7u %7u %10u %6s %7zu %s\n", fanout.name(id), (unsigned)s.delivered,
+               (unsigned)s.dropped, (unsigned)s.expired, fanout.queued(id), (unsigned)s.busy,
+               (unsigned)s.max_lag_ms, c.out_of_order ? "WRONG" : "ok", c.corrupt,
+               good ? "ok" : (accounted ? "WRONG" : "NOT ACCOUNTED FOR"));
+        ok &= good;
+    }
+
+    // Each policy must lose exactly what the model does
+    auto check = [&](const char *label, size_t got, size_t expected) {
+        bool good = got == expected;
+        printf("  %-52s %8zu, expected %8zu: %s\n", label, got, expected, good ? "ok" : "WRONG");
+        ok &= good;
+    };
+    for (int m = 0; m < 2; m++) {
+        const std::vector<uint32_t> &got = g_checks[2 + m].seqs, &expected = models[m].delivered;
+        size_t differ = got.size() > expected.size() ? got.size() - expected.size() : expected.size() - got.size();
+        for (size_t i = 0; i < got.size() && i < expected.size(); i++)
+            differ += got[i] != expected[i];
+        check(m ? "drop-oldest deliveries unlike the model" : "drop-newest deliveries unlike the model", differ, 0);
+    }
+    check("drop-oldest sink delivered past its max age", fanout.stats(3).max_lag_ms > MAX_AGE_MS, 0);
+    check("fast sink max lag while others stall, above normal (ms)",
+          fast_max_lag_stalled > fast_max_lag ? fast_max_lag_stalled - fast_max_lag : 0, 0);
+    check("staged sink dropped", fanout.stats(1).dropped, 0);
+    printf("%s\n", ok ? "all correct" : "ERRORS");
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,177 @@
+/*
+ * bench_feed.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * The UDP reading feed over loopback multicast: UT61E_FEED_ENCODER
+ * datagrams sent at a fixed rate or as fast as possible, received by
+ * feed_receiver on another thread. Reports one-way latency and loss, and
+ * checks every reading that arrives, that deliberately dropped datagrams
+ * are counted as lost and that swapped ones are counted as late.
+ */
+
+#include "bench.h"
+#include "feed_receiver.h"
+#include "ut61e_protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define FEED_BENCH_DEVICE   0xBE7C4
+#define FEED_BENCH_READINGS 50000    // Per run at most
+
+struct feed_run {
+    const char *name;
+    uint8_t batch;
+    double rate;             // Datagrams/s, 0 = as fast as possible
+    unsigned drop_every;     // Sender skips every nth datagram
+    unsigned swap_every;     // Sender swaps every nth datagram with the next
+};
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool run(const feed_run &r, const std::vector<ut61e_reading_t> &readings) {
+    feed_receiver receiver;
+    if (!receiver.open(FEED_DEFAULT_GROUP, 0, "127.0.0.1")) {
+        fprintf(stderr, "receiver: %s\n", receiver.error.c_str());
+        return false;
+    }
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    in_addr loopback;
+    loopback.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback));
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(receiver.port());
+    inet_pton(AF_INET, FEED_DEFAULT_GROUP, &to.sin_addr);
+
+    size_t datagrams = (readings.size() + r.batch - 1) / r.batch;
+    // Written by this thread, read by the receiver's
+    std::unique_ptr<std::atomic<int64_t>[]> sent_ns(new std::atomic<int64_t>[datagrams]());
+    std::vector<int64_t> latency_ns;
+    latency_ns.reserve(datagrams);
+    std::atomic<bool> sending(true);
+    size_t wrong = 0;
+    std::thread rx([&] {
+        ut61e_reading_t got[UT61E_FEED_MAX_READINGS];
+        ut61e_feed_header h;
+        const feed_source *source;
+        int n;
+        while ((n = receiver.receive(got, h, source, 200)) >= 0 || sending) {
+            if (n < 0)
+                continue;
+            int64_t t = now_ns();
+            if (h.sequence < datagrams && sent_ns[h.sequence])
+                latency_ns.push_back(t - sent_ns[h.sequence]);
+            for (int i = 0; i < n; i++)
+                if (h.first_reading + i >= readings.size()
+                    || memcmp(&got[i], &readings[h.first_reading + i], sizeof(got[i])) != 0)
+                    wrong++;
+        }
+    });
+
+    UT61E_FEED_ENCODER encoder(FEED_BENCH_DEVICE, r.batch);
+    uint8_t held[UT61E_FEED_MAX_SIZE];
+    size_t held_size = 0;
+    uint32_t held_sequence = 0;
+    unsigned dropped = 0, dropped_readings = 0, swapped = 0;
+    int64_t start = now_ns();
+    for (size_t i = 0; i < readings.size(); i++) {
+        if (!encoder.add(readings[i]) && i + 1 < readings.size())
+            continue;
+        uint32_t sequence = encoder.sequence;
+        if (r.rate > 0)
+            while (now_ns() < start + (int64_t)(sequence / r.rate * 1e9))
+                ;
+        const uint8_t *data = encoder.data();
+        bool last = i + 1 == readings.size();
+        if (r.drop_every && sequence % r.drop_every == r.drop_every - 1 && !last) {
+            dropped++;
+            dropped_readings += encoder.pending();
+        } else if (r.swap_every && sequence % r.swap_every == r.swap_every - 1 && !last) {
+            // Hold this one back until the next has gone
+            memcpy(held, data, encoder.size());
+            held_size = encoder.size();
+            held_sequence = sequence;
+        } else {
+            sent_ns[sequence] = now_ns();
+            sendto(fd, data, encoder.size(), 0, (sockaddr *)&to, sizeof(to));
+            if (held_size) {
+                sent_ns[held_sequence] = now_ns();
+                sendto(fd, held, held_size, 0, (sockaddr *)&to, sizeof(to));
+                held_size = 0;
+                swapped++;
+            }
+        }
+        encoder.next();
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    sending = false;
+    rx.join();
+    close(fd);
+
+    const feed_source *s = receiver.sources().empty() ? nullptr : &receiver.sources()[0];
+    uint64_t received = s ? s->readings : 0, lost = s ? s->lost_readings : 0;
+    uint64_t lost_datagrams = s ? s->lost_datagrams : 0, late = s ? s->late : 0;
+    std::sort(latency_ns.begin(), latency_ns.end());
+    auto percentile = [&](double p) {
+        return latency_ns.empty() ? 0.0 : latency_ns[(size_t)(p * (latency_ns.size() - 1))] / 1e3;
+    };
+    // Loss nobody planned is allowed when flooding; what the receiver counts
+    // must still add up, and planned drops and swaps must be seen as such
+    bool ok = !wrong && s && received + lost <= readings.size() && late == swapped;
+    if (r.rate > 0)
+        ok &= lost_datagrams == dropped && lost == dropped_readings
+            && received + lost + (readings.size() - s->next_reading) == readings.size();
+    printf("%-26s: %6.0f k readings/s, %6.0f k datagrams/s, latency p50 %6.1f us p99 %7.1f us max %7.1f us, "
+           "lost %llu/%zu readings (%u dropped), %llu late (%u swapped), %s\n",
+           r.name, readings.size() / seconds / 1e3, datagrams / seconds / 1e3, percentile(0.5), percentile(0.99),
+           percentile(1.0), (unsigned long long)lost, readings.size(), dropped_readings,
+           (unsigned long long)late, swapped, ok ? "OK" : "MISMATCH");
+    return ok;
+}
+
+int bench_feed(const bench_options &options) {
+    bench_options limited = options;
+    limited.packets = std::min<size_t>(options.packets, FEED_BENCH_READINGS);
+    std::vector<packet_t> packets = bench_packets(limited);
+    if (packets.size() > FEED_BENCH_READINGS)
+        packets.resize(FEED_BENCH_READINGS);
+    std::vector<ut61e_reading_t> readings;
+    for (auto &p: packets) {
+        ut61e_reading_t r;
+        if (ES51922::decode(p.data(), r)) {
+            r.time_ms = (uint32_t)(readings.size() * options.interval_ms);
+            readings.push_back(r);
+        }
+    }
+    if (readings.empty()) {
+        fprintf(stderr, "No packets\n");
+        return 1;
+    }
+    static const feed_run RUNS[] = {
+        {"batch 1, 20k/s", 1, 20000, 0, 0},
+        {"batch 8, 5k/s", 8, 5000, 0, 0},
+        {"batch 1, 1 in 50 dropped", 1, 20000, 50, 0},
+        {"batch 4, 1 in 20 swapped", 4, 20000, 0, 20},
+        {"batch 1, flood", 1, 0, 0, 0},
+        {"batch 32, flood", 32, 0, 0, 0},
+    };
+    printf("readings: %zu per run over %s loopback multicast\n", readings.size(), FEED_DEFAULT_GROUP);
+    bool ok = true;
+    for (auto &r: RUNS)
+        ok &= run(r, readings);
+    return ok ? 0 : 2;
+}
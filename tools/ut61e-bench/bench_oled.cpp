@@ -0,0 +1,102 @@
+/*
+ * bench_oled.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * UT61E_OLED on the host framebuffer: after every reading the panel must
+ * match the renderer once flushed, and the incrementally drawn screen must
+ * match one drawn from scratch. Reports what an update costs on the I2C bus
+ * against a full refresh. --screen prints the last screen.
+ */
+
+#include "bench.h"
+#include "ut61e_oled.h"
+#include <cstdio>
+#include <cstring>
+
+#define BYTES_PER_STEP  64      // As OLED_BYTES_PER_STEP in config.h-example
+
+int bench_oled(const bench_options &options) {
+    std::vector<packet_t> packets = bench_packets(options);
+    bool screen = false;
+    for (auto &e: options.extra)
+        screen |= e == "--screen";
+
+    UT61E_DISP dmm;
+    UT61E_OLED_FRAMEBUFFER panel;
+    UT61E_OLED oled(panel);
+    if (!oled.begin()) {
+        fprintf(stderr, "begin() failed\n");
+        return 1;
+    }
+    uint32_t setup_bus_bytes = panel.bus_bytes;
+    panel.bus_bytes = 0;
+    panel.writes = 0;
+
+    size_t readings = 0, panel_mismatches = 0, redraw_mismatches = 0, redraws_checked = 0;
+    size_t steps = 0, max_steps = 0;
+    double render_s = 0, flush_s = 0;
+    for (auto &p: packets) {
+        if (!dmm.parse(p.data(), false))
+            continue;
+        readings++;
+        auto start = std::chrono::steady_clock::now();
+        oled.show(dmm);
+        render_s += seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        size_t n = 0;
+        bool more = true;
+        while (more) {
+            more = oled.flush(BYTES_PER_STEP);
+            n++;
+        }
+        flush_s += seconds_since(start);
+        steps += n;
+        if (n > max_steps)
+            max_steps = n;
+        if (memcmp(panel.memory, oled.frame, sizeof(oled.frame)))
+            panel_mismatches++;
+
+        // From scratch, now and then. Not in HOLD, where the mirror keeps
+        // showing the held value.
+        if ((readings % 97 == 1 || readings < 100) && !(dmm.reading.flags & UT61E_FLAG_HOLD)) {
+            UT61E_OLED_FRAMEBUFFER fresh_panel;
+            UT61E_OLED fresh(fresh_panel);
+            fresh.begin();
+            fresh.show(dmm);
+            redraws_checked++;
+            if (memcmp(fresh.frame, oled.frame, sizeof(oled.frame)))
+                redraw_mismatches++;
+        }
+    }
+    if (!readings) {
+        fprintf(stderr, "No readings\n");
+        return 1;
+    }
+
+    // A full refresh, the way a plain framebuffer driver sends it
+    uint32_t full = UT61E_OLED_PAGES * (UT61E_OLED_WIDTH / UT61E_OLED_CHUNK) * (7 + UT61E_OLED_CHUNK);
+    double bus_per_reading = (double)panel.bus_bytes / readings;
+    printf("%zu readings, %u changed the screen, %u glyphs redrawn (%.2f per update)\n", readings, oled.updates,
+           oled.glyphs_drawn, oled.updates ? (double)oled.glyphs_drawn / oled.updates : 0.0);
+    printf("I2C bytes: %.1f per reading, %.1f per update, full refresh %u (%.1f%%), clear at begin() %u\n",
+           bus_per_reading, oled.updates ? (double)panel.bus_bytes / oled.updates : 0.0, full,
+           100.0 * bus_per_reading / full, setup_bus_bytes);
+    printf("pixel bytes %.1f per reading in %.2f writes; flush steps of %d bytes: %.2f per reading, at most %zu\n",
+           (double)oled.bytes_sent / readings, (double)panel.writes / readings, BYTES_PER_STEP,
+           (double)steps / readings, max_steps);
+    printf("host time: show() %.2f us, flush() %.2f us per reading\n", render_s / readings * 1e6,
+           flush_s / readings * 1e6);
+    printf("panel after flush: %s; incremental against full redraw: %zu checked, %s\n",
+           panel_mismatches ? "MISMATCH" : "identical", redraws_checked,
+           redraw_mismatches ? "MISMATCH" : "identical");
+    if (screen) {
+        static char text[UT61E_OLED_PAGES * 8 * (UT61E_OLED_WIDTH + 1) + 1];
+        panel.ascii(text, sizeof(text));
+        fputs(text, stdout);
+    }
+    return panel_mismatches || redraw_mismatches ? 2 : 0;
+}
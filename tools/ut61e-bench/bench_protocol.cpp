@@ -0,0 +1,131 @@
+/*
+ * bench_protocol.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * The protocol policies through UT61E_FRAMER_T and UT61E_PROTOCOL_DECODER:
+ * ES51922 checked against UT61E_DISP, then every policy encoding the same
+ * readings, framed from a byte stream with junk bytes mixed in, and decoded
+ * back again.
+ */
+
+#include "bench.h"
+#include "ut61e_display.h"
+#include "ut61e_framer.h"
+#include "ut61e_protocol.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Every reading a protocol can carry must come back exactly, range aside
+// (range codes differ between chipsets)
+static bool same_reading(const ut61e_reading_t &a, const ut61e_reading_t &b) {
+    return a.digits == b.digits && a.exponent == b.exponent && a.mode == b.mode && a.flags == b.flags;
+}
+
+// A UT61E reading as a meter with fewer digits would show it
+template <class Protocol>
+static ut61e_reading_t adapt(ut61e_reading_t r) {
+    for (uint8_t d = Protocol::DIGITS; d < ES51922::DIGITS; d++) {
+        r.digits /= 10;
+        r.exponent++;
+    }
+    if (r.digits >= Protocol::COUNTS)
+        r.digits = Protocol::COUNTS - 1;
+    if (r.digits <= -Protocol::COUNTS)
+        r.digits = -(Protocol::COUNTS - 1);
+    r.flags &= Protocol::FLAGS;
+    if (r.digits == 0 && !(r.flags & (UT61E_FLAG_OVERLOAD | UT61E_FLAG_UNDERLOAD)))
+        r.flags &= ~UT61E_FLAG_NEGATIVE;   // No such thing as -0 on the wire
+    r.range = 0;
+    r.time_ms = 0;
+    return r;
+}
+
+template <class Protocol>
+static bool round_trip(const std::vector<ut61e_reading_t> &source) {
+    std::vector<ut61e_reading_t> expected;
+    std::vector<uint8_t> stream;
+    uint8_t frame[Protocol::FRAME_SIZE];
+    uint32_t seed = 1, junk = 0;
+    for (auto &s: source) {
+        ut61e_reading_t r = adapt<Protocol>(s);
+        if (!Protocol::encode(r, frame))
+            continue;
+        expected.push_back(r);
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 97 == 0) {
+            // Line noise between frames; never CR, LF or a valid first byte
+            uint8_t c = (uint8_t)(0x80 | ((seed >> 8) & 0x0f));
+            stream.push_back(c);
+            junk++;
+        }
+        stream.insert(stream.end(), frame, frame + Protocol::FRAME_SIZE);
+    }
+
+    UT61E_FRAMER_T<Protocol> framer;
+    UT61E_PROTOCOL_DECODER<Protocol> decoder;
+    std::vector<ut61e_reading_t> decoded;
+    decoded.reserve(expected.size());
+    auto start = std::chrono::steady_clock::now();
+    for (uint8_t c: stream) {
+        if (framer.push(c)) {
+            ut61e_reading_t r;
+            r.time_ms = 0;
+            decoder.decode(framer.frame(), r);
+            decoded.push_back(r);
+        }
+    }
+    double s = seconds_since(start);
+
+    size_t mismatches = decoded.size() == expected.size() ? 0 : 1;
+    for (size_t i = 0; i < decoded.size() && i < expected.size(); i++)
+        if (!same_reading(decoded[i], expected[i]))
+            mismatches++;
+    bool ok = !mismatches && framer.resync_bytes == junk && !decoder.errors;
+    printf("%-8s: %zu/%zu readings representable, %.1f MB/s, %.2f M frames/s, %.0f%% memo hits, "
+           "%u resync bytes (%u junk), %s\n",
+           Protocol::name(), expected.size(), source.size(), stream.size() / s / 1e6,
+           decoded.size() / s / 1e6, decoded.empty() ? 0.0 : 100.0 * decoder.hits / decoded.size(),
+           framer.resync_bytes, junk, ok ? "round trip OK" : "MISMATCH");
+    return ok;
+}
+
+int bench_protocol(const bench_options &options) {
+    std::vector<packet_t> packets = bench_packets(options);
+    if (packets.empty()) {
+        fprintf(stderr, "No packets\n");
+        return 1;
+    }
+
+    // ES51922 policy against UT61E_DISP, packet by packet
+    UT61E_DISP dmm;
+    std::vector<ut61e_reading_t> readings;
+    readings.reserve(packets.size());
+    size_t mismatches = 0;
+    uint8_t frame[ES51922::FRAME_SIZE] = {0};
+    frame[12] = '\r';
+    frame[13] = '\n';
+    for (auto &p: packets) {
+        memcpy(frame, p.data(), p.size());
+        dmm.parse(p.data(), false);
+        ut61e_reading_t expected = dmm.reading, r;
+        ES51922::decode(frame, r);
+        // UT61E_DISP keeps the last AC/DC when the packet has neither or both
+        uint8_t current = frame[10] & 0x0c;
+        if (current == 0 || current == 0x0c)
+            expected.flags &= ~(UT61E_FLAG_AC | UT61E_FLAG_DC);
+        if (!ut61e_same_reading(r, expected))
+            mismatches++;
+        readings.push_back(r);
+    }
+    printf("packets : %zu\n", packets.size());
+    printf("ES51922 : %s UT61E_DISP\n", mismatches ? "MISMATCH with" : "identical to");
+
+    bool ok = !mismatches;
+    ok &= round_trip<ES51922>(readings);
+    ok &= round_trip<FS9721>(readings);
+    return ok ? 0 : 2;
+}
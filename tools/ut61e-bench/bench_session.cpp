@@ -0,0 +1,276 @@
+/*
+ * bench_session.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * UT61E_SESSION: each kind of session end on a scripted stream, the summary
+ * queue filling up, and the bench packets (synthetic, or capture files)
+ * with the dial turned and REL pressed now and then, checked against a
+ * plain two pass model over the whole stream. Then readings/s.
+ */
+
+#include "bench.h"
+#include "ut61e_display.h"
+#include "ut61e_session.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#define IDLE_GAP_MS   5000
+
+static ut61e_reading_t reading(uint32_t time_ms, int32_t digits, uint8_t mode = UT61E_MODE_VOLTAGE,
+                               uint16_t flags = UT61E_FLAG_DC | UT61E_FLAG_AUTO) {
+    ut61e_reading_t r = {};
+    r.time_ms = time_ms;
+    r.digits = digits;
+    r.exponent = -3;
+    r.mode = mode;
+    r.flags = flags | (digits < 0 ? UT61E_FLAG_NEGATIVE : 0);
+    return r;
+}
+
+static bool check(const char *label, double got, double expected, double tolerance) {
+    bool ok = fabs(got - expected) <= tolerance;
+    printf("  %-44s %12.6g, expected %12.6g: %s\n", label, got, expected, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+static bool check_end(const UT61E_SESSION &s, uint32_t id, uint8_t end, uint32_t count) {
+    bool ok = s.pending() && s.oldest().id == id && s.oldest().end == end && s.oldest().count == count;
+    printf("  session %-3u ends by %-36s %s\n", id, UT61E_SESSION_END_NAMES[end], ok ? "ok" : "WRONG");
+    return ok;
+}
+
+// The model: split where the setting flags, mode or gap change, then
+// summarise each session from its readings
+struct model_session {
+    uint32_t start_ms, end_ms, count, overloads;
+    long double sum;
+    double min, max;
+    uint16_t flags;
+    uint8_t mode, end;
+};
+
+static std::vector<model_session> model(const std::vector<ut61e_reading_t> &readings) {
+    const uint16_t setting = UT61E_FLAG_AC | UT61E_FLAG_DC | UT61E_FLAG_AUTO | UT61E_FLAG_RELATIVE
+                           | UT61E_FLAG_HOLD | UT61E_FLAG_PEAK_MAX | UT61E_FLAG_PEAK_MIN;
+    std::vector<model_session> sessions;
+    for (auto &r: readings) {
+        uint16_t flags = r.flags & setting;
+        model_session *s = sessions.empty() ? nullptr : &sessions.back();
+        if (s) {
+            uint16_t changed = flags ^ s->flags;
+            int end = -1;
+            if (r.mode != s->mode || (changed & (UT61E_FLAG_AC | UT61E_FLAG_DC)))
+                end = UT61E_SESSION_END_FUNCTION;
+            else if (changed & UT61E_FLAG_AUTO)
+                end = UT61E_SESSION_END_RANGE_MODE;
+            else if (changed & UT61E_FLAG_RELATIVE)
+                end = UT61E_SESSION_END_RELATIVE;
+            else if (changed & UT61E_FLAG_HOLD)
+                end = UT61E_SESSION_END_HOLD;
+            else if (changed & (UT61E_FLAG_PEAK_MAX | UT61E_FLAG_PEAK_MIN))
+                end = UT61E_SESSION_END_PEAK;
+            else if (r.time_ms - s->end_ms > IDLE_GAP_MS)
+                end = UT61E_SESSION_END_IDLE;
+            if (end >= 0) {
+                s->end = end;
+                s = nullptr;
+            }
+        }
+        if (!s) {
+            sessions.push_back({r.time_ms, r.time_ms, 0, 0, 0, 0, 0, flags, r.mode, 0});
+            s = &sessions.back();
+        }
+        s->end_ms = r.time_ms;
+        s->count++;
+        if (r.flags & (UT61E_FLAG_OVERLOAD | UT61E_FLAG_UNDERLOAD)) {
+            s->overloads++;
+            continue;
+        }
+        double v = ut61e_reading_value(r);
+        uint32_t values = s->count - s->overloads;
+        if (values == 1 || v < s->min)
+            s->min = v;
+        if (values == 1 || v > s->max)
+            s->max = v;
+        s->sum += v;
+    }
+    return sessions;
+}
+
+int bench_session(const bench_options &options) {
+    bool ok = true;
+
+    // Every kind of end, in turn
+    {
+        UT61E_SESSION s;
+        s.configure(IDLE_GAP_MS);
+        uint32_t t = 0;
+        printf("scripted stream, idle gap %d ms\n", IDLE_GAP_MS);
+        for (int i = 1; i <= 10; i++)
+            s.update(reading(t += 500, i * 1000));
+        // OL doesn't end the session
+        s.update(reading(t += 500, 0, UT61E_MODE_VOLTAGE, UT61E_FLAG_DC | UT61E_FLAG_AUTO | UT61E_FLAG_OVERLOAD));
+        ok &= check("open session", s.id(), 1, 0);
+        s.update(reading(t += 500, 5, UT61E_MODE_VOLTAGE, UT61E_FLAG_AC | UT61E_FLAG_AUTO));
+        ok &= check_end(s, 1, UT61E_SESSION_END_FUNCTION, 11);
+        const ut61e_session_summary &first = s.oldest();
+        ok &= check("min", first.min, 1.0, 0);
+        ok &= check("max", first.max, 10.0, 0);
+        ok &= check("mean", first.mean, 5.5, 1e-12);
+        ok &= check("overloads", first.overloads, 1, 0);
+        ok &= check("duration s", (first.end_ms - first.start_ms) / 1000.0, 5.0, 0);
+        char json[512];
+        size_t length = UT61E_SESSION::json(first, json, sizeof(json));
+        printf("  %.*s\n", (int)length, json);
+        s.pop();
+
+        s.update(reading(t += 500, 5, UT61E_MODE_VOLTAGE, UT61E_FLAG_AC));
+        ok &= check_end(s, 2, UT61E_SESSION_END_RANGE_MODE, 1);
+        s.pop();
+        // A manual range step doesn't end it either
+        ut61e_reading_t step = reading(t += 500, 50, UT61E_MODE_VOLTAGE, UT61E_FLAG_AC);
+        step.range = 4;
+        s.update(step);
+        s.update(reading(t += 500, 5, UT61E_MODE_VOLTAGE, UT61E_FLAG_AC | UT61E_FLAG_RELATIVE));
+        ok &= check_end(s, 3, UT61E_SESSION_END_RELATIVE, 2);
+        s.pop();
+        s.update(reading(t += 500, 5, UT61E_MODE_VOLTAGE, UT61E_FLAG_AC | UT61E_FLAG_RELATIVE | UT61E_FLAG_HOLD));
+        ok &= check_end(s, 4, UT61E_SESSION_END_HOLD, 1);
+        s.pop();
+        s.update(reading(t += 500, 5, UT61E_MODE_VOLTAGE, UT61E_FLAG_AC | UT61E_FLAG_PEAK_MAX));
+        ok &= check_end(s, 5, UT61E_SESSION_END_RELATIVE, 1);   // Several changes: the first in the list
+        s.pop();
+        s.update(reading(t += 500, 5, UT61E_MODE_CURRENT, UT61E_FLAG_AC | UT61E_FLAG_PEAK_MAX));
+        ok &= check_end(s, 6, UT61E_SESSION_END_FUNCTION, 1);
+        s.pop();
+        s.update(reading(t += 500, 5, UT61E_MODE_CURRENT, UT61E_FLAG_AC | UT61E_FLAG_PEAK_MIN));
+        ok &= check_end(s, 7, UT61E_SESSION_END_PEAK, 1);
+        s.pop();
+        s.update(reading(t += IDLE_GAP_MS + 1, 5, UT61E_MODE_CURRENT, UT61E_FLAG_AC | UT61E_FLAG_PEAK_MIN));
+        ok &= check_end(s, 8, UT61E_SESSION_END_IDLE, 1);
+        s.pop();
+        // Waiting for the gap closes it without another reading
+        s.idle(t + IDLE_GAP_MS);
+        ok &= check("still open at the gap", s.id(), 9, 0);
+        s.idle(t + IDLE_GAP_MS + 1);
+        ok &= check_end(s, 9, UT61E_SESSION_END_IDLE, 1);
+        s.pop();
+        ok &= check("open after idle", s.id(), 0, 0);
+        // Only OL: no min, max or mean
+        s.update(reading(t += 100, 0, UT61E_MODE_RESISTANCE, UT61E_FLAG_AUTO | UT61E_FLAG_OVERLOAD));
+        s.idle(t + IDLE_GAP_MS + 1);
+        length = UT61E_SESSION::json(s.oldest(), json, sizeof(json));
+        bool nulls = strstr(json, "\"min\":null,\"max\":null,\"mean\":null") != nullptr;
+        printf("  all OL gives null statistics                 %s\n", nulls ? "ok" : "WRONG");
+        ok &= nulls;
+        s.pop();
+
+        // The summary queue keeps the newest
+        for (int i = 0; i < UT61E_SESSION_PENDING + 2; i++)
+            s.update(reading(t += 500, i, UT61E_MODE_VOLTAGE + i % 2));
+        s.idle(t + IDLE_GAP_MS + 1);
+        printf("queue of %d, %d sessions unpublished\n", UT61E_SESSION_PENDING, UT61E_SESSION_PENDING + 2);
+        ok &= check("lost", s.lost, 2, 0);
+        ok &= check("oldest kept", s.oldest().id, 13, 0);
+        ok &= check("sessions", s.sessions, 16, 0);
+
+        // "session" goes in before the closing brace, or not at all
+        char object[32] = "{\"value\":1}";
+        length = UT61E_SESSION::append_json(object, strlen(object), sizeof(object), 42);
+        bool appended = !strcmp(object, "{\"value\":1,\"session\":42}") && length == strlen(object);
+        length = UT61E_SESSION::append_json(object, strlen(object), strlen(object) + 4, 43);
+        appended &= !strcmp(object, "{\"value\":1,\"session\":42}") && length == strlen(object);
+        printf("  append_json                                  %s\n", appended ? "ok" : "WRONG");
+        ok &= appended;
+    }
+
+    // The bench packets with the dial turned, REL pressed and the meter
+    // left now and then
+    std::vector<packet_t> packets = bench_packets(options);
+    if (packets.empty()) {
+        fprintf(stderr, "No packets\n");
+        return 1;
+    }
+    UT61E_DISP dmm;
+    std::vector<ut61e_reading_t> readings;
+    readings.reserve(packets.size());
+    std::mt19937 rng(11);
+    uint32_t t = 0;
+    uint8_t mode_shift = 0;
+    uint16_t extra = 0;
+    for (auto &p: packets) {
+        t += options.interval_ms;
+        if (!dmm.parse(p.data(), false))
+            continue;
+        switch (rng() % 2000) {
+            case 0: mode_shift = (mode_shift + 1) % 3; break;
+            case 1: extra ^= UT61E_FLAG_RELATIVE; break;
+            case 2: extra ^= UT61E_FLAG_HOLD; break;
+            case 3: t += IDLE_GAP_MS + rng() % 10000; break;
+        }
+        ut61e_reading_t r = dmm.reading;
+        r.time_ms = t;
+        r.mode = 1 + (r.mode - 1 + mode_shift) % (UT61E_MODE_COUNT - 1);
+        r.flags |= extra;
+        readings.push_back(r);
+    }
+    std::vector<model_session> expected = model(readings);
+    UT61E_SESSION s;
+    s.configure(IDLE_GAP_MS);
+    std::vector<ut61e_session_summary> got;
+    auto start = std::chrono::steady_clock::now();
+    for (auto &r: readings) {
+        s.update(r);
+        while (s.pending()) {
+            got.push_back(s.oldest());
+            s.pop();
+        }
+    }
+    double elapsed = seconds_since(start);
+    s.idle(t + IDLE_GAP_MS + 1);
+    if (s.pending())
+        got.push_back(s.oldest());
+    size_t wrong = 0;
+    double worst_mean = 0;
+    for (size_t i = 0; i < got.size() && i < expected.size(); i++) {
+        const ut61e_session_summary &g = got[i];
+        const model_session &e = expected[i];
+        uint32_t values = e.count - e.overloads;
+        double mean = values ? (double)(e.sum / values) : 0;
+        double scale = fabs(mean) > 1 ? fabs(mean) : 1;
+        if (values)
+            worst_mean = fmax(worst_mean, fabs(g.mean - mean) / scale);
+        if (g.id != i + 1 || g.start_ms != e.start_ms || g.end_ms != e.end_ms || g.count != e.count
+            || g.overloads != e.overloads || g.mode != e.mode || g.flags != e.flags
+            || (i + 1 < expected.size() && g.end != e.end)
+            || (values && (g.min != e.min || g.max != e.max || fabs(g.mean - mean) > 1e-9 * scale)))
+            wrong++;
+    }
+    printf("%zu readings, %zu sessions\n", readings.size(), expected.size());
+    ok &= check("sessions", got.size(), expected.size(), 0);
+    ok &= check("summaries unlike the model", wrong, 0, 0);
+    printf("  worst relative error in a mean: %.3g\n", worst_mean);
+
+    // Throughput: a session per mode change, once a second or so
+    size_t n = options.packets < readings.size() ? readings.size() : options.packets;
+    UT61E_SESSION timed;
+    timed.configure(IDLE_GAP_MS);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++) {
+        ut61e_reading_t r = readings[i % readings.size()];
+        r.time_ms = (uint32_t)(i * options.interval_ms);
+        timed.update(r);
+        if (timed.pending())
+            timed.pop();
+    }
+    double timed_s = seconds_since(start);
+    printf("%zu readings: %.1f M readings/s in the model check, %.1f M readings/s (%u sessions)\n",
+           n, readings.size() / elapsed / 1e6, n / timed_s / 1e6, timed.sessions);
+    printf("%s\n", ok ? "all correct" : "ERRORS");
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,82 @@
+/*
+ * main.cpp - ut61e-bench
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ *   ut61e-bench <subcommand> [capture files...] [-n packets] [-i interval_ms]
+ */
+
+#include "bench.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const struct {
+    const char *name;
+    int (*run)(const bench_options &);
+    const char *help;
+} SUBCOMMANDS[] = {
+    {"batch", bench_batch, "SIMD batch decoder against scalar and UT61E_DISP, packets/s"},
+    {"codec", bench_codec, "reading stream compression ratio and encode/decode speed"},
+    {"decode", bench_decode, "UT61E_DISP speed with and without the last-packet memo"},
+    {"duty", bench_duty, "deep sleep schedule: readings kept across wakes and publishes, energy model"},
+    {"energy", bench_energy, "charge/energy integrator against known integrals, readings/s"},
+    {"fanout", bench_fanout, "sink fan-out: per-sink queues and policies checked, packets/s"},
+    {"feed", bench_feed, "UDP reading feed over loopback multicast: latency, loss detection"},
+    {"oled", bench_oled, "OLED mirror: dirty-region updates checked, I2C bytes per update"},
+    {"protocol", bench_protocol, "protocol policies: framing and decode speed, round-trip checks"},
+    {"session", bench_session, "measurement sessions: every end checked, summaries against a model"},
+};
+
+bool parse_bench_options(int argc, char **argv, bench_options &options) {
+    for (int i = 0; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "-n") && i + 1 < argc)
+            options.packets = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "-i") && i + 1 < argc)
+            options.interval_ms = (unsigned)atoi(argv[++i]);
+        else if (a[0] == '-')
+            options.extra.push_back(a);
+        else
+            options.files.push_back(a);
+    }
+    return true;
+}
+
+std::vector<packet_t> bench_packets(const bench_options &options) {
+    std::vector<packet_t> packets;
+    for (auto &f: options.files)
+        if (!load_packets(f, packets))
+            fprintf(stderr, "Can't read %s\n", f.c_str());
+    if (options.files.empty()) {
+        synthetic_meter meter;
+        packets.reserve(options.packets);
+        for (size_t i = 0; i < options.packets; i++)
+            packets.push_back(meter.next_packet());
+    }
+    return packets;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: ut61e-bench <subcommand> [capture files...] [-n packets] [-i interval_ms]\n");
+    for (auto &s: SUBCOMMANDS)
+        fprintf(stderr, "  %-10s %s\n", s.name, s.help);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    for (auto &s: SUBCOMMANDS) {
+        if (!strcmp(argv[1], s.name)) {
+            bench_options options;
+            parse_bench_options(argc - 2, argv + 2, options);
+            return s.run(options);
+        }
+    }
+    usage();
+    return 1;
+}
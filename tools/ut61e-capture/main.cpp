@@ -0,0 +1,386 @@
+/*
+ * main.cpp - ut61e-capture
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Indexed capture files (ucap.h): pack raw captures into one, show its
+ * index, and query it by time, mode, flags, function and range.
+ *
+ *   ut61e-capture pack -o out.ucap [-b block_records] [-i interval_ms]
+ *                      [--start time] [--synthetic packets] [files...]
+ *   ut61e-capture info file.ucap
+ *   ut61e-capture query file.ucap [--from time] [--to time] [--mode m[,m]]
+ *                       [--flag f[,f]] [--function code] [--range n] [--all]
+ *                       [--count]
+ *   ut61e-capture bench [--synthetic packets] [-b block_records]
+ *
+ * Raw captures carry no timestamps, so pack spaces packets -i ms apart from
+ * --start (default: now). Times are ms since the epoch or local
+ * "YYYY-MM-DD[ HH:MM[:SS]]". bench packs a synthetic capture into a
+ * temporary file and checks indexed queries against a full scan.
+ */
+
+#include "ucap.h"
+#include "capture.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static const struct {
+    const char *name;
+    uint16_t flag;
+} FLAG_NAMES[] = {
+    {"negative", UT61E_FLAG_NEGATIVE}, {"rel", UT61E_FLAG_RELATIVE}, {"hold", UT61E_FLAG_HOLD},
+    {"battery", UT61E_FLAG_BATTERY_LOW}, {"auto", UT61E_FLAG_AUTO}, {"OL", UT61E_FLAG_OVERLOAD},
+    {"UL", UT61E_FLAG_UNDERLOAD}, {"max", UT61E_FLAG_PEAK_MAX}, {"min", UT61E_FLAG_PEAK_MIN},
+    {"AC", UT61E_FLAG_AC}, {"DC", UT61E_FLAG_DC},
+};
+
+static void usage() {
+    fprintf(stderr,
+        "usage: ut61e-capture pack -o out.ucap [-b block_records] [-i interval_ms]\n"
+        "                          [--start time] [--synthetic packets] [files...]\n"
+        "       ut61e-capture info file.ucap\n"
+        "       ut61e-capture query file.ucap [--from time] [--to time] [--mode m[,m]]\n"
+        "                           [--flag f[,f]] [--function code] [--range n] [--all] [--count]\n"
+        "       ut61e-capture bench [--synthetic packets] [-b block_records]\n"
+        "times: ms since the epoch or local YYYY-MM-DD[ HH:MM[:SS]]\n"
+        "flags:");
+    for (auto &f: FLAG_NAMES)
+        fprintf(stderr, " %s", f.name);
+    fprintf(stderr, "\n");
+}
+
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static bool parse_time(const char *s, int64_t &ms) {
+    char *end;
+    long long n = strtoll(s, &end, 10);
+    if (*end == 0 && end != s) {
+        ms = n;
+        return true;
+    }
+    static const char *const formats[] = {"%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M",
+                                          "%Y-%m-%dT%H:%M", "%Y-%m-%d"};
+    for (auto f: formats) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        const char *rest = strptime(s, f, &tm);
+        if (rest && *rest == 0) {
+            tm.tm_isdst = -1;
+            ms = (int64_t)mktime(&tm) * 1000;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Comma separated names into a bit mask
+static bool parse_modes(const char *s, uint16_t &modes) {
+    modes = 0;
+    while (*s) {
+        const char *comma = strchr(s, ',');
+        size_t length = comma ? (size_t)(comma - s) : strlen(s);
+        ut61e_mode_t mode = ut61e_mode_code(s, length);
+        if (mode == UT61E_MODE_UNKNOWN)
+            return false;
+        modes |= 1 << mode;
+        s += length + (comma ? 1 : 0);
+    }
+    return modes != 0;
+}
+
+static bool parse_flags(const char *s, uint16_t &flags) {
+    flags = 0;
+    while (*s) {
+        const char *comma = strchr(s, ',');
+        size_t length = comma ? (size_t)(comma - s) : strlen(s);
+        bool found = false;
+        for (auto &f: FLAG_NAMES) {
+            if (strlen(f.name) == length && !strncasecmp(f.name, s, length)) {
+                flags |= f.flag;
+                found = true;
+            }
+        }
+        if (!found)
+            return false;
+        s += length + (comma ? 1 : 0);
+    }
+    return flags != 0;
+}
+
+static bool pack(const char *output, const std::vector<const char *> &files, size_t synthetic,
+                 uint32_t block_records, unsigned interval_ms, int64_t start_ms, uint64_t &records) {
+    ucap_writer writer;
+    if (!writer.open(output, block_records)) {
+        fprintf(stderr, "%s\n", writer.error.c_str());
+        return false;
+    }
+    int64_t t = start_ms;
+    synthetic_meter meter;
+    for (size_t i = 0; i < synthetic; i++, t += interval_ms)
+        writer.add(t, meter.next_packet().data());
+    for (auto f: files) {
+        std::vector<packet_t> packets;
+        if (!load_packets(f, packets)) {
+            perror(f);
+            return false;
+        }
+        for (auto &p: packets) {
+            writer.add(t, p.data());
+            t += interval_ms;
+        }
+    }
+    records = writer.records;
+    if (!writer.close()) {
+        fprintf(stderr, "%s: %s\n", output, writer.error.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void print_time(int64_t ms, char *out, size_t size) {
+    time_t s = (time_t)(ms / 1000);
+    struct tm tm;
+    localtime_r(&s, &tm);
+    size_t n = strftime(out, size, "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(out + n, size - n, ".%03d", (int)(ms % 1000));
+}
+
+static int info(const char *path) {
+    ucap_reader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "%s\n", reader.error.c_str());
+        return 1;
+    }
+    const auto &blocks = reader.blocks();
+    uint64_t valid = 0;
+    uint16_t modes = 0, flags = 0;
+    for (auto &b: blocks) {
+        valid += b.valid;
+        modes |= b.modes;
+        flags |= b.flags;
+    }
+    char first[40] = "-", last[40] = "-";
+    if (!blocks.empty()) {
+        print_time(blocks.front().first_ms, first, sizeof(first));
+        print_time(blocks.back().last_ms, last, sizeof(last));
+    }
+    printf("records  : %llu (%llu valid)%s\n", (unsigned long long)reader.records(), (unsigned long long)valid,
+           reader.recovered() ? ", no footer: index rebuilt" : "");
+    printf("blocks   : %zu of %u records\n", blocks.size(), reader.header().block_records);
+    printf("time     : %s to %s\n", first, last);
+    printf("modes    :");
+    for (int m = 1; m < UT61E_MODE_COUNT; m++)
+        if (modes & (1 << m))
+            printf(" %s", UT61E_MODE_NAMES[m]);
+    printf("\nflags    :");
+    for (auto &f: FLAG_NAMES)
+        if (flags & f.flag)
+            printf(" %s", f.name);
+    printf("\n");
+    return 0;
+}
+
+static int query(const char *path, const ucap_filter &filter, bool count_only) {
+    ucap_reader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "%s\n", reader.error.c_str());
+        return 1;
+    }
+    ucap_query_stats stats;
+    if (!count_only)
+        printf("time_ms,value,unit,mode,range,flags,packet\n");
+    reader.query(filter, [&](const ucap_match &m) {
+        if (!count_only)
+            printf("%lld,%.10g,%s,%s,%u,%u,%.12s\n", (long long)m.time_ms, ut61e_reading_value(m.reading),
+                   UT61E_UNIT_NAMES[ut61e_mode_unit(m.reading.mode)], UT61E_MODE_NAMES[m.reading.mode],
+                   m.reading.range, m.reading.flags, (const char *)m.packet);
+        return true;
+    }, &stats);
+    if (count_only)
+        printf("%llu\n", (unsigned long long)stats.matches);
+    fprintf(stderr, "%llu matches, %llu records read, %llu blocks read, %llu skipped by the index, %zu in file\n",
+            (unsigned long long)stats.matches, (unsigned long long)stats.records_read,
+            (unsigned long long)stats.blocks_read, (unsigned long long)stats.blocks_skipped,
+            reader.blocks().size());
+    return 0;
+}
+
+// Indexed queries against a scan of every record with the same filter
+static int bench(size_t synthetic, uint32_t block_records) {
+    char path[] = "/tmp/ut61e-capture-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    const int64_t start_ms = 1790000000000;   // Spacing 500 ms
+    uint64_t records;
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = pack(path, {}, synthetic, block_records, 500, start_ms, records);
+    double pack_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    ucap_reader reader;
+    if (!ok || !reader.open(path)) {
+        fprintf(stderr, "%s\n", reader.error.c_str());
+        unlink(path);
+        return 1;
+    }
+    printf("pack     : %llu records, %zu blocks, %.1f M records/s\n", (unsigned long long)records,
+           reader.blocks().size(), records / pack_s / 1e6);
+
+    int64_t span = (int64_t)records * 500;
+    struct {
+        const char *name;
+        ucap_filter filter;
+    } queries[6];
+    queries[0].name = "1% time window";
+    queries[0].filter.from_ms = start_ms + span / 2;
+    queries[0].filter.to_ms = start_ms + span / 2 + span / 100;
+    queries[1].name = "capacitance";
+    queries[1].filter.modes = 1 << UT61E_MODE_CAPACITANCE;
+    queries[2].name = "overloads";
+    queries[2].filter.flags = UT61E_FLAG_OVERLOAD;
+    queries[3].name = "10% window, resistance range 6";
+    queries[3].filter.from_ms = start_ms + span / 4;
+    queries[3].filter.to_ms = start_ms + span / 4 + span / 10;
+    queries[3].filter.function = 0x33;
+    queries[3].filter.range = 6;
+    queries[4].name = "AC in 10% window";
+    queries[4].filter = queries[3].filter;
+    queries[4].filter.function = queries[4].filter.range = -1;
+    queries[4].filter.flags = UT61E_FLAG_AC;
+    queries[5].name = "everything";
+
+    for (auto &q: queries) {
+        ucap_query_stats stats;
+        t0 = std::chrono::steady_clock::now();
+        uint64_t sum = 0;
+        reader.query(q.filter, [&](const ucap_match &m) { sum += m.time_ms; return true; }, &stats);
+        double indexed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        ucap_filter all;
+        all.valid_only = false;
+        uint64_t scan_matches = 0, scan_sum = 0;
+        t0 = std::chrono::steady_clock::now();
+        reader.query(all, [&](const ucap_match &m) {
+            if (m.time_ms >= q.filter.from_ms && m.time_ms <= q.filter.to_ms
+                && q.filter.matches(m.packet, m.valid, m.reading)) {
+                scan_matches++;
+                scan_sum += m.time_ms;
+            }
+            return true;
+        });
+        double scan_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        bool same = scan_matches == stats.matches && scan_sum == sum;
+        ok &= same;
+        printf("%-31s: %8llu matches, %5llu blocks read, %5llu skipped, %8.2f ms (scan %.2f ms), %s\n", q.name,
+               (unsigned long long)stats.matches, (unsigned long long)stats.blocks_read,
+               (unsigned long long)stats.blocks_skipped, indexed_s * 1e3, scan_s * 1e3,
+               same ? "same as scan" : "MISMATCH with scan");
+    }
+
+    // Lose the footer and index as if the writer had been killed
+    size_t blocks = reader.blocks().size();
+    uint64_t truncate_at = reader.blocks().back().offset + sizeof(ucap_block_header)
+        + (uint64_t)block_records * sizeof(ucap_record);
+    reader.close();
+    if (truncate(path, truncate_at) == 0 && reader.open(path)) {
+        bool same = reader.recovered() && reader.blocks().size() == blocks && reader.records() == records;
+        ok &= same;
+        printf("recovery : %zu blocks rebuilt without the footer, %s\n", reader.blocks().size(),
+               same ? "OK" : "MISMATCH");
+    }
+    unlink(path);
+    return ok ? 0 : 2;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    const char *command = argv[1];
+    const char *output = nullptr;
+    std::vector<const char *> files;
+    size_t synthetic = 0;
+    uint32_t block_records = 4096;
+    unsigned interval_ms = 500;
+    int64_t start_ms = now_ms();
+    ucap_filter filter;
+    bool count_only = false;
+    for (int i = 2; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if (!strcmp(a, "-o") && has_arg) {
+            output = argv[++i];
+        } else if (!strcmp(a, "-b") && has_arg) {
+            block_records = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(a, "-i") && has_arg) {
+            interval_ms = (unsigned)atoi(argv[++i]);
+        } else if (!strcmp(a, "--synthetic") && has_arg) {
+            synthetic = (size_t)atof(argv[++i]);
+        } else if ((!strcmp(a, "--start") || !strcmp(a, "--from") || !strcmp(a, "--to")) && has_arg) {
+            int64_t t;
+            if (!parse_time(argv[++i], t)) {
+                fprintf(stderr, "bad time: %s\n", argv[i]);
+                return 1;
+            }
+            (a[2] == 's' ? start_ms : a[2] == 'f' ? filter.from_ms : filter.to_ms) = t;
+        } else if (!strcmp(a, "--mode") && has_arg) {
+            if (!parse_modes(argv[++i], filter.modes)) {
+                fprintf(stderr, "bad mode: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(a, "--flag") && has_arg) {
+            if (!parse_flags(argv[++i], filter.flags)) {
+                fprintf(stderr, "bad flag: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(a, "--function") && has_arg) {
+            filter.function = (int)strtol(argv[++i], nullptr, 0);
+        } else if (!strcmp(a, "--range") && has_arg) {
+            filter.range = atoi(argv[++i]);
+        } else if (!strcmp(a, "--all")) {
+            filter.valid_only = false;
+        } else if (!strcmp(a, "--count")) {
+            count_only = true;
+        } else if (a[0] != '-') {
+            files.push_back(a);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!strcmp(command, "pack")) {
+        if (!output || (files.empty() && !synthetic)) {
+            usage();
+            return 1;
+        }
+        uint64_t records;
+        if (!pack(output, files, synthetic, block_records, interval_ms, start_ms, records))
+            return 1;
+        fprintf(stderr, "%llu records\n", (unsigned long long)records);
+        return 0;
+    }
+    if (!strcmp(command, "info") && files.size() == 1)
+        return info(files[0]);
+    if (!strcmp(command, "query") && files.size() == 1)
+        return query(files[0], filter, count_only);
+    if (!strcmp(command, "bench"))
+        return bench(synthetic ? synthetic : 2000000, block_records);
+    usage();
+    return 1;
+}
@@ -0,0 +1,166 @@
+/*
+ * collector.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "collector.h"
+#include <chrono>
+#include <functional>
+#include <time.h>
+
+#define BATCH_MESSAGES  256    // Hand a batch over once it holds this many messages
+
+static int64_t thread_cpu_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+collector::collector(const std::string &r, unsigned workers, int f):root(r),fsync_ms(f) {
+    if (workers == 0)
+        workers = 1;
+    for (unsigned i = 0; i < workers; i++) {
+        shards.emplace_back(new shard);
+        shard &s = *shards.back();
+        s.thread = std::thread(&collector::run, this, std::ref(s));
+    }
+}
+
+collector::~collector() {
+    stop();
+}
+
+void collector::submit(std::string_view topic, std::string_view payload, int64_t time_ns) {
+    std::string_view device, base_id;
+    if (!split_topic(topic, device, base_id))
+        return;
+    shard &s = *shards[std::hash<std::string_view>()(base_id) % shards.size()];
+    batch &b = s.filling;
+    message m;
+    m.topic_offset = (uint32_t)b.arena.size();
+    m.topic_length = (uint32_t)topic.size();
+    b.arena.append(topic);
+    m.payload_offset = (uint32_t)b.arena.size();
+    m.payload_length = (uint32_t)payload.size();
+    b.arena.append(payload);
+    m.time_ns = time_ns;
+    b.messages.push_back(m);
+    if (b.messages.size() >= BATCH_MESSAGES)
+        hand_off(s);
+}
+
+void collector::hand_off(shard &s) {
+    if (s.filling.messages.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> guard(s.lock);
+        if (s.queued.messages.empty()) {
+            std::swap(s.queued, s.filling);
+        } else {
+            // Worker is behind: append rather than block the receive thread
+            uint32_t base = (uint32_t)s.queued.arena.size();
+            s.queued.arena.append(s.filling.arena);
+            for (message m: s.filling.messages) {
+                m.topic_offset += base;
+                m.payload_offset += base;
+                s.queued.messages.push_back(m);
+            }
+        }
+    }
+    s.filling.arena.clear();
+    s.filling.messages.clear();
+    s.ready.notify_one();
+}
+
+void collector::kick() {
+    for (auto &s: shards)
+        hand_off(*s);
+}
+
+void collector::process(shard &s, const batch &b) {
+    for (const message &m: b.messages) {
+        std::string_view topic(b.arena.data() + m.topic_offset, m.topic_length);
+        std::string_view payload(b.arena.data() + m.payload_offset, m.payload_length);
+        std::string_view device, base_id;
+        reading_row row;
+        if (!split_topic(topic, device, base_id) || !parse_reading(payload, row)) {
+            s.rejected++;
+            continue;
+        }
+        row.time_ns = m.time_ns;
+        auto it = s.devices.find(device);
+        if (it == s.devices.end())
+            it = s.devices.emplace(std::string(device),
+                                   std::unique_ptr<column_store>(new column_store(root, device))).first;
+        if (!it->second->ok()) {
+            s.rejected++;
+            continue;
+        }
+        it->second->append(row);
+        s.rows++;
+    }
+}
+
+void collector::run(shard &s) {
+    using clock = std::chrono::steady_clock;
+    auto next_sync = clock::now() + std::chrono::milliseconds(fsync_ms);
+    batch work;
+    bool stopping = false;
+    while (!stopping) {
+        {
+            std::unique_lock<std::mutex> guard(s.lock);
+            s.ready.wait_until(guard, next_sync, [&] { return s.stopping || !s.queued.messages.empty(); });
+            std::swap(work, s.queued);
+            stopping = s.stopping;
+        }
+        int64_t start = thread_cpu_ns();
+        process(s, work);
+        work.arena.clear();
+        work.messages.clear();
+        if (stopping || clock::now() >= next_sync) {
+            for (auto &d: s.devices)
+                d.second->fsync();
+            next_sync = clock::now() + std::chrono::milliseconds(fsync_ms);
+        }
+        s.cpu_ns += thread_cpu_ns() - start;
+    }
+    s.devices.clear();
+}
+
+void collector::stop() {
+    for (auto &s: shards) {
+        if (!s->thread.joinable())
+            continue;
+        hand_off(*s);
+        {
+            std::lock_guard<std::mutex> guard(s->lock);
+            s->stopping = true;
+        }
+        s->ready.notify_one();
+        s->thread.join();
+    }
+}
+
+uint64_t collector::rows() const {
+    uint64_t n = 0;
+    for (auto &s: shards)
+        n += s->rows;
+    return n;
+}
+
+uint64_t collector::rejected() const {
+    uint64_t n = 0;
+    for (auto &s: shards)
+        n += s->rejected;
+    return n;
+}
+
+double collector::worker_cpu_seconds() const {
+    uint64_t n = 0;
+    for (auto &s: shards)
+        n += s->cpu_ns;
+    return n / 1e9;
+}
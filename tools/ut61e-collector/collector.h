@@ -0,0 +1,76 @@
+/*
+ * collector.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Shards incoming messages across worker threads by device id. The receive
+ * thread only copies each message into the owning worker's current batch;
+ * parsing and column appends happen on the worker, so both topics of a
+ * device always land on the same thread and need no locking.
+ */
+
+#ifndef COLLECTOR_H_
+#define COLLECTOR_H_
+
+#include "column_store.h"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class collector {
+	public:
+		collector(const std::string &root, unsigned workers, int fsync_ms);
+		~collector();
+
+		// Receive thread side. Views are copied before returning.
+		void submit(std::string_view topic, std::string_view payload, int64_t time_ns);
+		// Hand partially filled batches to the workers (call when idle)
+		void kick();
+		// Drain all queues, flush and fsync every device, stop the workers
+		void stop();
+
+		uint64_t rows() const;
+		uint64_t rejected() const;
+		double worker_cpu_seconds() const;
+		unsigned workers() const { return (unsigned)shards.size(); }
+	private:
+		struct message {
+			uint32_t topic_offset, topic_length;
+			uint32_t payload_offset, payload_length;
+			int64_t time_ns;
+		};
+		struct batch {
+			std::string arena;
+			std::vector<message> messages;
+		};
+		struct shard {
+			std::mutex lock;
+			std::condition_variable ready;
+			batch filling;       // Owned by the receive thread
+			batch queued;        // Guarded by lock
+			bool stopping = false;
+			std::thread thread;
+			// Transparent, so a topic's device finds its store without a copy
+			std::map<std::string, std::unique_ptr<column_store>, std::less<>> devices;
+			std::atomic<uint64_t> rows{0};
+			std::atomic<uint64_t> rejected{0};
+			std::atomic<uint64_t> cpu_ns{0};
+		};
+
+		std::string root;
+		int fsync_ms;
+		std::vector<std::unique_ptr<shard>> shards;
+
+		void hand_off(shard &s);
+		void run(shard &s);
+		void process(shard &s, const batch &b);
+};
+
+#endif /* COLLECTOR_H_ */
@@ -0,0 +1,130 @@
+/*
+ * column_store.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "column_store.h"
+#include "ut61e_reading.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char *const COLUMN_FILES[] = {
+    "time.i64", "value.f64", "display_value.f64", "unit.u8", "mode.u8", "flags.u16"
+};
+
+static bool write_all(int fd, const void *data, size_t length) {
+    const char *p = (const char *)data;
+    while (length) {
+        ssize_t n = ::write(fd, p, length);
+        if (n <= 0)
+            return false;
+        p += n;
+        length -= n;
+    }
+    return true;
+}
+
+column_store::column_store(const std::string &root, std::string_view device, size_t block)
+    :rows(0),block_rows(block),dirty(false) {
+    for (int &fd: fds)
+        fd = -1;
+    std::string dir = root + "/" + std::string(device);
+    if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+        return;
+
+    // Describe the codes once so the files can be read without this source
+    std::string schema = dir + "/schema.txt";
+    if (access(schema.c_str(), F_OK) != 0) {
+        FILE *f = fopen(schema.c_str(), "w");
+        if (f) {
+            fprintf(f, "# ut61e-collector columns, little-endian, one row per message\n");
+            for (auto name: COLUMN_FILES)
+                fprintf(f, "column %s\n", name);
+            for (int i = 0; i < UT61E_MODE_COUNT; i++)
+                fprintf(f, "mode %d %s\n", i, UT61E_MODE_NAMES[i]);
+            for (int i = 0; i < UT61E_UNIT_COUNT; i++)
+                fprintf(f, "unit %d %s\n", i, UT61E_UNIT_NAMES[i]);
+            fprintf(f, "flag 0x%04x negative\nflag 0x%04x relative\nflag 0x%04x hold\n"
+                       "flag 0x%04x battery_low\nflag 0x%04x auto\nflag 0x%04x overload\n"
+                       "flag 0x%04x underload\nflag 0x%04x peak_max\nflag 0x%04x peak_min\n"
+                       "flag 0x%04x ac\nflag 0x%04x dc\n",
+                    UT61E_FLAG_NEGATIVE, UT61E_FLAG_RELATIVE, UT61E_FLAG_HOLD,
+                    UT61E_FLAG_BATTERY_LOW, UT61E_FLAG_AUTO, UT61E_FLAG_OVERLOAD,
+                    UT61E_FLAG_UNDERLOAD, UT61E_FLAG_PEAK_MAX, UT61E_FLAG_PEAK_MIN,
+                    UT61E_FLAG_AC, UT61E_FLAG_DC);
+            fclose(f);
+        }
+    }
+
+    for (int i = 0; i < COL_COUNT; i++) {
+        std::string path = dir + "/" + COLUMN_FILES[i];
+        fds[i] = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fds[i] < 0) {
+            for (int j = 0; j < i; j++) {
+                ::close(fds[j]);
+                fds[j] = -1;
+            }
+            return;
+        }
+    }
+    time.reserve(block_rows);
+    value.reserve(block_rows);
+    display_value.reserve(block_rows);
+    unit.reserve(block_rows);
+    mode.reserve(block_rows);
+    flags.reserve(block_rows);
+}
+
+column_store::~column_store() {
+    fsync();
+    for (int fd: fds)
+        if (fd >= 0)
+            ::close(fd);
+}
+
+void column_store::append(const reading_row &row) {
+    time.push_back(row.time_ns);
+    value.push_back(row.value);
+    display_value.push_back(row.display_value);
+    unit.push_back(row.unit);
+    mode.push_back(row.mode);
+    flags.push_back(row.flags);
+    rows++;
+    if (time.size() >= block_rows)
+        flush();
+}
+
+bool column_store::flush() {
+    if (time.empty() || !ok())
+        return true;
+    bool good = write_all(fds[COL_TIME], time.data(), time.size() * sizeof(int64_t))
+        && write_all(fds[COL_VALUE], value.data(), value.size() * sizeof(double))
+        && write_all(fds[COL_DISPLAY], display_value.data(), display_value.size() * sizeof(double))
+        && write_all(fds[COL_UNIT], unit.data(), unit.size())
+        && write_all(fds[COL_MODE], mode.data(), mode.size())
+        && write_all(fds[COL_FLAGS], flags.data(), flags.size() * sizeof(uint16_t));
+    time.clear();
+    value.clear();
+    display_value.clear();
+    unit.clear();
+    mode.clear();
+    flags.clear();
+    dirty = true;
+    return good;
+}
+
+bool column_store::fsync() {
+    bool good = flush();
+    if (!dirty || !ok())
+        return good;
+    for (int fd: fds)
+        good = (::fdatasync(fd) == 0) && good;
+    dirty = false;
+    return good;
+}
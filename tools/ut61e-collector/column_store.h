@@ -0,0 +1,51 @@
+/*
+ * column_store.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Append-only columnar storage for one device. Each field of reading_row gets
+ * its own file of fixed width little-endian values under <root>/<device>/:
+ *
+ *   time.i64  value.f64  display_value.f64  unit.u8  mode.u8  flags.u16
+ *
+ * Row n is at offset n * width in every file, so a file can be memory mapped
+ * and scanned on its own. Rows are buffered and written in blocks; fsync()
+ * makes everything written so far durable.
+ */
+
+#ifndef COLUMN_STORE_H_
+#define COLUMN_STORE_H_
+
+#include "reading_parser.h"
+#include <string>
+#include <vector>
+
+class column_store {
+	public:
+		column_store(const std::string &root, std::string_view device, size_t block_rows = 4096);
+		~column_store();
+		column_store(const column_store &) = delete;
+		column_store &operator=(const column_store &) = delete;
+
+		bool ok() const { return fds[0] >= 0; }
+		void append(const reading_row &row);
+		bool flush();   // Write out buffered rows
+		bool fsync();   // flush() then make it durable
+
+		uint64_t rows;  // Rows appended since opening
+	private:
+		enum { COL_TIME, COL_VALUE, COL_DISPLAY, COL_UNIT, COL_MODE, COL_FLAGS, COL_COUNT };
+		int fds[COL_COUNT];
+		size_t block_rows;
+		bool dirty;
+		std::vector<int64_t> time;
+		std::vector<double> value;
+		std::vector<double> display_value;
+		std::vector<uint8_t> unit;
+		std::vector<uint8_t> mode;
+		std::vector<uint16_t> flags;
+};
+
+#endif /* COLUMN_STORE_H_ */
@@ -0,0 +1,326 @@
+/*
+ * main.cpp - ut61e-collector
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Subscribes to the decoded reading topics of any number of UT61E WiFi
+ * interfaces and appends every reading to per-device columnar files.
+ *
+ *   ut61e-collector [-h host] [-p port] [-u user] [-P pass] [-o dir]
+ *                   [-w workers] [-s fsync_ms] [-t topic]...
+ *   ut61e-collector --bench [messages] [devices] [-w workers]
+ *
+ * --bench starts an in-process broker stand-in on loopback, publishes
+ * synthetic messages through it, and reports messages/sec overall and per
+ * core of worker CPU time. It then restarts the broker to check the
+ * collector reconnects, and reads one device's files back to check them.
+ */
+
+#include "collector.h"
+#include "mqtt_lite.h"
+#include "mqtt_standin.h"
+#include "ut61e_reading.h"
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static std::atomic<bool> g_running(true);
+
+static void on_signal(int) {
+    g_running = false;
+}
+
+static int64_t wall_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void usage() {
+    fprintf(stderr,
+        "usage: ut61e-collector [-h host] [-p port] [-u user] [-P pass] [-o dir]\n"
+        "                       [-w workers] [-s fsync_ms] [-t topic]...\n"
+        "       ut61e-collector --bench [messages] [devices] [-w workers]\n");
+}
+
+#define RECONNECT_MIN_MS    250    // First wait after a lost or refused connection
+#define RECONNECT_MAX_MS  30000    // Doubling up to this
+
+// Sleep for up to ms, waking early if told to stop
+static void wait_running(int ms, const std::atomic<bool> &running) {
+    for (int waited = 0; waited < ms && running; waited += 50)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+// Drive a collector from an MQTT connection until told to stop. A refused or
+// lost connection is retried with exponential backoff, subscribing again
+// each time.
+static void collect(collector &c, const char *host, uint16_t port, const char *user,
+                    const char *pass, const std::vector<std::string> &topics,
+                    const std::atomic<bool> &running) {
+    char client_id[32];
+    snprintf(client_id, sizeof(client_id), "ut61e-collector-%d", getpid());
+    int backoff_ms = RECONNECT_MIN_MS;
+    while (running) {
+        mqtt_lite mqtt;
+        bool subscribed = mqtt.connect(host, port, client_id, user, pass);
+        if (subscribed) {
+            mqtt.on_message([&](std::string_view topic, std::string_view payload) {
+                c.submit(topic, payload, wall_ns());
+            });
+            for (auto &t: topics)
+                subscribed = subscribed && mqtt.subscribe(t.c_str());
+        }
+        if (!subscribed) {
+            fprintf(stderr, "Can't connect to MQTT broker %s:%u, retrying in %d ms\n", host, port, backoff_ms);
+            c.kick();
+            wait_running(backoff_ms, running);
+            backoff_ms = backoff_ms * 2 < RECONNECT_MAX_MS ? backoff_ms * 2 : RECONNECT_MAX_MS;
+            continue;
+        }
+        backoff_ms = RECONNECT_MIN_MS;
+        while (running) {
+            int n = mqtt.poll(50);
+            if (n < 0) {
+                fprintf(stderr, "MQTT connection lost, reconnecting\n");
+                break;
+            }
+            if (n == 0)
+                c.kick();
+        }
+    }
+}
+
+// Delete a directory and everything under it
+static void remove_tree(const char *dir) {
+    nftw(dir, [](const char *path, const struct stat *, int, struct FTW *) { return remove(path); },
+         16, FTW_DEPTH | FTW_PHYS);
+}
+
+// The bench's i-th message, the value it carries and the topic it goes to
+static double bench_value(uint64_t i) {
+    return 1.2345 + (i % 100) * 1e-4;
+}
+
+static int bench_message(uint64_t i, char *payload, size_t size) {
+    double v = bench_value(i);
+    return snprintf(payload, size,
+        "{\"value\":%.4f,\"unit\":\"V\",\"display_value\":%.4f,\"display_unit\":\"V\","
+        "\"display_string\":\"%.4f\",\"mode\":\"voltage\",\"currentType\":\"DC\",\"peak\":\"\","
+        "\"relative\":\"0\",\"hold\":\"0\",\"range\":\"auto\",\"operation\":\"normal\","
+        "\"battery_low\":\"0\",\"negative\":false}", v, v, v);
+}
+
+static std::string bench_device(unsigned d) {
+    char id[16];
+    snprintf(id, sizeof(id), "%06X%s", 0xA00000 + d / 2, d & 1 ? "_x" : "");
+    return id;
+}
+
+static bool bench_publish(mqtt_lite &publisher, uint64_t from, uint64_t to, unsigned devices) {
+    std::vector<std::string> device_topics;
+    for (unsigned d = 0; d < devices; d++)
+        device_topics.push_back("tele/" + bench_device(d) + "/JSON");
+    char payload[512];
+    for (uint64_t i = from; i < to; i++) {
+        int n = bench_message(i, payload, sizeof(payload));
+        if (!publisher.publish(device_topics[i % devices], std::string_view(payload, n)))
+            return false;
+    }
+    return true;
+}
+
+// Wait until the collector has stored or rejected n messages
+static bool bench_drain(collector &c, mqtt_standin &broker, uint64_t n) {
+    int64_t deadline = mqtt_codec::now_ms() + 30000;
+    while (c.rows() + c.rejected() + broker.messages_dropped < n) {
+        if (mqtt_codec::now_ms() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+template <class T>
+static std::vector<T> read_column(const std::string &path) {
+    std::vector<T> column;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return column;
+    T v;
+    while (fread(&v, sizeof(v), 1, f) == 1)
+        column.push_back(v);
+    fclose(f);
+    return column;
+}
+
+// Read the first device's column files back and check every row against
+// the message it came from
+static bool bench_check(const char *dir, uint64_t messages, unsigned devices) {
+    std::string base = std::string(dir) + "/" + bench_device(0) + "/";
+    auto time = read_column<int64_t>(base + "time.i64");
+    auto value = read_column<double>(base + "value.f64");
+    auto display_value = read_column<double>(base + "display_value.f64");
+    auto unit = read_column<uint8_t>(base + "unit.u8");
+    auto mode = read_column<uint8_t>(base + "mode.u8");
+    auto flags = read_column<uint16_t>(base + "flags.u16");
+    size_t rows = (messages + devices - 1) / devices;
+    size_t mismatches = 0;
+    if (time.size() != rows || value.size() != rows || display_value.size() != rows || unit.size() != rows
+        || mode.size() != rows || flags.size() != rows) {
+        printf("read back          : %s has %zu rows, expected %zu\n", bench_device(0).c_str(), time.size(), rows);
+        return false;
+    }
+    for (size_t k = 0; k < rows; k++) {
+        char text[16];
+        snprintf(text, sizeof(text), "%.4f", bench_value(k * devices));
+        double v = strtod(text, nullptr);
+        if (value[k] != v || display_value[k] != v || unit[k] != UT61E_UNIT_VOLT || mode[k] != UT61E_MODE_VOLTAGE
+            || flags[k] != (UT61E_FLAG_DC | UT61E_FLAG_AUTO) || (k && time[k] < time[k - 1]))
+            mismatches++;
+    }
+    printf("read back          : %s, %zu rows, %s\n", bench_device(0).c_str(), rows,
+           mismatches ? "MISMATCH" : "every column as published");
+    return !mismatches;
+}
+
+static int bench(uint64_t messages, unsigned devices, unsigned workers) {
+    mqtt_standin broker;
+    if (!broker.start()) {
+        fprintf(stderr, "Can't start broker stand-in\n");
+        return 1;
+    }
+    char dir[] = "/tmp/ut61e-collector-bench-XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    printf("Broker stand-in on 127.0.0.1:%u, writing to %s\n", broker.port(), dir);
+
+    collector c(dir, workers, 1000);
+    std::atomic<bool> running(true);
+    std::vector<std::string> topics = {"tele/+/JSON", "tele/+_x/JSON"};
+    std::thread receiver([&] { collect(c, "127.0.0.1", broker.port(), nullptr, nullptr, topics, running); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    mqtt_lite publisher;
+    if (!publisher.connect("127.0.0.1", broker.port(), "ut61e-collector-bench")) {
+        fprintf(stderr, "Bench publisher can't connect\n");
+        running = false;
+        receiver.join();
+        c.stop();
+        remove_tree(dir);
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    bench_publish(publisher, 0, messages, devices);
+    bench_drain(c, broker, messages);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t rows = c.rows();
+
+    // Restart the broker: the collector has to reconnect and subscribe
+    // again before another message per device can arrive
+    uint64_t subscriptions = broker.subscriptions;
+    broker.stop();
+    bool reconnected = broker.start();
+    int64_t deadline = mqtt_codec::now_ms() + 10000;
+    while (reconnected && broker.subscriptions < subscriptions + topics.size()) {
+        reconnected = mqtt_codec::now_ms() < deadline;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    mqtt_lite again;
+    reconnected = reconnected && again.connect("127.0.0.1", broker.port(), "ut61e-collector-bench")
+        && bench_publish(again, messages, messages + devices, devices)
+        && bench_drain(c, broker, messages + devices) && c.rows() == messages + devices;
+
+    running = false;
+    receiver.join();
+    c.stop();
+    double cpu = c.worker_cpu_seconds();
+
+    printf("messages published : %llu to %u device topics\n", (unsigned long long)messages, devices);
+    printf("rows written       : %llu (rejected %llu, broker dropped %llu)\n",
+           (unsigned long long)rows, (unsigned long long)c.rejected(),
+           (unsigned long long)broker.messages_dropped.load());
+    printf("end to end         : %.0f msg/s over %.3f s\n", rows / seconds, seconds);
+    printf("workers            : %u, %.3f CPU s\n", c.workers(), cpu);
+    printf("per core           : %.0f msg/s/core (parse + columnar append + fsync)\n",
+           cpu > 0 ? rows / cpu : 0.0);
+    printf("broker restart     : %s\n", reconnected ? "reconnected, resubscribed" : "FAILED");
+    bool ok = rows == messages && reconnected && bench_check(dir, messages + devices, devices);
+    broker.stop();
+    remove_tree(dir);
+    return ok ? 0 : 2;
+}
+
+int main(int argc, char **argv) {
+    const char *host = "127.0.0.1", *user = nullptr, *pass = nullptr, *out = "ut61e-data";
+    uint16_t port = 1883;
+    unsigned workers = std::thread::hardware_concurrency();
+    int fsync_ms = 1000;
+    std::vector<std::string> topics;
+    bool bench_mode = false;
+    std::vector<const char *> positional;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if (!strcmp(a, "--bench"))
+            bench_mode = true;
+        else if (!strcmp(a, "-h") && has_arg)
+            host = argv[++i];
+        else if (!strcmp(a, "-p") && has_arg)
+            port = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "-u") && has_arg)
+            user = argv[++i];
+        else if (!strcmp(a, "-P") && has_arg)
+            pass = argv[++i];
+        else if (!strcmp(a, "-o") && has_arg)
+            out = argv[++i];
+        else if (!strcmp(a, "-w") && has_arg)
+            workers = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "-s") && has_arg)
+            fsync_ms = atoi(argv[++i]);
+        else if (!strcmp(a, "-t") && has_arg)
+            topics.push_back(argv[++i]);
+        else if (a[0] != '-')
+            positional.push_back(a);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (bench_mode) {
+        uint64_t messages = positional.size() > 0 ? strtoull(positional[0], nullptr, 10) : 1000000;
+        unsigned devices = positional.size() > 1 ? (unsigned)atoi(positional[1]) : 64;
+        return bench(messages, devices ? devices : 1, workers);
+    }
+
+    if (topics.empty())
+        topics = {"tele/+/JSON", "tele/+_x/JSON"};
+    if (mkdir(out, 0755) < 0 && errno != EEXIST) {
+        perror(out);
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    collector c(out, workers, fsync_ms);
+    collect(c, host, port, user, pass, topics, g_running);
+    c.stop();
+    fprintf(stderr, "%llu rows written, %llu messages rejected\n",
+            (unsigned long long)c.rows(), (unsigned long long)c.rejected());
+    return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * reading_parser.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "reading_parser.h"
+#include "ut61e_reading.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct cursor {
+    const char *p;
+    const char *end;
+
+    void skip_ws() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            p++;
+    }
+    bool take(char c) {
+        skip_ws();
+        if (p < end && *p == c) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+    // Returns the raw string contents; the firmware never escapes anything
+    // but we still step over escapes correctly.
+    bool string(std::string_view &out) {
+        skip_ws();
+        if (p >= end || *p != '"')
+            return false;
+        const char *start = ++p;
+        while (p < end && *p != '"') {
+            if (*p == '\\')
+                p++;
+            p++;
+        }
+        if (p >= end)
+            return false;
+        out = std::string_view(start, p - start);
+        p++;
+        return true;
+    }
+    // Any scalar that isn't a string: number, true, false, null
+    bool bare(std::string_view &out) {
+        skip_ws();
+        const char *start = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\r' && *p != '\n')
+            p++;
+        out = std::string_view(start, p - start);
+        return p > start;
+    }
+};
+
+// Numbers are short and bounded by the payload; copy into a small stack
+// buffer so strtod can't run past the end of a non-terminated view.
+double to_double(std::string_view s) {
+    char buffer[32];
+    size_t n = s.size() < sizeof(buffer) - 1 ? s.size() : sizeof(buffer) - 1;
+    memcpy(buffer, s.data(), n);
+    buffer[n] = 0;
+    return strtod(buffer, nullptr);
+}
+
+// The extended topic quotes its booleans as "0"/"1", the basic one uses true/false
+bool to_bool(std::string_view s) {
+    return s == "true" || s == "1";
+}
+
+} // namespace
+
+bool parse_reading(std::string_view payload, reading_row &row) {
+    cursor c = {payload.data(), payload.data() + payload.size()};
+    row.value = 0;
+    row.display_value = 0;
+    row.unit = UT61E_UNIT_NONE;
+    row.mode = UT61E_MODE_UNKNOWN;
+    row.flags = 0;
+
+    if (!c.take('{'))
+        return false;
+    bool have_value = false, have_display = false, negative = false;
+    double abs_value = 0;
+    while (true) {
+        std::string_view key, v;
+        if (!c.string(key))
+            break;
+        if (!c.take(':'))
+            return false;
+        c.skip_ws();
+        bool quoted = c.p < c.end && *c.p == '"';
+        if (quoted ? !c.string(v) : !c.bare(v))
+            return false;
+
+        switch (key.size() ? key[0] : 0) {
+            case 'v':
+                if (key == "value") {
+                    row.value = to_double(v);
+                    have_value = true;
+                }
+                break;
+            case 'd':
+                if (key == "display_value") {
+                    row.display_value = to_double(v);
+                    have_display = true;
+                }
+                break;
+            case 'a':
+                if (key == "absValue")
+                    abs_value = to_double(v);
+                break;
+            case 'u':
+                if (key == "unit") {
+                    row.unit = ut61e_unit_code(v.data(), v.size());
+                    // The basic topic reports the mode name under "unit"
+                    if (row.unit == UT61E_UNIT_NONE && row.mode == UT61E_MODE_UNKNOWN)
+                        row.mode = ut61e_mode_code(v.data(), v.size());
+                }
+                break;
+            case 'm':
+                if (key == "mode")
+                    row.mode = ut61e_mode_code(v.data(), v.size());
+                break;
+            case 'n':
+                if (key == "negative")
+                    negative = to_bool(v);
+                break;
+            case 'r':
+                if (key == "relative" && to_bool(v))
+                    row.flags |= UT61E_FLAG_RELATIVE;
+                else if (key == "range" && v == "auto")
+                    row.flags |= UT61E_FLAG_AUTO;
+                break;
+            case 'h':
+                if (key == "hold" && to_bool(v))
+                    row.flags |= UT61E_FLAG_HOLD;
+                break;
+            case 'b':
+                if (key == "battery_low" && to_bool(v))
+                    row.flags |= UT61E_FLAG_BATTERY_LOW;
+                break;
+            case 'o':
+                if (key == "operation") {
+                    if (v == "overload")
+                        row.flags |= UT61E_FLAG_OVERLOAD;
+                    else if (v == "underload")
+                        row.flags |= UT61E_FLAG_UNDERLOAD;
+                }
+                break;
+            case 'p':
+                if (key == "peak") {
+                    if (v == "max")
+                        row.flags |= UT61E_FLAG_PEAK_MAX;
+                    else if (v == "min")
+                        row.flags |= UT61E_FLAG_PEAK_MIN;
+                }
+                break;
+            case 'c':
+                if (key == "currentType") {
+                    if (v == "AC")
+                        row.flags |= UT61E_FLAG_AC;
+                    else if (v == "DC")
+                        row.flags |= UT61E_FLAG_DC;
+                }
+                break;
+        }
+        if (!c.take(','))
+            break;
+    }
+    if (!c.take('}') || !have_value)
+        return false;
+    if (negative)
+        row.flags |= UT61E_FLAG_NEGATIVE;
+    if (!have_display)
+        row.display_value = negative ? -abs_value : abs_value;
+    return true;
+}
+
+bool split_topic(std::string_view topic, std::string_view &device, std::string_view &base_id) {
+    size_t first = topic.find('/');
+    if (first == std::string_view::npos)
+        return false;
+    size_t second = topic.find('/', first + 1);
+    if (second == std::string_view::npos)
+        return false;
+    device = topic.substr(first + 1, second - first - 1);
+    // The id names a directory under the output root, so nothing that could
+    // climb out of it or be a bad file name gets through
+    if (device.empty() || device.size() > 32)
+        return false;
+    for (char ch: device) {
+        if (!isalnum((unsigned char)ch) && ch != '_' && ch != '-')
+            return false;
+    }
+    base_id = device;
+    if (base_id.size() > 2 && base_id.substr(base_id.size() - 2) == "_x")
+        base_id.remove_suffix(2);
+    return true;
+}
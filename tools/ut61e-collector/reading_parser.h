@@ -0,0 +1,37 @@
+/*
+ * reading_parser.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Zero-copy parser for the flat JSON objects published on tele/<id>/JSON and
+ * tele/<id>_x/JSON. Keys and string values are compared in place in the
+ * payload; nothing is allocated or copied.
+ */
+
+#ifndef READING_PARSER_H_
+#define READING_PARSER_H_
+
+#include <cstdint>
+#include <string_view>
+
+struct reading_row {
+	int64_t time_ns;       // Receive time, ns since the Unix epoch
+	double value;          // Base units
+	double display_value;  // As on the LCD, including sign
+	uint8_t unit;          // ut61e_unit_t
+	uint8_t mode;          // ut61e_mode_t
+	uint16_t flags;        // UT61E_FLAG_*
+};
+
+// Parse one message payload. Unknown keys are skipped; returns false if the
+// payload isn't a JSON object or carries no value at all.
+bool parse_reading(std::string_view payload, reading_row &row);
+
+// Split "tele/<id>/JSON" or "tele/<id>_x/JSON" into the device part ("<id>"
+// or "<id>_x") and the base id used to pick a worker. Returns false unless
+// the device part is 1 to 32 of [0-9A-Za-z_-].
+bool split_topic(std::string_view topic, std::string_view &device, std::string_view &base_id);
+
+#endif /* READING_PARSER_H_ */
@@ -0,0 +1,280 @@
+/*
+ * decode.cpp - ut61e-decode
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "decode.h"
+#include "capture.h"
+#include "ut61e_protocol.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+static char *append(char *p, const char *text) {
+    size_t n = strlen(text);
+    memcpy(p, text, n);
+    return p + n;
+}
+
+static char *format_u64(char *p, uint64_t v);
+
+// Everything after the timestamp, which is all that's left to redo while
+// the meter repeats itself. Built by hand: snprintf was most of the cost.
+static size_t format_body(char *out, const ut61e_reading_t &r, decode_format format) {
+    const char *unit = UT61E_UNIT_NAMES[ut61e_mode_unit(r.mode)];
+    const char *mode = UT61E_MODE_NAMES[r.mode < UT61E_MODE_COUNT ? r.mode : 0];
+    char *p = out;
+    bool json = format == FORMAT_JSONL;
+    p = append(p, json ? ",\"value\":" : ",");
+    p += ut61e_format_value(p, r.digits, r.exponent);
+    p = append(p, json ? ",\"unit\":\"" : ",");
+    p = append(p, unit);
+    p = append(p, json ? "\",\"mode\":\"" : ",");
+    p = append(p, mode);
+    p = append(p, json ? "\",\"range\":" : ",");
+    p = format_u64(p, r.range);
+    p = append(p, json ? ",\"flags\":" : ",");
+    p = format_u64(p, r.flags);
+    p = append(p, json ? "}\n" : "\n");
+    return p - out;
+}
+
+static char *format_u64(char *p, uint64_t v) {
+    char text[24];
+    int n = 0;
+    do {
+        text[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (n)
+        *p++ = text[--n];
+    return p;
+}
+
+namespace {
+
+struct chunk {
+    size_t start, end;           // Input byte range, cut after a LF
+    std::string output;
+    size_t used = 0;             // Bytes of output filled in
+    decode_stats stats;
+    bool done = false;
+};
+
+// Work shared by the workers and the writer
+struct job {
+    const uint8_t *data;
+    size_t size;
+    uint64_t first_index;
+    const decode_options &options;
+    std::vector<chunk> chunks;
+    // prefix[k]: packets before chunk k, -1 until known. Each worker counts
+    // its chunk, then waits for the previous chunk's count (a look-back scan).
+    std::unique_ptr<std::atomic<int64_t>[]> prefix;
+    std::atomic<size_t> next {0};
+    size_t written = 0;
+    size_t window;               // Chunks allowed in flight
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::string> spare;   // Written output buffers, to reuse
+
+    job(const uint8_t *d, size_t s, uint64_t f, const decode_options &o): data(d), size(s), first_index(f), options(o) { }
+};
+
+// Next LF in [p, end), or nullptr. Lines are 13 or 14 bytes, so a call to
+// memchr per line costs more than the search: look at 16 bytes at a time
+// as two words first. The lowest flagged byte of the usual zero-byte test
+// is always a real match.
+inline const uint8_t *next_lf(const uint8_t *p, const uint8_t *end) {
+    const uint64_t ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+    while (end - p >= 16) {
+        uint64_t a, b;
+        memcpy(&a, p, 8);
+        memcpy(&b, p + 8, 8);
+        a ^= ones * '\n';
+        b ^= ones * '\n';
+        uint64_t ma = (a - ones) & ~a & highs;
+        if (ma)
+            return p + (__builtin_ctzll(ma) >> 3);
+        uint64_t mb = (b - ones) & ~b & highs;
+        if (mb)
+            return p + 8 + (__builtin_ctzll(mb) >> 3);
+        p += 16;
+    }
+    return (const uint8_t *)memchr(p, '\n', end - p);
+}
+
+// First byte after the LF at or after offset - 1
+size_t boundary(const uint8_t *data, size_t size, size_t offset) {
+    if (offset == 0 || offset >= size)
+        return offset >= size ? size : 0;
+    const uint8_t *lf = (const uint8_t *)memchr(data + offset - 1, '\n', size - offset + 1);
+    return lf ? lf - data + 1 : size;
+}
+
+void decode_chunk(job &j, size_t k) {
+    chunk &c = j.chunks[k];
+    const uint8_t *data = j.data;
+    const uint8_t *end = data + c.end;
+
+    // Pass 1: count packets, so the next chunk can number its own
+    uint64_t count = 0;
+    for (const uint8_t *p = data + c.start; (p = next_lf(p, end)); p++)
+        if (packet_before_lf(data, p - data))
+            count++;
+    int64_t base;
+    while ((base = j.prefix[k].load(std::memory_order_acquire)) < 0)
+        std::this_thread::yield();
+    j.prefix[k + 1].store(base + count, std::memory_order_release);
+
+    // Pass 2: decode and format
+    UT61E_PROTOCOL_DECODER<ES51922> decoder;
+    decode_format format = j.options.format;
+    // Room for a typical line each; grown when a line might not fit
+    const size_t longest = 32 + 96;
+    size_t typical = format == FORMAT_BINARY ? sizeof(ut61e_reading_t) : format == FORMAT_JSONL ? 96 : 48;
+    {
+        // A recycled buffer: fresh ones cost a page fault every 4 kB
+        std::lock_guard<std::mutex> lock(j.mutex);
+        if (!j.spare.empty()) {
+            c.output.swap(j.spare.back());
+            j.spare.pop_back();
+        }
+    }
+    if (c.output.size() < count * typical + longest)
+        c.output.resize(count * typical + longest);
+    char *out = &c.output[0];
+    char *limit = out + c.output.size() - longest;
+    char body[96];
+    size_t body_length = 0;
+    ut61e_reading_t last = {};
+    bool have_body = false;
+    uint64_t index = j.first_index + base;
+    for (const uint8_t *p = data + c.start; (p = next_lf(p, end)); p++) {
+        const uint8_t *packet = packet_before_lf(data, p - data);
+        if (!packet)
+            continue;
+        uint64_t time_ms = index++ * j.options.interval_ms;
+        ut61e_reading_t r;
+        r.time_ms = (uint32_t)time_ms;
+        if (!decoder.decode(packet, r)) {
+            c.stats.rejected++;
+            continue;
+        }
+        c.stats.decoded++;
+        if (out > limit) {
+            size_t used = out - &c.output[0];
+            c.output.resize(c.output.size() * 2);
+            out = &c.output[0] + used;
+            limit = &c.output[0] + c.output.size() - longest;
+        }
+        if (format == FORMAT_BINARY) {
+            memcpy(out, &r, sizeof(r));
+            out += sizeof(r);
+            continue;
+        }
+        if (!have_body || !ut61e_same_reading(r, last)) {
+            body_length = format_body(body, r, format);
+            last = r;
+            have_body = true;
+        }
+        if (format == FORMAT_JSONL) {
+            memcpy(out, "{\"time_ms\":", 11);
+            out += 11;
+        }
+        out = format_u64(out, time_ms);
+        memcpy(out, body, body_length);
+        out += body_length;
+    }
+    c.used = out - &c.output[0];
+    c.stats.packets = count;
+    c.stats.memo_hits = decoder.hits;
+    c.stats.bytes_in = c.end - c.start;
+}
+
+void worker(job &j) {
+    for (;;) {
+        size_t k = j.next.fetch_add(1);
+        if (k >= j.chunks.size())
+            return;
+        {
+            // Don't run too far ahead of the writer
+            std::unique_lock<std::mutex> lock(j.mutex);
+            j.changed.wait(lock, [&] { return k < j.written + j.window; });
+        }
+        decode_chunk(j, k);
+        std::lock_guard<std::mutex> lock(j.mutex);
+        j.chunks[k].done = true;
+        j.changed.notify_all();
+    }
+}
+
+bool write_all(int fd, const char *data, size_t length) {
+    while (length) {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0)
+            return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+} // namespace
+
+bool decode_buffer(const uint8_t *data, size_t size, uint64_t first_index, int fd,
+                   const decode_options &options, decode_stats &stats) {
+    job j(data, size, first_index, options);
+    size_t chunk_size = std::max<size_t>(options.chunk_size, 4096);
+    for (size_t start = 0; start < size;) {
+        chunk c;
+        c.start = start;
+        c.end = boundary(data, size, std::min(size, start + chunk_size));
+        j.chunks.push_back(std::move(c));
+        start = j.chunks.back().end;
+    }
+    j.prefix.reset(new std::atomic<int64_t>[j.chunks.size() + 1]);
+    for (size_t k = 0; k <= j.chunks.size(); k++)
+        j.prefix[k] = k ? -1 : 0;
+    unsigned workers = options.workers ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+    j.window = 2 * workers;
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < workers; w++)
+        threads.emplace_back(worker, std::ref(j));
+
+    bool ok = true;
+    for (size_t k = 0; k < j.chunks.size(); k++) {
+        chunk &c = j.chunks[k];
+        {
+            std::unique_lock<std::mutex> lock(j.mutex);
+            j.changed.wait(lock, [&] { return c.done; });
+        }
+        if (ok && !write_all(fd, c.output.data(), c.used)) {
+            ok = false;
+            stats.write_errors++;
+        }
+        stats.bytes_in += c.stats.bytes_in;
+        stats.bytes_out += c.used;
+        stats.packets += c.stats.packets;
+        stats.decoded += c.stats.decoded;
+        stats.rejected += c.stats.rejected;
+        stats.memo_hits += c.stats.memo_hits;
+        std::lock_guard<std::mutex> lock(j.mutex);
+        j.spare.push_back(std::move(c.output));
+        j.written = k + 1;
+        j.changed.notify_all();
+    }
+    for (auto &t: threads)
+        t.join();
+    return ok;
+}
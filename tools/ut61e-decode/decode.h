@@ -0,0 +1,45 @@
+/*
+ * decode.h - ut61e-decode
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Parallel decoding of raw captures: the input is cut into chunks at line
+ * ends, workers decode chunks with the ES51922 protocol decoder and format
+ * them, and the output goes out in input order.
+ */
+
+#ifndef DECODE_H_
+#define DECODE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum decode_format { FORMAT_CSV, FORMAT_JSONL, FORMAT_BINARY };
+
+struct decode_options {
+	decode_format format = FORMAT_CSV;
+	unsigned workers = 0;             // 0 = one per core
+	size_t chunk_size = 8 << 20;      // Input bytes per work item
+	unsigned interval_ms = 500;       // Packet spacing, for time_ms
+};
+
+struct decode_stats {
+	uint64_t bytes_in = 0;
+	uint64_t bytes_out = 0;
+	uint64_t packets = 0;       // Lines long enough to hold a packet
+	uint64_t decoded = 0;
+	uint64_t rejected = 0;      // Garbled, or an unknown function code
+	uint64_t memo_hits = 0;     // Repeats of the previous packet
+	uint64_t write_errors = 0;
+};
+
+// Decode one capture held in memory and write the output to fd. Packet
+// numbering (and so time_ms) carries on from first_index; the number of
+// packets seen is added to stats.packets.
+bool decode_buffer(const uint8_t *data, size_t size, uint64_t first_index, int fd,
+                   const decode_options &options, decode_stats &stats);
+
+#endif /* DECODE_H_ */
@@ -0,0 +1,307 @@
+/*
+ * fleet.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ */
+
+#include "fleet.h"
+#include "mqtt_lite.h"
+#include "ut61e_display.h"
+#include "ut61e_framer.h"
+#include "ut61e_serializer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#define PING_PREFIX      "ut61e-fleet/"
+#define DRAIN_QUIET_MS   500     // Probe has drained once nothing arrived for this long
+#define DRAIN_MAX_MS     5000
+
+static int64_t now_us() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+struct device {
+    uint32_t id;
+    char raw_topic[32];
+    char hex_topic[32];
+    char json_topic[32];
+    char json_extended_topic[32];
+    char ping_topic[40];
+    mqtt_lite mqtt;
+    UT61E_FRAMER framer;
+    synthetic_meter meter;
+    size_t capture_position;
+    int64_t next_us;
+    int64_t next_ping_us;
+    uint32_t ping_seq = 0;
+
+    explicit device(uint32_t i):id(i),meter(i),capture_position(0),next_us(0),next_ping_us(0) {
+        snprintf(raw_topic, sizeof(raw_topic), "tele/%X/RAW", id);
+        snprintf(hex_topic, sizeof(hex_topic), "tele/%X/HEX", id);
+        snprintf(json_topic, sizeof(json_topic), "tele/%X/JSON", id);
+        snprintf(json_extended_topic, sizeof(json_extended_topic), "tele/%X_x/JSON", id);
+        snprintf(ping_topic, sizeof(ping_topic), PING_PREFIX "%X/PING", id);
+    }
+};
+
+// Counters a worker thread owns; summed after the run
+struct worker_stats {
+    uint64_t packets = 0;
+    uint64_t published = 0;
+    uint64_t send_errors = 0;
+    uint64_t late = 0;
+    uint64_t pings = 0;
+    unsigned connected = 0;
+};
+
+// Everything the firmware does with one meter packet, then publish it
+class publisher {
+    public:
+        publisher():json_basic(false),json_extended(true) {}
+
+        void send(device &d, const fleet_options &options, worker_stats &stats) {
+            uint8_t frame[UT61E_FRAMER::FRAME_SIZE];
+            if (options.capture && !options.capture->empty()) {
+                const packet_t &p = (*options.capture)[d.capture_position++ % options.capture->size()];
+                memcpy(frame, p.data(), p.size());
+                frame[12] = '\r';
+                frame[13] = '\n';
+            } else {
+                d.meter.next(frame);
+            }
+            // Byte at a time, exactly as rxTask feeds the framer
+            bool complete = false;
+            for (uint8_t c: frame)
+                complete = d.framer.push(c);
+            if (!complete)
+                return;
+            stats.packets++;
+            bool good = dmm.parse(d.framer.packet(), false);
+            publish(d, d.raw_topic, std::string_view(d.framer.packet(), UT61E_FRAMER::PACKET_SIZE), stats);
+            if (!good)
+                return;
+            char hex[2 * UT61E_FRAMER::PACKET_SIZE + 1];
+            for (uint8_t i = 0; i < UT61E_FRAMER::PACKET_SIZE; i++)
+                snprintf(hex + 2 * i, 3, "%02X", (uint8_t)d.framer.packet()[i]);
+            publish(d, d.hex_topic, std::string_view(hex, sizeof(hex) - 1), stats);
+            if (dmm.hold)
+                return;
+            size_t n = json_basic.write(dmm, buffer, sizeof(buffer));
+            publish(d, d.json_topic, std::string_view(buffer, std::min(n, sizeof(buffer) - 1)), stats);
+            n = json_extended.write(dmm, buffer, sizeof(buffer));
+            publish(d, d.json_extended_topic, std::string_view(buffer, std::min(n, sizeof(buffer) - 1)), stats);
+        }
+
+        void ping(device &d, worker_stats &stats) {
+            char payload[32];
+            int n = snprintf(payload, sizeof(payload), "%lld", (long long)now_us());
+            if (d.mqtt.publish(d.ping_topic, std::string_view(payload, n)))
+                stats.pings++;
+            else
+                stats.send_errors++;
+        }
+    private:
+        UT61E_DISP dmm;
+        UT61E_JSON_SERIALIZER json_basic;
+        UT61E_JSON_SERIALIZER json_extended;
+        char buffer[512];
+
+        void publish(device &d, const char *topic, std::string_view payload, worker_stats &stats) {
+            if (d.mqtt.publish(topic, payload))
+                stats.published++;
+            else
+                stats.send_errors++;
+        }
+};
+
+// Counts deliveries of the fleet's tele/ topics and times the pings
+class probe {
+    public:
+        probe(uint32_t base, unsigned count):delivered(0),base_id(base),devices(count),last_message_ms(0) {}
+
+        bool start(const fleet_options &options) {
+            if (!mqtt.connect(options.host.c_str(), options.port, "ut61e-fleet-probe", options.user, options.pass))
+                return false;
+            mqtt.on_message([this](std::string_view topic, std::string_view payload) { receive(topic, payload); });
+            return mqtt.subscribe("tele/#") && mqtt.subscribe(PING_PREFIX "+/PING");
+        }
+
+        void run(const std::atomic<bool> &running) {
+            while (running)
+                if (mqtt.poll(20) < 0)
+                    break;
+        }
+
+        // Keep receiving until the broker has nothing more for us
+        void drain() {
+            int64_t start = mqtt_codec::now_ms();
+            last_message_ms = start;
+            while (mqtt_codec::now_ms() - last_message_ms < DRAIN_QUIET_MS
+                   && mqtt_codec::now_ms() - start < DRAIN_MAX_MS)
+                if (mqtt.poll(20) < 0)
+                    break;
+        }
+
+        uint64_t delivered;
+        std::vector<uint32_t> latency_us;
+    private:
+        uint32_t base_id;
+        unsigned devices;
+        int64_t last_message_ms;
+        mqtt_lite mqtt;
+
+        bool ours(std::string_view id) {
+            char text[16];
+            size_t n = std::min(id.size(), sizeof(text) - 1);
+            memcpy(text, id.data(), n);
+            text[n] = 0;
+            uint32_t value = strtoul(text, nullptr, 16);
+            return value >= base_id && value - base_id < devices;
+        }
+
+        void receive(std::string_view topic, std::string_view payload) {
+            int64_t now = now_us();
+            last_message_ms = now / 1000;
+            if (topic.compare(0, sizeof(PING_PREFIX) - 1, PING_PREFIX) == 0) {
+                char text[32];
+                size_t n = std::min(payload.size(), sizeof(text) - 1);
+                memcpy(text, payload.data(), n);
+                text[n] = 0;
+                latency_us.push_back((uint32_t)std::max<int64_t>(0, now - strtoll(text, nullptr, 10)));
+                return;
+            }
+            // tele/<id>/... or tele/<id>_x/JSON
+            std::string_view id = topic.substr(5);
+            id = id.substr(0, id.find_first_of("_/"));
+            if (ours(id))
+                delivered++;
+        }
+};
+
+} // namespace
+
+bool run_fleet(const fleet_options &options, fleet_result &result) {
+    result = fleet_result();
+    result.devices = options.devices;
+    probe listener(options.base_id, options.devices);
+    if (!listener.start(options)) {
+        fprintf(stderr, "Probe can't connect to %s:%u\n", options.host.c_str(), options.port);
+        return false;
+    }
+    std::atomic<bool> probing(true);
+    std::thread probe_thread([&] { listener.run(probing); });
+
+    unsigned threads = std::max(1u, std::min(options.threads, options.devices));
+    std::vector<worker_stats> stats(threads);
+    std::atomic<unsigned> ready(0);
+    std::atomic<bool> go(false), running(true);
+    std::atomic<int64_t> start_us(0);
+    int64_t connect_start = now_us();
+
+    auto worker = [&](unsigned t) {
+        publisher pub;
+        worker_stats &s = stats[t];
+        std::vector<std::unique_ptr<device>> mine;
+        for (unsigned i = t; i < options.devices; i += threads) {
+            auto d = std::make_unique<device>(options.base_id + i);
+            char client_id[32];
+            snprintf(client_id, sizeof(client_id), "esp8266-%X", d->id);
+            if (d->mqtt.connect(options.host.c_str(), options.port, client_id, options.user, options.pass)) {
+                s.connected++;
+                mine.push_back(std::move(d));
+            }
+        }
+        ready++;
+        while (!go)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // Spread the devices evenly over one interval, as real meters would be
+        int64_t interval = options.interval_ms * 1000LL, ping = options.ping_ms * 1000LL;
+        for (size_t k = 0; k < mine.size(); k++) {
+            int64_t phase = interval * (int64_t)(k * threads + t) / options.devices;
+            mine[k]->next_us = start_us + phase;
+            mine[k]->next_ping_us = start_us + phase + ping;
+        }
+        int64_t last_keepalive = now_us();
+        while (running) {
+            int64_t now = now_us(), earliest = now + 5000;
+            for (auto &d: mine) {
+                if (now >= d->next_us) {
+                    pub.send(*d, options, s);
+                    d->next_us += interval;
+                    if (now - d->next_us > interval) {
+                        // More than an interval behind: count it and carry on from now
+                        s.late++;
+                        d->next_us = now + interval;
+                    }
+                }
+                if (ping && now >= d->next_ping_us) {
+                    pub.ping(*d, s);
+                    d->next_ping_us += ping;
+                    if (d->next_ping_us < now)
+                        d->next_ping_us = now + ping;
+                }
+                earliest = std::min(earliest, std::min(d->next_us, ping ? d->next_ping_us : d->next_us));
+            }
+            // Read PINGRESPs and send keep-alives about once a second
+            if (now - last_keepalive > 1000000) {
+                for (auto &d: mine)
+                    d->mqtt.poll(0);
+                last_keepalive = now;
+            }
+            int64_t wait = earliest - now_us();
+            if (wait > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(wait));
+        }
+        for (auto &d: mine)
+            d->mqtt.disconnect();
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++)
+        workers.emplace_back(worker, t);
+    while (ready < threads)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    result.connect_seconds = (now_us() - connect_start) / 1e6;
+    start_us = now_us();
+    go = true;
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    running = false;
+    for (auto &w: workers)
+        w.join();
+    result.seconds = (now_us() - start_us) / 1e6;
+
+    probing = false;
+    probe_thread.join();
+    listener.drain();
+
+    for (auto &s: stats) {
+        result.connected += s.connected;
+        result.packets += s.packets;
+        result.published += s.published;
+        result.send_errors += s.send_errors;
+        result.late += s.late;
+        result.pings += s.pings;
+    }
+    result.delivered = listener.delivered;
+    result.latency_us = std::move(listener.latency_us);
+    std::sort(result.latency_us.begin(), result.latency_us.end());
+    return true;
+}
+
+double latency_percentile(const fleet_result &result, double percentile) {
+    if (result.latency_us.empty())
+        return 0;
+    size_t i = (size_t)(percentile / 100.0 * (result.latency_us.size() - 1) + 0.5);
+    return result.latency_us[std::min(i, result.latency_us.size() - 1)] / 1000.0;
+}
@@ -0,0 +1,57 @@
+/*
+ * fleet.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Emulates a fleet of UT61E WiFi interfaces. Every device replays a meter
+ * stream byte by byte through the firmware's framer, decoder and
+ * serializers and publishes on its own tele/<id>/... topics at the meter's
+ * cadence, over its own MQTT connection. A probe connection counts what the
+ * broker delivers and times ping messages for round-trip latency.
+ */
+
+#ifndef FLEET_H_
+#define FLEET_H_
+
+#include "capture.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct fleet_options {
+	std::string host = "127.0.0.1";
+	uint16_t port = 1883;
+	const char *user = nullptr;
+	const char *pass = nullptr;
+	unsigned devices = 100;
+	unsigned threads = 1;
+	unsigned interval_ms = 500;     // Packet cadence of each meter
+	unsigned ping_ms = 1000;        // Latency probe cadence of each device
+	unsigned seconds = 10;          // Length of each measurement step
+	uint32_t base_id = 0xF00000;    // First device id
+	const std::vector<packet_t> *capture = nullptr;   // Replayed if not empty
+};
+
+struct fleet_result {
+	unsigned devices = 0;
+	unsigned connected = 0;
+	double connect_seconds = 0;
+	double seconds = 0;             // Measured publishing time
+	uint64_t packets = 0;           // Meter packets decoded and published
+	uint64_t published = 0;         // Messages handed to the broker
+	uint64_t delivered = 0;         // Of those, seen by the probe
+	uint64_t send_errors = 0;
+	uint64_t late = 0;              // Packets sent more than an interval late
+	uint64_t pings = 0;
+	std::vector<uint32_t> latency_us;   // Sorted ping round trips
+};
+
+// Run one measurement step with options.devices devices
+bool run_fleet(const fleet_options &options, fleet_result &result);
+// Latency percentile (0..100) in ms
+double latency_percentile(const fleet_result &result, double percentile);
+
+#endif /* FLEET_H_ */
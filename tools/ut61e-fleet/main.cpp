@@ -0,0 +1,148 @@
+/*
+ * main.cpp - ut61e-fleet
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Load generator for sizing brokers and collectors: emulates N UT61E WiFi
+ * interfaces publishing to one broker.
+ *
+ *   ut61e-fleet [-h host] [-p port] [-u user] [-P pass] [--standin]
+ *               [-n devices[,devices...]] [-w threads] [-i interval_ms]
+ *               [-d seconds] [--ping ms] [--base id] [capture files...]
+ *
+ * A comma separated -n runs one step per fleet size and prints a row each.
+ * --standin starts the in-process broker stand-in instead of using -h/-p.
+ */
+
+#include "fleet.h"
+#include "mqtt_standin.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+static void usage() {
+    fprintf(stderr,
+        "usage: ut61e-fleet [-h host] [-p port] [-u user] [-P pass] [--standin]\n"
+        "                   [-n devices[,devices...]] [-w threads] [-i interval_ms]\n"
+        "                   [-d seconds] [--ping ms] [--base id] [capture files...]\n");
+}
+
+// Every device is a socket, two with the stand-in in the same process
+static void raise_file_limit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char **argv) {
+    fleet_options options;
+    options.threads = std::thread::hardware_concurrency();
+    std::vector<unsigned> steps;
+    std::vector<std::string> files;
+    bool standin = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if (!strcmp(a, "--standin"))
+            standin = true;
+        else if (!strcmp(a, "-h") && has_arg)
+            options.host = argv[++i];
+        else if (!strcmp(a, "-p") && has_arg)
+            options.port = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "-u") && has_arg)
+            options.user = argv[++i];
+        else if (!strcmp(a, "-P") && has_arg)
+            options.pass = argv[++i];
+        else if (!strcmp(a, "-n") && has_arg) {
+            for (char *p = argv[++i]; *p; ) {
+                unsigned n = (unsigned)strtoul(p, &p, 10);
+                if (n)
+                    steps.push_back(n);
+                if (*p)
+                    p++;
+            }
+        }
+        else if (!strcmp(a, "-w") && has_arg)
+            options.threads = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "-i") && has_arg)
+            options.interval_ms = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "-d") && has_arg)
+            options.seconds = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "--ping") && has_arg)
+            options.ping_ms = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "--base") && has_arg)
+            options.base_id = strtoul(argv[++i], nullptr, 16);
+        else if (a[0] != '-')
+            files.push_back(a);
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (steps.empty())
+        steps.push_back(options.devices);
+    if (options.interval_ms == 0 || options.threads == 0) {
+        usage();
+        return 1;
+    }
+
+    std::vector<packet_t> capture;
+    for (auto &f: files)
+        if (!load_packets(f, capture))
+            fprintf(stderr, "Can't read %s\n", f.c_str());
+    options.capture = &capture;
+    raise_file_limit();
+
+    mqtt_standin broker;
+    if (standin) {
+        if (!broker.start()) {
+            fprintf(stderr, "Can't start broker stand-in\n");
+            return 1;
+        }
+        options.host = "127.0.0.1";
+        options.port = broker.port();
+    }
+    printf("Broker %s:%u%s, %u threads, %u ms cadence, %s\n", options.host.c_str(), options.port,
+           standin ? " (stand-in)" : "", options.threads, options.interval_ms,
+           capture.empty() ? "synthetic meters" : "replaying captures");
+    printf("%8s %9s %10s %10s %8s %8s %8s %8s %8s %9s %9s\n", "devices", "connect", "target/s",
+           "msg/s", "late%", "p50 ms", "p99 ms", "p99.9", "max ms", "dropped", "errors");
+
+    int status = 0;
+    for (unsigned n: steps) {
+        options.devices = n;
+        uint64_t broker_dropped = broker.messages_dropped;
+        fleet_result r;
+        if (!run_fleet(options, r))
+            return 1;
+        // RAW, HEX and both JSON topics for every packet
+        double target = 4.0 * n * 1000.0 / options.interval_ms;
+        uint64_t dropped = r.published > r.delivered ? r.published - r.delivered : 0;
+        printf("%8u %8.2fs %10.0f %10.0f %7.2f%% %8.2f %8.2f %8.2f %8.2f %9llu %9llu\n",
+               r.connected, r.connect_seconds, target, r.published / r.seconds,
+               r.packets ? 100.0 * r.late / r.packets : 0.0,
+               latency_percentile(r, 50), latency_percentile(r, 99), latency_percentile(r, 99.9),
+               latency_percentile(r, 100), (unsigned long long)dropped,
+               (unsigned long long)r.send_errors);
+        if (standin && broker.messages_dropped != broker_dropped)
+            printf("%8s broker stand-in dropped %llu messages to slow subscribers\n", "",
+                   (unsigned long long)(broker.messages_dropped - broker_dropped));
+        if (r.connected < n) {
+            fprintf(stderr, "Only %u of %u devices connected\n", r.connected, n);
+            status = 2;
+        }
+        fflush(stdout);
+    }
+    if (standin)
+        broker.stop();
+    return status;
+}
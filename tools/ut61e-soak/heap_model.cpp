@@ -0,0 +1,176 @@
+/*
+ * heap_model.cpp
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * The model follows umm_malloc as the ESP8266 core configures it: 8 byte
+ * blocks, a 4 byte header in the first block of each allocation, best fit,
+ * the remainder of a split block staying free, and neighbouring free blocks
+ * merged on free. Free space is kept as a sorted list of extents.
+ *
+ * Single threaded, like the firmware. The hooks must not allocate.
+ */
+
+#include "heap_model.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#define MAX_EXTENTS     8192
+#define NOT_MODELLED    0xffffffffu
+
+struct extent {
+    uint32_t start;     // Blocks
+    uint32_t length;
+};
+
+// In front of every real allocation, 16 bytes to keep the alignment
+struct allocation_header {
+    uint32_t block;     // Start in the model, or NOT_MODELLED
+    uint32_t blocks;
+    uint64_t size;
+};
+static_assert(sizeof(allocation_header) == 16, "header must keep max_align_t alignment");
+
+static heap_counts g_counts;
+static extent g_free[MAX_EXTENTS];
+static uint32_t g_extents = 0;
+static bool g_modelling = false;
+
+// umm_blocks(): the first block holds the header and 4 bytes of data
+static uint32_t blocks_for(size_t size) {
+    return size <= 4 ? 1 : 2 + (uint32_t)((size - 5) / 8);
+}
+
+static uint32_t model_alloc(uint32_t blocks) {
+    uint32_t best = g_extents;
+    for (uint32_t i = 0; i < g_extents; i++)
+        if (g_free[i].length >= blocks && (best == g_extents || g_free[i].length < g_free[best].length)) {
+            best = i;
+            if (g_free[i].length == blocks)
+                break;
+        }
+    if (best == g_extents)
+        return NOT_MODELLED;
+    uint32_t start = g_free[best].start;
+    if (g_free[best].length == blocks) {
+        memmove(g_free + best, g_free + best + 1, (g_extents - best - 1) * sizeof(extent));
+        g_extents--;
+    } else {
+        g_free[best].start += blocks;
+        g_free[best].length -= blocks;
+    }
+    return start;
+}
+
+static void model_free(uint32_t start, uint32_t blocks) {
+    // First extent after the freed blocks
+    uint32_t lo = 0, hi = g_extents;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (g_free[mid].start < start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    bool joins_before = lo > 0 && g_free[lo - 1].start + g_free[lo - 1].length == start;
+    bool joins_after = lo < g_extents && start + blocks == g_free[lo].start;
+    if (joins_before && joins_after) {
+        g_free[lo - 1].length += blocks + g_free[lo].length;
+        memmove(g_free + lo, g_free + lo + 1, (g_extents - lo - 1) * sizeof(extent));
+        g_extents--;
+    } else if (joins_before) {
+        g_free[lo - 1].length += blocks;
+    } else if (joins_after) {
+        g_free[lo].start = start;
+        g_free[lo].length += blocks;
+    } else if (g_extents < MAX_EXTENTS) {
+        memmove(g_free + lo + 1, g_free + lo, (g_extents - lo) * sizeof(extent));
+        g_free[lo] = {start, blocks};
+        g_extents++;
+    }
+    // With every extent slot taken the blocks are lost to the model; a heap
+    // that fragmented has failed long before
+}
+
+static void *hooked_new(size_t size) {
+    allocation_header *h = (allocation_header *)malloc(sizeof(allocation_header) + size);
+    if (!h)
+        throw std::bad_alloc();
+    h->size = size;
+    h->blocks = blocks_for(size);
+    h->block = NOT_MODELLED;
+    if (g_modelling) {
+        h->block = model_alloc(h->blocks);
+        if (h->block == NOT_MODELLED) {
+            g_counts.model_failures++;
+        } else {
+            g_counts.model_used += h->blocks * 8;
+            if (g_counts.model_used > g_counts.model_peak)
+                g_counts.model_peak = g_counts.model_used;
+        }
+    }
+    g_counts.allocations++;
+    g_counts.bytes += size;
+    g_counts.live++;
+    g_counts.live_bytes += size;
+    if (g_counts.live_bytes > g_counts.peak_live_bytes)
+        g_counts.peak_live_bytes = g_counts.live_bytes;
+    return h + 1;
+}
+
+static void hooked_delete(void *p) {
+    if (!p)
+        return;
+    allocation_header *h = (allocation_header *)p - 1;
+    if (h->block != NOT_MODELLED && g_modelling) {
+        model_free(h->block, h->blocks);
+        g_counts.model_used -= h->blocks * 8;
+    }
+    g_counts.frees++;
+    g_counts.live--;
+    g_counts.live_bytes -= h->size;
+    free(h);
+}
+
+void *operator new(size_t size) { return hooked_new(size); }
+void *operator new[](size_t size) { return hooked_new(size); }
+void operator delete(void *p) noexcept { hooked_delete(p); }
+void operator delete[](void *p) noexcept { hooked_delete(p); }
+void operator delete(void *p, size_t) noexcept { hooked_delete(p); }
+void operator delete[](void *p, size_t) noexcept { hooked_delete(p); }
+
+namespace heap_model {
+
+void start(size_t heap_bytes) {
+    g_free[0] = {0, (uint32_t)(heap_bytes / 8)};
+    g_extents = 1;
+    g_modelling = true;
+}
+
+const heap_counts &counts() {
+    return g_counts;
+}
+
+// As umm_info() works them out: fragmentation is
+// 100 - 100 * sqrt(sum of squared free extent sizes) / free blocks
+heap_layout layout() {
+    heap_layout l = {0, 0, 0, g_extents};
+    uint64_t free_blocks = 0, largest = 0;
+    double squares = 0;
+    for (uint32_t i = 0; i < g_extents; i++) {
+        free_blocks += g_free[i].length;
+        squares += (double)g_free[i].length * g_free[i].length;
+        if (g_free[i].length > largest)
+            largest = g_free[i].length;
+    }
+    l.free_bytes = (uint32_t)(free_blocks * 8);
+    l.largest_free = (uint32_t)(largest * 8);
+    l.fragmentation = free_blocks ? (uint8_t)(100 - sqrt(squares) * 100 / free_blocks) : 0;
+    return l;
+}
+
+} // namespace heap_model
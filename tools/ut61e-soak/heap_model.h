@@ -0,0 +1,49 @@
+/*
+ * heap_model.h
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Replaces the global operator new/delete: every allocation in the process
+ * is counted, and replayed on a model of the ESP8266's umm_malloc heap so
+ * the soak shows what weeks of allocations would do to the device's heap.
+ */
+
+#ifndef HEAP_MODEL_H_
+#define HEAP_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+struct heap_counts {
+	uint64_t allocations = 0;
+	uint64_t frees = 0;
+	uint64_t bytes = 0;             // Requested by all allocations
+	uint64_t live = 0;              // Allocations not yet freed
+	uint64_t live_bytes = 0;
+	uint64_t peak_live_bytes = 0;
+	uint64_t model_failures = 0;    // Allocations the modelled heap couldn't satisfy
+	uint32_t model_used = 0;        // Bytes of the modelled heap in use, headers included
+	uint32_t model_peak = 0;
+};
+
+// The modelled heap as ESP.getFreeHeap(), getMaxFreeBlockSize() and
+// getHeapFragmentation() would report it
+struct heap_layout {
+	uint32_t free_bytes;
+	uint32_t largest_free;
+	uint8_t fragmentation;          // umm_malloc's metric, 0..100
+	uint32_t free_extents;
+};
+
+namespace heap_model {
+	// Start modelling a heap of this many free bytes. Allocations made
+	// before this (static initialisation, setup) are outside it, like the
+	// ones the firmware makes before its free heap is measured.
+	void start(size_t heap_bytes);
+	const heap_counts &counts();
+	heap_layout layout();
+}
+
+#endif /* HEAP_MODEL_H_ */
@@ -0,0 +1,237 @@
+/*
+ * main.cpp - ut61e-soak
+ *
+ *  Created on: 2026-10-19
+ *         git: https://github.com/cabletie/UT61EWIFI
+ *      Author: CableTie
+ *
+ * Heap soak test: pushes replayed packets through the firmware's decode and
+ * publish path (framer, UT61E_DISP, filter, energy counter, measurement
+ * sessions, UDP feed encoder and every serializer) with allocation hooks, and reports allocations per
+ * packet, peak heap, leaks and the fragmentation the modelled ESP8266 heap
+ * ends up with.
+ *
+ *   ut61e-soak [-n packets] [-i interval_ms] [--heap bytes] [--sample packets]
+ *              [--no-memo] [capture files...]
+ *
+ * Capture files are replayed over and over until -n packets have gone
+ * through; without any the synthetic meter is used.
+ */
+
+#include "heap_model.h"
+#include "capture.h"
+#include "ut61e_display.h"
+#include "ut61e_energy.h"
+#include "ut61e_feed.h"
+#include "ut61e_filter.h"
+#include "ut61e_framer.h"
+#include "ut61e_serializer.h"
+#include "ut61e_session.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct soak_options {
+    uint64_t packets = 20000000;
+    unsigned interval_ms = 500;
+    size_t heap = 40000;            // Free heap of a D1 mini once connected
+    uint64_t sample = 10000;        // Look at the modelled heap this often
+    bool memoise = true;
+    std::vector<std::string> files;
+};
+
+// Allocations made by one part of the path
+struct stage_counts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t packets = 0;
+    void add(const heap_counts &before, const heap_counts &after) {
+        allocations += after.allocations - before.allocations;
+        bytes += after.bytes - before.bytes;
+        packets++;
+    }
+    void print(const char *label) const {
+        printf("  %-8s %10.2f allocations, %10.1f bytes per packet (%llu packets)\n", label,
+               packets ? (double)allocations / packets : 0.0, packets ? (double)bytes / packets : 0.0,
+               (unsigned long long)packets);
+    }
+};
+
+static void usage() {
+    fprintf(stderr,
+        "usage: ut61e-soak [-n packets] [-i interval_ms] [--heap bytes] [--sample packets]\n"
+        "                  [--no-memo] [capture files...]\n");
+}
+
+int main(int argc, char **argv) {
+    soak_options options;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if (!strcmp(a, "-n") && has_arg)
+            options.packets = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "-i") && has_arg)
+            options.interval_ms = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(a, "--heap") && has_arg)
+            options.heap = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "--sample") && has_arg)
+            options.sample = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "--no-memo"))
+            options.memoise = false;
+        else if (a[0] == '-') {
+            usage();
+            return 1;
+        } else
+            options.files.push_back(a);
+    }
+    if (!options.sample)
+        options.sample = 1;
+
+    // Frames to replay, CR LF included
+    std::vector<packet_t> replay;
+    for (auto &f: options.files)
+        if (!load_packets(f, replay))
+            fprintf(stderr, "Can't read %s\n", f.c_str());
+    if (!options.files.empty() && replay.empty()) {
+        fprintf(stderr, "No packets\n");
+        return 1;
+    }
+    synthetic_meter meter;
+
+    // The firmware's objects, set up as it would be
+    UT61E_DISP dmm;
+    dmm.memoise = options.memoise;
+    UT61E_FRAMER framer;
+    UT61E_FILTER filter;
+    uint8_t kinds[UT61E_MODE_COUNT], params[UT61E_MODE_COUNT];
+    memset(kinds, UT61E_FILTER_MEDIAN, sizeof(kinds));
+    memset(params, 5, sizeof(params));
+    filter.configure(kinds, params, 3, 10);
+    UT61E_ENERGY energy;
+    UT61E_SESSION session;
+    session.configure(10000);
+    UT61E_FEED_ENCODER feed(0xC0FFEE, 1);
+    UT61E_JSON_SERIALIZER json_basic(false);
+    UT61E_JSON_SERIALIZER json_extended(true);
+    UT61E_CSV_SERIALIZER csv;
+    UT61E_INFLUX_SERIALIZER influx("ut61e", "C0FFEE");
+    static char message[512];
+
+    heap_model::start(options.heap);
+    heap_counts warm;                     // After the first sample, for leaks
+    stage_counts decode, publish, hit, partial, miss, rejected;
+    heap_layout worst = heap_model::layout();
+    uint32_t max_extents = worst.free_extents;
+    uint64_t frames = 0;
+    uint64_t decile = options.packets / 10 ? options.packets / 10 : 1;
+    printf("%12s %12s %10s %10s %10s %6s\n", "packets", "live bytes", "allocs", "free", "largest", "frag");
+
+    auto start = std::chrono::steady_clock::now();
+    uint8_t frame[14];
+    for (uint64_t n = 0; n < options.packets; n++) {
+        if (replay.empty())
+            meter.next(frame);
+        else {
+            memcpy(frame, replay[n % replay.size()].data(), 12);
+            frame[12] = '\r';
+            frame[13] = '\n';
+        }
+        bool complete = false;
+        for (uint8_t b: frame)
+            complete |= framer.push(b);
+        if (!complete)
+            continue;
+        frames++;
+
+        heap_counts before = heap_model::counts();
+        uint32_t hits = dmm.memo_hits, partials = dmm.memo_partial;
+        bool good = dmm.parse(framer.frame(), false);
+        heap_counts parsed = heap_model::counts();
+        decode.add(before, parsed);
+        if (!good)
+            rejected.add(before, parsed);
+        else if (dmm.memo_hits != hits)
+            hit.add(before, parsed);
+        else if (dmm.memo_partial != partials)
+            partial.add(before, parsed);
+        else
+            miss.add(before, parsed);
+
+        if (good) {
+            dmm.reading.time_ms = (uint32_t)(n * options.interval_ms);
+            filter.update(dmm.reading);
+            energy.update(dmm.reading);
+            session.update(dmm.reading);
+            if (feed.add(dmm.reading)) {
+                feed.data();
+                feed.next();
+            }
+            json_basic.write(dmm, message, sizeof(message));
+            size_t length = json_extended.write(dmm, message, sizeof(message));
+            length = filter.append_json(message, length, sizeof(message));
+            UT61E_SESSION::append_json(message, length, sizeof(message), session.id());
+            influx.write(dmm, message, sizeof(message));
+            csv.write(dmm, message, sizeof(message));
+            if (n % 120 == 0)
+                energy.json(message, sizeof(message));
+            if (session.pending()) {
+                UT61E_SESSION::json(session.oldest(), message, sizeof(message));
+                session.pop();
+            }
+        }
+        publish.add(parsed, heap_model::counts());
+
+        if (n % options.sample == 0 || n + 1 == options.packets) {
+            heap_layout l = heap_model::layout();
+            if (l.free_bytes < worst.free_bytes)
+                worst.free_bytes = l.free_bytes;
+            if (l.largest_free < worst.largest_free)
+                worst.largest_free = l.largest_free;
+            if (l.fragmentation > worst.fragmentation)
+                worst.fragmentation = l.fragmentation;
+            if (l.free_extents > max_extents)
+                max_extents = l.free_extents;
+            if (n == 0)
+                warm = heap_model::counts();
+            if (n % decile == 0 || n + 1 == options.packets) {
+                const heap_counts &c = heap_model::counts();
+                printf("%12llu %12llu %10llu %10u %10u %5u%%\n", (unsigned long long)n + 1,
+                       (unsigned long long)c.live_bytes, (unsigned long long)c.live, l.free_bytes,
+                       l.largest_free, l.fragmentation);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const heap_counts &c = heap_model::counts();
+    heap_layout end = heap_model::layout();
+    printf("\n%llu packets, %llu frames in %.1f s: %.2f M packets/s, memo %s\n",
+           (unsigned long long)options.packets, (unsigned long long)frames, seconds,
+           options.packets / seconds / 1e6, options.memoise ? "on" : "off");
+    printf("allocations per packet:\n");
+    decode.print("decode");
+    hit.print("hit");
+    partial.print("partial");
+    miss.print("miss");
+    rejected.print("rejected");
+    publish.print("publish");
+    printf("heap: peak %llu bytes live, %llu allocations (%lld bytes) live at the end, "
+           "%+lld bytes since the first packet\n",
+           (unsigned long long)c.peak_live_bytes, (unsigned long long)c.live, (long long)c.live_bytes,
+           (long long)c.live_bytes - (long long)warm.live_bytes);
+    printf("modelled %zu byte heap: free %u (lowest %u between packets, %u at the peak), largest block %u "
+           "(lowest %u), fragmentation %u%% (highest %u%%), up to %u free extents, %llu failed allocations\n",
+           options.heap, end.free_bytes, worst.free_bytes, (unsigned)(options.heap - c.model_peak),
+           end.largest_free, worst.largest_free,
+           end.fragmentation, worst.fragmentation, max_extents, (unsigned long long)c.model_failures);
+
+    bool leak = c.live_bytes > warm.live_bytes;
+    if (leak)
+        printf("LEAK: live bytes grew over the run\n");
+    if (c.model_failures)
+        printf("OUT OF MEMORY on the modelled heap\n");
+    return leak || c.model_failures ? 2 : 0;
+}